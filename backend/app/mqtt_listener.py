@@ -7,9 +7,16 @@ MQTT 监听服务 — 订阅设备上报的测试报告，校验并入库。
 """
 
 import asyncio
+import base64
+import concurrent.futures
 import json
+import math
+import struct
 import logging
+import threading
+import time
 import uuid
+from collections import deque
 from datetime import datetime, timezone
 
 import paho.mqtt.client as mqtt
@@ -84,6 +91,381 @@ async def persist_report(payload: dict) -> uuid.UUID | None:
             return report_id
 
 
+# ═══════════════════════════════════════════════════════════════
+#  分块报告重组
+# ═══════════════════════════════════════════════════════════════
+
+CHUNK_TIMEOUT_S = 60.0          # 首块到达后多久仍未集齐即丢弃
+CHUNK_MAX_PENDING = 1024        # 同时重组中的报告数上限，超出时丢弃最旧的
+
+
+class ChunkAssembler:
+    """
+    重组设备端 ReportSerializer::write_chunked 拆出的分块报告。
+
+    分块报告的每条消息都是独立 JSON 对象，末尾带
+    "chunk": {"report_id": int, "seq": int, "last": bool}:
+
+    - 以 (device_id, report_id) 归并；seq 从 0 连续编号，last 为 true 的块 seq 最大；
+    - 各块的 results、anomaly_summary (可缺省) 分别按 seq 顺序拼接即完整数组；
+      has_anomaly / sdk_overhead 等其余字段取自最后一块；
+    - 块可乱序到达，重复的 seq (QoS1 重投，包括已重组完成之后才到的) 忽略；
+    - 首块到达后 CHUNK_TIMEOUT_S 内未集齐则整份丢弃 (设备端中途发布失败时会换用
+      新的 report_id 整份重发，旧的残块由此清理)。
+
+    只在 paho 网络线程上调用，不加锁。
+    """
+
+    def __init__(self, timeout_s: float = CHUNK_TIMEOUT_S, max_pending: int = CHUNK_MAX_PENDING):
+        self._timeout_s = timeout_s
+        self._max_pending = max_pending
+        # key -> {"started": float, "chunks": {seq: payload}, "count": int | None}
+        self._pending: dict[tuple[str, int], dict] = {}
+        self._done: deque[tuple[str, int]] = deque(maxlen=max_pending)
+        self._done_set: set[tuple[str, int]] = set()
+        self.completed = 0
+        self.expired = 0
+
+    def feed(self, payload: dict) -> dict | None:
+        """
+        送入一块。集齐时返回重组后的完整报告 (不含 chunk 字段)，否则返回 None。
+
+        Raises
+        ------
+        ValueError
+            chunk 字段格式非法。
+        """
+        chunk = payload.get("chunk")
+        if not isinstance(chunk, dict):
+            raise ValueError("chunk 须为对象")
+        report_id, seq, last = chunk.get("report_id"), chunk.get("seq"), chunk.get("last")
+        if not isinstance(report_id, int) or not isinstance(seq, int) or seq < 0 \
+                or not isinstance(last, bool):
+            raise ValueError(f"chunk 字段非法: {chunk}")
+        if not isinstance(payload.get("results"), list):
+            raise ValueError("分块的 results 须为数组")
+
+        now = time.monotonic()
+        self._expire(now)
+
+        key = (str(payload.get("device_id")), report_id)
+        if key in self._done_set:
+            return None
+        entry = self._pending.get(key)
+        if entry is None:
+            if len(self._pending) >= self._max_pending:
+                oldest = min(self._pending, key=lambda k: self._pending[k]["started"])
+                self._drop(oldest, "重组中的报告过多")
+            entry = {"started": now, "chunks": {}, "count": None}
+            self._pending[key] = entry
+
+        entry["chunks"].setdefault(seq, payload)
+        if last:
+            entry["count"] = seq + 1
+        count = entry["count"]
+        if count is None or len(entry["chunks"]) < count:
+            return None
+        if any(s >= count for s in entry["chunks"]):
+            self._drop(key, "seq 超出最后一块")
+            return None
+
+        del self._pending[key]
+        self.completed += 1
+        if len(self._done) == self._done.maxlen:
+            self._done_set.discard(self._done[0])
+        self._done.append(key)
+        self._done_set.add(key)
+        chunks = entry["chunks"]
+        report = {k: v for k, v in chunks[count - 1].items() if k != "chunk"}
+        report["results"] = [r for s in range(count) for r in chunks[s]["results"]]
+        report["anomaly_summary"] = [
+            a for s in range(count) for a in chunks[s].get("anomaly_summary", [])
+        ]
+        return report
+
+    @property
+    def pending(self) -> int:
+        return len(self._pending)
+
+    def _expire(self, now: float):
+        stale = [k for k, e in self._pending.items() if now - e["started"] > self._timeout_s]
+        for key in stale:
+            self._drop(key, "超时未集齐")
+
+    def _drop(self, key: tuple[str, int], reason: str):
+        entry = self._pending.pop(key)
+        self.expired += 1
+        logger.warning("⚠️  丢弃分块报告 device=%s report_id=%d — %s (已收 %d 块)",
+                       key[0], key[1], reason, len(entry["chunks"]))
+
+
+# ═══════════════════════════════════════════════════════════════
+#  飞行记录器突发 (<topic>/flight)
+# ═══════════════════════════════════════════════════════════════
+
+
+class _BitReader:
+    """高位在前的位读取器，与设备端 codec::BitReader 一致。"""
+
+    def __init__(self, data: bytes):
+        self._value = int.from_bytes(data, "big")
+        self._bits = len(data) * 8
+        self._pos = 0
+
+    def get(self, n: int) -> int:
+        if self._pos + n > self._bits:
+            raise ValueError("编码流提前结束")
+        self._pos += n
+        return (self._value >> (self._bits - self._pos)) & ((1 << n) - 1)
+
+
+def _decode_times(data: bytes, count: int) -> list[int]:
+    """解码二阶差分编码的整数 (codec::put_time)：时间戳 (毫秒) 或十进制定点指标。"""
+    r = _BitReader(data)
+    out: list[int] = []
+    prev = delta = 0
+    for i in range(count):
+        if i == 0:
+            prev = r.get(64)
+            if prev >= 1 << 63:
+                prev -= 1 << 64
+            out.append(prev)
+            continue
+        ones = 0
+        while ones < 4 and r.get(1) == 1:
+            ones += 1
+        width = (0, 7, 9, 12, 64)[ones]
+        dod = r.get(width) if width else 0
+        if width and dod >> (width - 1):
+            dod -= 1 << width
+        delta += dod
+        prev += delta
+        out.append(prev)
+    return out
+
+
+def _decode_values(data: bytes, count: int) -> list[float | None]:
+    """解码 XOR 编码的 double (codec::put_value)，NaN (本周期未采样) 记为 None。"""
+    r = _BitReader(data)
+    out: list[float | None] = []
+    prev = lead = trail = 0
+    window = False
+    for i in range(count):
+        if i == 0:
+            bits = r.get(64)
+        elif r.get(1) == 0:
+            bits = prev
+        else:
+            if r.get(1) == 1:
+                lead, length = r.get(5), r.get(6) or 64
+                if lead + length > 64:
+                    raise ValueError("非法的有效位窗口")
+                trail = 64 - lead - length
+                window = True
+            elif not window:
+                raise ValueError("缺少有效位窗口")
+            bits = prev ^ (r.get(64 - lead - trail) << trail)
+        prev = bits
+        v = struct.unpack(">d", bits.to_bytes(8, "big"))[0]
+        out.append(None if math.isnan(v) else v)
+    return out
+
+
+def decode_flight_record(record: dict) -> dict:
+    """
+    解码设备端 FlightRecorder::freeze() 生成的 flight_recorder 字段:
+    {"timestamps_ms": [...], "metrics": {name: [value | None, ...]}}。带 scale 的指标为
+    十进制定点 (整数 / scale)。格式不符时抛出 ValueError。
+    """
+    if record.get("encoding") != "gorilla":
+        raise ValueError(f"未知编码: {record.get('encoding')}")
+    count = record.get("samples")
+    if not isinstance(count, int) or count <= 0:
+        raise ValueError("samples 须为正整数")
+    try:
+        times = _decode_times(base64.b64decode(record["timestamps"], validate=True), count)
+        metrics = {}
+        for m in record["metrics"]:
+            data = base64.b64decode(m["values"], validate=True)
+            if "scale" in m:  # 十进制定点：整数按二阶差分编码
+                scale = int(m["scale"])
+                metrics[m["name"]] = [v / scale for v in _decode_times(data, count)]
+            else:
+                metrics[m["name"]] = _decode_values(data, count)
+    except (KeyError, TypeError) as e:
+        raise ValueError(f"字段缺失或非法: {e}") from e
+    return {"timestamps_ms": times, "metrics": metrics}
+
+
+async def attach_flight_record(payload: dict, decoded: dict) -> uuid.UUID | None:
+    """
+    把解码后的飞行记录并入触发它的报告 (同一设备、同一 timestamp 的最新一份)，
+    写入 report_data["flight_recorder"]。报告尚未入库或已被清理时返回 None。
+    """
+    async with async_session() as session:
+        async with session.begin():
+            result = await session.execute(
+                select(TestReport)
+                .where(TestReport.device_id == payload["device_id"])
+                .where(TestReport.report_data["timestamp"].astext == str(payload.get("timestamp")))
+                .order_by(TestReport.created_at.desc())
+                .limit(1)
+            )
+            report = result.scalar_one_or_none()
+            if report is None:
+                logger.warning("⚠️  飞行记录找不到对应报告 — device=%s timestamp=%s",
+                               payload["device_id"], payload.get("timestamp"))
+                return None
+            # 整体赋新 dict，JSONB 列才会被识别为已修改
+            report.report_data = {**report.report_data, "flight_recorder": decoded}
+            logger.info("🛩️  飞行记录已并入报告 — id=%s samples=%d",
+                        report.id, len(decoded["timestamps_ms"]))
+            return report.id
+
+
+# ═══════════════════════════════════════════════════════════════
+#  入库统计 (异常风暴压测时观察排队情况)
+# ═══════════════════════════════════════════════════════════════
+
+INGEST_STATS_INTERVAL_S = 10.0
+# 已提交到事件循环、尚未完成的入库任务上限；超出时 paho 线程等待最旧的任务完成 (反压)
+INGEST_MAX_BACKLOG = 4096
+
+
+class IngestStats:
+    """
+    入库链路计数与延迟。paho 网络线程与事件循环都会更新，内部加锁。
+
+    - backlog: 已提交到事件循环、尚未完成的任务数 (含排队未开始的与飞行记录)
+    - in_flight: 已开始、尚未完成入库 + 回调 (含 AI 分析) 的报告数
+    - handle: 入库 + 回调耗时；e2e: 设备时间戳到处理完成 (秒级精度)
+    """
+
+    def __init__(self, window: int = 4096):
+        self._lock = threading.Lock()
+        self._handle_ms: deque[float] = deque(maxlen=window)
+        self._e2e_ms: deque[float] = deque(maxlen=window)
+        self.received = 0
+        self.rejected = 0
+        self.persisted = 0
+        self.failed = 0
+        self.anomalous = 0
+        self.backlog = 0
+        self.max_backlog = 0
+        self.in_flight = 0
+        self.max_in_flight = 0
+        self._last_log = time.monotonic()
+
+    def on_received(self):
+        with self._lock:
+            self.received += 1
+
+    def on_rejected(self):
+        with self._lock:
+            self.rejected += 1
+
+    def on_submitted(self):
+        with self._lock:
+            self.backlog += 1
+            self.max_backlog = max(self.max_backlog, self.backlog)
+
+    def on_settled(self):
+        with self._lock:
+            self.backlog -= 1
+
+    def on_start(self, payload: dict):
+        with self._lock:
+            self.in_flight += 1
+            self.max_in_flight = max(self.max_in_flight, self.in_flight)
+            if payload.get("has_anomaly"):
+                self.anomalous += 1
+
+    def on_done(self, payload: dict, started: float, ok: bool):
+        now = time.monotonic()
+        e2e = _report_age_ms(payload)
+        with self._lock:
+            self.in_flight -= 1
+            if ok:
+                self.persisted += 1
+                self._handle_ms.append((now - started) * 1000.0)
+                if e2e is not None:
+                    self._e2e_ms.append(e2e)
+            else:
+                self.failed += 1
+
+    def snapshot(self) -> dict:
+        with self._lock:
+            return {
+                "received": self.received,
+                "rejected": self.rejected,
+                "persisted": self.persisted,
+                "failed": self.failed,
+                "anomalous": self.anomalous,
+                "backlog": self.backlog,
+                "max_backlog": self.max_backlog,
+                "in_flight": self.in_flight,
+                "max_in_flight": self.max_in_flight,
+                "handle_ms": _percentiles(self._handle_ms),
+                "e2e_ms": _percentiles(self._e2e_ms),
+            }
+
+    def maybe_log(self):
+        now = time.monotonic()
+        with self._lock:
+            if now - self._last_log < INGEST_STATS_INTERVAL_S:
+                return
+            self._last_log = now
+        s = self.snapshot()
+        logger.info(
+            "📊 入库统计 — 收到 %d 入库 %d 失败 %d 拒绝 %d 异常 %d 积压 %d (峰值 %d) "
+            "在途 %d (峰值 %d) 处理 p50/p99 %.0f/%.0f ms 端到端 p50/p99 %.0f/%.0f ms",
+            s["received"], s["persisted"], s["failed"], s["rejected"], s["anomalous"],
+            s["backlog"], s["max_backlog"], s["in_flight"], s["max_in_flight"],
+            s["handle_ms"]["p50"], s["handle_ms"]["p99"],
+            s["e2e_ms"]["p50"], s["e2e_ms"]["p99"],
+        )
+
+
+def _percentiles(samples) -> dict:
+    if not samples:
+        return {"p50": 0.0, "p99": 0.0, "max": 0.0}
+    ordered = sorted(samples)
+    n = len(ordered)
+    return {
+        "p50": ordered[n // 2],
+        "p99": ordered[min(n - 1, int(n * 0.99))],
+        "max": ordered[-1],
+    }
+
+
+def _report_age_ms(payload: dict) -> float | None:
+    ts = payload.get("timestamp")
+    if not isinstance(ts, str):
+        return None
+    try:
+        sent = datetime.fromisoformat(ts.replace("Z", "+00:00"))
+    except ValueError:
+        return None
+    if sent.tzinfo is None:
+        sent = sent.replace(tzinfo=timezone.utc)
+    return (datetime.now(timezone.utc) - sent).total_seconds() * 1000.0
+
+
+_ingest_stats = IngestStats()
+_chunk_assembler = ChunkAssembler()
+
+
+def get_ingest_stats() -> dict:
+    """返回入库统计快照 (计数、积压与在途数、处理与端到端延迟分位数、分块重组情况)。"""
+    snapshot = _ingest_stats.snapshot()
+    snapshot["chunked"] = {
+        "completed": _chunk_assembler.completed,
+        "expired": _chunk_assembler.expired,
+        "pending": _chunk_assembler.pending,
+    }
+    return snapshot
+
+
 # ═══════════════════════════════════════════════════════════════
 #  MQTT 回调
 # ═══════════════════════════════════════════════════════════════
@@ -110,43 +492,107 @@ def _on_message(client, userdata, msg):
     """收到消息后：校验 → 入库 → 触发回调。"""
     topic = msg.topic
     logger.info("📩 收到消息 — topic=%s size=%d", topic, len(msg.payload))
+    _ingest_stats.on_received()
+    _ingest_stats.maybe_log()
 
     try:
         payload = json.loads(msg.payload.decode("utf-8"))
     except (json.JSONDecodeError, UnicodeDecodeError) as e:
         logger.error("❌ JSON 解析失败: %s", e)
+        _ingest_stats.on_rejected()
+        return
+
+    if isinstance(payload, dict) and "flight_recorder" in payload:
+        try:
+            if not payload.get("device_id"):
+                raise ValueError("缺少 device_id")
+            decoded = decode_flight_record(payload["flight_recorder"])
+        except ValueError as e:
+            logger.error("❌ 飞行记录解码失败: %s", e)
+            _ingest_stats.on_rejected()
+            return
+        _run_on_loop(userdata, attach_flight_record(payload, decoded), "飞行记录入库")
         return
 
+    if isinstance(payload, dict) and "chunk" in payload:
+        try:
+            payload = _chunk_assembler.feed(payload)
+        except ValueError as e:
+            logger.error("❌ 分块校验失败: %s", e)
+            _ingest_stats.on_rejected()
+            return
+        if payload is None:
+            return  # 尚未集齐
+        logger.info("🧩 分块报告已重组 — device=%s results=%d",
+                    payload.get("device_id"), len(payload["results"]))
+
     is_valid, err = validate_report_payload(payload)
     if not is_valid:
         logger.error("❌ 报告校验失败: %s", err)
+        _ingest_stats.on_rejected()
         return
 
-    # 在事件循环中执行异步入库
+    _run_on_loop(userdata, _handle_report(payload), "入库")
+
+
+# 已提交、尚未完成的入库任务 (paho 线程提交，事件循环线程完成时移除)
+_pending: set[concurrent.futures.Future] = set()
+_pending_lock = threading.Lock()
+
+
+def _run_on_loop(userdata, coro, what: str):
+    """
+    在事件循环中执行异步入库。提交后立即返回，不阻塞 paho 网络线程；
+    积压达到 INGEST_MAX_BACKLOG 时才等待最旧的任务完成。
+    """
     loop = userdata.get("loop")
     if loop and loop.is_running():
-        future = asyncio.run_coroutine_threadsafe(
-            _handle_report(payload), loop
-        )
-        try:
-            future.result(timeout=30)
-        except Exception as e:
-            logger.error("❌ 入库失败: %s", e, exc_info=True)
+        with _pending_lock:
+            full = len(_pending) >= INGEST_MAX_BACKLOG
+            waiting = list(_pending) if full else []
+        if waiting:
+            logger.warning("⚠️ 入库积压 %d，等待事件循环追上", len(waiting))
+            concurrent.futures.wait(waiting, timeout=30,
+                                    return_when=concurrent.futures.FIRST_COMPLETED)
+
+        future = asyncio.run_coroutine_threadsafe(coro, loop)
+        with _pending_lock:
+            _pending.add(future)
+        _ingest_stats.on_submitted()
+
+        def _settled(f: concurrent.futures.Future):
+            with _pending_lock:
+                _pending.discard(f)
+            _ingest_stats.on_settled()
+            if f.cancelled():
+                logger.error("❌ %s已取消", what)
+            elif f.exception() is not None:
+                e = f.exception()
+                logger.error("❌ %s失败: %s", what, e, exc_info=(type(e), e, e.__traceback__))
+
+        future.add_done_callback(_settled)
     else:
         # 没有运行中的事件循环时，创建新的
-        asyncio.run(_handle_report(payload))
+        asyncio.run(coro)
 
 
 async def _handle_report(payload: dict):
-    report_id = await persist_report(payload)
-    if report_id:
-        for cb in _on_report_saved_callbacks:
-            try:
-                result = cb(report_id, payload)
-                if asyncio.iscoroutine(result):
-                    await result
-            except Exception as e:
-                logger.error("❌ 回调执行失败: %s", e, exc_info=True)
+    started = time.monotonic()
+    _ingest_stats.on_start(payload)
+    ok = False
+    try:
+        report_id = await persist_report(payload)
+        if report_id:
+            for cb in _on_report_saved_callbacks:
+                try:
+                    result = cb(report_id, payload)
+                    if asyncio.iscoroutine(result):
+                        await result
+                except Exception as e:
+                    logger.error("❌ 回调执行失败: %s", e, exc_info=True)
+        ok = report_id is not None
+    finally:
+        _ingest_stats.on_done(payload, started, ok)
 
 
 # ═══════════════════════════════════════════════════════════════
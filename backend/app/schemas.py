@@ -4,7 +4,7 @@ Pydantic v2 请求/响应 Schema — 用于 FastAPI 接口数据校验。
 
 import uuid
 from datetime import datetime
-from typing import Any
+from typing import Any, Literal
 
 from pydantic import BaseModel, Field
 
@@ -12,6 +12,26 @@ from pydantic import BaseModel, Field
 # ────────────────────────── Template ──────────────────────────
 
 
+class BandDefinition(BaseModel):
+    """波形指标的一个频带，带内能量 (均方值) 超过 threshold_max 即异常。"""
+
+    name: str = Field(..., examples=["bearing"], description="频带名称")
+    low_hz: float = Field(..., ge=0, examples=[3000.0], description="下边界 (Hz，含)")
+    high_hz: float = Field(..., gt=0, examples=[3300.0], description="上边界 (Hz，不含)")
+    threshold_max: float | None = Field(
+        None, examples=[0.005], description="带内能量上限 (单位²)"
+    )
+
+
+class QuantileDefinition(BaseModel):
+    """直方图指标的一个分位数阈值。"""
+
+    q: float = Field(..., gt=0, lt=1, examples=[0.99], description="分位点")
+    threshold_max: float | None = Field(
+        None, examples=[200.0], description="该分位数的上限"
+    )
+
+
 class MetricDefinition(BaseModel):
     """单个测试指标定义。"""
 
@@ -28,6 +48,72 @@ class MetricDefinition(BaseModel):
         examples=["NPU 核心温度，决定了 AI 视觉算法的算力释放"],
         description="指标的业务语义描述，告知 AI Agent 该指标的含义和影响",
     )
+    priority: Literal["normal", "low"] | None = Field(
+        None,
+        examples=["low"],
+        description="采集优先级；设备端超出自身开销预算时优先丢弃 low 指标",
+    )
+    type: Literal["scalar", "waveform", "vector", "histogram"] | None = Field(
+        None,
+        examples=["waveform"],
+        description=(
+            "指标类型；waveform 在设备端对高频采样做 FFT，只上报 RMS、峰值、峰值因数与频带能量；"
+            "vector 为定长数组 (如各核使用率)，阈值逐元素比较；"
+            "histogram 上报桶计数与分位数估计，threshold_max/min 作用于中位数"
+        ),
+    )
+    sample_rate_hz: int | None = Field(
+        None, gt=0, examples=[50000], description="waveform: 采样率 (Hz)"
+    )
+    block_size: int | None = Field(
+        None, ge=16, le=65536, examples=[1024], description="waveform: FFT 块长 (2 的幂)"
+    )
+    blocks: int | None = Field(
+        None, gt=0, le=4096, examples=[8], description="waveform: 每份报告汇总的块数"
+    )
+    peak_max: float | None = Field(None, description="waveform: 峰值上限")
+    crest_factor_max: float | None = Field(None, description="waveform: 峰值因数上限")
+    bands: list[BandDefinition] | None = Field(
+        None, max_length=64, description="waveform: 频带能量阈值"
+    )
+    length: int | None = Field(
+        None, ge=1, le=4096, examples=[8], description="vector: 元素个数"
+    )
+    labels: list[str] | None = Field(
+        None, max_length=4096, examples=[["cpu0", "cpu1"]], description="vector: 元素名称 (可选)"
+    )
+    buckets: list[float] | None = Field(
+        None,
+        min_length=1,
+        max_length=256,
+        examples=[[5, 10, 25, 50, 100, 250, 500]],
+        description="histogram: 各桶上界 (严格递增)，另有隐含的溢出桶",
+    )
+    quantiles: list[QuantileDefinition] | None = Field(
+        None, max_length=16, description="histogram: 分位数阈值"
+    )
+    expression: str | None = Field(
+        None,
+        max_length=4096,
+        examples=["mem_used / mem_total * 100"],
+        description=(
+            "派生指标表达式；设置后该指标不采集，由设备端每周期按表达式计算，"
+            "只能引用在其之前声明的指标，支持 + - * / 比较 && || ! 与 abs/sqrt/min/max/delta/rate"
+        ),
+    )
+
+
+class RuleDefinition(BaseModel):
+    """复合规则，条件为真时设备端在 anomaly_summary 中报告 "规则 <name> 触发"。"""
+
+    name: str = Field(..., min_length=1, examples=["hot_but_idle"], description="规则名称")
+    when: str = Field(
+        ...,
+        min_length=1,
+        max_length=4096,
+        examples=["cpu_temperature > 70 && cpu_usage < 10"],
+        description="条件表达式 (语法同派生指标)，须引用至少一个指标",
+    )
 
 
 class AnalysisConfig(BaseModel):
@@ -56,6 +142,9 @@ class SchemaDefinition(BaseModel):
     metrics: list[MetricDefinition] = Field(
         ..., min_length=1, description="至少包含一个测试指标"
     )
+    rules: list[RuleDefinition] | None = Field(
+        None, max_length=256, description="在设备端按采样频率求值的复合规则"
+    )
     analysis_config: AnalysisConfig | None = Field(
         None, description="AI 分析配置 — 自定义提示词、工作流和重点关注领域"
     )
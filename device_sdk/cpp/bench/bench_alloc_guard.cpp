@@ -0,0 +1,112 @@
+/*
+ * EdgeStelle — 定长内存模式校验: 稳态 step() 周期内不得有 SDK 自身的堆分配
+ *
+ * 替换进程的 malloc 族 (glibc) 或全局 operator new (其他 libc)，只统计被测线程；
+ * 落在 alloc::ThirdPartyScope 内的分配 (Paho / libcurl 内部) 单独计数，不判失败。
+ *
+ * 需可用的模板接口与 broker (发布失败会走错误路径并产生分配):
+ *   API_BASE_URL=http://localhost:8000 MQTT_BROKER_URI=tcp://localhost:1883 \
+ *       ./bench_alloc_guard <template_id> [cycles]
+ *
+ * 有 SDK 分配时返回 1，可直接接入 CI。
+ */
+
+#include "edgestelle_device.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local bool        g_armed = false;   // 只统计被测线程，忽略 Paho 后台线程
+std::atomic<size_t>      g_sdk_allocs{0};
+std::atomic<size_t>      g_third_party_allocs{0};
+std::atomic<size_t>      g_sdk_bytes{0};
+
+void count_alloc(size_t n) {
+    if (!g_armed) return;
+    if (edgestelle::alloc::third_party_depth > 0) {
+        g_third_party_allocs.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        g_sdk_allocs.fetch_add(1, std::memory_order_relaxed);
+        g_sdk_bytes.fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+// operator new 默认经 malloc 实现，钩住 malloc 族即可覆盖 C 与 C++ 两侧的分配
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+
+void* malloc(size_t n)            { count_alloc(n); return __libc_malloc(n); }
+void* calloc(size_t c, size_t n)  { count_alloc(c * n); return __libc_calloc(c, n); }
+void* realloc(void* p, size_t n)  { count_alloc(n); return __libc_realloc(p, n); }
+void* memalign(size_t a, size_t n) { count_alloc(n); return __libc_memalign(a, n); }
+void* aligned_alloc(size_t a, size_t n) { count_alloc(n); return __libc_memalign(a, n); }
+int posix_memalign(void** out, size_t a, size_t n) {
+    count_alloc(n);
+    *out = __libc_memalign(a, n);
+    return *out ? 0 : ENOMEM;
+}
+}
+#else
+static void* counted_new(size_t n) {
+    count_alloc(n);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    std::abort();
+}
+void* operator new(size_t n)   { return counted_new(n); }
+void* operator new[](size_t n) { return counted_new(n); }
+void operator delete(void* p) noexcept   { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept   { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+#endif
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "用法: %s <template_id> [cycles]\n", argv[0]);
+        return 2;
+    }
+    std::string template_id = argv[1];
+    int cycles = argc >= 3 ? std::atoi(argv[2]) : 200;
+    constexpr int kWarmup = 3;
+
+    edgestelle::DeviceConfig cfg;
+    if (const char* env = std::getenv("DEVICE_ID"))       cfg.device_id       = env;
+    if (const char* env = std::getenv("API_BASE_URL"))    cfg.api_base_url    = env;
+    if (const char* env = std::getenv("MQTT_BROKER_URI")) cfg.mqtt_broker_uri = env;
+    if (const char* env = std::getenv("BATCH_SIZE"))      cfg.batch_size      = std::atoi(env);
+    cfg.queue_depth = 16;
+
+    edgestelle::EdgeStelleDevice device(cfg);
+    auto ready = device.prepare(template_id);
+    if (!ready) {
+        std::fprintf(stderr, "prepare 失败: %s\n", ready.error().to_string().c_str());
+        return 2;
+    }
+
+    // 预热: 首个周期会初始化 stdio 缓冲、调节器基线与 MQTT 连接
+    for (int i = 0; i < kWarmup; ++i) device.step();
+
+    g_armed = true;
+    for (int i = 0; i < cycles; ++i) device.step();
+    g_armed = false;
+
+    size_t sdk = g_sdk_allocs.load();
+    std::printf("\n稳态 %d 个周期: SDK 分配 %zu 次 (%zu bytes)，第三方库分配 %zu 次\n",
+                cycles, sdk, g_sdk_bytes.load(), g_third_party_allocs.load());
+    if (sdk > 0) {
+        std::printf("❌ 稳态路径存在 SDK 堆分配\n");
+        return 1;
+    }
+    std::printf("✅ 稳态路径无 SDK 堆分配\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * EdgeStelle — 多 broker 分片与故障转移校验
+ *
+ *   ./bench_broker_failover [devices]
+ *
+ * 纯内存运行，broker 由假通道代替 (可随时上线 / 下线，统计连接与发布次数)，校验:
+ *   - HashRing：devices 个 device_id (默认 100000) 在 4 个 broker 上的分布；增加第 5 个
+ *     broker 时只有落到新 broker 上的设备迁移、迁移比例约 1/5；摘除一个 broker
+ *     (owner(key, up)) 时只有原本落在它上面的设备迁移，且与不含该 broker 的环一致；
+ *   - BasicFailoverChannel：首选 broker 下线后发布切到偏好顺序中的下一个、失败 broker 的
+ *     连接已断开；首选 broker 恢复、退避期过后由后台探测回切，备用 broker 的连接断开。
+ * 任一校验不通过时返回 1。
+ */
+
+#include "edgestelle_brokers.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+#include <map>
+#include <thread>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+
+namespace {
+
+struct FakeBroker {
+    bool     up        = true;
+    int      clients   = 0;   // 当前连着的客户端数
+    uint64_t published = 0;
+};
+
+std::map<std::string, FakeBroker> g_brokers;
+
+/**
+ * 与 MqttChannel 同接口的假通道：连接与发布立即完成，结果取决于 broker 是否在线。
+ */
+class FakeChannel {
+public:
+    FakeChannel(const DeviceConfig&, std::string uri, std::string) : uri_(std::move(uri)) {}
+    ~FakeChannel() { disconnect(); }
+
+    const std::string& uri() const { return uri_; }
+
+    bool connected()  const { return connected_; }
+    bool connecting() const { return pending_; }
+
+    Result<void> connect_async(detail::MqttCompletion* notify = nullptr) {
+        if (connected_ || pending_) return {};
+        pending_ = true;
+        if (notify) notify->done(broker().up ? Result<void>{} : Error{Errc::mqtt_connect, "refused"});
+        return {};
+    }
+
+    Result<void> wait_connected() {
+        if (!pending_) return connected_ ? Result<void>{} : Error{Errc::mqtt_connect, "not connected"};
+        pending_ = false;
+        if (!broker().up) return Error{Errc::mqtt_connect, "refused"};
+        connected_ = true;
+        ++broker().clients;
+        return {};
+    }
+
+    Result<void> publish(const std::string&, const std::string&, int) {
+        if (!connected_ || !broker().up) return Error{Errc::mqtt_publish, "connection lost"};
+        ++broker().published;
+        return {};
+    }
+
+    void disconnect() {
+        pending_ = false;
+        if (!connected_) return;
+        connected_ = false;
+        --broker().clients;
+    }
+
+private:
+    FakeBroker& broker() { return g_brokers[uri_]; }
+
+    std::string uri_;
+    bool        connected_ = false;
+    bool        pending_   = false;
+};
+
+std::vector<std::string> broker_uris(int n) {
+    std::vector<std::string> uris;
+    for (int i = 0; i < n; ++i) uris.push_back("tcp://broker-" + std::to_string(i) + ":1883");
+    return uris;
+}
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    std::printf("  %-44s %s\n", what, ok ? "通过" : "失败");
+    if (!ok) ++failures;
+}
+
+void ring_placement(size_t devices) {
+    std::vector<std::string> ids;
+    for (size_t d = 0; d < devices; ++d) ids.push_back("edge-" + std::to_string(d));
+
+    detail::HashRing four(broker_uris(4)), five(broker_uris(5));
+    std::vector<size_t> share(4, 0);
+    size_t moved = 0, moved_elsewhere = 0;
+    for (const auto& id : ids) {
+        size_t a = four.owner(id), b = five.owner(id);
+        ++share[a];
+        if (a != b) {
+            ++moved;
+            if (b != 4) ++moved_elsewhere;
+        }
+    }
+    std::printf("HashRing: %zu 台设备，4 个 broker 上的占比", devices);
+    for (size_t n : share) std::printf(" %.1f%%", 100.0 * static_cast<double>(n) / static_cast<double>(devices));
+    std::printf("\n  增加第 5 个 broker: 迁移 %.1f%% (理想 20%%)\n", 100.0 * static_cast<double>(moved) / static_cast<double>(devices));
+    check(moved_elsewhere == 0, "增加 broker 时只迁往新 broker");
+    check(moved > devices / 10 && moved < devices * 3 / 10, "迁移比例接近 1/5");
+
+    // 摘除 broker-2：与由其余 3 个 broker 构成的环一致，且只影响原本落在它上面的设备
+    auto uris = broker_uris(4);
+    std::vector<bool> up{true, true, false, true};
+    detail::HashRing three({uris[0], uris[1], uris[3]});
+    const size_t to_three[] = {0, 1, 2, 2};   // four 的节点编号 → three 的节点编号 (2 不用)
+    size_t removed_moved = 0, mismatched = 0, bystanders = 0;
+    for (const auto& id : ids) {
+        size_t a = four.owner(id), b = four.owner(id, up);
+        if (a != b) ++removed_moved;
+        if (a != 2 && a != b) ++bystanders;
+        if (to_three[b] != three.owner(id)) ++mismatched;
+    }
+    std::printf("  摘除 broker-2: 迁移 %.1f%%\n", 100.0 * static_cast<double>(removed_moved) / static_cast<double>(devices));
+    check(bystanders == 0, "摘除 broker 时其余设备不迁移");
+    check(mismatched == 0, "摘除后的归属与不含该 broker 的环一致");
+}
+
+void failover() {
+    auto uris = broker_uris(3);
+    for (const auto& u : uris) g_brokers[u] = FakeBroker{};
+
+    DeviceConfig cfg;
+    cfg.device_id    = "edge-failover";
+    cfg.mqtt_brokers = uris;
+    auto order = detail::HashRing(uris).preference(cfg.device_id);
+    const std::string& first  = uris[order[0]];
+    const std::string& second = uris[order[1]];
+
+    detail::BasicFailoverChannel<FakeChannel> ch(cfg);
+    ch.set_probe_interval(std::chrono::milliseconds(10));
+    std::printf("FailoverChannel: 偏好顺序 %s → %s → %s\n", first.c_str(), second.c_str(), uris[order[2]].c_str());
+
+    ch.connect_async();
+    check(ch.wait_connected() && ch.uri() == first, "连接首选 broker");
+    check(static_cast<bool>(ch.publish("t", "p", 1)) && g_brokers[first].published == 1, "发布到首选 broker");
+
+    g_brokers[first].up = false;
+    auto t = bench_clock::now();
+    bool sent = static_cast<bool>(ch.publish("t", "p", 1));
+    double switch_ms = ms_since(t);
+    check(sent && ch.uri() == second && g_brokers[second].published == 1, "首选下线后切到第二个 broker 并重发");
+    check(g_brokers[first].clients == 0, "失败 broker 的连接已断开");
+    std::printf("  切换并重发耗时 %.3f ms\n", switch_ms);
+
+    g_brokers[first].up = true;
+    // 失败 broker 首次退避 1 s，之后的发布触发后台探测，下一次发布时回切
+    std::this_thread::sleep_for(detail::BrokerHealth::kBackoffMin + std::chrono::milliseconds(50));
+    for (int i = 0; i < 3 && ch.uri() != first; ++i) ch.publish("t", "p", 1);
+    check(ch.uri() == first, "首选恢复后回切");
+    check(g_brokers[second].clients == 0 && g_brokers[first].clients == 1, "回切后只保留首选 broker 的连接");
+    check(static_cast<bool>(ch.publish("t", "p", 1)) && g_brokers[first].published >= 2, "回切后发布到首选 broker");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t devices = argc >= 2 ? static_cast<size_t>(std::atol(argv[1])) : 100000;
+
+    ring_placement(devices);
+    failover();
+
+    std::printf("%s\n", failures == 0 ? "全部通过" : "存在失败项");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+/*
+ * EdgeStelle — 设备舰队基准: 单线程协程执行器 vs 每设备一个线程
+ *
+ * 两种模式运行相同的循环 (拉取一次模板 → 每周期测试 + 发布 + 休眠)，
+ * 对比总耗时、CPU 时间、峰值 RSS、线程数与单周期 (测试 + 发布) 延迟:
+ *
+ *   API_BASE_URL=http://localhost:8000 MQTT_BROKER_URI=tcp://localhost:1883 \
+ *       ./bench_coro_fleet <coro|threads> <template_id> [devices] [cycles] [interval_ms]
+ *
+ * 每种模式单独运行一次进程，避免峰值 RSS 互相污染。SDK 日志被丢弃，结果写到原 stdout。
+ */
+
+#include "edgestelle_coro.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::print_summary;
+
+namespace {
+
+struct FleetStats {
+    std::vector<double> cycle_ms;
+    uint64_t            published = 0;
+    uint64_t            failed    = 0;
+};
+
+int current_threads() {
+    // /proc/self/status 的 "Threads:" 行
+    FILE* f = std::fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char line[256];
+    int n = 0;
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, "Threads:", 8) == 0) {
+            n = std::atoi(line + 8);
+            break;
+        }
+    }
+    std::fclose(f);
+    return n;
+}
+
+DeviceConfig device_config(const DeviceConfig& base, int i) {
+    DeviceConfig cfg = base;
+    cfg.device_id = "bench-" + std::to_string(i);
+    return cfg;
+}
+
+coro::Task<void> coro_device(coro::Executor& ex, coro::AsyncDevice& dev, std::string template_id,
+                             int cycles, std::chrono::milliseconds interval,
+                             std::chrono::milliseconds offset, FleetStats& stats) {
+    co_await ex.sleep_for(offset);   // 错开启动，避免所有设备同时发布
+    auto tmpl = co_await dev.fetch_template(template_id);
+    if (!tmpl) {
+        stats.failed += static_cast<uint64_t>(cycles);
+        co_return;
+    }
+    for (int i = 0; i < cycles; ++i) {
+        auto t = bench_clock::now();
+        auto sent = co_await dev.publish(dev.execute_test(tmpl.value()));
+        stats.cycle_ms.push_back(ms_since(t));
+        ++(sent ? stats.published : stats.failed);
+        co_await ex.sleep_for(interval);
+    }
+}
+
+void run_coro(const DeviceConfig& base, const std::string& template_id, int devices, int cycles,
+              std::chrono::milliseconds interval, FleetStats& stats) {
+    coro::Executor ex;
+    std::vector<std::unique_ptr<coro::AsyncDevice>> fleet;
+    fleet.reserve(static_cast<size_t>(devices));
+    for (int i = 0; i < devices; ++i) {
+        fleet.push_back(std::make_unique<coro::AsyncDevice>(ex, device_config(base, i)));
+        ex.spawn(coro_device(ex, *fleet.back(), template_id, cycles, interval,
+                             interval * i / devices, stats));
+    }
+    ex.run();
+}
+
+void run_threads(const DeviceConfig& base, const std::string& template_id, int devices, int cycles,
+                 std::chrono::milliseconds interval, FleetStats& stats) {
+    std::vector<FleetStats> per(static_cast<size_t>(devices));
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<size_t>(devices));
+    for (int i = 0; i < devices; ++i) {
+        threads.emplace_back([&, i] {
+            FleetStats& s = per[static_cast<size_t>(i)];
+            std::this_thread::sleep_for(interval * i / devices);
+            EdgeStelleDevice dev(device_config(base, i));
+            auto tmpl = dev.try_fetch_template(template_id);
+            if (!tmpl) {
+                s.failed += static_cast<uint64_t>(cycles);
+                return;
+            }
+            for (int c = 0; c < cycles; ++c) {
+                auto t = bench_clock::now();
+                auto report = dev.try_execute_test(tmpl.value());
+                auto sent = dev.try_publish_report(report.value());
+                s.cycle_ms.push_back(ms_since(t));
+                ++(sent ? s.published : s.failed);
+                std::this_thread::sleep_for(interval);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (auto& s : per) {
+        stats.cycle_ms.insert(stats.cycle_ms.end(), s.cycle_ms.begin(), s.cycle_ms.end());
+        stats.published += s.published;
+        stats.failed    += s.failed;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || (std::strcmp(argv[1], "coro") != 0 && std::strcmp(argv[1], "threads") != 0)) {
+        std::fprintf(stderr, "用法: %s <coro|threads> <template_id> [devices] [cycles] [interval_ms]\n",
+                     argv[0]);
+        return 1;
+    }
+    bool        use_coro    = std::strcmp(argv[1], "coro") == 0;
+    std::string template_id = argv[2];
+    int devices = argc >= 4 ? std::atoi(argv[3]) : 1000;
+    int cycles  = argc >= 5 ? std::atoi(argv[4]) : 10;
+    auto interval = std::chrono::milliseconds(argc >= 6 ? std::atoi(argv[5]) : 1000);
+
+    DeviceConfig base;
+    if (const char* env = std::getenv("API_BASE_URL"))    base.api_base_url    = env;
+    if (const char* env = std::getenv("MQTT_BROKER_URI")) base.mqtt_broker_uri = env;
+
+    // SDK 的逐周期日志写 stdout，基准期间丢弃
+    std::fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    if (!std::freopen("/dev/null", "w", stdout)) return 1;
+
+    // 后台采样线程数峰值 (自身计入，两种模式同样 +1)
+    std::atomic<bool> done{false};
+    std::atomic<int>  peak_threads{0};
+    std::thread sampler([&] {
+        while (!done) {
+            peak_threads = std::max(peak_threads.load(), current_threads());
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    });
+
+    FleetStats stats;
+    auto t0 = bench_clock::now();
+    if (use_coro) run_coro(base, template_id, devices, cycles, interval, stats);
+    else          run_threads(base, template_id, devices, cycles, interval, stats);
+    double wall_ms = ms_since(t0);
+
+    done = true;
+    sampler.join();
+
+    std::fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    double cpu_s = static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)
+                 + static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+
+    std::printf("模式 %s: %d 台设备 × %d 周期，周期 %lld ms\n", argv[1], devices, cycles,
+                static_cast<long long>(interval.count()));
+    std::printf("  总耗时        %10.1f ms\n", wall_ms);
+    std::printf("  已发布 / 失败 %10llu / %llu\n", static_cast<unsigned long long>(stats.published),
+                static_cast<unsigned long long>(stats.failed));
+    std::printf("  CPU 时间      %10.3f s  (%.1f us/报告)\n", cpu_s,
+                stats.published ? cpu_s * 1e6 / static_cast<double>(stats.published) : 0.0);
+    std::printf("  峰值 RSS      %10ld KiB\n", ru.ru_maxrss);
+    std::printf("  峰值线程数    %10d\n", peak_threads.load());
+    print_summary("  测试 + 发布", stats.cycle_ms);
+    return 0;
+}
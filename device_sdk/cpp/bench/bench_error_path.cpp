@@ -0,0 +1,123 @@
+/*
+ * EdgeStelle — 错误路径基准: 异常 vs Result，30% 网络失败率
+ *
+ *   ./bench_error_path [iterations] [good_url]
+ *
+ * 1) 纯 CPU 对比：模拟一次"网络调用"，30% 概率失败，分别以 throw/catch
+ *    与 Result 返回错误，统计单次调用的平均与 p99 耗时；
+ * 2) 给出 good_url 时，再以真实 HttpClient 交替请求 good_url 与一个被拒绝的
+ *    本地端口 (同样 30% 失败)，对比两种错误传递方式的端到端耗时。
+ *
+ * 以 -DEDGESTELLE_NO_EXCEPTIONS=ON 构建时只运行 Result 部分。
+ */
+
+#include "edgestelle_device.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::print_summary;
+
+namespace {
+
+constexpr double kFailureRate = 0.30;
+
+__attribute__((noinline)) Result<std::string> op_result(bool fail, int i) {
+    if (fail) return Error{Errc::http_transport, "HTTP GET failed: Couldn't connect to server"};
+    return std::string("ok-") + std::to_string(i);
+}
+
+#ifndef EDGESTELLE_NO_EXCEPTIONS
+__attribute__((noinline)) std::string op_throw(bool fail, int i) {
+    if (fail) throw std::runtime_error("HTTP GET failed: Couldn't connect to server");
+    return std::string("ok-") + std::to_string(i);
+}
+#endif
+
+std::vector<bool> failure_pattern(int n) {
+    std::mt19937 rng(42);
+    std::bernoulli_distribution fail(kFailureRate);
+    std::vector<bool> out(static_cast<size_t>(n));
+    for (int i = 0; i < n; ++i) out[static_cast<size_t>(i)] = fail(rng);
+    return out;
+}
+
+/**
+ * 每 kBatch 次调用计时一次，换算为单次耗时 (微秒) 以避开时钟读取开销。
+ */
+template <class Fn>
+std::vector<double> timed_batches(int iterations, Fn&& fn) {
+    constexpr int kBatch = 64;
+    std::vector<double> per_call_us;
+    for (int i = 0; i + kBatch <= iterations; i += kBatch) {
+        auto t = bench_clock::now();
+        for (int j = i; j < i + kBatch; ++j) fn(j);
+        per_call_us.push_back(ms_since(t) * 1000.0 / kBatch);
+    }
+    return per_call_us;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int iterations = argc >= 2 ? std::atoi(argv[1]) : 1000000;
+    auto pattern = failure_pattern(iterations);
+    size_t sink = 0;
+
+    std::printf("── 模拟调用，失败率 %.0f%% ──\n", kFailureRate * 100);
+
+    auto with_result = timed_batches(iterations, [&](int i) {
+        auto r = op_result(pattern[static_cast<size_t>(i)], i);
+        sink += r ? r.value().size() : r.error().message.size();
+    });
+    print_summary("Result<T>", with_result, "us");
+
+#ifndef EDGESTELLE_NO_EXCEPTIONS
+    auto with_throw = timed_batches(iterations, [&](int i) {
+        try {
+            sink += op_throw(pattern[static_cast<size_t>(i)], i).size();
+        } catch (const std::exception& e) {
+            sink += std::strlen(e.what());
+        }
+    });
+    print_summary("throw / catch", with_throw, "us");
+#endif
+
+    if (argc >= 3) {
+        std::string good_url = argv[2];
+        std::string bad_url  = "http://127.0.0.1:9/";   // discard 端口，通常拒绝连接
+        int http_iterations = std::min(iterations, 2000);
+        detail::HttpClient http;
+
+        std::vector<double> result_ms;
+        for (int i = 0; i < http_iterations; ++i) {
+            auto t = bench_clock::now();
+            auto r = http.get(pattern[static_cast<size_t>(i)] ? bad_url : good_url);
+            sink += r ? r.value().size() : 1;
+            result_ms.push_back(ms_since(t));
+        }
+        std::printf("── 真实 HTTP (%s / 拒绝连接) ──\n", good_url.c_str());
+        print_summary("HttpClient::get → Result", result_ms);
+
+#ifndef EDGESTELLE_NO_EXCEPTIONS
+        std::vector<double> throw_ms;
+        for (int i = 0; i < http_iterations; ++i) {
+            auto t = bench_clock::now();
+            try {
+                sink += detail::value_or_throw(
+                    http.get(pattern[static_cast<size_t>(i)] ? bad_url : good_url)).size();
+            } catch (const std::exception&) {
+                sink += 1;
+            }
+            throw_ms.push_back(ms_since(t));
+        }
+        print_summary("HttpClient::get → throw", throw_ms);
+#endif
+    }
+
+    std::printf("(sink=%zu)\n", sink);
+    return 0;
+}
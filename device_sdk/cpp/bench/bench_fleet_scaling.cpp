@@ -0,0 +1,126 @@
+/*
+ * EdgeStelle — 舰队核分区扩展性基准
+ *
+ *   ./bench_fleet_scaling [devices] [ticks] [max_partitions]
+ *
+ * 以 devices 台设备 (默认 20000) 快进 ticks 个周期 (默认 20，VirtualClock)，分区数从 1
+ * 倍增到 max_partitions (默认为可用 CPU 数)，输出扩展性报告:
+ *   partitions  墙钟耗时  报告/秒  加速比  并行效率  CPU 时间  捕获摘要
+ * 报告走捕获路径 (不连接 broker)，捕获流只做摘要不落盘；各分区数下的摘要应一致
+ * (分区不改变任何设备的数值)。模板在本地生成并经 TemplateRegistry 注册，无需网络。
+ */
+
+#include "edgestelle_fleet.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::TemplateHeader;
+using edgestelle::bench::make_template;
+
+namespace {
+
+// 捕获流的摘要：按 8 字节块乘加混合，只为比较各分区数下的输出是否一致
+struct DigestSink {
+    uint64_t h     = 0x9e3779b97f4a7c15ULL;
+    uint64_t bytes = 0;
+};
+
+ssize_t digest_write(void* cookie, const char* buf, size_t size) {
+    auto* d = static_cast<DigestSink*>(cookie);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, buf + i, 8);
+        d->h = (d->h ^ w) * 0x100000001b3ULL;
+    }
+    for (; i < size; ++i) d->h = (d->h ^ static_cast<unsigned char>(buf[i])) * 0x100000001b3ULL;
+    d->bytes += size;
+    return static_cast<ssize_t>(size);
+}
+
+double cpu_seconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t devices = argc >= 2 ? static_cast<size_t>(std::atol(argv[1])) : 20000;
+    int    ticks   = argc >= 3 ? std::atoi(argv[2]) : 20;
+    size_t cpus    = detail::allowed_cpus().size();
+    size_t max_p   = argc >= 4 ? static_cast<size_t>(std::atol(argv[3])) : cpus;
+
+    TemplateRegistry registry;
+    if (auto r = registry.publish("bench", make_template(16, 3, 95, TemplateHeader{bench::kTemplateId, "1"})); !r) {
+        std::fprintf(stderr, "%s\n", r.error().to_string().c_str());
+        return 1;
+    }
+
+    struct Row {
+        size_t     partitions;
+        double     ms;
+        double     cpu_s;
+        DigestSink digest;
+    };
+    std::vector<Row> rows;
+
+    // SDK 的逐 tick 日志写 stdout，基准期间丢弃
+    std::fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    if (!std::freopen("/dev/null", "w", stdout)) return 1;
+    for (size_t p = 1; p <= max_p; p = p * 2 > max_p && p < max_p ? max_p : p * 2) {
+        DeviceConfig cfg;
+        FleetConfig  fleet;
+        fleet.devices    = devices;
+        fleet.partitions = p;
+        fleet.seed       = 7;
+        FleetSimulator sim(cfg, fleet);
+        sim.set_template_registry(registry);
+        VirtualClock clock(1700000000);
+        sim.set_clock(clock);
+
+        DigestSink sink;
+        cookie_io_functions_t io{nullptr, digest_write, nullptr, nullptr};
+        std::FILE* capture = fopencookie(&sink, "w", io);
+        sim.set_capture(capture);
+
+        double cpu0 = cpu_seconds();
+        auto   t    = bench_clock::now();
+        auto   done = sim.run("bench", ticks);
+        std::fflush(capture);
+        double ms   = ms_since(t);
+        double cpu  = cpu_seconds() - cpu0;
+        std::fclose(capture);
+        if (!done) {
+            std::fprintf(stderr, "%s\n", done.error().to_string().c_str());
+            return 1;
+        }
+        rows.push_back(Row{sim.partitions(), ms, cpu, sink});
+        if (p == max_p) break;
+    }
+
+    std::fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    std::printf("%zu 台设备 × %d 个周期，16 个指标，可用 CPU %zu 个\n", devices, ticks, cpus);
+    std::printf("%10s %10s %12s %8s %8s %8s  %s\n", "partitions", "墙钟 ms", "报告/秒", "加速比", "效率",
+                "CPU s", "捕获摘要");
+    for (const auto& r : rows) {
+        double speedup = rows.front().ms / r.ms;
+        std::printf("%10zu %10.1f %12.0f %8.2f %7.0f%% %8.2f  %016llx (%llu 字节)\n", r.partitions, r.ms,
+                    static_cast<double>(devices) * ticks / (r.ms / 1e3), speedup,
+                    100.0 * speedup / static_cast<double>(r.partitions), r.cpu_s,
+                    static_cast<unsigned long long>(r.digest.h), static_cast<unsigned long long>(r.digest.bytes));
+    }
+    return 0;
+}
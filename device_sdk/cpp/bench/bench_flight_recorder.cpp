@@ -0,0 +1,101 @@
+/*
+ * EdgeStelle — 飞行记录器基准
+ *
+ *   ./bench_flight_recorder [metrics] [samples] [path]
+ *
+ * 以 metrics 个指标 (默认 64)、保留 samples 个周期 (默认 600) 的记录器，逐周期
+ * record() 模拟器输出，每 samples 个周期 freeze() 一次，报告:
+ *   - record() 每周期耗时 (稳态开销)；
+ *   - freeze() 压缩 + 序列化整个窗口的耗时；
+ *   - 突发消息长度与原始窗口 (时间戳 + 全部 double) 的压缩比。
+ * 数值分两组：模拟器原值 (尾数近似随机，XOR 压缩的最坏情形) 与保留两位小数的值
+ * (典型传感器分辨率，按十进制定点编码)。path 非空时映射到该文件，否则匿名映射。
+ * 纯计算，无需网络。
+ */
+
+#include "edgestelle_recorder.hpp"
+#include "edgestelle_sim.hpp"
+#include "bench_util.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::print_summary;
+using edgestelle::bench::make_template;
+
+namespace {
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int         metrics = argc >= 2 ? std::atoi(argv[1]) : 64;
+    size_t      samples = argc >= 3 ? static_cast<size_t>(std::atol(argv[2])) : 600;
+    std::string path    = argc >= 4 ? argv[3] : "";
+
+    auto compiled = compile_template(make_template(metrics));
+    if (!compiled) {
+        std::fprintf(stderr, "%s\n", compiled.error().to_string().c_str());
+        return 1;
+    }
+    std::vector<MetricDynamics> dynamics(static_cast<size_t>(metrics), MetricDynamics{50.0, 15.0, 0.0, 100.0, 0.9});
+    auto sim = CorrelatedSimulator::create(dynamics, {}, 1, 42);
+    if (!sim) {
+        std::fprintf(stderr, "%s\n", sim.error().to_string().c_str());
+        return 1;
+    }
+
+    size_t raw_bytes = samples * (sizeof(int64_t) + static_cast<size_t>(metrics) * sizeof(double));
+    std::printf("%d 个指标，保留 %zu 个周期 (原始窗口 %zu KiB)，%s\n", metrics, samples, raw_bytes / 1024,
+                path.empty() ? "匿名映射" : path.c_str());
+
+    for (double decimals : {0.0, 100.0}) {
+        auto rec = FlightRecorder::open(path, compiled.value(), samples, "bench-flight-001");
+        if (!rec) {
+            std::fprintf(stderr, "%s\n", rec.error().to_string().c_str());
+            return 1;
+        }
+        FlightRecorder& fr = rec.value();
+
+        Report report;
+        report.tmpl = compiled.value();
+        report.results.reserve(static_cast<size_t>(metrics));
+        std::snprintf(report.timestamp, sizeof(report.timestamp), "2026-01-01T00:00:00Z");
+
+        auto t_sim = Clock::time_point{} + std::chrono::seconds(1700000000);
+        std::vector<double> record_ns, freeze_us;
+        size_t burst_bytes = 0;
+        for (size_t c = 0; c < samples * 5; ++c) {
+            sim.value().step();
+            report.results.clear();
+            for (uint32_t m = 0; m < static_cast<uint32_t>(metrics); ++m) {
+                double v = sim.value().value(m, 0);
+                if (decimals > 0.0) v = std::round(v * decimals) / decimals;   // 如解析 "53.27" 所得
+                report.results.push_back(MetricResult{m, v});
+            }
+            t_sim += std::chrono::milliseconds(100);
+
+            auto t = bench_clock::now();
+            fr.record(t_sim, report);
+            record_ns.push_back(ms_since(t) * 1e6);
+
+            if ((c + 1) % samples == 0) {
+                t = bench_clock::now();
+                bool frozen = fr.freeze(report);
+                freeze_us.push_back(ms_since(t) * 1e3);
+                if (frozen) burst_bytes = fr.burst().size();
+                fr.release();
+            }
+        }
+
+        std::printf("%s:\n", decimals > 0.0 ? "保留两位小数" : "模拟器原值");
+        print_summary("  record()", record_ns, "ns");
+        print_summary("  freeze()", freeze_us, "us");
+        std::printf("  突发消息 %zu 字节 (Base64 后)，压缩比 %.2fx，每点 %.2f 字节\n", burst_bytes,
+                    static_cast<double>(raw_bytes) / static_cast<double>(burst_bytes),
+                    static_cast<double>(burst_bytes) / static_cast<double>(samples * static_cast<size_t>(metrics + 1)));
+    }
+    return 0;
+}
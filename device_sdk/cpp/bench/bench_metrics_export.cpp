@@ -0,0 +1,141 @@
+/*
+ * EdgeStelle — Prometheus 指标端点基准
+ *
+ *   ./bench_metrics_export [metrics] [seconds]
+ *
+ * 以 metrics 个标量指标 (默认 4096) 的模板:
+ *   1) 单线程: 快照发布 (采样线程侧) 与渲染 (抓取侧) 的耗时、渲染长度，以及渲染缓冲是否换址 (扩容)；
+ *   2) 并发: 端点监听 127.0.0.1 的临时端口，采样线程每 1 ms 发布一次快照，另一线程经
+ *      loopback 连续抓取 seconds 秒，对比无抓取时的发布耗时，并报告抓取次数与跳过的快照数。
+ * 只用 loopback，无需 broker。
+ */
+
+#include "edgestelle_exporter.hpp"
+#include "edgestelle_sim.hpp"
+#include "bench_util.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::print_summary;
+using edgestelle::bench::make_template;
+
+namespace {
+
+void fill(Report& report, uint32_t tick) {
+    const auto& metrics = report.tmpl->metrics;
+    report.results.clear();
+    report.anomalies.clear();
+    for (uint32_t i = 0; i < metrics.size(); ++i) {
+        double v = static_cast<double>(detail::mix32(tick * 0x9E3779B9U + i) % 10000) / 100.0;
+        report.results.push_back(MetricResult{i, v});
+        if (v > metrics[i].threshold_max) report.anomalies.push_back(Anomaly{i, AnomalyKind::above_max});
+    }
+}
+
+// 一次 HTTP 抓取，返回响应长度；失败返回 0
+size_t scrape(int port, std::string& response) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    response.clear();
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        const char req[] = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        ::send(fd, req, sizeof(req) - 1, MSG_NOSIGNAL);
+        char buf[16384];
+        for (ssize_t n; (n = ::recv(fd, buf, sizeof(buf), 0)) > 0;) response.append(buf, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    return response.size();
+}
+
+std::vector<double> sample_for(MetricsExporter& exporter, Report& report, int seconds) {
+    std::vector<double> us;
+    auto t0 = bench_clock::now();
+    for (uint32_t k = 0; ms_since(t0) < seconds * 1000.0; ++k) {
+        fill(report, k);
+        auto t = bench_clock::now();
+        exporter.publish(report, SdkStats{}, std::chrono::system_clock::now());
+        us.push_back(ms_since(t) * 1e3);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return us;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int metrics = argc >= 2 ? std::atoi(argv[1]) : 4096;
+    int seconds = argc >= 3 ? std::atoi(argv[2]) : 3;
+
+    auto compiled = compile_template(make_template(metrics, 4, 95));
+    if (!compiled) {
+        std::fprintf(stderr, "%s\n", compiled.error().to_string().c_str());
+        return 1;
+    }
+    Report report;
+    report.tmpl = compiled.value();
+    report.results.reserve(report.tmpl->metrics.size());
+    report.anomalies.reserve(report.tmpl->metrics.size() * 2);
+    MetricsExporter exporter(report.tmpl, "bench-export-001");
+
+    // ── 1) 单线程 ──
+    {
+        std::vector<double> publish_us, render_us;
+        size_t size = 0;
+        const char* buffer = nullptr;
+        bool moved = false;
+        for (uint32_t k = 0; k < 200; ++k) {
+            fill(report, k);
+            auto t = bench_clock::now();
+            exporter.publish(report, SdkStats{}, std::chrono::system_clock::now());
+            publish_us.push_back(ms_since(t) * 1e3);
+            t = bench_clock::now();
+            auto text = exporter.render();
+            render_us.push_back(ms_since(t) * 1e3);
+            size = text.size();
+            if (buffer && text.data() != buffer) moved = true;
+            buffer = text.data();
+        }
+        std::printf("%d 个指标，渲染 %zu 字节，渲染缓冲%s\n", metrics, size, moved ? "曾扩容" : "未扩容");
+        print_summary("  发布快照", publish_us, "us");
+        print_summary("  渲染", render_us, "us");
+    }
+
+    // ── 2) 并发 ──
+    auto baseline = sample_for(exporter, report, 1);
+    if (auto started = exporter.start("127.0.0.1", 0); !started) {
+        std::fprintf(stderr, "%s\n", started.error().to_string().c_str());
+        return 1;
+    }
+    std::atomic<bool> done{false};
+    size_t bad = 0;
+    std::vector<double> scrape_ms;
+    std::thread scraper([&] {
+        std::string response;
+        while (!done) {
+            auto t = bench_clock::now();
+            scrape(exporter.port(), response);
+            scrape_ms.push_back(ms_since(t));
+            if (response.rfind("HTTP/1.1 200", 0) != 0 || response.find("edgestelle_metric{") == std::string::npos) ++bad;
+        }
+    });
+    auto contended = sample_for(exporter, report, seconds);
+    done = true;
+    scraper.join();
+    exporter.stop();
+
+    print_summary("  发布快照 (无抓取)", baseline, "us");
+    print_summary("  发布快照 (连续抓取)", contended, "us");
+    print_summary("  抓取 (HTTP 往返)", scrape_ms);
+    std::printf("抓取 %llu 次，异常响应 %zu，跳过快照 %llu / %zu\n",
+                static_cast<unsigned long long>(exporter.scrapes()), bad,
+                static_cast<unsigned long long>(exporter.snapshots_skipped()), contended.size());
+    return bad == 0 ? 0 : 1;
+}
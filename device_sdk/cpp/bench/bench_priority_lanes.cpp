@@ -0,0 +1,130 @@
+/*
+ * EdgeStelle — 发布分道基准: 积压下的告警延迟
+ *
+ *   ./bench_priority_lanes [link_kbps] [routine_kbps]
+ *
+ * 在 link_kbps (默认 256 KiB/s) 的上行链路上积压 N 份常规报告后产生一份越界报告，
+ * 以虚拟时间计算该报告发出的时刻 (time-to-alert):
+ *   - FIFO:  单个 ReportQueue，按入队顺序发送；
+ *   - 分道:  LanedReportQueue，alert 道先发，routine 道按 routine_kbps 令牌桶整形。
+ * 同时报告分道下清空积压所需的时间。载荷经 ReportSerializer 实际序列化，纯计算，无需网络。
+ */
+
+#include "edgestelle_lanes.hpp"
+#include "edgestelle_sim.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+
+using namespace edgestelle;
+using edgestelle::bench::make_template;
+
+namespace {
+
+using vclock = detail::TokenBucket::clock;
+
+void fill(Report& report, uint32_t tick, bool anomalous) {
+    const auto& metrics = report.tmpl->metrics;
+    report.results.clear();
+    report.anomalies.clear();
+    for (uint32_t i = 0; i < metrics.size(); ++i) {
+        double v = static_cast<double>(detail::mix32(tick * 0x9E3779B9U + i) % 9000) / 100.0;
+        report.results.push_back(MetricResult{i, v});
+    }
+    if (anomalous) {
+        report.results[0].value = 99.0;
+        report.anomalies.push_back(Anomaly{0, AnomalyKind::above_max});
+    }
+    std::snprintf(report.timestamp, sizeof(report.timestamp), "2026-01-01T00:00:00Z");
+}
+
+/**
+ * 以虚拟时间模拟上行链路：每发一份报告，时间前进 载荷长度 / 链路速率。
+ */
+struct Link {
+    double      bytes_per_s;
+    double      t_s = 0.0;
+    std::string payload;
+
+    void send(const Report& report) {
+        ReportSerializer::write(report, "bench-lanes-001", payload);
+        t_s += static_cast<double>(payload.size()) / bytes_per_s;
+    }
+
+    vclock::time_point now(vclock::time_point t0) const {
+        return t0 + std::chrono::duration_cast<vclock::duration>(std::chrono::duration<double>(t_s));
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    double link_bps    = (argc >= 2 ? std::atof(argv[1]) : 256.0) * 1024.0;
+    double routine_bps = (argc >= 3 ? std::atof(argv[2]) : 128.0) * 1024.0;
+
+    auto compiled = compile_template(make_template(64, 3, 95));
+    if (!compiled) {
+        std::fprintf(stderr, "%s\n", compiled.error().to_string().c_str());
+        return 1;
+    }
+    const CompiledTemplate& tmpl = *compiled.value();
+
+    std::printf("链路 %.0f KiB/s，routine 道整形 %.0f KiB/s\n", link_bps / 1024.0, routine_bps / 1024.0);
+    std::printf("%8s  %16s  %16s  %16s\n", "积压", "FIFO 告警 (ms)", "分道告警 (ms)", "分道清空积压 (s)");
+
+    for (size_t backlog : {size_t{0}, size_t{10}, size_t{100}, size_t{1000}, size_t{5000}}) {
+        // ── FIFO ──
+        double fifo_ms = 0.0;
+        {
+            ReportQueue q;
+            q.reset(backlog + 1, tmpl, 0);
+            for (size_t i = 0; i <= backlog; ++i) {
+                Report& r = q.push();
+                r.tmpl = compiled.value();
+                fill(r, static_cast<uint32_t>(i), i == backlog);
+            }
+            Link link{link_bps, 0.0, {}};
+            while (!q.empty()) {
+                bool alert = q.front().has_anomaly();
+                link.send(q.front());
+                q.pop();
+                if (alert) fifo_ms = link.t_s * 1e3;
+            }
+        }
+
+        // ── 分道 ──
+        double lanes_ms = 0.0, drain_s = 0.0;
+        {
+            LanedReportQueue q;
+            q.reset(8, backlog + 1, tmpl, 0);
+            for (size_t i = 0; i <= backlog; ++i) {
+                Report& r = q.staging();
+                r.tmpl = compiled.value();
+                fill(r, static_cast<uint32_t>(i), i == backlog);
+                q.commit();
+            }
+            auto t0 = vclock::now();
+            detail::TokenBucket buckets[kLanes];
+            buckets[static_cast<size_t>(Lane::alert)].reset(LaneConfig{1, 0.0, 0}, t0);
+            buckets[static_cast<size_t>(Lane::routine)].reset(LaneConfig{0, routine_bps, 0}, t0);
+            Link link{link_bps, 0.0, {}};
+            // 与 EdgeStelleDevice::flush() 相同的次序：先清空 alert 道，再按令牌发 routine 道
+            while (!q.empty()) {
+                for (Lane lane : {Lane::alert, Lane::routine}) {
+                    auto& lq = q.lane(lane);
+                    auto& bucket = buckets[static_cast<size_t>(lane)];
+                    while (!lq.empty() && bucket.ready(link.now(t0))) {
+                        link.send(lq.front());
+                        bucket.consume(link.payload.size());
+                        if (lane == Lane::alert) lanes_ms = link.t_s * 1e3;
+                        lq.pop();
+                    }
+                }
+                if (!q.empty()) link.t_s += 0.01;   // 令牌用尽，等待下一周期
+            }
+            drain_s = link.t_s;
+        }
+        std::printf("%8zu  %16.1f  %16.1f  %16.2f\n", backlog, fifo_ms, lanes_ms, drain_s);
+    }
+    return 0;
+}
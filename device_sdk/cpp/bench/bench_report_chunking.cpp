@@ -0,0 +1,136 @@
+/*
+ * EdgeStelle — 超大报告分块写出基准
+ *
+ *   ./bench_report_chunking [metrics] [chunk_kb] [iterations]
+ *
+ * 以 metrics 个标量指标 (默认 100000) 的报告对比:
+ *   1) write(): 整份序列化到一个缓冲，报告耗时、载荷大小与缓冲峰值；
+ *   2) write_chunked(): 按 chunk_kb 分块，sink 只计数，报告耗时、块数、最大块长、超出块预算的
+ *      块数 (应为 0) 与缓冲峰值；
+ * 并按订阅端语义 (results / anomaly_summary 按 seq 拼接，其余字段取最后一块) 重组一次，
+ * 校验与整份输出一致。任一块超出预算或重组不一致时返回 1。
+ * 纯计算，无需网络。指标数超过默认的 EDGESTELLE_MAX_METRICS，本程序在包含 SDK 前调大该上限。
+ */
+
+#ifndef EDGESTELLE_MAX_METRICS
+#define EDGESTELLE_MAX_METRICS 1000000
+#endif
+
+#include "edgestelle_report.hpp"
+#include "edgestelle_sim.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::print_summary;
+using edgestelle::bench::make_template;
+
+namespace {
+
+void fill(Report& report, uint32_t tick) {
+    const auto& metrics = report.tmpl->metrics;
+    report.results.clear();
+    report.anomalies.clear();
+    for (uint32_t i = 0; i < metrics.size(); ++i) {
+        double v = static_cast<double>(detail::mix32(tick * 0x9E3779B9U + i) % 10000) / 100.0;
+        report.results.push_back(MetricResult{i, v});
+        if (v > metrics[i].threshold_max) report.anomalies.push_back(Anomaly{i, AnomalyKind::above_max});
+    }
+    std::snprintf(report.timestamp, sizeof(report.timestamp), "2026-01-01T00:00:00Z");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int    metrics = argc >= 2 ? std::atoi(argv[1]) : 100000;
+    size_t chunk   = (argc >= 3 ? static_cast<size_t>(std::atoi(argv[2])) : 128) << 10;
+    int    iters   = argc >= 4 ? std::atoi(argv[3]) : 20;
+    const std::string device_id = "bench-chunk-001";
+
+    auto compiled = compile_template(make_template(metrics, 6, 95));
+    if (!compiled) {
+        std::fprintf(stderr, "%s\n", compiled.error().to_string().c_str());
+        return 1;
+    }
+    Report report;
+    report.tmpl = compiled.value();
+    fill(report, 0);
+    std::printf("%d 个指标，%zu 个越界；块预算 %zu KiB，max_chunk_size %zu 字节\n", metrics,
+                report.anomalies.size(), chunk >> 10,
+                ReportSerializer::max_chunk_size(*report.tmpl, device_id, 0, chunk));
+
+    // ── 1) 整份 ──
+    std::string whole;
+    {
+        std::vector<double> ms;
+        for (int k = 0; k < iters; ++k) {
+            fill(report, static_cast<uint32_t>(k));
+            auto t = bench_clock::now();
+            ReportSerializer::write(report, device_id, whole);
+            ms.push_back(ms_since(t));
+        }
+        std::printf("write():         载荷 %zu 字节，缓冲峰值 %zu 字节\n", whole.size(), whole.capacity());
+        print_summary("  序列化", ms);
+    }
+
+    // ── 2) 分块 ──
+    {
+        std::string out;
+        std::vector<double> ms;
+        size_t chunks = 0, largest = 0, over = 0;
+        for (int k = 0; k < iters; ++k) {
+            fill(report, static_cast<uint32_t>(k));
+            chunks = 0;
+            over   = 0;
+            auto t = bench_clock::now();
+            auto r = ReportSerializer::write_chunked(report, device_id, static_cast<uint64_t>(k) + 1, chunk, out,
+                                                     [&](const std::string& c) -> Result<void> {
+                                                         ++chunks;
+                                                         largest = std::max(largest, c.size());
+                                                         over += c.size() > chunk ? 1 : 0;
+                                                         return {};
+                                                     });
+            ms.push_back(ms_since(t));
+            if (!r) return 1;
+        }
+        std::printf("write_chunked(): %zu 块，最大块 %zu 字节，超出块预算 %zu 块，缓冲峰值 %zu 字节 (整份的 %.1f%%)\n",
+                    chunks, largest, over, out.capacity(), 100.0 * static_cast<double>(out.capacity())
+                                                         / static_cast<double>(whole.capacity()));
+        print_summary("  序列化 + 分块", ms);
+        if (over > 0) return 1;
+    }
+
+    // ── 重组校验 (最后一轮的报告) ──
+    {
+        std::vector<std::string> parts;
+        std::string out;
+        ReportSerializer::write_chunked(report, device_id, 1, chunk, out, [&](const std::string& c) -> Result<void> {
+            parts.push_back(c);
+            return {};
+        });
+        nlohmann::json results = nlohmann::json::array();
+        nlohmann::json summary = nlohmann::json::array();
+        nlohmann::json last;
+        for (size_t s = 0; s < parts.size(); ++s) {
+            last = nlohmann::json::parse(parts[s]);
+            bool seq_ok = parts.size() == 1 || (last["chunk"]["seq"] == s && last["chunk"]["last"] == (s + 1 == parts.size()));
+            if (!seq_ok) {
+                std::printf("重组校验: 失败 (第 %zu 块的 seq / last 不符)\n", s);
+                return 1;
+            }
+            for (auto& r : last["results"]) results.push_back(std::move(r));
+            if (last.contains("anomaly_summary")) {
+                for (auto& a : last["anomaly_summary"]) summary.push_back(std::move(a));
+            }
+        }
+        last.erase("chunk");
+        last["results"]         = std::move(results);
+        last["anomaly_summary"] = std::move(summary);
+        bool same = last == nlohmann::json::parse(whole);
+        std::printf("重组校验: %s\n", same ? "通过" : "失败");
+        return same ? 0 : 1;
+    }
+}
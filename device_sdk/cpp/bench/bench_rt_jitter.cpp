@@ -0,0 +1,217 @@
+/*
+ * EdgeStelle — 采样线程实时调度的唤醒抖动基准
+ *
+ *   ./bench_rt_jitter [cycles] [period_us] [priority] [cpu] [load_threads] [query_threads]
+ *
+ * 以 PeriodicTimer 按 period_us (默认 1000) 的周期等待 cycles 次 (默认 2000)，每周期
+ * 写一遍 4 MiB 缓冲模拟采样处理，同时 load_threads 个线程 (默认为可用 CPU 数) 持续
+ * 空转制造调度竞争。依次在以下设置下运行:
+ *   - normal    默认调度，不绑核、不锁内存；
+ *   - realtime  RealtimeGuard：SCHED_FIFO priority (默认 50)、绑定 cpu (默认 0)、mlockall。
+ * query_threads (默认 1) 非 0 时再加两轮：每周期把 16 个指标写入本地时序库 (预先写入
+ * 1 小时 10 Hz 的数据)，同时 query_threads 个默认调度的线程持锁反复执行与 GET /query
+ * 相同的最近 1 小时原始点查询:
+ *   - rt+lock   采样线程持同一把锁直接 append() (查询线程被抢占时采样线程随之等待)；
+ *   - rt+feed   采样线程只放入 StoreFeed，由默认调度的写入线程每 10 ms 持锁取空。
+ * 输出唤醒延迟 p50 / p99 / p99.9 / max (us)、每周期处理耗时 p99 / max (us，含等锁)、
+ * 超出周期次数与缺页次数 (getrusage)。
+ * 缺少 CAP_SYS_NICE / CAP_IPC_LOCK 时 realtime 行标注未生效的步骤，数值与 normal 接近。
+ */
+
+#include "edgestelle_latency.hpp"
+#include "edgestelle_realtime.hpp"
+#include "edgestelle_sim.hpp"
+#include "edgestelle_tsdb.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include <sys/resource.h>
+
+using namespace edgestelle;
+using edgestelle::bench::make_template;
+
+namespace {
+
+constexpr int     kStoreMetrics = 16;
+constexpr int64_t kStoreT0      = 1700000000000LL;
+
+enum class Mode { normal, realtime, locked, feed };
+
+struct Faults {
+    long minor = 0;
+    long major = 0;
+};
+
+Faults thread_faults() {
+    rusage ru{};
+    getrusage(RUSAGE_THREAD, &ru);
+    return Faults{ru.ru_minflt, ru.ru_majflt};
+}
+
+/**
+ * 在 dir 中打开时序库并写入 1 小时 10 Hz 的数据，返回下一个可用时间戳。
+ */
+Result<TimeSeriesStore> open_store(const std::string& dir, const TemplatePtr& tmpl, int64_t& next_ms) {
+    DeviceConfig defaults;
+    auto store = TimeSeriesStore::open(dir, tmpl, defaults.store_tiers, defaults.store_segment_bytes);
+    if (!store) return store;
+    int64_t t = kStoreT0;
+    for (int i = 0; i < 36000; ++i, t += 100) {
+        for (uint32_t m = 0; m < kStoreMetrics; ++m) {
+            if (auto r = store.value().append(m, t, 50.0 + (i + static_cast<int>(m)) % 100 * 0.01); !r) {
+                return r.error();
+            }
+        }
+    }
+    next_ms = t;
+    return store;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int  cycles    = argc >= 2 ? std::atoi(argv[1]) : 2000;
+    long period_us = argc >= 3 ? std::atol(argv[2]) : 1000;
+    int  priority  = argc >= 4 ? std::atoi(argv[3]) : 50;
+    int  cpu       = argc >= 5 ? std::atoi(argv[4]) : 0;
+    int  load      = argc >= 6 ? std::atoi(argv[5]) : static_cast<int>(detail::allowed_cpus().size());
+    int  queriers  = argc >= 7 ? std::atoi(argv[6]) : 1;
+
+    auto compiled = compile_template(make_template(kStoreMetrics));
+    if (!compiled) {
+        std::fprintf(stderr, "%s\n", compiled.error().to_string().c_str());
+        return 1;
+    }
+    char tmp_dir[] = "/tmp/edgestelle-rt-XXXXXX";
+    if (queriers > 0 && !::mkdtemp(tmp_dir)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> spinners;
+    for (int i = 0; i < load; ++i) {
+        spinners.emplace_back([&] {
+            volatile uint64_t x = 0;
+            while (!stop) ++x;
+        });
+    }
+
+    std::printf("%d 个周期 × %ld us，%d 个负载线程，%d 个查询线程\n", cycles, period_us, load, queriers);
+    std::printf("%-9s %9s %9s %9s %9s %9s %9s %6s %8s %6s  %s\n", "mode", "p50 us", "p99 us", "p99.9 us",
+                "max us", "work p99", "work max", "超期", "minflt", "majflt", "生效");
+
+    std::vector<Mode> modes{Mode::normal, Mode::realtime};
+    if (queriers > 0) modes.insert(modes.end(), {Mode::locked, Mode::feed});
+    const char* names[] = {"normal", "realtime", "rt+lock", "rt+feed"};
+
+    for (Mode mode : modes) {
+        std::optional<TimeSeriesStore> store;
+        std::mutex                     store_mutex;
+        std::optional<StoreFeed>       feed;
+        int64_t                        next_ms = 0;
+        if (mode == Mode::locked || mode == Mode::feed) {
+            std::string dir = std::string(tmp_dir) + "/" + names[static_cast<int>(mode)];
+            auto opened = open_store(dir, compiled.value(), next_ms);
+            if (!opened) {
+                std::fprintf(stderr, "%s\n", opened.error().to_string().c_str());
+                return 1;
+            }
+            store.emplace(std::move(opened).value());
+            if (mode == Mode::feed) feed.emplace(static_cast<size_t>(kStoreMetrics) * 2000);
+        }
+
+        // 查询线程与写入线程在采样线程应用实时调度前创建，保持默认调度
+        std::atomic<bool> done{false};
+        std::atomic<uint64_t> queries{0};
+        std::vector<std::thread> helpers;
+        if (store) {
+            for (int q = 0; q < queriers; ++q) {
+                helpers.emplace_back([&] {
+                    std::string out;
+                    while (!done) {
+                        std::lock_guard<std::mutex> lock(store_mutex);
+                        store->query("metric=sensor_000&limit=100000", out);
+                        queries.fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+            }
+        }
+        if (feed) {
+            helpers.emplace_back([&] {
+                for (bool last = false; !last; ) {
+                    last = done;
+                    {
+                        std::lock_guard<std::mutex> lock(store_mutex);
+                        feed->drain([&](const StorePoint& p) { store->append(p.metric, p.t_ms, p.value); });
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+            });
+        }
+
+        std::thread sampler([&] {
+            RealtimeGuard guard;
+            std::string   note = "-";
+            if (mode != Mode::normal) {
+                RealtimeConfig cfg;
+                cfg.priority    = priority;
+                cfg.cpus        = {cpu};
+                cfg.lock_memory = true;
+                if (auto r = guard.apply(cfg); !r) std::fprintf(stderr, "%s\n", r.error().to_string().c_str());
+                note = std::string(guard.fifo() ? "fifo " : "") + (guard.pinned() ? "pin " : "") +
+                       (guard.locked() ? "mlock" : "");
+                if (note.empty()) note = "无";
+            }
+
+            std::vector<char> work(4 << 20);
+            Report            report;
+            report.tmpl = compiled.value();
+            for (uint32_t m = 0; m < kStoreMetrics; ++m) report.results.push_back(MetricResult{m, 50.0});
+            LatencyHistogram  wake, work_ms;
+            PeriodicTimer     timer;
+            Faults            before = thread_faults();
+            timer.start();
+            for (int i = 0; i < cycles; ++i) {
+                auto t = std::chrono::steady_clock::now();
+                std::memset(work.data(), i, work.size() / 16);
+                auto now = Clock::time_point(std::chrono::milliseconds(next_ms + i));
+                if (feed) {
+                    feed->push(now, report);
+                } else if (store) {
+                    std::lock_guard<std::mutex> lock(store_mutex);
+                    store->append(now, report);
+                }
+                work_ms.observe(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count());
+                if (auto late = timer.wait_next(std::chrono::microseconds(period_us), stop)) wake.observe(*late);
+            }
+            Faults after = thread_faults();
+            done = true;
+            if (store) {
+                char extra[96];
+                std::snprintf(extra, sizeof(extra), "；查询 %llu 次，丢弃 %llu 份",
+                              static_cast<unsigned long long>(queries.load()),
+                              static_cast<unsigned long long>(feed ? feed->dropped() : 0));
+                note += extra;
+            }
+            std::printf("%-9s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %6llu %8ld %6ld  %s\n",
+                        names[static_cast<int>(mode)], wake.quantile(0.5) * 1e3, wake.quantile(0.99) * 1e3,
+                        wake.quantile(0.999) * 1e3, wake.max() * 1e3, work_ms.quantile(0.99) * 1e3,
+                        work_ms.max() * 1e3, static_cast<unsigned long long>(timer.overruns()),
+                        after.minor - before.minor, after.major - before.major, note.c_str());
+        });
+        sampler.join();
+        done = true;
+        for (auto& t : helpers) t.join();
+    }
+
+    stop = true;
+    for (auto& t : spinners) t.join();
+    if (queriers > 0) std::system(("rm -rf '" + std::string(tmp_dir) + "'").c_str());
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * EdgeStelle — 派生指标与规则求值基准
+ *
+ *   ./bench_rules [devices] [cycles]
+ *
+ * 以 16 个原始指标、8 个派生指标、8 条规则的模板，对 devices 台设备 (默认 10000)
+ * 求值 cycles 个周期 (默认 200)，对比:
+ *   - 逐设备: 每台设备一个 lanes = 1 的 ExprEvaluator (单设备 SDK 的求值方式)；
+ *   - 批量:   一个 lanes = devices 的 ExprEvaluator (舰队模式的求值方式)。
+ * 报告每设备每周期的耗时，并校验两种方式的结果逐位一致。另以一组含缺失输入 (NaN)
+ * 的规则校验缺失值不会使规则触发 (如 "x != 3"、"!(x > 5)")。纯计算。
+ * 建议以 -DCMAKE_BUILD_TYPE=Release -DCMAKE_CXX_FLAGS=-march=native 构建。
+ */
+
+#include "edgestelle_report.hpp"
+#include "edgestelle_sim.hpp"
+#include "bench_util.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::print_summary;
+using edgestelle::bench::TemplateHeader;
+using edgestelle::bench::template_json;
+
+namespace {
+
+constexpr int kRaw = 16;
+
+std::string make_template() {
+    std::string metrics, rules;
+    char buf[160];
+    for (int i = 0; i < kRaw; ++i) {
+        std::snprintf(buf, sizeof(buf), R"(%s{"name":"m%02d","unit":""})", i ? "," : "", i);
+        metrics += buf;
+    }
+    static const char* derived[] = {
+        "m00 / m01 * 100", "rate(m02)", "(m03 + m04 + m05) / 3", "max(m06, m07) - min(m06, m07)",
+        "abs(delta(m08))", "sqrt(m09 * m09 + m10 * m10)", "m11 > 60 && m12 < 40", "-m13 + 2 * m14 - m15 / 4",
+    };
+    for (int k = 0; k < 8; ++k) {
+        std::snprintf(buf, sizeof(buf), R"(,{"name":"d%d","unit":"","expression":"%s"})", k, derived[k]);
+        metrics += buf;
+    }
+    static const char* when[] = {
+        "m00 > 70 && m01 < 30", "d0 > 150 || d0 < 50", "rate(m02) > 5", "d2 > 60 && !(m03 > 80)",
+        "abs(m04 - m05) > 40", "d5 > 90", "d6 && m13 > 50", "m14 >= 99 || m15 <= 1",
+    };
+    for (int k = 0; k < 8; ++k) {
+        std::snprintf(buf, sizeof(buf), R"(%s{"name":"r%d","when":"%s"})", k ? "," : "", k, when[k]);
+        rules += buf;
+    }
+    return template_json(metrics, rules);
+}
+
+/**
+ * lanes 个 lane 的求值状态 (与 RuleEngine 相同的矩阵布局)。
+ */
+struct Lanes {
+    ExprEvaluator       eval;
+    std::vector<double> values, prev, out;
+    size_t              n = 0;
+
+    void reset(const CompiledTemplate& tmpl, size_t lanes) {
+        n = lanes;
+        uint32_t depth = 1;
+        for (const auto& m : tmpl.metrics) depth = std::max(depth, m.program.max_depth);
+        for (const auto& r : tmpl.rules)   depth = std::max(depth, r.program.max_depth);
+        eval.reserve(depth, lanes);
+        values.assign(tmpl.metrics.size() * lanes, 0.0);
+        prev.assign(values.size(), 0.0);
+        out.assign(tmpl.rules.size() * lanes, 0.0);
+    }
+
+    void run(const CompiledTemplate& tmpl) {
+        for (uint32_t m = 0; m < tmpl.metrics.size(); ++m) {
+            if (!tmpl.metrics[m].derived()) continue;
+            eval.run(tmpl.metrics[m].program, values.data(), prev.data(), 1.0, &values[m * n]);
+        }
+        for (size_t r = 0; r < tmpl.rules.size(); ++r) {
+            eval.run(tmpl.rules[r].program, values.data(), prev.data(), 1.0, &out[r * n]);
+        }
+        prev = values;
+    }
+};
+
+/**
+ * lane 0 的 x 缺失 (NaN)、y = 10，lane 1 的 x = 4、y = 0；逐条校验规则是否触发
+ * (与 RuleEngine 相同，结果为非 NaN 的非 0 值才算触发)。返回不符合预期的条数。
+ */
+size_t check_missing_inputs() {
+    struct Case {
+        const char* when;
+        bool        fires_missing;   // lane 0
+        bool        fires_known;     // lane 1
+    };
+    static const Case cases[] = {
+        {"x != 3", false, true},           {"!(x > 5)", false, true},
+        {"!x", false, false},              {"x == x", false, true},
+        {"x < 3 || y > 5", true, false},   {"x > 3 && y > 5", false, false},
+        {"!(x > 5 && y > 1)", false, true}, {"!(x > 5 || y > 1)", false, true},
+        {"delta(y) > 0", false, false},    {"!(delta(y) > 0)", false, false},
+    };
+    std::string rules;
+    char buf[160];
+    for (size_t k = 0; k < std::size(cases); ++k) {
+        std::snprintf(buf, sizeof(buf), R"(%s{"name":"c%zu","when":"%s"})", k ? "," : "", k, cases[k].when);
+        rules += buf;
+    }
+    auto compiled = compile_template(template_json(R"({"name":"x","unit":""},{"name":"y","unit":""})", rules,
+                                                   TemplateHeader{"missing", {}}));
+    if (!compiled) {
+        std::fprintf(stderr, "%s\n", compiled.error().to_string().c_str());
+        return std::size(cases);
+    }
+    const CompiledTemplate& tmpl = *compiled.value();
+
+    Lanes lanes;
+    lanes.reset(tmpl, 2);
+    std::fill(lanes.prev.begin(), lanes.prev.end(), std::numeric_limits<double>::quiet_NaN());   // 首个周期
+    lanes.values = {std::numeric_limits<double>::quiet_NaN(), 4.0, 10.0, 0.0};
+    lanes.run(tmpl);
+
+    size_t wrong = 0;
+    for (size_t k = 0; k < std::size(cases); ++k) {
+        bool missing = std::fabs(lanes.out[k * 2]) > 0.0, known = std::fabs(lanes.out[k * 2 + 1]) > 0.0;
+        if (missing != cases[k].fires_missing || known != cases[k].fires_known) {
+            std::printf("  规则 \"%s\": x 缺失时%s触发、x = 4 时%s触发，与预期不符\n", cases[k].when,
+                        missing ? "" : "未", known ? "" : "未");
+            ++wrong;
+        }
+    }
+    std::printf("缺失输入: %zu 条规则，不符合预期 %zu 条\n", std::size(cases), wrong);
+    return wrong;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t devices = argc >= 2 ? static_cast<size_t>(std::atol(argv[1])) : 10000;
+    int    cycles  = argc >= 3 ? std::atoi(argv[2]) : 200;
+
+    auto compiled = compile_template(make_template());
+    if (!compiled) {
+        std::fprintf(stderr, "%s\n", compiled.error().to_string().c_str());
+        return 1;
+    }
+    const CompiledTemplate& tmpl = *compiled.value();
+    size_t metrics = tmpl.metrics.size();
+
+    std::vector<MetricDynamics> dynamics(kRaw, MetricDynamics{50.0, 15.0, 0.0, 100.0, 0.9});
+    auto sim = CorrelatedSimulator::create(dynamics, {}, devices, 42);
+    if (!sim) {
+        std::fprintf(stderr, "%s\n", sim.error().to_string().c_str());
+        return 1;
+    }
+
+    std::vector<Lanes> single(devices);
+    for (auto& l : single) l.reset(tmpl, 1);
+    Lanes batch;
+    batch.reset(tmpl, devices);
+
+    std::vector<double> single_ns, batch_ns;
+    size_t mismatches = 0, fired = 0;
+    for (int c = 0; c < cycles; ++c) {
+        sim.value().step();
+        for (uint32_t m = 0; m < kRaw; ++m) {
+            for (size_t d = 0; d < devices; ++d) {
+                double v = sim.value().value(m, d);
+                batch.values[m * devices + d] = v;
+                single[d].values[m] = v;
+            }
+        }
+
+        auto t = bench_clock::now();
+        for (auto& l : single) l.run(tmpl);
+        single_ns.push_back(ms_since(t) * 1e6 / static_cast<double>(devices));
+
+        t = bench_clock::now();
+        batch.run(tmpl);
+        batch_ns.push_back(ms_since(t) * 1e6 / static_cast<double>(devices));
+
+        for (size_t d = 0; d < devices; ++d) {
+            for (size_t m = kRaw; m < metrics; ++m) {
+                double a = single[d].values[m], b = batch.values[m * devices + d];
+                if (std::memcmp(&a, &b, sizeof(double)) != 0) ++mismatches;
+            }
+            for (size_t r = 0; r < tmpl.rules.size(); ++r) {
+                double a = single[d].out[r], b = batch.out[r * devices + d];
+                if (std::memcmp(&a, &b, sizeof(double)) != 0) ++mismatches;
+                if (std::fabs(b) > 0.0) ++fired;
+            }
+        }
+    }
+
+    std::printf("%zu 台设备，%d 个派生指标，%zu 条规则，%d 个周期，规则触发 %zu 次\n",
+                devices, static_cast<int>(metrics) - kRaw, tmpl.rules.size(), cycles, fired);
+    print_summary("  逐设备 (lanes = 1)", single_ns, "ns/设备");
+    print_summary("  批量 (lanes = N)", batch_ns, "ns/设备");
+    std::printf("结果不一致 %zu 处\n", mismatches);
+    size_t wrong = check_missing_inputs();
+    return mismatches == 0 && wrong == 0 ? 0 : 1;
+}
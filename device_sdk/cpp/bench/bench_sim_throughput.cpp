@@ -0,0 +1,93 @@
+/*
+ * EdgeStelle — 相关时间序列模拟吞吐基准
+ *
+ *   ./bench_sim_throughput [devices] [steps]
+ *
+ * 以 6 个典型指标、devices 台设备运行 CorrelatedSimulator，报告每秒样本数，
+ * 并抽样校验 lag-1 自相关与 cpu_usage / cpu_temperature 的互相关。
+ * 建议以 -DCMAKE_BUILD_TYPE=Release -DCMAKE_CXX_FLAGS=-march=native 构建。
+ */
+
+#include "edgestelle_sim.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+
+namespace {
+
+double correlation(const std::vector<double>& x, const std::vector<double>& y) {
+    size_t n = std::min(x.size(), y.size());
+    double mx = 0, my = 0;
+    for (size_t i = 0; i < n; ++i) { mx += x[i]; my += y[i]; }
+    mx /= static_cast<double>(n);
+    my /= static_cast<double>(n);
+    double sxy = 0, sxx = 0, syy = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sxy += (x[i] - mx) * (y[i] - my);
+        sxx += (x[i] - mx) * (x[i] - mx);
+        syy += (y[i] - my) * (y[i] - my);
+    }
+    return sxy / std::sqrt(sxx * syy);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t devices = argc >= 2 ? static_cast<size_t>(std::atol(argv[1])) : 10000;
+    int    steps   = argc >= 3 ? std::atoi(argv[2]) : 1000;
+
+    // cpu_usage, cpu_temperature, memory_usage, network_latency, packet_loss_rate, disk_usage
+    std::vector<MetricDynamics> metrics = {
+        {40.0, 20.0,  0.0, 100.0, 0.8},
+        {48.0, 12.0, 25.0,  95.0, 0.97},
+        {55.0, 15.0,  5.0,  99.0, 0.95},
+        {35.0, 25.0,  1.0, 500.0, 0.6},
+        { 0.8,  1.2,  0.0,  15.0, 0.5},
+        {60.0, 20.0,  1.0,  99.0, 0.995},
+    };
+    const size_t n = metrics.size();
+    std::vector<double> corr(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) corr[i * n + i] = 1.0;
+    auto set = [&](size_t i, size_t j, double rho) { corr[i * n + j] = corr[j * n + i] = rho; };
+    set(0, 1, 0.8);
+    set(0, 2, 0.4);
+    set(3, 4, 0.6);
+
+    auto created = CorrelatedSimulator::create(metrics, corr, devices, 42);
+    if (!created) {
+        std::fprintf(stderr, "%s\n", created.error().to_string().c_str());
+        return 1;
+    }
+    CorrelatedSimulator sim = std::move(created).value();
+
+    // 抽样设备 0 的序列用于校验
+    std::vector<double> cpu, temp, cpu_next;
+    cpu.reserve(static_cast<size_t>(steps));
+    temp.reserve(static_cast<size_t>(steps));
+
+    auto t0 = bench_clock::now();
+    for (int s = 0; s < steps; ++s) {
+        sim.step();
+        cpu.push_back(sim.row(0)[0]);
+        temp.push_back(sim.row(1)[0]);
+    }
+    double ms = ms_since(t0);
+
+    double samples = static_cast<double>(devices) * static_cast<double>(n) * steps;
+    std::printf("%zu 台设备 × %zu 指标 × %d 周期: %.1f ms，%.1f M 样本/秒\n",
+                devices, n, steps, ms, samples / ms / 1e3);
+
+    // 互相关用单周期全体设备的截面估计，自相关用设备 0 的时间序列估计
+    std::vector<double> cross_cpu(sim.row(0), sim.row(0) + devices);
+    std::vector<double> cross_temp(sim.row(1), sim.row(1) + devices);
+    cpu_next.assign(cpu.begin() + 1, cpu.end());
+    cpu.pop_back();
+    std::printf("lag-1 自相关 cpu_usage: %.3f (φ=0.8)\n", correlation(cpu, cpu_next));
+    std::printf("截面相关 cpu_usage~cpu_temperature: %.3f (扰动 ρ=0.8，稳态约 0.52)\n",
+                correlation(cross_cpu, cross_temp));
+    return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * EdgeStelle — 共享模板注册表基准
+ *
+ *   ./bench_template_registry [devices] [templates] [metrics] [readers]
+ *
+ * devices 台逻辑设备 (默认 10000) 轮流使用 templates 个不同模板 (默认 4，每个 metrics
+ * 个指标，默认 64)，对比:
+ *   - 每台设备自行编译一份 (copies) 与经 TemplateRegistry 共享 (registry) 的堆内存与
+ *     取得模板的耗时；
+ *   - readers 个线程 (默认 4) 持续 Slot::current() 读取，同时另一线程不断发布新版本
+ *     (编译后间隔 1 ms) 时，单次读取的耗时，并校验读到的实例始终完整；
+ *   - readers 个线程对 templates 个 id 交替 refresh() / acquire()，同时另一线程反复
+ *     prune()，1 秒内全部结束即无锁顺序死锁 (10 秒未结束判失败)。
+ * 模板响应体在本地生成，纯计算，无需网络。以 -DEDGESTELLE_TSAN=ON 构建可同时检查数据竞争。
+ */
+
+#include "edgestelle_registry.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+#include <thread>
+
+#include <malloc.h>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::print_summary;
+
+namespace {
+
+std::string make_template(int index, int version, int metrics) {
+    return bench::make_template(metrics, 3, 80 + version % 10,
+                                bench::TemplateHeader{"tpl-" + std::to_string(index), std::to_string(version)});
+}
+
+size_t heap_in_use() { return mallinfo2().uordblks; }
+
+/**
+ * refresh() / acquire() 与 prune() 并发运行 1 秒；看门狗 10 秒内未见结束即判为死锁退出。
+ */
+bool prune_while_refreshing(int templates, int metrics, int threads) {
+    TemplateRegistry registry;
+    std::vector<std::vector<std::string>> versions(static_cast<size_t>(templates));
+    for (int t = 0; t < templates; ++t) {
+        for (int v = 1; v <= 8; ++v) versions[static_cast<size_t>(t)].push_back(make_template(t, v, metrics));
+    }
+
+    std::atomic<bool> stop{false}, finished{false};
+    std::atomic<uint64_t> refreshes{0}, prunes{0}, pruned{0};
+    std::thread watchdog([&] {
+        auto t = bench_clock::now();
+        while (!finished) {
+            if (ms_since(t) > 10000.0) {
+                std::fprintf(stderr, "prune() 与 refresh() 10 秒未结束，疑似死锁\n");
+                std::_Exit(1);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (int r = 0; r < threads; ++r) {
+        workers.emplace_back([&, r] {
+            for (uint64_t i = static_cast<uint64_t>(r); !stop; ++i) {
+                size_t k = i % static_cast<size_t>(templates);
+                std::string id = "tpl-" + std::to_string(k);
+                auto fetch = [&](const std::string&) {
+                    return Result<std::string>(versions[k][(i / static_cast<size_t>(templates)) % versions[k].size()]);
+                };
+                auto got = i % 2 ? registry.acquire(id, fetch) : registry.refresh(id, fetch);
+                if (got) ++refreshes;
+            }
+        });
+    }
+    workers.emplace_back([&] {
+        while (!stop) {
+            pruned += registry.prune();
+            ++prunes;
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    stop = true;
+    for (auto& th : workers) th.join();
+    finished = true;
+    watchdog.join();
+    std::printf("prune() 与 refresh() / acquire() 并发 1 秒: 取得模板 %llu 次，prune %llu 次 (释放 %llu 个)，未死锁\n",
+                static_cast<unsigned long long>(refreshes.load()), static_cast<unsigned long long>(prunes.load()),
+                static_cast<unsigned long long>(pruned.load()));
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int devices   = argc >= 2 ? std::atoi(argv[1]) : 10000;
+    int templates = argc >= 3 ? std::atoi(argv[2]) : 4;
+    int metrics   = argc >= 4 ? std::atoi(argv[3]) : 64;
+    int readers   = argc >= 5 ? std::atoi(argv[4]) : 4;
+
+    std::vector<std::string> bodies;
+    for (int t = 0; t < templates; ++t) bodies.push_back(make_template(t, 1, metrics));
+    std::printf("%d 台设备，%d 个模板 × %d 个指标\n", devices, templates, metrics);
+
+    for (bool shared : {false, true}) {
+        TemplateRegistry registry;
+        std::vector<TemplatePtr> held;
+        held.reserve(static_cast<size_t>(devices));
+        size_t before = heap_in_use();
+        auto t = bench_clock::now();
+        for (int d = 0; d < devices; ++d) {
+            int k = d % templates;
+            Result<TemplatePtr> tmpl = shared
+                ? registry.acquire("tpl-" + std::to_string(k),
+                                   [&](const std::string&) { return Result<std::string>(bodies[static_cast<size_t>(k)]); })
+                : compile_template(bodies[static_cast<size_t>(k)]);
+            if (!tmpl) {
+                std::fprintf(stderr, "%s\n", tmpl.error().to_string().c_str());
+                return 1;
+            }
+            held.push_back(std::move(tmpl).value());
+        }
+        double ms    = ms_since(t);
+        size_t bytes = heap_in_use() - before;
+        std::printf("%-9s 堆内存 %8zu KiB (每台 %7.1f 字节)，取得模板每台 %.2f us",
+                    shared ? "registry" : "copies", bytes / 1024,
+                    static_cast<double>(bytes) / devices, ms * 1e3 / devices);
+        if (shared) {
+            std::printf("，编译 %llu 次，实例 %zu 个",
+                        static_cast<unsigned long long>(registry.compiles()), registry.templates());
+        }
+        std::printf("\n");
+    }
+
+    // RCU 读：读线程只做原子 load，发布线程持续替换版本
+    TemplateRegistry registry;
+    auto& slot = registry.slot("tpl-0");
+    if (auto r = registry.publish("tpl-0", make_template(0, 1, metrics)); !r) {
+        std::fprintf(stderr, "%s\n", r.error().to_string().c_str());
+        return 1;
+    }
+    std::vector<std::string> versions;
+    for (int v = 2; v < 64; ++v) versions.push_back(make_template(0, v, metrics));
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> torn{0};
+    std::vector<std::vector<double>> read_ns(static_cast<size_t>(readers));
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            constexpr int kBatch = 1000;
+            auto& out = read_ns[static_cast<size_t>(r)];
+            while (!stop) {
+                auto t = bench_clock::now();
+                for (int i = 0; i < kBatch; ++i) {
+                    TemplatePtr p = slot.current();
+                    if (!p || p->metrics.size() != static_cast<size_t>(metrics)) ++torn;
+                }
+                out.push_back(ms_since(t) * 1e6 / kBatch);
+            }
+        });
+    }
+    size_t swaps = 0;
+    auto t = bench_clock::now();
+    while (ms_since(t) < 1000.0) {
+        registry.publish("tpl-0", versions[swaps++ % versions.size()]);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stop = true;
+    for (auto& th : threads) th.join();
+
+    std::vector<double> all;
+    for (auto& v : read_ns) all.insert(all.end(), v.begin(), v.end());
+    std::printf("%d 个读线程，1 秒内发布 %zu 次新版本 (不完整读取 %llu 次)\n", readers, swaps,
+                static_cast<unsigned long long>(torn.load()));
+    print_summary("  Slot::current()", all, "ns");
+
+    return prune_while_refreshing(templates, metrics, readers) ? 0 : 1;
+}
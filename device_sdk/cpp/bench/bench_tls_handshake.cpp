@@ -0,0 +1,109 @@
+/*
+ * EdgeStelle — TLS 握手基准: 完整握手 vs 会话恢复 vs 长连接复用
+ *
+ * 先用 bench/tls_env.sh 启动本地自签名 HTTPS 替身与 TLS mosquitto，然后:
+ *   ./bench_tls_handshake <https_url> <mqtts_uri> <ca_file> [iterations]
+ *
+ * 在目标 ARM 板上运行即可得到该类 CPU 的握手开销。
+ */
+
+#include "edgestelle_device.hpp"
+#include "bench_util.hpp"
+
+#include <cstdlib>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::print_summary;
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::fprintf(stderr, "用法: %s <https_url> <mqtts_uri> <ca_file> [iterations]\n", argv[0]);
+        return 1;
+    }
+    std::string url      = argv[1];
+    std::string mqtt_uri = argv[2];
+    TlsConfig   tls;
+    tls.ca_file = argv[3];
+    int iterations = argc >= 5 ? std::atoi(argv[4]) : 50;
+
+    std::string cache = "bench_tls_sessions.bin";
+    std::remove(cache.c_str());
+
+    std::vector<double> full, resumed, warm;
+
+    // 1) 每次新建客户端、无会话缓存 → 完整握手
+    for (int i = 0; i < iterations; ++i) {
+        detail::HttpClient http(tls);
+        if (!http.get(url)) continue;
+        full.push_back(http.last_tls_handshake_us() / 1000.0);
+    }
+
+    // 2) 每次新建客户端 (模拟进程重启)，从会话文件导入 → 恢复握手
+    TlsConfig cached = tls;
+    cached.session_cache_path = cache;
+    bool persisted = false;
+    {
+        detail::HttpClient prime(cached);
+        auto r = prime.get(url);
+        if (!r) {
+            std::fprintf(stderr, "HTTPS 请求失败: %s\n", r.error().to_string().c_str());
+            return 1;
+        }
+        prime.save_sessions();
+        persisted = prime.can_persist_sessions();
+    }
+    for (int i = 0; i < iterations; ++i) {
+        detail::HttpClient http(cached);
+        if (!http.get(url)) continue;
+        resumed.push_back(http.last_tls_handshake_us() / 1000.0);
+    }
+
+    // 3) 同一客户端重复请求 → 连接复用，不握手；记录整次请求耗时
+    {
+        detail::HttpClient http(tls);
+        http.get(url);
+        for (int i = 0; i < iterations; ++i) {
+            auto t = bench_clock::now();
+            if (http.get(url)) warm.push_back(ms_since(t));
+        }
+    }
+
+    std::printf("── HTTPS (%s) ──\n", url.c_str());
+    print_summary("完整握手 (handshake)", full);
+    print_summary("会话恢复 (handshake)", resumed);
+    if (!persisted) std::printf("  (libcurl 不支持会话导出，上一行实际为完整握手)\n");
+    print_summary("长连接复用 (整次请求)", warm);
+
+    // 4) MQTT over TLS: 每次新建连接 vs 长连接上发布
+    std::vector<double> mqtt_full, mqtt_warm;
+    auto ssl = mqtt::ssl_options_builder().trust_store(tls.ca_file).finalize();
+    auto opts = mqtt::connect_options_builder().clean_session(true).finalize();
+    opts.set_ssl(ssl);
+
+    for (int i = 0; i < iterations; ++i) {
+        mqtt::async_client client(mqtt_uri, "bench-tls-" + std::to_string(i));
+        auto t = bench_clock::now();
+        client.connect(opts)->wait();
+        mqtt_full.push_back(ms_since(t));
+        client.disconnect()->wait();
+    }
+    {
+        mqtt::async_client client(mqtt_uri, "bench-tls-warm");
+        client.connect(opts)->wait();
+        for (int i = 0; i < iterations; ++i) {
+            auto t = bench_clock::now();
+            client.publish(mqtt::make_message("bench/tls", "ping", 1, false))->wait();
+            mqtt_warm.push_back(ms_since(t));
+        }
+        client.disconnect()->wait();
+    }
+
+    std::printf("── MQTT (%s) ──\n", mqtt_uri.c_str());
+    print_summary("新建连接 (connect)", mqtt_full);
+    print_summary("长连接发布 (QoS1 publish)", mqtt_warm);
+
+    std::remove(cache.c_str());
+    return 0;
+}
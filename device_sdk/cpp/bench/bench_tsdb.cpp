@@ -0,0 +1,124 @@
+/*
+ * EdgeStelle — 本地时序库基准
+ *
+ *   ./bench_tsdb [metrics] [hours] [dir]
+ *
+ * 以 metrics 个指标 (默认 16)、1 Hz 写入 hours 小时 (默认 24) 的模拟数据 (保留两位
+ * 小数)，默认 tier (6 小时原始点、7 天分钟桶、90 天小时桶)，报告:
+ *   - append() 每点耗时与每点占用的压缩字节；
+ *   - 重新打开 (扫描活动段、补齐 rollup 当前桶) 的耗时；
+ *   - 典型查询的耗时：最近 1 小时原始点、最近 1 小时 / 全程聚合、全程按 5 分钟分桶。
+ * dir 默认为 /tmp 下的临时目录，结束后删除。纯计算 + 本地文件，无需网络。
+ */
+
+#include "edgestelle_sim.hpp"
+#include "edgestelle_tsdb.hpp"
+#include "bench_util.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace edgestelle;
+using edgestelle::bench::bench_clock;
+using edgestelle::bench::ms_since;
+using edgestelle::bench::print_summary;
+using edgestelle::bench::make_template;
+
+namespace {
+
+template <class F>
+std::vector<double> repeat_us(int n, F&& f) {
+    std::vector<double> us;
+    for (int i = 0; i < n; ++i) {
+        auto t = bench_clock::now();
+        f();
+        us.push_back(ms_since(t) * 1e3);
+    }
+    return us;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int         metrics = argc >= 2 ? std::atoi(argv[1]) : 16;
+    double      hours   = argc >= 3 ? std::atof(argv[2]) : 24.0;
+    std::string dir     = argc >= 4 ? argv[3] : "";
+    bool        temp    = dir.empty();
+    if (temp) {
+        char tmpl_dir[] = "/tmp/edgestelle-tsdb-XXXXXX";
+        if (!::mkdtemp(tmpl_dir)) {
+            std::perror("mkdtemp");
+            return 1;
+        }
+        dir = tmpl_dir;
+    }
+
+    auto compiled = compile_template(make_template(metrics));
+    if (!compiled) {
+        std::fprintf(stderr, "%s\n", compiled.error().to_string().c_str());
+        return 1;
+    }
+    DeviceConfig defaults;
+    auto open = [&] { return TimeSeriesStore::open(dir, compiled.value(), defaults.store_tiers,
+                                                   defaults.store_segment_bytes); };
+    auto store = open();
+    if (!store) {
+        std::fprintf(stderr, "%s\n", store.error().to_string().c_str());
+        return 1;
+    }
+
+    std::vector<MetricDynamics> dynamics(static_cast<size_t>(metrics), MetricDynamics{50.0, 15.0, 0.0, 100.0, 0.99});
+    auto sim = CorrelatedSimulator::create(dynamics, {}, 1, 42);
+    if (!sim) {
+        std::fprintf(stderr, "%s\n", sim.error().to_string().c_str());
+        return 1;
+    }
+
+    const int64_t t0      = 1700000000000LL;
+    const auto    seconds = static_cast<int64_t>(hours * 3600);
+    std::vector<double> append_ns;
+    append_ns.reserve(static_cast<size_t>(seconds));
+    for (int64_t s = 0; s < seconds; ++s) {
+        sim.value().step();
+        auto t = bench_clock::now();
+        for (uint32_t m = 0; m < static_cast<uint32_t>(metrics); ++m) {
+            double v = std::round(sim.value().value(m, 0) * 100.0) / 100.0;
+            if (auto r = store.value().append(m, t0 + s * 1000, v); !r) {
+                std::fprintf(stderr, "%s\n", r.error().to_string().c_str());
+                return 1;
+            }
+        }
+        append_ns.push_back(ms_since(t) * 1e6 / metrics);
+    }
+    int64_t end = t0 + seconds * 1000;
+    size_t  bytes = store.value().stored_bytes();
+
+    std::printf("%d 个指标 × %.1f 小时 (1 Hz)，%zu 个段，压缩后 %zu KiB\n", metrics, hours,
+                store.value().segments(), bytes / 1024);
+    print_summary("  append() 每点", append_ns, "ns");
+
+    auto t = bench_clock::now();
+    store = open();
+    std::printf("  重新打开 %.1f ms\n", ms_since(t));
+
+    const TimeSeriesStore& db = store.value();
+    std::vector<SeriesPoint>  points;
+    std::vector<SeriesBucket> buckets;
+    Aggregate agg;
+    print_summary("  最近 1 小时原始点", repeat_us(50, [&] {
+        points.clear();
+        db.range(0, end - 3600 * 1000, end, points);
+    }), "us");
+    print_summary("  最近 1 小时聚合", repeat_us(50, [&] { agg = db.aggregate(0, end - 3600 * 1000, end); }), "us");
+    print_summary("  全程聚合", repeat_us(50, [&] { agg = db.aggregate(0, t0, end); }), "us");
+    print_summary("  全程 5 分钟分桶", repeat_us(50, [&] {
+        buckets.clear();
+        db.downsample(0, t0, end, 300 * 1000, buckets);
+    }), "us");
+    std::printf("  全程聚合 count=%llu mean=%.3f；原始点每点 %.2f 字节\n",
+                static_cast<unsigned long long>(agg.count), agg.mean(),
+                static_cast<double>(bytes) / static_cast<double>(static_cast<int64_t>(metrics) * std::min<int64_t>(seconds, 6 * 3600)));
+
+    if (temp) std::system(("rm -rf '" + dir + "'").c_str());
+    return 0;
+}
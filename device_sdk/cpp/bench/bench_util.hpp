@@ -0,0 +1,85 @@
+/*
+ * EdgeStelle — 基准程序公共工具
+ */
+
+#ifndef EDGESTELLE_BENCH_UTIL_HPP
+#define EDGESTELLE_BENCH_UTIL_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace edgestelle {
+namespace bench {
+
+using bench_clock = std::chrono::steady_clock;
+
+inline double ms_since(bench_clock::time_point from) {
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - from).count();
+}
+
+/**
+ * 打印一组样本的 p50 / p90 / max，unit 仅用于显示 (默认毫秒)。
+ */
+inline void print_summary(const char* label, std::vector<double> samples, const char* unit = "ms") {
+    if (samples.empty()) {
+        std::printf("%-32s  (无样本)\n", label);
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&](double p) {
+        return samples[static_cast<size_t>(p * static_cast<double>(samples.size() - 1))];
+    };
+    std::printf("%-32s  n=%-5zu p50=%9.3f %s  p90=%9.3f %s  max=%9.3f %s\n",
+                label, samples.size(), pct(0.5), unit, pct(0.9), unit, samples.back(), unit);
+}
+
+constexpr const char* kTemplateId = "6f1c2a9e-0d3b-4b8e-9a51-3c2d7e8f9a10";
+
+/**
+ * 合成模板的 id 与 version (为空时不写入)。
+ */
+struct TemplateHeader {
+    std::string id = kTemplateId;
+    std::string version;
+};
+
+/**
+ * 组装模板 JSON：metrics 与 rules 为对应数组的内容 (逗号分隔的对象)，rules 为空时省略。
+ */
+inline std::string template_json(const std::string& metrics, const std::string& rules = {},
+                                 const TemplateHeader& header = {}) {
+    std::string body = R"({"id":")" + header.id + '"';
+    if (!header.version.empty()) body += R"(,"version":")" + header.version + '"';
+    body += R"(,"schema_definition":{"metrics":[)" + metrics + ']';
+    if (!rules.empty()) body += R"(,"rules":[)" + rules + ']';
+    return body + "}}";
+}
+
+/**
+ * metrics 个单位为 % 的合成指标 sensor_<序号> (序号补零到 name_width 位) 组成的模板 JSON；
+ * threshold_max 非 0 时每个指标带此上限。
+ */
+inline std::string make_template(int metrics, int name_width = 3, double threshold_max = 0.0,
+                                 const TemplateHeader& header = {}) {
+    std::string list;
+    char buf[128];
+    for (int i = 0; i < metrics; ++i) {
+        int n = std::snprintf(buf, sizeof(buf), R"(%s{"name":"sensor_%0*d","unit":"%%")", i ? "," : "",
+                              name_width, i);
+        if (threshold_max != 0.0) {
+            n += std::snprintf(buf + n, sizeof(buf) - static_cast<size_t>(n), R"(,"threshold_max":%g)",
+                               threshold_max);
+        }
+        list.append(buf, static_cast<size_t>(n));
+        list += '}';
+    }
+    return template_json(list, {}, header);
+}
+
+} // namespace bench
+} // namespace edgestelle
+
+#endif // EDGESTELLE_BENCH_UTIL_HPP
@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+# EdgeStelle — 二进制体积 / 峰值 RSS 对比
+#
+# 分别以 full 与 embedded 配置构建 edgestelle_device，报告:
+#   - 可执行文件大小 (stripped)
+#   - 单次运行的峰值 RSS (/usr/bin/time -f %M)
+#
+# 用法: bench/footprint.sh <template_id> [构建根目录]
+#   API_BASE_URL / MQTT_BROKER_URI 等环境变量原样传给被测程序。
+set -euo pipefail
+
+TEMPLATE_ID="${1:?用法: footprint.sh <template_id> [构建根目录]}"
+ROOT="${2:-/tmp/edgestelle-footprint}"
+SRC="$(cd "$(dirname "$0")/.." && pwd)"
+
+printf "%-10s %12s %14s\n" profile "size(KiB)" "peak_rss(KiB)"
+for profile in full embedded; do
+    dir="$ROOT/$profile"
+    cmake -S "$SRC" -B "$dir" -DCMAKE_BUILD_TYPE=Release \
+        -DEDGESTELLE_PROFILE="$profile" > /dev/null
+    cmake --build "$dir" -j"$(nproc)" > /dev/null
+
+    bin="$dir/edgestelle_device"
+    cp "$bin" "$dir/edgestelle_device.stripped"
+    strip "$dir/edgestelle_device.stripped"
+    size_kb=$(( $(stat -c %s "$dir/edgestelle_device.stripped") / 1024 ))
+
+    # 被测程序失败 (如 broker 不可达) 时仍记录峰值 RSS
+    /usr/bin/time -f %M -o "$dir/rss.txt" "$bin" "$TEMPLATE_ID" > /dev/null 2>&1 || true
+    rss_kb=$(tail -n1 "$dir/rss.txt")
+    printf "%-10s %12s %14s\n" "$profile" "$size_kb" "$rss_kb"
+done
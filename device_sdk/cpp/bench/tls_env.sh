@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+# EdgeStelle — 本地 TLS 基准环境
+#
+# 生成自签名 CA / 服务端证书，启动:
+#   - mosquitto TLS 监听 8883
+#   - HTTPS 模板接口替身 8443 (返回固定模板)
+#
+# 用法: bench/tls_env.sh [工作目录]    (Ctrl-C 结束)
+set -euo pipefail
+
+WORK="${1:-/tmp/edgestelle-tls}"
+mkdir -p "$WORK"
+cd "$WORK"
+
+if [ ! -f ca.crt ]; then
+    openssl req -x509 -newkey rsa:2048 -nodes -days 30 \
+        -subj "/CN=edgestelle-bench-ca" -keyout ca.key -out ca.crt
+    openssl req -newkey rsa:2048 -nodes \
+        -subj "/CN=localhost" -keyout server.key -out server.csr
+    printf "subjectAltName=DNS:localhost,IP:127.0.0.1\n" > san.ext
+    openssl x509 -req -in server.csr -CA ca.crt -CAkey ca.key -CAcreateserial \
+        -days 30 -extfile san.ext -out server.crt
+fi
+
+cat > mosquitto.conf <<CONF
+listener 8883
+allow_anonymous true
+cafile   $WORK/ca.crt
+certfile $WORK/server.crt
+keyfile  $WORK/server.key
+CONF
+
+mosquitto -c mosquitto.conf &
+MOSQ_PID=$!
+trap 'kill $MOSQ_PID 2>/dev/null || true' EXIT
+
+echo "mqtts: ssl://localhost:8883"
+echo "https: https://localhost:8443/api/v1/templates/bench"
+echo "ca:    $WORK/ca.crt"
+
+python3 - "$WORK" <<'PY'
+import http.server, json, ssl, sys
+
+work = sys.argv[1]
+body = json.dumps({
+    "id": "00000000-0000-0000-0000-000000000000",
+    "schema_definition": {"metrics": [
+        {"name": "cpu_temperature", "unit": "°C", "threshold_max": 85},
+        {"name": "memory_usage", "unit": "%", "threshold_max": 90},
+    ]},
+}).encode()
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def do_GET(self):
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, *args):
+        pass
+
+ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+ctx.load_cert_chain(f"{work}/server.crt", f"{work}/server.key")
+srv = http.server.ThreadingHTTPServer(("127.0.0.1", 8443), Handler)
+srv.socket = ctx.wrap_socket(srv.socket, server_side=True)
+srv.serve_forever()
+PY
@@ -0,0 +1,32 @@
+/*
+ * EdgeStelle — C++ Device SDK: 堆分配归属标记
+ *
+ * 定长内存模式 (EDGESTELLE_FIXED_MEMORY) 承诺 prepare() 之后 SDK 自身不再申请堆内存。
+ * Paho / libcurl 内部的分配不在 SDK 控制范围内，调用它们时用 ThirdPartyScope 标记，
+ * 分配钩子 (bench/bench_alloc_guard.cpp) 据此把两类分配分开统计。
+ */
+
+#ifndef EDGESTELLE_ALLOC_HPP
+#define EDGESTELLE_ALLOC_HPP
+
+namespace edgestelle {
+namespace alloc {
+
+/**
+ * 当前线程处于第三方库调用中的嵌套深度。
+ */
+inline thread_local int third_party_depth = 0;
+
+class ThirdPartyScope {
+public:
+    ThirdPartyScope()  { ++third_party_depth; }
+    ~ThirdPartyScope() { --third_party_depth; }
+
+    ThirdPartyScope(const ThirdPartyScope&)            = delete;
+    ThirdPartyScope& operator=(const ThirdPartyScope&) = delete;
+};
+
+} // namespace alloc
+} // namespace edgestelle
+
+#endif // EDGESTELLE_ALLOC_HPP
@@ -0,0 +1,345 @@
+/*
+ * EdgeStelle — C++ Device SDK: 多 broker 分片与故障转移
+ *
+ * DeviceConfig::mqtt_brokers 给出多个 broker 时:
+ *   - HashRing 把 device_id 一致性哈希到 broker (每个 broker 64 个虚拟节点，以 URI 定位)，
+ *     增删或摘除一个 broker 只影响原本落在它上面的设备；
+ *   - 单设备 (FailoverChannel) 按环上顺序得到自己的 broker 偏好列表：连接或发布失败立即
+ *     切到下一个可用 broker 并重试一次，失败的 broker 按指数退避 (1 s 起，至多 30 s)
+ *     暂时摘除；运行在备用 broker 上时定期对更靠前的 broker 发起后台连接探测，
+ *     连上即回切；
+ *   - 舰队模式 (edgestelle_fleet.hpp) 每个 broker 一个分片，各自的连接与在途窗口，
+ *     某个 broker 过载或重启只影响落在它上面的设备。
+ *
+ * 只配置一个 broker 时行为与单个 MqttChannel 相同。
+ */
+
+#ifndef EDGESTELLE_BROKERS_HPP
+#define EDGESTELLE_BROKERS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "edgestelle_config.hpp"
+#include "edgestelle_log.hpp"
+#include "edgestelle_mqtt.hpp"
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+namespace detail {
+
+// ═════════════════════════════════════════════════════
+//  一致性哈希环
+// ═════════════════════════════════════════════════════
+
+class HashRing {
+public:
+    static constexpr int kVirtualNodes = 64;
+
+    explicit HashRing(const std::vector<std::string>& nodes) : nodes_(nodes.size()) {
+        points_.reserve(nodes.size() * kVirtualNodes);
+        for (uint32_t n = 0; n < nodes.size(); ++n) {
+            for (int v = 0; v < kVirtualNodes; ++v) {
+                points_.push_back(Point{hash(nodes[n] + "#" + std::to_string(v)), n});
+            }
+        }
+        std::sort(points_.begin(), points_.end(),
+                  [](const Point& a, const Point& b) { return a.hash < b.hash || (a.hash == b.hash && a.node < b.node); });
+    }
+
+    size_t nodes() const { return nodes_; }
+
+    /**
+     * key 的归属节点。
+     */
+    size_t owner(std::string_view key) const { return points_[first_point(key)].node; }
+
+    /**
+     * key 的归属节点，跳过 up[n] 为 false 的节点；全部不可用时返回原归属。
+     */
+    size_t owner(std::string_view key, const std::vector<bool>& up) const {
+        size_t start = first_point(key);
+        for (size_t i = 0; i < points_.size(); ++i) {
+            uint32_t n = points_[(start + i) % points_.size()].node;
+            if (up[n]) return n;
+        }
+        return points_[start].node;
+    }
+
+    /**
+     * 沿环顺时针得到 key 的节点偏好顺序 (各节点出现一次)。
+     */
+    std::vector<size_t> preference(std::string_view key) const {
+        std::vector<size_t> order;
+        std::vector<bool>   seen(nodes_, false);
+        size_t start = first_point(key);
+        for (size_t i = 0; i < points_.size() && order.size() < nodes_; ++i) {
+            uint32_t n = points_[(start + i) % points_.size()].node;
+            if (seen[n]) continue;
+            seen[n] = true;
+            order.push_back(n);
+        }
+        return order;
+    }
+
+    // FNV-1a + murmur3 终混
+    static uint32_t hash(std::string_view s) {
+        uint32_t h = 2166136261U;
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 16777619U;
+        }
+        h ^= h >> 16;
+        h *= 0x85EBCA6BU;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35U;
+        h ^= h >> 16;
+        return h;
+    }
+
+private:
+    struct Point {
+        uint32_t hash;
+        uint32_t node;
+    };
+
+    size_t first_point(std::string_view key) const {
+        uint32_t h = hash(key);
+        auto it = std::lower_bound(points_.begin(), points_.end(), h,
+                                   [](const Point& p, uint32_t v) { return p.hash < v; });
+        return it == points_.end() ? 0 : static_cast<size_t>(it - points_.begin());
+    }
+
+    size_t             nodes_;
+    std::vector<Point> points_;
+};
+
+// ═════════════════════════════════════════════════════
+//  broker 健康状态
+// ═════════════════════════════════════════════════════
+
+/**
+ * 连续失败计数与退避截止时刻 (steady_clock，不受 VirtualClock 影响)。
+ */
+class BrokerHealth {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds kBackoffMin{1000};
+    static constexpr std::chrono::milliseconds kBackoffMax{30000};
+
+    bool available(clock::time_point now) const { return failures_ == 0 || now >= down_until_; }
+    bool healthy() const { return failures_ == 0; }
+    int  failures() const { return failures_; }
+    clock::time_point down_until() const { return down_until_; }
+
+    void mark_up() { failures_ = 0; }
+
+    void mark_down(clock::time_point now) {
+        ++failures_;
+        auto backoff = kBackoffMin * (1 << std::min(failures_ - 1, 5));
+        down_until_ = now + std::min<std::chrono::milliseconds>(backoff, kBackoffMax);
+    }
+
+private:
+    int               failures_ = 0;
+    clock::time_point down_until_{};
+};
+
+/**
+ * 后台连接的完成标记：connect_async(&probe) 之后轮询 finished()，
+ * 完成后再调用 wait_connected() 收尾 (此时不会阻塞)。
+ */
+class ConnectProbe : public MqttCompletion {
+public:
+    void reset() { state_ = kPending; }
+    bool finished() const { return state_ != kPending; }
+
+    void done(Result<void> result) override { state_ = result ? kOk : kFailed; }
+
+private:
+    enum : int { kPending, kOk, kFailed };
+    std::atomic<int> state_{kPending};
+};
+
+// ═════════════════════════════════════════════════════
+//  单设备故障转移
+// ═════════════════════════════════════════════════════
+
+/**
+ * 按 device_id 的一致性哈希顺序在多个 broker 间故障转移的 MQTT 通道，
+ * 接口与 MqttChannel 的同步部分一致，可直接替换。同一时刻只有一个活动连接
+ * (回切探测期间可能短暂有两个)；切走的 broker 连接随即断开。
+ *
+ * Channel 为单 broker 通道 (默认 MqttChannel)，基准以内存中的假通道代入。
+ */
+template <class Channel>
+class BasicFailoverChannel {
+public:
+    static constexpr std::chrono::milliseconds kProbeInterval{5000};
+
+    explicit BasicFailoverChannel(const DeviceConfig& cfg) {
+        auto uris = cfg.broker_uris();
+        order_ = HashRing(uris).preference(cfg.device_id);
+        for (const auto& uri : uris) {
+            channels_.push_back(std::make_unique<Channel>(cfg, uri, "device-" + cfg.device_id));
+        }
+        health_.resize(uris.size());
+        active_ = order_.front();
+    }
+
+    ~BasicFailoverChannel() { disconnect(); }
+
+    BasicFailoverChannel(const BasicFailoverChannel&)            = delete;
+    BasicFailoverChannel& operator=(const BasicFailoverChannel&) = delete;
+
+    const std::string& uri() const { return channels_[active_]->uri(); }
+
+    /**
+     * 回切探测的间隔 (默认 kProbeInterval)。
+     */
+    void set_probe_interval(std::chrono::milliseconds interval) { probe_interval_ = interval; }
+
+    bool connected()  const { return channels_[active_]->connected(); }
+    bool connecting() const { return channels_[active_]->connecting(); }
+
+    /**
+     * 向当前首选的可用 broker 发起连接但不等待。
+     */
+    Result<void> connect_async() {
+        if (connected() || connecting()) return {};
+        active_ = pick(BrokerHealth::clock::now(), {});
+        return channels_[active_]->connect_async();
+    }
+
+    /**
+     * 等待连接完成；失败时依次尝试其余 broker，全部失败返回最后一个错误。
+     */
+    Result<void> wait_connected() {
+        std::vector<bool> tried(channels_.size(), false);
+        for (;;) {
+            tried[active_] = true;
+            auto conn = channels_[active_]->wait_connected();
+            auto now  = BrokerHealth::clock::now();
+            if (conn) {
+                health_[active_].mark_up();
+                return conn;
+            }
+            health_[active_].mark_down(now);
+            size_t next = pick(now, tried);
+            if (next == kNone) return conn;
+            EDGESTELLE_LOG_ERR("⚠️  broker %s 连接失败 (%s)，切换到 %s", channels_[active_]->uri().c_str(),
+                               conn.error().message.c_str(), channels_[next]->uri().c_str());
+            active_ = next;
+            // 发起失败时下一轮 wait_connected() 返回 "not connected"，照常切走
+            channels_[active_]->connect_async();
+        }
+    }
+
+    /**
+     * 同步发布。失败时把当前 broker 标记为不可用，切换到下一个 broker 重试一次。
+     */
+    Result<void> publish(const std::string& topic, const std::string& payload, int qos) {
+        maybe_fail_back();
+        auto sent = channels_[active_]->publish(topic, payload, qos);
+        if (sent || channels_.size() == 1) return sent;
+
+        auto now = BrokerHealth::clock::now();
+        size_t failed = active_;
+        health_[failed].mark_down(now);
+        channels_[failed]->disconnect();   // 丢弃半断开的客户端及其回调，恢复后由探测重连
+        std::vector<bool> tried(channels_.size(), false);
+        tried[failed] = true;
+        active_ = pick(now, tried);
+        EDGESTELLE_LOG_ERR("⚠️  broker %s 发布失败 (%s)，切换到 %s", channels_[failed]->uri().c_str(),
+                           sent.error().message.c_str(), channels_[active_]->uri().c_str());
+        if (!channels_[active_]->connected()) {
+            channels_[active_]->connect_async();
+            if (auto conn = wait_connected(); !conn) return conn;
+        }
+        return channels_[active_]->publish(topic, payload, qos);
+    }
+
+    void disconnect() {
+        for (auto& ch : channels_) ch->disconnect();   // 等待进行中的探测结束
+        probe_ = kNone;
+    }
+
+private:
+    static constexpr size_t kNone = static_cast<size_t>(-1);
+
+    /**
+     * 按偏好顺序选第一个可用且未尝试过的 broker；都在退避中时选最早恢复的；
+     * 全部尝试过返回 kNone。
+     */
+    size_t pick(BrokerHealth::clock::time_point now, const std::vector<bool>& tried) const {
+        size_t fallback = kNone;
+        for (size_t n : order_) {
+            if (!tried.empty() && tried[n]) continue;
+            if (health_[n].available(now)) return n;
+            if (fallback == kNone || health_[n].down_until() < health_[fallback].down_until()) fallback = n;
+        }
+        return fallback;
+    }
+
+    size_t rank(size_t node) const {
+        return static_cast<size_t>(std::find(order_.begin(), order_.end(), node) - order_.begin());
+    }
+
+    /**
+     * 运行在备用 broker 上时，定期向更靠前的 broker 发起后台连接；连上即回切。
+     */
+    void maybe_fail_back() {
+        auto now = BrokerHealth::clock::now();
+        if (probe_ != kNone) {
+            if (!probe_state_.finished()) return;   // 探测仍在进行，不等待
+            Channel& p = *channels_[probe_];
+            size_t probed = probe_;
+            probe_ = kNone;
+            if (!p.wait_connected()) {
+                health_[probed].mark_down(now);
+            } else if (rank(probed) < rank(active_)) {
+                health_[probed].mark_up();
+                EDGESTELLE_LOG("🔁 broker %s 已恢复，回切", p.uri().c_str());
+                channels_[active_]->disconnect();
+                active_ = probed;
+                return;
+            } else {
+                p.disconnect();
+            }
+        }
+        if (channels_.size() == 1 || rank(active_) == 0 || now < next_probe_) return;
+        next_probe_ = now + probe_interval_;
+
+        for (size_t n : order_) {
+            if (n == active_) break;
+            if (!health_[n].available(now)) continue;
+            probe_state_.reset();
+            if (channels_[n]->connect_async(&probe_state_)) probe_ = n;
+            break;
+        }
+    }
+
+    std::vector<std::unique_ptr<Channel>> channels_;
+    std::vector<BrokerHealth>             health_;
+    std::vector<size_t>                   order_;      // 本设备的 broker 偏好顺序
+    size_t                                active_ = 0;
+    size_t                                probe_  = kNone;   // 正在探测的 broker
+    ConnectProbe                          probe_state_;
+    BrokerHealth::clock::time_point       next_probe_{};
+    std::chrono::milliseconds             probe_interval_ = kProbeInterval;
+};
+
+using FailoverChannel = BasicFailoverChannel<MqttChannel>;
+
+} // namespace detail
+} // namespace edgestelle
+
+#endif // EDGESTELLE_BROKERS_HPP
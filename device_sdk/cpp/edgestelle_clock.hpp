@@ -0,0 +1,114 @@
+/*
+ * EdgeStelle — C++ Device SDK: 可注入时钟
+ *
+ * 报告时间戳与采样周期之间的休眠都经由 Clock:
+ *   - SystemClock: 墙钟 + 真实休眠 (默认)；
+ *   - VirtualClock: 从给定起点开始，sleep_for() 只推进内部时间、立即返回。
+ *
+ * 虚拟时钟配合 DeviceConfig::seed / FleetConfig::seed，可在数秒内快进生成
+ * 一整天的上报数据，且多次运行的报告内容逐字节一致，用于整条链路的回归基准。
+ */
+
+#ifndef EDGESTELLE_CLOCK_HPP
+#define EDGESTELLE_CLOCK_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+namespace edgestelle {
+
+class Clock {
+public:
+    using time_point = std::chrono::system_clock::time_point;
+
+    virtual ~Clock() = default;
+
+    /**
+     * 当前时间 (用于报告时间戳与场景时刻)。
+     */
+    virtual time_point now() const = 0;
+
+    /**
+     * 休眠 d；stop 置位时尽快返回。
+     */
+    virtual void sleep_for(std::chrono::milliseconds d, const std::atomic<bool>& stop) = 0;
+
+    /**
+     * 供另一个线程使用的副本，从当前时刻起独立推进；可跨线程共享的时钟返回 nullptr。
+     */
+    virtual std::unique_ptr<Clock> fork() const { return nullptr; }
+};
+
+class SystemClock final : public Clock {
+public:
+    static SystemClock& instance() {
+        static SystemClock clock;
+        return clock;
+    }
+
+    time_point now() const override { return std::chrono::system_clock::now(); }
+
+    void sleep_for(std::chrono::milliseconds d, const std::atomic<bool>& stop) override {
+        // 分片休眠，保证 stop 能及时生效
+        auto deadline = std::chrono::steady_clock::now() + d;
+        while (!stop && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                std::chrono::milliseconds(100), deadline - std::chrono::steady_clock::now()));
+        }
+    }
+};
+
+/**
+ * 快进时钟。不加锁，只应在驱动模拟的线程上使用。
+ */
+class VirtualClock final : public Clock {
+public:
+    explicit VirtualClock(time_point start) : now_(start) {}
+
+    /**
+     * @param epoch_s  起点 (Unix 秒)
+     */
+    explicit VirtualClock(int64_t epoch_s = 0)
+        : now_(std::chrono::system_clock::from_time_t(static_cast<std::time_t>(epoch_s))) {}
+
+    time_point now() const override { return now_; }
+
+    void sleep_for(std::chrono::milliseconds d, const std::atomic<bool>&) override { advance(d); }
+
+    std::unique_ptr<Clock> fork() const override { return std::make_unique<VirtualClock>(now_); }
+
+    void advance(std::chrono::milliseconds d) { now_ += d; }
+
+private:
+    time_point now_;
+};
+
+namespace detail {
+
+/**
+ * 由全局种子与设备 id 派生该设备的随机流种子 (FNV-1a + splitmix64 终混)，
+ * 同一全局种子下各设备的序列互不相关且可复现。
+ */
+inline uint64_t derive_seed(uint64_t seed, std::string_view device_id) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : device_id) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    uint64_t z = seed + h + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+} // namespace detail
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_CLOCK_HPP
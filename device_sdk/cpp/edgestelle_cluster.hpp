@@ -0,0 +1,881 @@
+/*
+ * EdgeStelle — C++ Device SDK: 分布式压测 (协调端 + worker 进程)
+ *
+ * 单台主机模拟的设备流量压不满大型 broker 集群时，把舰队 (edgestelle_fleet.hpp) 分给
+ * 多个 worker 进程，可以在同一主机上，也可以在不同主机上:
+ *
+ *   协调端   FleetCoordinator 监听一个 TCP 端口，等齐 workers 个 worker 后按各自上报的
+ *            核分区数分配设备全局序号区间 [first, first + count) 与目标速率 (报告/秒)，
+ *            各 worker 就绪后约定一个统一的开始时刻，结束时把各 worker 的计数与 tick
+ *            耗时直方图合并为一份报告；
+ *   worker   FleetWorker 连接协调端，按分配构造 FleetSimulator (FleetConfig::first_device
+ *            = first)，在 set_start_gate() 中等待开始时刻，运行结束后回传结果。
+ *
+ * 协调端可以自己拉起本机 worker (spawn()，以同一程序、同样的参数与环境另起进程)，
+ * 便于单机多进程验证；其他主机上的 worker 以 FLEET_COORDINATOR=<host>:<port> 启动。
+ *
+ * 模拟器与场景按设备全局序号取随机数，种子由协调端统一下发，因而各 worker 的报告与
+ * 单进程运行同一舰队时逐台一致 (捕获文件按行排序后相同)。开始时刻按墙钟 (Unix 毫秒)
+ * 约定，跨主机运行需要 NTP 同步；各 worker 的 broker、API 地址与场景文件取自各自的配置。
+ *
+ * 协议为按行的文本，每行 "<动词> key=value ..."，值中不含空白:
+ *
+ *   worker → 协调端  HELLO host=<主机名> pid=<pid> cpus=<核分区数>
+ *   协调端 → worker  ASSIGN worker=<k> template=<id> first=<n> count=<n> rate=<报告/秒> ticks=<n> seed=<n>
+ *   worker → 协调端  READY | ERROR msg=<原因>
+ *   协调端 → worker  START at_ms=<Unix 毫秒> | ABORT
+ *   协调端 → worker  STOP                      (运行中，协调端收到 stop() 时)
+ *   worker → 协调端  RESULT sampled=.. published=.. dropped=.. shed=.. anomalous=.. acked=.. failed=..
+ *                    elapsed_ms=.. tick_ms=<LatencyHistogram::encode()> | ERROR msg=<原因>
+ *
+ * 错误原因中的空白替换为 '_'。任一 worker 出错或断开时协调端向其余 worker 发 ABORT
+ * (运行中则发 STOP) 并返回错误。
+ */
+
+#ifndef EDGESTELLE_CLUSTER_HPP
+#define EDGESTELLE_CLUSTER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "edgestelle_fleet.hpp"
+
+extern char** environ;
+
+namespace edgestelle {
+
+/**
+ * 一次分布式压测 (或其中一个 worker) 的结果。
+ */
+struct FleetReport {
+    size_t           workers     = 0;
+    size_t           devices     = 0;
+    double           target_rate = 0.0;   // 报告/秒
+    uint64_t         sampled     = 0;
+    uint64_t         published   = 0;
+    uint64_t         dropped     = 0;
+    uint64_t         shed        = 0;
+    uint64_t         anomalous   = 0;
+    uint64_t         acked       = 0;
+    uint64_t         failed      = 0;
+    double           elapsed_s   = 0.0;   // 合并后取最慢的 worker
+    LatencyHistogram tick_ms;             // 各 worker 各分区每个 tick 的耗时
+
+    double rate() const { return elapsed_s > 0.0 ? static_cast<double>(published) / elapsed_s : 0.0; }
+
+    void merge(const FleetReport& o) {
+        workers     += o.workers;
+        devices     += o.devices;
+        target_rate += o.target_rate;
+        sampled     += o.sampled;
+        published   += o.published;
+        dropped     += o.dropped;
+        shed        += o.shed;
+        anomalous   += o.anomalous;
+        acked       += o.acked;
+        failed      += o.failed;
+        elapsed_s    = std::max(elapsed_s, o.elapsed_s);
+        tick_ms.merge(o.tick_ms);
+    }
+};
+
+namespace detail {
+
+/**
+ * 按行收发的 TCP 连接 (拥有 fd)。
+ */
+class LineChannel {
+public:
+    LineChannel() = default;
+    explicit LineChannel(int fd) : fd_(fd) {}
+    ~LineChannel() { close(); }
+
+    LineChannel(LineChannel&& o) noexcept : fd_(o.fd_), buf_(std::move(o.buf_)) { o.fd_ = -1; }
+    LineChannel& operator=(LineChannel&& o) noexcept {
+        if (this != &o) {
+            close();
+            fd_  = o.fd_;
+            buf_ = std::move(o.buf_);
+            o.fd_ = -1;
+        }
+        return *this;
+    }
+
+    int  fd()   const { return fd_; }
+    bool open() const { return fd_ >= 0; }
+
+    void close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    Result<void> send(std::string line) {
+        line += '\n';
+        for (size_t off = 0; off < line.size();) {
+            ssize_t n = ::send(fd_, line.data() + off, line.size() - off, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return Error{Errc::cluster, std::string("发送失败: ") + std::strerror(errno)};
+            off += static_cast<size_t>(n);
+        }
+        return {};
+    }
+
+    /**
+     * 读一行 (不含换行) 到 out。timeout_ms 内没有完整的一行时返回 false (可再次调用)，
+     * 对端关闭或出错时返回错误；timeout_ms < 0 表示一直等待。
+     */
+    Result<bool> read_line(std::string& out, int timeout_ms) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+        for (;;) {
+            if (size_t nl = buf_.find('\n'); nl != std::string::npos) {
+                out.assign(buf_, 0, nl);
+                if (!out.empty() && out.back() == '\r') out.pop_back();
+                buf_.erase(0, nl + 1);
+                return true;
+            }
+            int wait = -1;
+            if (timeout_ms >= 0) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+                wait = static_cast<int>(std::max<int64_t>(left, 0));
+            }
+            pollfd p{fd_, POLLIN, 0};
+            int rc = ::poll(&p, 1, wait);
+            if (rc < 0 && errno == EINTR) continue;
+            if (rc < 0) return Error{Errc::cluster, std::string("poll: ") + std::strerror(errno)};
+            if (rc == 0) return false;
+            char chunk[4096];
+            ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n == 0) return Error{Errc::cluster, "连接已关闭"};
+            if (n < 0) return Error{Errc::cluster, std::string("接收失败: ") + std::strerror(errno)};
+            buf_.append(chunk, static_cast<size_t>(n));
+        }
+    }
+
+private:
+    int         fd_ = -1;
+    std::string buf_;   // 已收到、尚未成行的字节
+};
+
+/**
+ * "<host>:<port>" 拆分 (按最后一个冒号)。
+ */
+inline Result<std::pair<std::string, std::string>> split_host_port(const std::string& addr) {
+    size_t colon = addr.rfind(':');
+    if (colon == std::string::npos || colon + 1 == addr.size()) {
+        return Error{Errc::cluster, "地址须为 <host>:<port>: " + addr};
+    }
+    std::string host = addr.substr(0, colon);
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+    return std::make_pair(host, addr.substr(colon + 1));
+}
+
+inline Result<int> tcp_listen(const std::string& addr) {
+    auto hp = split_host_port(addr);
+    if (!hp) return hp.error();
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_PASSIVE;
+    addrinfo* res = nullptr;
+    const std::string& host = hp.value().first;
+    if (int rc = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), hp.value().second.c_str(), &hints, &res);
+        rc != 0) {
+        return Error{Errc::cluster, addr + ": " + ::gai_strerror(rc)};
+    }
+    std::string why = "无可用地址";
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, 64) == 0) {
+            ::freeaddrinfo(res);
+            return fd;
+        }
+        why = std::strerror(errno);
+        ::close(fd);
+    }
+    ::freeaddrinfo(res);
+    return Error{Errc::cluster, "监听 " + addr + " 失败: " + why};
+}
+
+inline Result<int> tcp_connect(const std::string& addr) {
+    auto hp = split_host_port(addr);
+    if (!hp) return hp.error();
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (int rc = ::getaddrinfo(hp.value().first.c_str(), hp.value().second.c_str(), &hints, &res); rc != 0) {
+        return Error{Errc::cluster, addr + ": " + ::gai_strerror(rc)};
+    }
+    std::string why = "无可用地址";
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            ::freeaddrinfo(res);
+            return fd;
+        }
+        why = std::strerror(errno);
+        ::close(fd);
+    }
+    ::freeaddrinfo(res);
+    return Error{Errc::cluster, "连接协调端 " + addr + " 失败: " + why};
+}
+
+/**
+ * 协议行的动词 (第一个空格之前)。
+ */
+inline std::string_view verb(std::string_view line) { return line.substr(0, line.find(' ')); }
+
+/**
+ * 协议行中 key=value 的值，缺失时返回 nullopt。
+ */
+inline std::optional<std::string> field(std::string_view line, std::string_view key) {
+    for (size_t pos = line.find(' '); pos != std::string_view::npos;) {
+        size_t start = pos + 1;
+        size_t end   = line.find(' ', start);
+        std::string_view kv = line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+        if (kv.size() > key.size() && kv.substr(0, key.size()) == key && kv[key.size()] == '=') {
+            return std::string(kv.substr(key.size() + 1));
+        }
+        pos = end;
+    }
+    return std::nullopt;
+}
+
+inline uint64_t field_u64(std::string_view line, std::string_view key) {
+    auto v = field(line, key);
+    return v ? std::strtoull(v->c_str(), nullptr, 10) : 0;
+}
+
+inline double field_f64(std::string_view line, std::string_view key) {
+    auto v = field(line, key);
+    return v ? std::strtod(v->c_str(), nullptr) : 0.0;
+}
+
+/**
+ * 把任意文本变成不含空白的协议值。
+ */
+inline std::string token(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) {
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') c = '_';
+    }
+    return out.empty() ? "-" : out;
+}
+
+/**
+ * 每台设备每 ms 至多发布一份 (FleetConfig::tick_ms 不小于 1)，devices 台设备达不到 rate 时返回错误。
+ */
+inline Result<void> check_rate(size_t devices, double rate) {
+    if (rate * 1e-3 <= static_cast<double>(devices)) return {};
+    char msg[160];
+    std::snprintf(msg, sizeof(msg), "目标 %.0f 报告/秒超出 %zu 台设备的上限 %zu (每台每 ms 至多一份)",
+                  rate, devices, devices * 1000);
+    return Error{Errc::sim_config, msg};
+}
+
+inline std::string encode_result(const FleetReport& r) {
+    char buf[320];
+    std::snprintf(buf, sizeof(buf),
+                  "RESULT sampled=%llu published=%llu dropped=%llu shed=%llu anomalous=%llu acked=%llu "
+                  "failed=%llu elapsed_ms=%.3f tick_ms=",
+                  static_cast<unsigned long long>(r.sampled), static_cast<unsigned long long>(r.published),
+                  static_cast<unsigned long long>(r.dropped), static_cast<unsigned long long>(r.shed),
+                  static_cast<unsigned long long>(r.anomalous), static_cast<unsigned long long>(r.acked),
+                  static_cast<unsigned long long>(r.failed), r.elapsed_s * 1e3);
+    return buf + r.tick_ms.encode();
+}
+
+inline Result<FleetReport> decode_result(std::string_view line) {
+    FleetReport r;
+    r.sampled   = field_u64(line, "sampled");
+    r.published = field_u64(line, "published");
+    r.dropped   = field_u64(line, "dropped");
+    r.shed      = field_u64(line, "shed");
+    r.anomalous = field_u64(line, "anomalous");
+    r.acked     = field_u64(line, "acked");
+    r.failed    = field_u64(line, "failed");
+    r.elapsed_s = field_f64(line, "elapsed_ms") / 1e3;
+    auto hist = field(line, "tick_ms");
+    if (!hist) return Error{Errc::cluster, "RESULT 缺少 tick_ms"};
+    auto decoded = LatencyHistogram::decode(*hist);
+    if (!decoded) return decoded.error();
+    r.tick_ms = std::move(decoded).value();
+    return r;
+}
+
+inline int64_t unix_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace detail
+
+struct CoordinatorConfig {
+    std::string listen           = "0.0.0.0:7070";   // "<host>:<port>"，端口为 0 时由系统分配
+    size_t      workers          = 1;                // 等齐这么多个 worker 后开始
+    size_t      devices          = 100;
+    double      rate             = 0.0;              // 全舰队目标报告/秒 (至多设备数 × 1000)，0 表示每台设备每 tick_ms 一份
+    int         tick_ms          = 1000;
+    uint64_t    seed             = 42;
+    int         start_delay_ms   = 1000;             // 全部就绪后再过多久开始 (留给 START 送达)
+    int         join_timeout_ms  = 60000;            // 等待 worker 连接与就绪的上限
+};
+
+class FleetCoordinator {
+public:
+    explicit FleetCoordinator(CoordinatorConfig cfg) : cfg_(std::move(cfg)) {}
+
+    ~FleetCoordinator() {
+        if (listen_fd_ >= 0) ::close(listen_fd_);
+        reap(std::chrono::seconds(5));
+    }
+
+    FleetCoordinator(const FleetCoordinator&)            = delete;
+    FleetCoordinator& operator=(const FleetCoordinator&) = delete;
+
+    /**
+     * 开始监听 CoordinatorConfig::listen。
+     */
+    Result<void> listen() {
+        auto fd = detail::tcp_listen(cfg_.listen);
+        if (!fd) return fd.error();
+        listen_fd_ = fd.value();
+        sockaddr_storage addr{};
+        socklen_t len = sizeof(addr);
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port
+                                                 : reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+        EDGESTELLE_LOG("🛰️  协调端监听 %s (端口 %d)，等待 %zu 个 worker", cfg_.listen.c_str(), port_, cfg_.workers);
+        return {};
+    }
+
+    int port() const { return port_; }
+
+    /**
+     * 在本机拉起 n 个 worker：以 argv 重新执行当前程序 (/proc/self/exe)，环境变量沿用本进程，
+     * 去掉 unset 中列出的变量并加上 FLEET_COORDINATOR=127.0.0.1:<port>。须在 listen() 之后调用。
+     */
+    Result<void> spawn(const std::vector<std::string>& argv, size_t n, const std::vector<std::string>& unset = {}) {
+        std::vector<std::string> env;
+        for (char** e = environ; *e; ++e) {
+            std::string_view kv(*e);
+            std::string_view name = kv.substr(0, kv.find('='));
+            if (name == "FLEET_COORDINATOR") continue;
+            if (std::find(unset.begin(), unset.end(), name) != unset.end()) continue;
+            env.emplace_back(kv);
+        }
+        env.push_back("FLEET_COORDINATOR=127.0.0.1:" + std::to_string(port_));
+
+        std::vector<char*> args, envp;
+        for (const auto& a : argv) args.push_back(const_cast<char*>(a.c_str()));
+        args.push_back(nullptr);
+        for (auto& e : env) envp.push_back(e.data());
+        envp.push_back(nullptr);
+        for (size_t k = 0; k < n; ++k) {
+            pid_t pid = 0;
+            if (int rc = ::posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, args.data(), envp.data()); rc != 0) {
+                return Error{Errc::cluster, std::string("拉起 worker 失败: ") + std::strerror(rc)};
+            }
+            children_.push_back(pid);
+        }
+        EDGESTELLE_LOG("🛰️  已在本机拉起 %zu 个 worker", n);
+        return {};
+    }
+
+    /**
+     * 等齐 worker、分配、同步开始并等待结果，返回合并后的报告。
+     *
+     * @param ticks  各 worker 运行的周期数 (<0 表示直到 stop())
+     */
+    Result<FleetReport> run(const std::string& template_id, int ticks) {
+        stop_      = false;
+        stop_sent_ = false;
+        auto result = [&]() -> Result<FleetReport> {
+            if (auto r = accept_workers(); !r) return r.error();
+            if (auto r = assign(template_id, ticks); !r) return r.error();
+            if (auto r = start(); !r) return r.error();
+            return collect();
+        }();
+        if (!result) {
+            for (auto& w : workers_) {
+                if (w.ch.open() && !w.finished) w.ch.send(w.started ? "STOP" : "ABORT");
+            }
+        }
+        workers_.clear();
+        reap(std::chrono::seconds(30));
+        if (result) log_report(result.value());
+        return result;
+    }
+
+    /**
+     * 请求各 worker 在当前周期结束后收尾并回传结果 (可在信号处理中调用)。
+     */
+    void stop() { stop_ = true; }
+
+    /**
+     * 各 worker 的结果 (run() 成功后有效)，按分配顺序。
+     */
+    const std::vector<FleetReport>& worker_reports() const { return reports_; }
+
+    /**
+     * 各 worker 分到的第一台设备的全局序号，与 worker_reports() 对应。
+     */
+    const std::vector<size_t>& worker_first_devices() const { return firsts_; }
+
+private:
+    struct Worker {
+        detail::LineChannel ch;
+        std::string         host;
+        long                pid      = 0;
+        size_t              cpus     = 1;
+        size_t              first    = 0;
+        size_t              count    = 0;
+        bool                ready    = false;
+        bool                started  = false;
+        bool                finished = false;
+    };
+
+    Result<void> accept_workers() {
+        if (listen_fd_ < 0) {
+            if (auto r = listen(); !r) return r;
+        }
+        if (cfg_.workers == 0 || cfg_.workers > cfg_.devices) {
+            return Error{Errc::sim_config, "worker 数须在 1 与设备数之间"};
+        }
+        workers_.clear();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(cfg_.join_timeout_ms);
+        while (workers_.size() < cfg_.workers) {
+            if (stop_) return Error{Errc::cluster, "已取消"};
+            if (std::chrono::steady_clock::now() > deadline) {
+                return Error{Errc::cluster, "等待 worker 超时 (已连接 " + std::to_string(workers_.size()) + " 个)"};
+            }
+            if (auto r = check_children(); !r) return r;
+            pollfd p{listen_fd_, POLLIN, 0};
+            if (::poll(&p, 1, 200) <= 0) continue;
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) continue;
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            Worker w;
+            w.ch = detail::LineChannel(fd);
+            std::string line;
+            auto hello = w.ch.read_line(line, 5000);
+            if (!hello || !hello.value() || detail::verb(line) != "HELLO") {
+                EDGESTELLE_LOG_ERR("⚠️  忽略未发送 HELLO 的连接");
+                continue;
+            }
+            w.host = detail::field(line, "host").value_or("?");
+            w.pid  = static_cast<long>(detail::field_u64(line, "pid"));
+            w.cpus = std::max<size_t>(1, detail::field_u64(line, "cpus"));
+            EDGESTELLE_LOG("🛰️  worker %zu: %s pid %ld，%zu 个核分区", workers_.size(), w.host.c_str(), w.pid, w.cpus);
+            workers_.push_back(std::move(w));
+        }
+        return {};
+    }
+
+    /**
+     * 按核分区数加权切分设备区间；每台设备的速率相同，worker 的目标速率与其设备数成正比。
+     */
+    Result<void> assign(const std::string& template_id, int ticks) {
+        if (auto r = detail::check_rate(cfg_.devices, cfg_.rate); !r) return r;
+        size_t total = 0;
+        for (const auto& w : workers_) total += w.cpus;
+        double per_device = cfg_.rate > 0.0 ? cfg_.rate / static_cast<double>(cfg_.devices)
+                                            : 1000.0 / std::max(1, cfg_.tick_ms);
+        size_t acc = 0;
+        firsts_.clear();
+        for (size_t k = 0; k < workers_.size(); ++k) {
+            auto& w = workers_[k];
+            w.first = cfg_.devices * acc / total;
+            firsts_.push_back(w.first);
+            acc += w.cpus;
+            w.count = cfg_.devices * acc / total - w.first;
+            if (w.count == 0) return Error{Errc::sim_config, "worker " + std::to_string(k) + " 未分到设备"};
+            char buf[256];
+            std::snprintf(buf, sizeof(buf), "ASSIGN worker=%zu template=%s first=%zu count=%zu rate=%.6f ticks=%d seed=%llu",
+                          k, detail::token(template_id).c_str(), w.first, w.count,
+                          per_device * static_cast<double>(w.count), ticks,
+                          static_cast<unsigned long long>(cfg_.seed));
+            if (auto r = w.ch.send(buf); !r) return worker_error(k, r.error());
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(cfg_.join_timeout_ms);
+        return wait_each([&](size_t k, const std::string& line) -> Result<bool> {
+            if (detail::verb(line) == "READY") {
+                workers_[k].ready = true;
+                return true;
+            }
+            return unexpected(k, line);
+        }, [&](const Worker& w) { return w.ready; }, deadline);
+    }
+
+    Result<void> start() {
+        int64_t at = detail::unix_ms() + cfg_.start_delay_ms;
+        for (size_t k = 0; k < workers_.size(); ++k) {
+            if (auto r = workers_[k].ch.send("START at_ms=" + std::to_string(at)); !r) return worker_error(k, r.error());
+            workers_[k].started = true;
+        }
+        EDGESTELLE_LOG("🛰️  %zu 个 worker 就绪，%d ms 后开始", workers_.size(), cfg_.start_delay_ms);
+        return {};
+    }
+
+    Result<FleetReport> collect() {
+        reports_.assign(workers_.size(), FleetReport{});
+        auto r = wait_each([&](size_t k, const std::string& line) -> Result<bool> {
+            if (detail::verb(line) != "RESULT") return unexpected(k, line);
+            auto rep = detail::decode_result(line);
+            if (!rep) return worker_error(k, rep.error());
+            rep.value().workers     = 1;
+            rep.value().devices     = workers_[k].count;
+            rep.value().target_rate = cfg_.rate > 0.0
+                ? cfg_.rate * static_cast<double>(workers_[k].count) / static_cast<double>(cfg_.devices)
+                : static_cast<double>(workers_[k].count) * 1000.0 / std::max(1, cfg_.tick_ms);
+            reports_[k] = std::move(rep).value();
+            workers_[k].finished = true;
+            return true;
+        }, [](const Worker& w) { return w.finished; }, std::nullopt);
+        if (!r) return r.error();
+
+        FleetReport merged;
+        for (const auto& rep : reports_) merged.merge(rep);
+        return merged;
+    }
+
+    /**
+     * 轮询各 worker 的连接，把收到的行交给 on_line，直到 done(w) 对全部 worker 成立。
+     * 期间收到 stop()：已开始的运行向各 worker 转发 STOP 并继续等待结果，否则放弃。
+     */
+    template <class OnLine, class Done>
+    Result<void> wait_each(OnLine&& on_line, Done&& done,
+                           std::optional<std::chrono::steady_clock::time_point> deadline) {
+        std::vector<pollfd> fds(workers_.size());
+        for (;;) {
+            size_t pending = 0;
+            for (size_t k = 0; k < workers_.size(); ++k) {
+                bool d = done(workers_[k]);
+                fds[k] = pollfd{d ? -1 : workers_[k].ch.fd(), POLLIN, 0};
+                pending += d ? 0 : 1;
+            }
+            if (pending == 0) return {};
+            if (stop_ && !stop_sent_) {
+                stop_sent_ = true;
+                for (auto& w : workers_) {
+                    if (!w.started) return Error{Errc::cluster, "已取消"};
+                    if (!w.finished) w.ch.send("STOP");
+                }
+            }
+            if (deadline && std::chrono::steady_clock::now() > *deadline) {
+                return Error{Errc::cluster, "等待 worker 超时"};
+            }
+            if (auto r = check_children(); !r) return r;
+            if (::poll(fds.data(), fds.size(), 200) <= 0) continue;
+            for (size_t k = 0; k < workers_.size(); ++k) {
+                if (fds[k].fd < 0 || fds[k].revents == 0) continue;
+                std::string line;
+                for (;;) {
+                    auto got = workers_[k].ch.read_line(line, 0);
+                    if (!got) return worker_error(k, got.error());
+                    if (!got.value()) break;
+                    auto handled = on_line(k, line);
+                    if (!handled) return handled.error();
+                    if (done(workers_[k])) break;
+                }
+            }
+        }
+    }
+
+    Error unexpected(size_t k, const std::string& line) {
+        if (detail::verb(line) == "ERROR") {
+            return Error{Errc::cluster, "worker " + std::to_string(k) + " (" + workers_[k].host + "): " +
+                                            detail::field(line, "msg").value_or("?")};
+        }
+        return Error{Errc::cluster, "worker " + std::to_string(k) + " 发来意外的消息: " + line.substr(0, 64)};
+    }
+
+    Error worker_error(size_t k, const Error& err) {
+        workers_[k].finished = true;   // 连接已不可用，不再转发 STOP / ABORT
+        return Error{Errc::cluster, "worker " + std::to_string(k) + " (" + workers_[k].host + "): " + err.message};
+    }
+
+    /**
+     * 本机拉起的 worker 提前退出时报错 (连接断开之外更早发现启动失败)。
+     */
+    Result<void> check_children() {
+        for (auto it = children_.begin(); it != children_.end();) {
+            int status = 0;
+            if (::waitpid(*it, &status, WNOHANG) != *it) {
+                ++it;
+                continue;
+            }
+            pid_t pid = *it;
+            it = children_.erase(it);
+            if (!(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+                return Error{Errc::cluster, "本机 worker 进程 " + std::to_string(pid) + " 异常退出"};
+            }
+        }
+        return {};
+    }
+
+    /**
+     * 等待本机拉起的 worker 退出，超时后 SIGTERM。
+     */
+    void reap(std::chrono::seconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!children_.empty()) {
+            for (auto it = children_.begin(); it != children_.end();) {
+                it = ::waitpid(*it, nullptr, WNOHANG) == *it ? children_.erase(it) : std::next(it);
+            }
+            if (children_.empty()) break;
+            if (std::chrono::steady_clock::now() > deadline) {
+                for (pid_t pid : children_) ::kill(pid, SIGTERM);
+                for (pid_t pid : children_) ::waitpid(pid, nullptr, 0);
+                children_.clear();
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+
+    void log_report(const FleetReport& r) const {
+        const auto& h = r.tick_ms;
+        EDGESTELLE_LOG("📊 分布式压测: %zu 个 worker，%zu 台设备，耗时 %.1f s", r.workers, r.devices, r.elapsed_s);
+        EDGESTELLE_LOG("📊 已采样 %llu 已发布 %llu 丢弃 %llu 分片丢弃 %llu 异常 %llu 确认 %llu 失败 %llu",
+                       static_cast<unsigned long long>(r.sampled), static_cast<unsigned long long>(r.published),
+                       static_cast<unsigned long long>(r.dropped), static_cast<unsigned long long>(r.shed),
+                       static_cast<unsigned long long>(r.anomalous), static_cast<unsigned long long>(r.acked),
+                       static_cast<unsigned long long>(r.failed));
+        EDGESTELLE_LOG("📊 速率 %.0f 报告/秒 (目标 %.0f，%.0f%%)", r.rate(), r.target_rate,
+                       r.target_rate > 0.0 ? 100.0 * r.rate() / r.target_rate : 0.0);
+        EDGESTELLE_LOG("📊 tick 耗时 (ms，%llu 个): p50 %.2f  p90 %.2f  p99 %.2f  max %.2f",
+                       static_cast<unsigned long long>(h.count()), h.quantile(0.5), h.quantile(0.9),
+                       h.quantile(0.99), h.max());
+        for (size_t k = 0; k < reports_.size(); ++k) {
+            const auto& w = reports_[k];
+            EDGESTELLE_LOG("📊   worker %zu [%zu, %zu): 已发布 %llu，%.0f 报告/秒，tick p99 %.2f ms", k,
+                           firsts_[k], firsts_[k] + w.devices,
+                           static_cast<unsigned long long>(w.published), w.rate(), w.tick_ms.quantile(0.99));
+        }
+    }
+
+    CoordinatorConfig        cfg_;
+    int                      listen_fd_ = -1;
+    int                      port_      = 0;
+    std::vector<Worker>      workers_;
+    std::vector<pid_t>       children_;
+    std::vector<FleetReport> reports_;
+    std::vector<size_t>      firsts_;
+    std::atomic<bool>        stop_{false};
+    bool                     stop_sent_ = false;
+};
+
+/**
+ * worker 端：连接协调端，按分配运行一段舰队并回传结果。
+ */
+class FleetWorker {
+public:
+    /**
+     * @param fleet  除设备区间、速率与种子 (由协调端下发) 外的舰队配置，如 partitions / cpus
+     */
+    FleetWorker(const DeviceConfig& cfg, FleetConfig fleet, std::optional<Scenario> scenario = {})
+        : config_(cfg), fleet_(std::move(fleet)), scenario_(std::move(scenario)) {}
+
+    ~FleetWorker() { join_watcher(); }
+
+    FleetWorker(const FleetWorker&)            = delete;
+    FleetWorker& operator=(const FleetWorker&) = delete;
+
+    void set_clock(Clock& clock)                 { clock_ = &clock; }
+    void set_capture(std::FILE* capture)         { capture_ = capture; }
+    void set_shard_timeline(std::FILE* timeline) { shard_timeline_ = timeline; }
+
+    /**
+     * 连接 coordinator ("<host>:<port>")，运行分到的设备区间，返回本 worker 的结果。
+     */
+    Result<FleetReport> run(const std::string& coordinator, std::FILE* timeline = nullptr) {
+        stop_ = false;
+        auto fd = detail::tcp_connect(coordinator);
+        if (!fd) return fd.error();
+        ch_ = detail::LineChannel(fd.value());
+
+        char host[256] = "?";
+        ::gethostname(host, sizeof(host) - 1);
+        size_t cpus = fleet_.partitions == 0 ? detail::allowed_cpus().size() : fleet_.partitions;
+        if (auto r = ch_.send("HELLO host=" + detail::token(host) + " pid=" + std::to_string(::getpid()) +
+                              " cpus=" + std::to_string(cpus));
+            !r) {
+            return r.error();
+        }
+
+        std::string line;
+        if (auto r = wait_line(line); !r) return r.error();
+        if (detail::verb(line) != "ASSIGN") return Error{Errc::cluster, "期望 ASSIGN，收到: " + line.substr(0, 64)};
+        std::string template_id = detail::field(line, "template").value_or("");
+        FleetConfig fleet = fleet_;
+        fleet.first_device = detail::field_u64(line, "first");
+        fleet.devices      = detail::field_u64(line, "count");
+        fleet.seed         = detail::field_u64(line, "seed");
+        double rate        = detail::field_f64(line, "rate");
+        int    ticks       = static_cast<int>(std::strtol(detail::field(line, "ticks").value_or("-1").c_str(), nullptr, 10));
+        if (rate > 0.0) {
+            // tick 取每台设备的报告间隔向下取整 (至少 1 ms)，每 tick 发布的份数补足小数部分
+            if (auto r = detail::check_rate(fleet.devices, rate); !r) {
+                ch_.send("ERROR msg=" + detail::token(r.error().message));
+                return r.error();
+            }
+            double period_ms = static_cast<double>(fleet.devices) * 1000.0 / rate;
+            fleet.tick_ms          = static_cast<int>(std::min(period_ms, 3600e3));
+            fleet.reports_per_tick = rate * fleet.tick_ms / 1000.0;
+        }
+        EDGESTELLE_LOG("🛰️  worker %llu: 设备 [%zu, %zu)，目标 %.0f 报告/秒 (tick %d ms，每 tick %.2f 份)",
+                       static_cast<unsigned long long>(detail::field_u64(line, "worker")), fleet.first_device,
+                       fleet.first_device + fleet.devices, rate, fleet.tick_ms,
+                       rate > 0.0 ? fleet.reports_per_tick : static_cast<double>(fleet.devices));
+
+        FleetSimulator sim(config_, fleet, scenario_);
+        if (clock_) sim.set_clock(*clock_);
+        sim.set_capture(capture_);
+        sim.set_shard_timeline(shard_timeline_);
+        std::chrono::steady_clock::time_point began;
+        sim.set_start_gate([&]() -> Result<void> {
+            if (auto r = ch_.send("READY"); !r) return r;
+            std::string msg;
+            if (auto r = wait_line(msg); !r) return r.error();
+            if (detail::verb(msg) != "START") return Error{Errc::cluster, "协调端取消了本次运行"};
+            int64_t at = static_cast<int64_t>(detail::field_u64(msg, "at_ms"));
+            while (!stop_) {
+                int64_t left = at - detail::unix_ms();
+                if (left <= 0) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(std::min<int64_t>(left, 100)));
+            }
+            if (stop_) sim.stop();   // run() 开始时清除了此前的 stop()
+            began = std::chrono::steady_clock::now();
+            watch(sim);
+            return {};
+        });
+
+        sim_ = &sim;
+        auto done = sim.run(template_id, ticks, timeline);
+        sim_ = nullptr;
+        join_watcher();
+        if (!done) {
+            ch_.send("ERROR msg=" + detail::token(done.error().to_string()));
+            return done.error();
+        }
+
+        FleetReport r;
+        const FleetTick& s = sim.summary();
+        r.workers     = 1;
+        r.devices     = fleet.devices;
+        r.target_rate = rate;
+        r.sampled     = s.sampled;
+        r.published   = s.published;
+        r.dropped     = s.dropped;
+        r.shed        = s.shed;
+        r.anomalous   = s.anomalous;
+        r.acked       = s.acked;
+        r.failed      = s.failed;
+        r.elapsed_s   = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+        r.tick_ms     = sim.tick_histogram();
+        if (lost_) return Error{Errc::cluster, "与协调端的连接已断开"};
+        if (auto sent = ch_.send(detail::encode_result(r)); !sent) return sent.error();
+        ch_.close();
+        return r;
+    }
+
+    /**
+     * 请求当前运行在本周期结束后收尾 (可在信号处理中调用)；结果照常回传协调端。
+     */
+    void stop() {
+        stop_ = true;
+        if (FleetSimulator* sim = sim_.load()) sim->stop();
+    }
+
+private:
+    /**
+     * 等待协调端的下一行 (可被 stop() 打断)。
+     */
+    Result<void> wait_line(std::string& line) {
+        for (;;) {
+            auto got = ch_.read_line(line, 200);
+            if (!got) return Error{Errc::cluster, "与协调端的连接: " + got.error().message};
+            if (got.value()) return {};
+            if (stop_) return Error{Errc::cluster, "已取消"};
+        }
+    }
+
+    /**
+     * 运行期间在后台线程上读协调端：收到 STOP / ABORT 或连接断开时停止模拟。
+     */
+    void watch(FleetSimulator& sim) {
+        watching_ = true;
+        watcher_ = std::thread([this, &sim] {
+            std::string line;
+            while (watching_) {
+                auto got = ch_.read_line(line, 100);
+                if (!got) {
+                    EDGESTELLE_LOG_ERR("⚠️  与协调端的连接断开，停止运行");
+                    lost_ = true;
+                    sim.stop();
+                    return;
+                }
+                if (got.value() && (detail::verb(line) == "STOP" || detail::verb(line) == "ABORT")) {
+                    EDGESTELLE_LOG("🛰️  协调端要求停止");
+                    sim.stop();
+                }
+            }
+        });
+    }
+
+    void join_watcher() {
+        watching_ = false;
+        if (watcher_.joinable()) watcher_.join();
+    }
+
+    const DeviceConfig&          config_;
+    FleetConfig                  fleet_;
+    std::optional<Scenario>      scenario_;
+    Clock*                       clock_          = nullptr;
+    std::FILE*                   capture_        = nullptr;
+    std::FILE*                   shard_timeline_ = nullptr;
+
+    detail::LineChannel          ch_;
+    std::thread                  watcher_;
+    std::atomic<bool>            watching_{false};
+    std::atomic<bool>            lost_{false};
+    std::atomic<FleetSimulator*> sim_{nullptr};
+    std::atomic<bool>            stop_{false};
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_CLUSTER_HPP
@@ -0,0 +1,342 @@
+/*
+ * EdgeStelle — C++ Device SDK: 时间序列压缩编码
+ *
+ * Gorilla 风格的逐点编码 (Pelkonen et al., VLDB 2015)，按位写入调用方提供的缓冲，
+ * 编码状态为平凡结构体，可直接存放在 mmap 文件头中跨进程续写:
+ *
+ *   数值 (double)   首值 64 位原样；之后与前值异或:
+ *                     0                          与前值相同
+ *                     10 <有效位>                前导 / 尾随 0 不少于上一个块，沿用其窗口
+ *                     11 <5 位前导 0><6 位长度><有效位>
+ *   时间 (int64 ms) 首值 64 位原样；之后按二阶差分 dod 分桶:
+ *                     0 (dod = 0)   10 + 7 位   110 + 9 位   1110 + 12 位   1111 + 64 位
+ *
+ * 流中不记录点数，由调用方另行保存。按采样周期等间隔、缓慢变化的指标每点约 1 ~ 2 字节。
+ * put_value() / put_time() 在剩余空间不足一个点的最坏长度时整点拒绝写入，流不会留下半个点。
+ */
+
+#ifndef EDGESTELLE_CODEC_HPP
+#define EDGESTELLE_CODEC_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace edgestelle {
+namespace codec {
+
+// ═════════════════════════════════════════════════════
+//  位流
+// ═════════════════════════════════════════════════════
+
+/**
+ * 高位在前的位写入器。缓冲不必预先清零 (每进入一个新字节先将其置 0)；
+ * 空间不足时 put() 返回 false 且不写入。
+ */
+class BitWriter {
+public:
+    BitWriter(uint8_t* buf, size_t capacity, uint64_t bit_pos = 0)
+        : buf_(buf), cap_bits_(static_cast<uint64_t>(capacity) * 8), pos_(bit_pos) {}
+
+    bool put(uint64_t v, unsigned n) {
+        if (pos_ + n > cap_bits_) return false;
+        while (n > 0) {
+            auto     used = static_cast<unsigned>(pos_ & 7);
+            unsigned room = 8 - used;
+            unsigned take = std::min(room, n);
+            auto bits = static_cast<uint8_t>((v >> (n - take)) & ((1u << take) - 1));
+            uint8_t& byte = buf_[pos_ >> 3];
+            if (used == 0) byte = 0;
+            byte = static_cast<uint8_t>(byte | (bits << (room - take)));
+            pos_ += take;
+            n    -= take;
+        }
+        return true;
+    }
+
+    uint64_t bits()  const { return pos_; }
+    uint64_t room()  const { return cap_bits_ - pos_; }
+    size_t   bytes() const { return static_cast<size_t>((pos_ + 7) >> 3); }
+
+private:
+    uint8_t* buf_;
+    uint64_t cap_bits_;
+    uint64_t pos_;
+};
+
+/**
+ * 位读取器，读越界时 get() 返回 false。
+ */
+class BitReader {
+public:
+    BitReader(const uint8_t* buf, size_t size, uint64_t bit_pos = 0)
+        : buf_(buf), size_(size), size_bits_(static_cast<uint64_t>(size) * 8), pos_(bit_pos) {}
+
+    bool get(unsigned n, uint64_t& v) {
+        if (pos_ + n > size_bits_) return false;
+        if (n == 0) {
+            v = 0;
+            return true;
+        }
+        // 一次取出当前字节起的 8 个字节 (大端)；跨出这 64 位时再补下一字节
+        size_t   byte = static_cast<size_t>(pos_ >> 3);
+        auto     off  = static_cast<unsigned>(pos_ & 7);
+        uint64_t word = load(byte);
+        if (off + n <= 64) {
+            v = (word << off) >> (64 - n);
+        } else {
+            unsigned low = off + n - 64;
+            v = ((word << off) >> (64 - n)) | (static_cast<uint64_t>(buf_[byte + 8]) >> (8 - low));
+        }
+        pos_ += n;
+        return true;
+    }
+
+    uint64_t bits() const { return pos_; }
+
+private:
+    uint64_t load(size_t byte) const {
+        uint64_t word = 0;
+        if (byte + 8 <= size_) {
+            std::memcpy(&word, buf_ + byte, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            word = __builtin_bswap64(word);
+#endif
+        } else {
+            for (size_t i = 0; i < 8; ++i) word = (word << 8) | (byte + i < size_ ? buf_[byte + i] : 0);
+        }
+        return word;
+    }
+
+    const uint8_t* buf_;
+    size_t         size_;
+    uint64_t       size_bits_;
+    uint64_t       pos_;
+};
+
+// ═════════════════════════════════════════════════════
+//  数值 (XOR)
+// ═════════════════════════════════════════════════════
+
+struct XorState {
+    uint64_t prev    = 0;
+    uint8_t  lead    = 0;
+    uint8_t  trail   = 0;
+    bool     started = false;
+    bool     window  = false;   // lead / trail 有效
+};
+
+constexpr unsigned kMaxValueBits = 2 + 5 + 6 + 64;
+
+// n 个点的最坏编码长度 (字节)
+inline size_t xor_bound(size_t n) { return (n * kMaxValueBits + 7) / 8 + 8; }
+
+inline bool put_value(BitWriter& w, XorState& s, double v) {
+    if (w.room() < kMaxValueBits) return false;
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    if (!s.started) {
+        w.put(bits, 64);
+        s.prev    = bits;
+        s.started = true;
+        return true;
+    }
+    uint64_t x = bits ^ s.prev;
+    if (x == 0) {
+        w.put(0, 1);
+        return true;
+    }
+    auto lead  = static_cast<unsigned>(std::min(31, __builtin_clzll(x)));
+    auto trail = static_cast<unsigned>(__builtin_ctzll(x));
+    if (s.window && lead >= s.lead && trail >= s.trail) {
+        w.put(0b10, 2);
+        w.put(x >> s.trail, 64u - s.lead - s.trail);
+    } else {
+        unsigned len = 64 - lead - trail;
+        w.put(0b11, 2);
+        w.put(lead, 5);
+        w.put(len & 63, 6);   // 长度 64 以 0 表示
+        w.put(x >> trail, len);
+        s.lead   = static_cast<uint8_t>(lead);
+        s.trail  = static_cast<uint8_t>(trail);
+        s.window = true;
+    }
+    s.prev = bits;
+    return true;
+}
+
+inline bool get_value(BitReader& r, XorState& s, double& v) {
+    uint64_t bits = 0;
+    if (!s.started) {
+        if (!r.get(64, bits)) return false;
+        s.started = true;
+    } else {
+        uint64_t flag;
+        if (!r.get(1, flag)) return false;
+        if (flag == 0) {
+            bits = s.prev;
+        } else {
+            if (!r.get(1, flag)) return false;
+            if (flag == 1) {
+                uint64_t lead, len;
+                if (!r.get(5, lead) || !r.get(6, len)) return false;
+                if (len == 0) len = 64;
+                if (lead + len > 64) return false;
+                s.lead   = static_cast<uint8_t>(lead);
+                s.trail  = static_cast<uint8_t>(64 - lead - len);
+                s.window = true;
+            } else if (!s.window) {
+                return false;
+            }
+            uint64_t x;
+            if (!r.get(64 - s.lead - s.trail, x)) return false;
+            bits = s.prev ^ (x << s.trail);
+        }
+    }
+    s.prev = bits;
+    std::memcpy(&v, &bits, sizeof(v));
+    return true;
+}
+
+// ═════════════════════════════════════════════════════
+//  时间戳 (二阶差分)
+// ═════════════════════════════════════════════════════
+
+// 首个差分相对 0 编码，之后均为二阶差分
+struct DeltaState {
+    int64_t prev    = 0;
+    int64_t delta   = 0;
+    bool    started = false;
+};
+
+constexpr unsigned kMaxTimeBits = 4 + 64;
+
+inline size_t delta_bound(size_t n) { return (n * kMaxTimeBits + 7) / 8 + 8; }
+
+inline bool put_time(BitWriter& w, DeltaState& s, int64_t t) {
+    if (w.room() < kMaxTimeBits) return false;
+    if (!s.started) {
+        w.put(static_cast<uint64_t>(t), 64);
+        s.prev    = t;
+        s.started = true;
+        return true;
+    }
+    int64_t delta = t - s.prev;
+    int64_t dod   = delta - s.delta;
+    auto u = static_cast<uint64_t>(dod);
+    if (dod == 0) {
+        w.put(0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+        w.put(0b10, 2);
+        w.put(u & 0x7F, 7);
+    } else if (dod >= -256 && dod <= 255) {
+        w.put(0b110, 3);
+        w.put(u & 0x1FF, 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+        w.put(0b1110, 4);
+        w.put(u & 0xFFF, 12);
+    } else {
+        w.put(0b1111, 4);
+        w.put(u, 64);
+    }
+    s.prev  = t;
+    s.delta = delta;
+    return true;
+}
+
+inline bool get_time(BitReader& r, DeltaState& s, int64_t& t) {
+    uint64_t v;
+    if (!s.started) {
+        if (!r.get(64, v)) return false;
+        s.prev    = static_cast<int64_t>(v);
+        s.started = true;
+        t = s.prev;
+        return true;
+    }
+    // 前缀 1 的个数决定位宽
+    unsigned ones = 0;
+    for (; ones < 4; ++ones) {
+        if (!r.get(1, v)) return false;
+        if (v == 0) break;
+    }
+    static const unsigned widths[] = {0, 7, 9, 12, 64};
+    unsigned width = widths[ones];
+    int64_t dod = 0;
+    if (width > 0) {
+        if (!r.get(width, v)) return false;
+        // 符号扩展 (64 位宽时原样)
+        if (width < 64 && (v >> (width - 1)) & 1) v |= ~uint64_t{0} << width;
+        dod = static_cast<int64_t>(v);
+    }
+    s.delta += dod;
+    s.prev  += s.delta;
+    t = s.prev;
+    return true;
+}
+
+// ═════════════════════════════════════════════════════
+//  十进制定点
+// ═════════════════════════════════════════════════════
+
+// 按十进制记录的读数 (如 "53.27") 尾数低位近似随机，XOR 几乎不省空间；
+// 乘以 scale 后是整数的可改按 put_time() 的二阶差分编码整数
+constexpr int64_t kDecimalScales[] = {1, 10, 100, 1000, 10000};
+
+/**
+ * v × scale 是否为整数，且 整数 / scale 逐位还原 v。
+ */
+inline bool fits_scale(double v, int64_t scale) {
+    constexpr double kLimit = 9007199254740992.0;   // 2^53
+    auto   s = static_cast<double>(scale);
+    double x = v * s;
+    return std::fabs(x) < kLimit && static_cast<double>(std::llround(x)) / s == v;
+}
+
+inline int64_t to_fixed(double v, int64_t scale) { return std::llround(v * static_cast<double>(scale)); }
+
+/**
+ * v 适用的最小 scale，都不适用 (含非有限值) 时返回 0。
+ */
+inline int64_t decimal_scale(double v) {
+    for (int64_t scale : kDecimalScales) {
+        if (fits_scale(v, scale)) return scale;
+    }
+    return 0;
+}
+
+// ═════════════════════════════════════════════════════
+//  Base64
+// ═════════════════════════════════════════════════════
+
+inline size_t base64_size(size_t n) { return (n + 2) / 3 * 4; }
+
+/**
+ * 追加标准 Base64 (带 = 填充)，out 预留 base64_size(n) 时不申请堆内存。
+ */
+inline void append_base64(const uint8_t* data, size_t n, std::string& out) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t i = 0;
+    for (; i + 3 <= n; i += 3) {
+        uint32_t v = (uint32_t{data[i]} << 16) | (uint32_t{data[i + 1]} << 8) | data[i + 2];
+        out += table[(v >> 18) & 63];
+        out += table[(v >> 12) & 63];
+        out += table[(v >> 6) & 63];
+        out += table[v & 63];
+    }
+    if (i < n) {
+        uint32_t v = uint32_t{data[i]} << 16;
+        if (i + 1 < n) v |= uint32_t{data[i + 1]} << 8;
+        out += table[(v >> 18) & 63];
+        out += table[(v >> 12) & 63];
+        out += i + 1 < n ? table[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+}
+
+} // namespace codec
+} // namespace edgestelle
+
+#endif // EDGESTELLE_CODEC_HPP
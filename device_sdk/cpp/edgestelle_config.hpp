@@ -0,0 +1,148 @@
+/*
+ * EdgeStelle — C++ Device SDK: 配置
+ */
+
+#ifndef EDGESTELLE_CONFIG_HPP
+#define EDGESTELLE_CONFIG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "edgestelle_governor.hpp"
+
+// ─── 静态内存预算 (嵌入式构建可在编译期调小) ───
+#ifndef EDGESTELLE_MAX_METRICS
+#define EDGESTELLE_MAX_METRICS 4096              // 单个模板的指标数上限
+#endif
+#ifndef EDGESTELLE_MAX_TEMPLATE_BYTES
+#define EDGESTELLE_MAX_TEMPLATE_BYTES (1u << 20) // 模板响应体上限
+#endif
+#ifndef EDGESTELLE_MAX_PAYLOAD_BYTES
+#define EDGESTELLE_MAX_PAYLOAD_BYTES (256u << 10) // 单份报告序列化缓冲的预留大小
+#endif
+#ifndef EDGESTELLE_MAX_MESSAGE_BYTES
+#define EDGESTELLE_MAX_MESSAGE_BYTES (128u << 10) // 单条 MQTT 消息的默认上限，超出即分块发布
+#endif
+
+namespace edgestelle {
+
+// ═════════════════════════════════════════════════════
+//  配置
+// ═════════════════════════════════════════════════════
+
+/**
+ * TLS 配置，同时作用于 https:// 模板拉取与 ssl:// / mqtts:// broker。
+ *
+ * session_cache_path 非空时，HTTPS 的 TLS 会话票据会落盘并在进程重启后导入，
+ * 下次唤醒即可走恢复握手 (需 libcurl >= 8.12 且启用 ssls-export)。
+ */
+struct TlsConfig {
+    std::string ca_file;            // 自签名证书场景下的 CA
+    std::string cert_file;          // 客户端证书 (双向认证，可选)
+    std::string key_file;
+    bool        verify_peer = true;
+    std::string session_cache_path;
+};
+
+/**
+ * 单个发布道的参数 (见 edgestelle_lanes.hpp)。bytes_per_s 为 0 表示不整形；
+ * burst_bytes 为 0 时取 1 秒的配额。
+ */
+struct LaneConfig {
+    int    qos         = 1;
+    double bytes_per_s = 0.0;
+    size_t burst_bytes = 0;
+};
+
+/**
+ * 本地时序库的一个存储粒度 (见 edgestelle_tsdb.hpp)。interval_ms 为 0 表示原始点，
+ * 否则为 rollup 桶宽；retention_ms 为 0 表示不过期。
+ */
+struct StoreTier {
+    int64_t interval_ms  = 0;
+    int64_t retention_ms = 0;
+};
+
+/**
+ * run_loop() 采样线程的实时调度 (见 edgestelle_realtime.hpp)。任一项启用时周期按绝对
+ * 时刻对齐，并测量唤醒延迟；报告时间戳精确到微秒。
+ */
+struct RealtimeConfig {
+    int              priority             = 0;         // SCHED_FIFO 优先级 (1–99)，0 表示保持普通调度
+    std::vector<int> cpus;                             // 采样线程允许运行的 CPU，空表示不绑定
+    bool             lock_memory          = false;     // mlockall 并预先触碰栈与堆，运行中不再缺页
+    size_t           stack_prefault_bytes = 256 * 1024;
+    size_t           heap_prefault_bytes  = 4 << 20;
+
+    bool enabled() const { return priority > 0 || !cpus.empty() || lock_memory; }
+};
+
+struct DeviceConfig {
+    std::string device_id       = "edge-cpp-001";
+    std::string api_base_url    = "http://localhost:8000";
+    std::string mqtt_broker_uri = "tcp://localhost:1883";
+    // 多个 broker (非空时取代 mqtt_broker_uri)：单设备按 device_id 的一致性哈希顺序
+    // 故障转移，舰队模式按 device_id 分片到各 broker (见 edgestelle_brokers.hpp)
+    std::vector<std::string> mqtt_brokers;
+    std::string mqtt_username;
+    std::string mqtt_password;
+    std::string mqtt_topic_prefix = "iot/test/report";
+    TlsConfig   tls;
+
+    // 单条报告消息的上限 (字节)：报告超出时按 ReportSerializer::write_chunked 分块发布；
+    // 应不大于 broker 的 message_size_limit，0 表示不分块
+    size_t      max_message_bytes = EDGESTELLE_MAX_MESSAGE_BYTES;
+
+    // 连续运行 (run_loop) 参数；budget 约束 SDK 自身开销
+    int            sample_interval_ms = 1000;
+    int            batch_size         = 1;
+    int            queue_depth        = 256;   // 待发布报告槽位数，prepare() 时一次性分配
+    int            alert_queue_depth  = 32;    // 其中越界报告另有的槽位数
+    OverheadBudget budget;
+
+    // 发布分道：越界报告走 alert 道、先于积压的常规报告发出
+    LaneConfig     alert_lane         {1, 0.0, 0};
+    LaneConfig     routine_lane       {0, 0.0, 0};
+
+    // 采样线程的 SCHED_FIFO、绑核与内存锁定；启用时另导出唤醒延迟直方图
+    RealtimeConfig realtime;
+
+    // 非 0 时 run_loop() 在该端口以 Prometheus 文本格式提供 /metrics (见 edgestelle_exporter.hpp)
+    int            metrics_port       = 0;
+    std::string    metrics_bind       = "0.0.0.0";
+
+    // 飞行记录器保留的周期数：非 0 时逐周期记录全部指标，越界时把窗口压缩后随告警
+    // 发布到 <报告 topic>/flight (见 edgestelle_recorder.hpp)；path 为空时仅在内存中
+    int            flight_recorder_samples = 0;
+    std::string    flight_recorder_path;
+
+    // 本地时序库目录：非空时逐周期写入各指标，断网时仍可本地查询；指标端点开启时
+    // 另提供 GET /query。默认保留 6 小时原始点、7 天分钟桶、90 天小时桶
+    std::string            store_dir;
+    std::vector<StoreTier> store_tiers {{0, 6 * 3600 * 1000LL}, {60 * 1000, 7 * 86400 * 1000LL},
+                                        {3600 * 1000, 90 * 86400 * 1000LL}};
+    size_t                 store_segment_bytes = 16 * 1024;
+
+    // 模拟随机种子：0 表示每次运行随机；非 0 时与 device_id 一起派生该设备的随机流
+    uint64_t       seed               = 0;
+
+    std::string mqtt_report_topic() const {
+        return mqtt_topic_prefix + "/" + device_id;
+    }
+
+    std::vector<std::string> broker_uris() const {
+        return mqtt_brokers.empty() ? std::vector<std::string>{mqtt_broker_uri} : mqtt_brokers;
+    }
+
+    int report_qos(bool anomalous) const { return anomalous ? alert_lane.qos : routine_lane.qos; }
+
+    static bool uri_uses_tls(const std::string& uri) {
+        return uri.rfind("ssl://", 0) == 0 || uri.rfind("mqtts://", 0) == 0;
+    }
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_CONFIG_HPP
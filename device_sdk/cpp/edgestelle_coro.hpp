@@ -0,0 +1,550 @@
+/*
+ * EdgeStelle — C++ Device SDK: 协程接口 (C++20)
+ *
+ * 同步接口在 MQTT token 的 wait() 与 curl_easy_perform 上阻塞，每台设备占用一个线程。
+ * 本头文件提供单线程执行器与协程版设备，数千台设备的循环可在一个线程上交错运行:
+ *
+ *   coro::Executor ex;
+ *   coro::AsyncDevice dev(ex, cfg);
+ *   ex.spawn(dev.run_loop("tpl-1", 100));
+ *   ex.run();
+ *
+ * 执行器以 curl_multi_poll 为唯一阻塞点: HTTP 由 curl multi 驱动，
+ * Paho 回调线程通过 post() 投递完成的协程并用 curl_multi_wakeup 唤醒，定时器用最小堆管理。
+ *
+ * 需要 -std=c++20；SDK 其余部分仍为 C++17。
+ */
+
+#ifndef EDGESTELLE_CORO_HPP
+#define EDGESTELLE_CORO_HPP
+
+#if !defined(__cpp_impl_coroutine)
+#error "edgestelle_coro.hpp 需要 C++20 协程 (-std=c++20)"
+#endif
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "edgestelle_device.hpp"
+
+namespace edgestelle {
+namespace coro {
+
+// ═════════════════════════════════════════════════════
+//  Task
+// ═════════════════════════════════════════════════════
+
+namespace detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // SDK 路径以 Result 传递错误，协程内的异常视为编程错误
+    void unhandled_exception() noexcept { std::terminate(); }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            auto next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+};
+
+template <typename T>
+struct Promise;
+
+} // namespace detail
+
+/**
+ * 惰性协程任务：被 co_await 时才开始执行，结束后对称转移回等待方。
+ */
+template <typename T = void>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::Promise<T>;
+    using handle_type  = std::coroutine_handle<promise_type>;
+
+    explicit Task(handle_type h) : handle_(h) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    ~Task() { if (handle_) handle_.destroy(); }
+
+    Task(const Task&)            = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        handle_.promise().continuation = caller;
+        return handle_;
+    }
+
+    T await_resume() {
+        if constexpr (!std::is_void_v<T>) return std::move(*handle_.promise().value);
+    }
+
+private:
+    handle_type handle_;
+};
+
+namespace detail {
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() {
+        return Task<T>(std::coroutine_handle<Promise>::from_promise(*this));
+    }
+
+    template <typename U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() {
+        return Task<void>(std::coroutine_handle<Promise>::from_promise(*this));
+    }
+
+    void return_void() {}
+};
+
+} // namespace detail
+
+// ═════════════════════════════════════════════════════
+//  单线程执行器
+// ═════════════════════════════════════════════════════
+
+class Executor {
+public:
+    Executor() {
+        multi_ = curl_multi_init();
+        share_ = curl_share_init();
+        // 单线程使用，无需加锁回调；同一 broker / 模板服务的 DNS 与 TLS 会话在设备间共享
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    }
+
+    ~Executor() {
+        if (multi_) curl_multi_cleanup(multi_);
+        if (share_) curl_share_cleanup(share_);
+    }
+
+    Executor(const Executor&)            = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    /**
+     * 登记一个顶层任务，run() 时开始执行；任务结束后帧自动释放。
+     */
+    void spawn(Task<void> task) {
+        ++live_;
+        ready_.push_back(detach(this, std::move(task)).handle);
+    }
+
+    /**
+     * 运行到所有顶层任务结束。
+     */
+    void run() {
+        while (live_ > 0) {
+            take_posted();
+            fire_timers();
+            drive_transfers();
+            while (!ready_.empty()) {
+                auto h = ready_.front();
+                ready_.pop_front();
+                h.resume();
+            }
+            if (live_ == 0) break;
+            // 无就绪协程: 阻塞到下一个定时器、socket 事件或 post() 唤醒
+            curl_multi_poll(multi_, nullptr, 0, poll_timeout_ms(), nullptr);
+        }
+    }
+
+    /**
+     * 线程安全：把协程投递回执行器线程恢复 (供 Paho 回调使用)。
+     */
+    void post(std::coroutine_handle<> h) {
+        {
+            std::lock_guard<std::mutex> lock(posted_mu_);
+            posted_.push_back(h);
+        }
+        curl_multi_wakeup(multi_);
+    }
+
+    struct SleepAwaiter {
+        Executor&                             ex;
+        std::chrono::steady_clock::time_point deadline;
+
+        bool await_ready() const { return deadline <= std::chrono::steady_clock::now(); }
+        void await_suspend(std::coroutine_handle<> h) {
+            ex.timers_.push(Timer{deadline, ex.timer_seq_++, h});
+        }
+        void await_resume() const {}
+    };
+
+    SleepAwaiter sleep_for(std::chrono::milliseconds d) {
+        return SleepAwaiter{*this, std::chrono::steady_clock::now() + d};
+    }
+
+    /**
+     * 把已设置好的 easy handle 交给 curl multi 执行，完成后恢复等待方。
+     */
+    struct TransferAwaiter {
+        Executor&               ex;
+        CURL*                   easy;
+        CURLcode                result = CURLE_OK;
+        std::coroutine_handle<> handle;
+
+        bool await_ready() const { return false; }
+        bool await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            curl_easy_setopt(easy, CURLOPT_PRIVATE, this);
+            if (curl_multi_add_handle(ex.multi_, easy) != CURLM_OK) {
+                result = CURLE_FAILED_INIT;
+                return false;
+            }
+            return true;
+        }
+        CURLcode await_resume() const { return result; }
+    };
+
+    TransferAwaiter perform(CURL* easy) { return TransferAwaiter{*this, easy, CURLE_OK, {}}; }
+
+    CURLSH* share() const { return share_; }
+
+private:
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() {
+                return Detached{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never  final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    static Detached detach(Executor* ex, Task<void> task) {
+        co_await std::move(task);
+        --ex->live_;
+    }
+
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t                              seq;   // 同一时刻按登记顺序唤醒
+        std::coroutine_handle<>               handle;
+
+        bool operator>(const Timer& o) const {
+            return deadline != o.deadline ? deadline > o.deadline : seq > o.seq;
+        }
+    };
+
+    void take_posted() {
+        std::lock_guard<std::mutex> lock(posted_mu_);
+        for (auto h : posted_) ready_.push_back(h);
+        posted_.clear();
+    }
+
+    void fire_timers() {
+        auto now = std::chrono::steady_clock::now();
+        while (!timers_.empty() && timers_.top().deadline <= now) {
+            ready_.push_back(timers_.top().handle);
+            timers_.pop();
+        }
+    }
+
+    void drive_transfers() {
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL*    easy = msg->easy_handle;
+            CURLcode res  = msg->data.result;   // remove 之后 msg 失效
+            TransferAwaiter* op = nullptr;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, &op);
+            curl_multi_remove_handle(multi_, easy);
+            op->result = res;
+            ready_.push_back(op->handle);
+        }
+    }
+
+    int poll_timeout_ms() const {
+        constexpr int kIdleMs = 1000;
+        if (timers_.empty()) return kIdleMs;
+        auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+            timers_.top().deadline - std::chrono::steady_clock::now()).count();
+        return static_cast<int>(std::clamp<long long>(wait, 0, kIdleMs));
+    }
+
+    CURLM*  multi_ = nullptr;
+    CURLSH* share_ = nullptr;
+    int     live_  = 0;
+
+    std::deque<std::coroutine_handle<>> ready_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    uint64_t timer_seq_ = 0;
+
+    std::mutex                           posted_mu_;
+    std::vector<std::coroutine_handle<>> posted_;
+};
+
+// ═════════════════════════════════════════════════════
+//  协程版设备
+// ═════════════════════════════════════════════════════
+
+namespace detail {
+
+/**
+ * 把 MqttChannel 的完成回调转换为 co_await：start 发起操作，
+ * Paho 回调线程上的 done() 把等待方投递回执行器。
+ */
+template <typename Start>
+class MqttOp final : public edgestelle::detail::MqttCompletion {
+public:
+    MqttOp(Executor& ex, Start start) : ex_(ex), start_(std::move(start)) {}
+
+    bool await_ready() const { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        handle_ = h;
+        auto started = start_(*this);
+        if (!started) {
+            result_ = std::move(started);
+            return false;
+        }
+        return true;
+    }
+
+    Result<void> await_resume() { return std::move(result_); }
+
+    void done(Result<void> result) override {
+        result_ = std::move(result);
+        ex_.post(handle_);
+    }
+
+private:
+    Executor&               ex_;
+    Start                   start_;
+    std::coroutine_handle<> handle_;
+    Result<void>            result_;
+};
+
+} // namespace detail
+
+/**
+ * 协程版设备：与 EdgeStelleDevice 相同的拉取 → 测试 → 上报流程，
+ * 所有等待都挂起协程而不阻塞线程。对象须在其任务结束前保持存活。
+ */
+class AsyncDevice {
+public:
+    AsyncDevice(Executor& ex, const DeviceConfig& cfg)
+        : ex_(ex), cfg_(cfg), simulator_(TestSimulator::for_device(cfg)), mqtt_(cfg),
+          topic_(cfg.mqtt_report_topic()) {
+        easy_ = curl_easy_init();
+    }
+
+    ~AsyncDevice() {
+        mqtt_.disconnect();
+        if (easy_) curl_easy_cleanup(easy_);
+    }
+
+    AsyncDevice(const AsyncDevice&)            = delete;
+    AsyncDevice& operator=(const AsyncDevice&) = delete;
+
+    /**
+     * 连接 MQTT broker；已连接时立即返回。本设备的另一协程正在连接时挂起到其完成，
+     * 与之共用结果。
+     */
+    Task<Result<void>> connect() {
+        if (mqtt_.connected()) co_return Result<void>{};
+        if (connecting_) {
+            co_await ConnectWaiter{*this};
+            co_return connect_result_;
+        }
+        connecting_ = true;
+        detail::MqttOp op(ex_, [this](edgestelle::detail::MqttCompletion& c) {
+            return mqtt_.connect_async(&c);
+        });
+        connect_result_ = mqtt_.complete_connect(co_await op);   // 只做状态收尾，不阻塞
+        connecting_     = false;
+        for (auto h : std::exchange(connect_waiters_, {})) ex_.post(h);
+        co_return connect_result_;
+    }
+
+    /**
+     * 替换报告时间戳所用的时钟 (如 VirtualClock)；周期等待仍由执行器按真实时间调度。
+     * clock 须在设备对象之后析构。
+     */
+    void set_clock(Clock& clock) { clock_ = &clock; }
+
+    /**
+     * 模板经 registry 共享 (见 edgestelle_registry.hpp)，run_loop() 每周期取其当前实例，
+     * 模板更新后下个周期即换用。registry 须在设备对象之后析构。
+     */
+    void set_template_registry(TemplateRegistry& registry) { registry_ = &registry; }
+
+    /**
+     * 从云端拉取测试模板并编译；使用注册表时已注册的模板直接返回。
+     * 同一执行器上的多台设备可能同时拉取同一模板，注册表只保留一份实例。
+     */
+    Task<Result<TemplatePtr>> fetch_template(std::string template_id) {
+        if (registry_) {
+            if (auto p = registry_->slot(template_id).current()) co_return p;
+        }
+        if (!easy_) co_return Error{Errc::http_init, "Failed to init curl"};
+        std::string url = cfg_.api_base_url + "/api/v1/templates/" + template_id;
+
+        body_.clear();
+        edgestelle::detail::BodySink sink{&body_, EDGESTELLE_MAX_TEMPLATE_BYTES};
+        curl_easy_reset(easy_);
+        curl_easy_setopt(easy_, CURLOPT_SHARE, ex_.share());
+        edgestelle::detail::setup_get(easy_, url, cfg_.tls, &sink);
+
+        CURLcode res = co_await ex_.perform(easy_);
+        auto ok = edgestelle::detail::check_get(easy_, url, res);
+        if (!ok) co_return ok.error();
+        if (registry_) co_return registry_->publish(template_id, body_);
+        co_return compile_template(body_);
+    }
+
+    /**
+     * 执行一轮测试 (纯计算，不挂起)。返回的报告在下次调用前有效。
+     */
+    const Report& execute_test(const TemplatePtr& tmpl) {
+        edgestelle::detail::fill_report(simulator_, tmpl, false, clock_->now(), report_);
+        return report_;
+    }
+
+    /**
+     * 通过 MQTT 发布测试报告，未连接时先连接。
+     */
+    Task<Result<void>> publish(const Report& report) {
+        auto conn = co_await connect();
+        if (!conn) co_return conn;
+
+        ReportSerializer::write(report, cfg_.device_id, payload_);
+        int qos = cfg_.report_qos(report.has_anomaly());
+        // Paho 在发送时复制载荷，payload_ 可在完成前被下一次序列化覆盖
+        detail::MqttOp op(ex_, [this, qos](edgestelle::detail::MqttCompletion& c) {
+            alloc::ThirdPartyScope third_party;
+            return mqtt_.publish_async(topic_, payload_, qos, c);
+        });
+        auto sent = co_await op;
+        if (!sent) {
+            mqtt_.disconnect();   // 丢弃失效连接，下次发布时重连
+            co_return sent;
+        }
+        ++published_;
+        co_return sent;
+    }
+
+    /**
+     * 连续运行：拉取一次模板后按采样周期测试并发布 (使用注册表时每周期取其当前实例)。
+     *
+     * 网络错误不终止循环：拉取失败在下个周期重试；发布失败的报告直接丢弃
+     * (协程版面向大规模仿真，不做积压重发)。
+     *
+     * @param cycles  运行周期数，<0 表示直到 stop()
+     */
+    Task<void> run_loop(std::string template_id, int cycles = -1) {
+        stop_ = false;
+        auto interval = std::chrono::milliseconds(cfg_.sample_interval_ms);
+        TemplatePtr tmpl;
+        const TemplateRegistry::Slot* slot = registry_ ? &registry_->slot(template_id) : nullptr;
+
+        for (int i = 0; (cycles < 0 || i < cycles) && !stop_; ++i) {
+            if (slot) {
+                if (auto latest = slot->current()) tmpl = std::move(latest);
+            }
+            if (!tmpl) {
+                auto fetched = co_await fetch_template(template_id);
+                if (!fetched) {
+                    log_error("拉取模板", fetched.error());
+                    co_await ex_.sleep_for(interval);
+                    continue;
+                }
+                tmpl = std::move(fetched).value();
+            }
+
+            auto sent = co_await publish(execute_test(tmpl));
+            if (!sent) {
+                ++failed_;
+                log_error("发布报告", sent.error());
+            }
+            co_await ex_.sleep_for(interval);
+        }
+        mqtt_.disconnect();
+    }
+
+    /**
+     * 请求 run_loop() 在当前周期结束后退出 (须在执行器线程上调用)。
+     */
+    void stop() { stop_ = true; }
+
+    uint64_t published() const { return published_; }
+    uint64_t failed()    const { return failed_; }
+
+private:
+    struct ConnectWaiter {
+        AsyncDevice& dev;
+
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> h) { dev.connect_waiters_.push_back(h); }
+        void await_resume() const {}
+    };
+
+    void log_error(const char* what, const Error& err) const {
+        EDGESTELLE_LOG_ERR("⚠️  [%s] %s失败: %s", cfg_.device_id.c_str(), what,
+                           err.to_string().c_str());
+    }
+
+    Executor&                       ex_;
+    DeviceConfig                    cfg_;
+    TestSimulator                   simulator_;
+    edgestelle::detail::MqttChannel mqtt_;
+    CURL*                           easy_ = nullptr;
+    TemplateRegistry*               registry_ = nullptr;
+    Clock*                          clock_    = &SystemClock::instance();
+    std::string                     topic_;
+    std::string                     body_;      // 模板响应体
+    std::string                     payload_;   // 序列化缓冲，跨周期复用
+    Report                          report_;
+
+    bool                                 connecting_ = false;
+    Result<void>                         connect_result_;
+    std::vector<std::coroutine_handle<>> connect_waiters_;   // 等待 connecting_ 中的连接完成
+
+    bool     stop_      = false;
+    uint64_t published_ = 0;
+    uint64_t failed_    = 0;
+};
+
+} // namespace coro
+} // namespace edgestelle
+
+#endif // EDGESTELLE_CORO_HPP
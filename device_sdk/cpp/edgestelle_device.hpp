@@ -2,13 +2,16 @@
  * EdgeStelle — C++ Device SDK
  *
  * 依赖:
- *   - Eclipse Paho MQTT C++ (libpaho-mqttpp3)
+ *   - Eclipse Paho MQTT C++ (libpaho-mqttpp3)；-fno-exceptions 构建改用 Paho C (libpaho-mqtt3as)
  *   - nlohmann/json (header-only JSON 库)
  *   - libcurl (HTTP GET 模板)
  *
  * 编译 (Linux/嵌入式):
  *   g++ -std=c++17 -o edgestelle_device edgestelle_device.cpp \
  *       -lpaho-mqttpp3 -lpaho-mqtt3as -lcurl -lpthread
+ *
+ * 定义 EDGESTELLE_MINIMAL (嵌入式构建配置) 时只保留类型化接口，
+ * 不提供基于 nlohmann DOM 的 json 便捷接口。
  */
 
 #ifndef EDGESTELLE_DEVICE_SDK_HPP
@@ -18,69 +21,359 @@
 #include <vector>
 #include <random>
 #include <chrono>
-#include <sstream>
-#include <iostream>
-#include <stdexcept>
+#include <ctime>
+#include <cmath>
+#include <algorithm>
 #include <functional>
+#include <limits>
+#include <unordered_map>
+#include <memory>
+#include <optional>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "edgestelle_result.hpp"
 
 // ─── 第三方头文件 ───
+#if defined(EDGESTELLE_NO_EXCEPTIONS) && !defined(JSON_NOEXCEPTION)
+#define JSON_NOEXCEPTION
+#endif
 #include <nlohmann/json.hpp>
-#include <mqtt/async_client.h>
 #include <curl/curl.h>
 
+#include "edgestelle_alloc.hpp"
+#include "edgestelle_brokers.hpp"
+#include "edgestelle_clock.hpp"
+#include "edgestelle_config.hpp"
+#include "edgestelle_exporter.hpp"
+#include "edgestelle_lanes.hpp"
+#include "edgestelle_log.hpp"
+#include "edgestelle_mqtt.hpp"
+#include "edgestelle_report.hpp"
+#include "edgestelle_sim.hpp"
+#include "edgestelle_trace.hpp"
+#include "edgestelle_tsdb.hpp"
+#include "edgestelle_waveform.hpp"
+#include "edgestelle_probes.hpp"
+#include "edgestelle_realtime.hpp"
+#include "edgestelle_recorder.hpp"
+#include "edgestelle_registry.hpp"
+
 using json = nlohmann::json;
 
 namespace edgestelle {
 
-// ═════════════════════════════════════════════════════
-//  配置
-// ═════════════════════════════════════════════════════
-
-struct DeviceConfig {
-    std::string device_id       = "edge-cpp-001";
-    std::string api_base_url    = "http://localhost:8000";
-    std::string mqtt_broker_uri = "tcp://localhost:1883";
-    std::string mqtt_username;
-    std::string mqtt_password;
-    std::string mqtt_topic_prefix = "iot/test/report";
-
-    std::string mqtt_report_topic() const {
-        return mqtt_topic_prefix + "/" + device_id;
-    }
-};
-
 // ═════════════════════════════════════════════════════
 //  HTTP 工具 (libcurl)
 // ═════════════════════════════════════════════════════
 
 namespace detail {
 
-static size_t write_callback(void* contents, size_t size, size_t nmemb, std::string* out) {
+/**
+ * 响应体写入目标，超出 limit 时中止传输 (静态内存预算)。
+ */
+struct BodySink {
+    std::string* out;
+    size_t       limit;
+};
+
+static size_t write_callback(void* contents, size_t size, size_t nmemb, BodySink* sink) {
     size_t total = size * nmemb;
-    out->append(static_cast<char*>(contents), total);
+    if (sink->out->size() + total > sink->limit) return 0;   // → CURLE_WRITE_ERROR
+    sink->out->append(static_cast<char*>(contents), total);
     return total;
 }
 
-inline std::string http_get(const std::string& url) {
-    CURL* curl = curl_easy_init();
-    if (!curl) throw std::runtime_error("Failed to init curl");
-
-    std::string response;
+/**
+ * 为一次 GET 设置 easy handle (URL、写回调、超时与 TLS 选项)。
+ * 同步 HttpClient 与协程执行器 (edgestelle_coro.hpp) 共用。
+ */
+inline void setup_get(CURL* curl, const std::string& url, const TlsConfig& tls, BodySink* sink) {
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, sink);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 15L);
+    curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 1L);
+    if (!tls.ca_file.empty())   curl_easy_setopt(curl, CURLOPT_CAINFO, tls.ca_file.c_str());
+    if (!tls.cert_file.empty()) curl_easy_setopt(curl, CURLOPT_SSLCERT, tls.cert_file.c_str());
+    if (!tls.key_file.empty())  curl_easy_setopt(curl, CURLOPT_SSLKEY, tls.key_file.c_str());
+    if (!tls.verify_peer) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+}
 
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-
+/**
+ * 把传输结果与 HTTP 状态码转换为 Result。
+ */
+inline Result<void> check_get(CURL* curl, const std::string& url, CURLcode res) {
     if (res != CURLE_OK) {
-        throw std::runtime_error(
-            std::string("HTTP GET failed: ") + curl_easy_strerror(res)
-        );
+        return Error{Errc::http_transport,
+                     std::string("HTTP GET failed: ") + curl_easy_strerror(res)};
+    }
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    if (status >= 400) {
+        return Error{Errc::http_status, "HTTP GET " + url + " → " + std::to_string(status)};
+    }
+    return {};
+}
+
+/**
+ * 复用 easy handle 与 share handle 的 HTTP 客户端。
+ *
+ * - 同一进程内：连接保活 + 共享 TLS 会话缓存，重复请求无需完整握手；
+ * - 跨进程重启：会话票据按 TlsConfig::session_cache_path 导出/导入。
+ */
+class HttpClient {
+public:
+    explicit HttpClient(const TlsConfig& tls = {}) : tls_(tls) {
+        share_ = curl_share_init();
+        curl_  = curl_easy_init();
+        if (!share_ || !curl_) return;   // 由 get() 报告 Errc::http_init
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_easy_setopt(curl_, CURLOPT_SHARE, share_);
+        load_sessions();
+    }
+
+    ~HttpClient() {
+        if (curl_ && share_) save_sessions();
+        if (curl_)  curl_easy_cleanup(curl_);
+        if (share_) curl_share_cleanup(share_);
+    }
+
+    HttpClient(const HttpClient&)            = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    Result<std::string> get(const std::string& url) {
+        if (!curl_ || !share_) return Error{Errc::http_init, "Failed to init curl"};
+
+        std::string response;
+        BodySink sink{&response, EDGESTELLE_MAX_TEMPLATE_BYTES};
+        curl_easy_reset(curl_);
+        curl_easy_setopt(curl_, CURLOPT_SHARE, share_);
+        setup_get(curl_, url, tls_, &sink);
+
+        CURLcode res = curl_easy_perform(curl_);
+        if (res != CURLE_OK) return check_get(curl_, url, res).error();
+
+        // appconnect - connect = 本次 TLS 握手耗时；复用连接时两者均为 0
+        curl_off_t connect_us = 0, appconnect_us = 0;
+        curl_easy_getinfo(curl_, CURLINFO_CONNECT_TIME_T, &connect_us);
+        curl_easy_getinfo(curl_, CURLINFO_APPCONNECT_TIME_T, &appconnect_us);
+        last_handshake_us_ = appconnect_us > connect_us ? appconnect_us - connect_us : 0;
+        if (last_handshake_us_ > 0) sessions_dirty_ = true;
+
+        auto ok = check_get(curl_, url, res);
+        if (!ok) return ok.error();
+        return response;
+    }
+
+    /**
+     * 最近一次请求的 TLS 握手耗时 (微秒)，未发生握手时为 0。
+     */
+    long long last_tls_handshake_us() const { return last_handshake_us_; }
+
+    /**
+     * 将共享缓存中的 TLS 会话写入 session_cache_path (先写临时文件再 rename)。
+     */
+    void save_sessions() {
+#if LIBCURL_VERSION_NUM >= 0x080c00
+        if (tls_.session_cache_path.empty() || !sessions_dirty_) return;
+        std::string tmp = tls_.session_cache_path + ".tmp";
+        FILE* f = std::fopen(tmp.c_str(), "wb");
+        if (!f) return;
+        CURLcode res = curl_easy_ssls_export(curl_, &HttpClient::export_session, f);
+        bool ok = std::fclose(f) == 0 && res == CURLE_OK;
+        if (ok && std::rename(tmp.c_str(), tls_.session_cache_path.c_str()) == 0) {
+            sessions_dirty_ = false;
+            return;
+        }
+        std::remove(tmp.c_str());
+        if (res == CURLE_NOT_BUILT_IN) {
+            // 该 libcurl 未编译 ssls-export，会话只能在进程内复用
+            EDGESTELLE_LOG_ERR("⚠️  libcurl 未启用 ssls-export，TLS 会话不会落盘");
+            tls_.session_cache_path.clear();
+        }
+#endif
+    }
+
+    /**
+     * 当前 libcurl 是否支持把 TLS 会话持久化到磁盘。
+     */
+    bool can_persist_sessions() const { return !tls_.session_cache_path.empty(); }
+
+private:
+    // 会话文件格式: 重复的 [u32 长度 + 字节] × 3 (session_key, shmac, sdata)
+    static bool write_blob(FILE* f, const void* data, size_t len) {
+        auto n = static_cast<uint32_t>(len);
+        return std::fwrite(&n, sizeof(n), 1, f) == 1
+            && (len == 0 || std::fwrite(data, 1, len, f) == len);
+    }
+
+    static bool read_blob(FILE* f, std::string& out) {
+        uint32_t n = 0;
+        if (std::fread(&n, sizeof(n), 1, f) != 1 || n > (1u << 20)) return false;
+        out.resize(n);
+        return n == 0 || std::fread(&out[0], 1, n, f) == n;
     }
-    return response;
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    static CURLcode export_session(CURL*, void* userptr, const char* session_key,
+                                   const unsigned char* shmac, size_t shmac_len,
+                                   const unsigned char* sdata, size_t sdata_len,
+                                   curl_off_t, int, const char*, size_t) {
+        FILE* f = static_cast<FILE*>(userptr);
+        bool ok = write_blob(f, session_key, std::strlen(session_key) + 1)
+               && write_blob(f, shmac, shmac_len)
+               && write_blob(f, sdata, sdata_len);
+        return ok ? CURLE_OK : CURLE_WRITE_ERROR;
+    }
+#endif
+
+    void load_sessions() {
+#if LIBCURL_VERSION_NUM >= 0x080c00
+        if (tls_.session_cache_path.empty()) return;
+        FILE* f = std::fopen(tls_.session_cache_path.c_str(), "rb");
+        if (!f) return;
+        std::string key, shmac, sdata;
+        while (read_blob(f, key) && read_blob(f, shmac) && read_blob(f, sdata)) {
+            // 过期或格式不兼容的会话由 libcurl 拒绝，退回完整握手即可
+            curl_easy_ssls_import(curl_, key.c_str(),
+                reinterpret_cast<const unsigned char*>(shmac.data()), shmac.size(),
+                reinterpret_cast<const unsigned char*>(sdata.data()), sdata.size());
+        }
+        std::fclose(f);
+#endif
+    }
+
+    TlsConfig tls_;
+    CURL*     curl_  = nullptr;
+    CURLSH*   share_ = nullptr;
+    long long last_handshake_us_ = 0;
+    bool      sessions_dirty_    = false;
+};
+
+#ifndef EDGESTELLE_NO_EXCEPTIONS
+inline std::string http_get(const std::string& url) {
+    HttpClient client;
+    return value_or_throw(client.get(url));
 }
+#endif
+
+} // namespace detail
+
+// ═════════════════════════════════════════════════════
+//  派生指标与规则
+// ═════════════════════════════════════════════════════
+
+namespace detail {
+
+/**
+ * 模板中派生指标与规则的逐周期求值状态 (表达式见 edgestelle_expr.hpp)。
+ *
+ * 指标值矩阵按指标主序存放 lanes 个 lane (单设备 1 个，舰队为设备数)：调用方以 load()
+ * 写入各 lane 的原始结果，evaluate() 按声明顺序算出派生指标、再逐条规则求值，
+ * 之后以 store() / append_anomalies() 读回。缓冲全部在 bind() 时分配。
+ */
+class RuleEngine {
+public:
+    void bind(const TemplatePtr& tmpl, size_t lanes) {
+        tmpl_  = tmpl;
+        lanes_ = lanes;
+        derived_.clear();
+        uint32_t depth = 1;
+        bool     prev  = false;
+        for (uint32_t i = 0; i < tmpl->metrics.size(); ++i) {
+            const MetricSpec& m = tmpl->metrics[i];
+            if (!m.derived()) continue;
+            derived_.push_back(i);
+            depth = std::max(depth, m.program.max_depth);
+            prev |= m.program.uses_prev;
+        }
+        for (const auto& r : tmpl->rules) {
+            depth = std::max(depth, r.program.max_depth);
+            prev |= r.program.uses_prev;
+        }
+        size_t cells = tmpl->metrics.size() * lanes;
+        values_.assign(cells, kMissing);
+        prev_.assign(prev ? cells : 0, kMissing);
+        fired_.assign(tmpl->rules.size() * lanes, 0.0);
+        eval_.reserve(depth, lanes);
+        has_last_ = false;
+    }
+
+    /**
+     * 模板含派生指标或规则。
+     */
+    bool active() const { return tmpl_ && (!derived_.empty() || !tmpl_->rules.empty()); }
+
+    /**
+     * 写入 lane 的本周期结果；results 中没有的指标记为缺失 (NaN)。
+     */
+    void load(size_t lane, const std::vector<MetricResult>& results) {
+        for (size_t m = 0; m < tmpl_->metrics.size(); ++m) values_[m * lanes_ + lane] = kMissing;
+        for (const auto& r : results) values_[r.metric * lanes_ + lane] = r.value;
+    }
+
+    /**
+     * 全部 lane 求值一个周期。now 决定 rate() 的时间间隔。
+     */
+    void evaluate(Clock::time_point now) {
+        EDGESTELLE_TRACE_SCOPE("rules");
+        double dt_s = has_last_ ? std::chrono::duration<double>(now - last_).count() : kMissing;
+        last_     = now;
+        has_last_ = true;
+        for (uint32_t m : derived_) {
+            eval_.run(tmpl_->metrics[m].program, values_.data(), prev_.data(), dt_s, &values_[m * lanes_]);
+        }
+        for (size_t r = 0; r < tmpl_->rules.size(); ++r) {
+            eval_.run(tmpl_->rules[r].program, values_.data(), prev_.data(), dt_s, &fired_[r * lanes_]);
+        }
+        if (!prev_.empty()) std::copy(values_.begin(), values_.end(), prev_.begin());
+    }
+
+    double value(uint32_t metric, size_t lane) const { return values_[metric * lanes_ + lane]; }
+
+    /**
+     * 把 lane 的派生指标值写回 results。
+     */
+    void store(size_t lane, std::vector<MetricResult>& results) const {
+        for (auto& r : results) {
+            if (tmpl_->metrics[r.metric].derived()) r.value = value(r.metric, lane);
+        }
+    }
+
+    /**
+     * 为 lane 上本周期为真的规则追加 rule_fired 异常。
+     */
+    void append_anomalies(size_t lane, Report& report) const {
+        const auto& rules = tmpl_->rules;
+        for (uint32_t r = 0; r < rules.size(); ++r) {
+            if (std::fabs(fired_[r * lanes_ + lane]) > 0.0) {
+                report.anomalies.push_back(Anomaly{rules[r].metric, AnomalyKind::rule_fired, r});
+            }
+        }
+    }
+
+private:
+    static constexpr double kMissing = std::numeric_limits<double>::quiet_NaN();
+
+    TemplatePtr           tmpl_;
+    size_t                lanes_ = 0;
+    std::vector<uint32_t> derived_;   // 派生指标下标，按声明顺序
+    std::vector<double>   values_;    // 本周期，values_[metric * lanes_ + lane]
+    std::vector<double>   prev_;      // 上一周期 (只在有 delta / rate 时保留)
+    std::vector<double>   fired_;     // 规则结果，fired_[rule * lanes_ + lane]
+    ExprEvaluator         eval_;
+    Clock::time_point     last_{};
+    bool                  has_last_ = false;
+};
 
 } // namespace detail
 
@@ -92,24 +385,122 @@ class TestSimulator {
 public:
     TestSimulator() : rng_(std::random_device{}()) {}
 
+    /**
+     * 固定种子：同一种子、同一模板下的采样序列可复现。
+     */
+    explicit TestSimulator(uint64_t seed) {
+        std::seed_seq seq{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+        rng_.seed(seq);
+    }
+
+    /**
+     * 按设备配置构造：config.seed 非 0 时使用由 (seed, device_id) 派生的独立随机流。
+     */
+    static TestSimulator for_device(const DeviceConfig& cfg) {
+        if (cfg.seed == 0) return TestSimulator();
+        return TestSimulator(detail::derive_seed(cfg.seed, cfg.device_id));
+    }
+
     /**
      * 根据指标名称生成模拟数值。
      */
     double simulate_metric(const std::string& name) {
-        auto it = profiles_.find(name);
-        const auto& p = (it != profiles_.end()) ? it->second : default_profile_;
+        return simulate(profile(name));
+    }
 
-        std::normal_distribution<double> dist(p.mean, p.stddev);
-        double val = dist(rng_);
-        val = std::max(p.min_val, std::min(p.max_val, val));
-        return std::round(val * 100.0) / 100.0;
+    /**
+     * 模板各指标的 AR(1) 参数，按指标名查表，未知指标用默认参数。
+     * 波形指标的 AR(1) 值作为模拟振动的幅度系数 (均值 1)。
+     */
+    static std::vector<MetricDynamics> dynamics_for(const CompiledTemplate& tmpl) {
+        static const Profile waveform_level = {1.0, 0.15, 0.2, 4.0, 0.95};
+        std::vector<MetricDynamics> dynamics;
+        dynamics.reserve(tmpl.metrics.size());
+        for (const auto& m : tmpl.metrics) {
+            dynamics.push_back(m.kind == MetricKind::waveform ? waveform_level : profile(m.name));
+        }
+        return dynamics;
+    }
+
+    /**
+     * 模板各指标间扰动的相关矩阵 (n×n 行主序)。
+     */
+    static std::vector<double> correlation_for(const CompiledTemplate& tmpl) {
+        const auto& metrics = tmpl.metrics;
+        size_t n = metrics.size();
+        std::vector<double> corr(n * n, 0.0);
+        for (size_t i = 0; i < n; ++i) corr[i * n + i] = 1.0;
+        for (const auto& c : correlations()) {
+            for (size_t i = 0; i < n; ++i) {
+                if (metrics[i].name != c.a) continue;
+                for (size_t j = 0; j < n; ++j) {
+                    if (metrics[j].name != c.b) continue;
+                    corr[i * n + j] = corr[j * n + i] = c.rho;
+                }
+            }
+        }
+        return corr;
     }
 
     /**
-     * 批量执行模拟测试。
+     * 预先绑定模板 (定长内存模式在 prepare 阶段调用，避免首个周期分配)。
+     */
+    void prepare(const TemplatePtr& tmpl) { bind(tmpl); }
+
+    /**
+     * 按编译后的模板执行一轮模拟测试，结果写入 report.results / report.elements
+     * (复用其容量)。
+     *
+     * 各指标按 AR(1) 过程随周期连续变化，已知相关的指标 (如 cpu_usage 与
+     * cpu_temperature) 扰动联动；模拟器只在模板变化时重建。
+     * 被丢弃的低优先级指标同样推进状态，恢复后不会出现跳变。
+     *
+     * 波形指标每周期合成 blocks × block_size 个振动样本并提取特征 (被丢弃时不合成)；
+     * 向量指标的各元素是同一参数下互相独立的 AR(1) 过程；直方图指标以该指标的
+     * AR(1) 值为中位数，每周期抽取 kHistogramSamples 个对数正态观测值计入各桶。
+     * 派生指标不模拟，只占位 (NaN)，由 rules() 在原始结果齐备后计算。
+     */
+    void run_tests(const TemplatePtr& tmpl, bool drop_low_priority, Report& report) {
+        EDGESTELLE_TRACE_SCOPE("sample");
+        bind(tmpl);
+        sim_->step();
+        report.results.clear();
+        report.elements.clear();
+        const auto& metrics = tmpl->metrics;
+        auto wave = waveforms_.begin();
+        auto vec  = vectors_.begin();
+        auto hist = histograms_.begin();
+        for (uint32_t i = 0; i < metrics.size(); ++i) {
+            bool dropped = drop_low_priority && metrics[i].low_priority;
+            switch (metrics[i].kind) {
+                case MetricKind::waveform:
+                    if (!dropped) sample_waveform(*wave, i, metrics[i].waveform, sim_->value(i, 0), report);
+                    ++wave;
+                    break;
+                case MetricKind::vector:
+                    sample_vector(*vec++, i, dropped, report);
+                    break;
+                case MetricKind::histogram:
+                    if (!dropped) sample_histogram(*hist, i, metrics[i].histogram, sim_->value(i, 0), report);
+                    ++hist;
+                    break;
+                case MetricKind::scalar:
+                    if (dropped) break;
+                    report.results.push_back(MetricResult{
+                        i, metrics[i].derived() ? std::numeric_limits<double>::quiet_NaN()
+                                                : round2(sim_->value(i, 0))});
+                    break;
+            }
+        }
+    }
+
+#ifndef EDGESTELLE_MINIMAL
+    /**
+     * 批量执行模拟测试 (json 接口)。
      */
     json run_tests(const json& metrics) {
         json results = json::array();
+        EDGESTELLE_TRACE_SCOPE("sample");
         for (const auto& metric : metrics) {
             std::string name = metric.value("name", "unknown");
             double value = simulate_metric(name);
@@ -125,124 +516,956 @@ public:
         }
         return results;
     }
+#endif
+
+    /**
+     * 当前模板的派生指标与规则求值状态 (lanes = 1)，随模板在 run_tests() 中重新绑定。
+     */
+    detail::RuleEngine& rules() { return rules_; }
 
 private:
-    struct Profile { double mean, stddev, min_val, max_val; };
+    using Profile = MetricDynamics;
 
-    std::mt19937 rng_;
-    Profile default_profile_ = {50.0, 15.0, 0.0, 100.0};
-
-    std::unordered_map<std::string, Profile> profiles_ = {
-        {"cpu_temperature",   {48.0, 12.0, 25.0, 95.0}},
-        {"memory_usage",      {55.0, 15.0,  5.0, 99.0}},
-        {"network_latency",   {35.0, 25.0,  1.0, 500.0}},
-        {"packet_loss_rate",  { 0.8,  1.2,  0.0, 15.0}},
-        {"disk_usage",        {60.0, 20.0,  1.0, 99.0}},
-        {"cpu_usage",         {40.0, 20.0,  0.0, 100.0}},
+    double simulate(const Profile& p) {
+        std::normal_distribution<double> dist(p.mean, p.stddev);
+        double val = dist(rng_);
+        val = std::max(p.min_val, std::min(p.max_val, val));
+        return std::round(val * 100.0) / 100.0;
+    }
+
+    void bind(const TemplatePtr& tmpl) {
+        if (bound_tmpl_ == tmpl) return;
+        auto dynamics = dynamics_for(*tmpl);
+        auto sim = CorrelatedSimulator::create(dynamics, correlation_for(*tmpl), 1, rng_());
+        if (!sim) {
+            // 同名指标重复等情况可能破坏正定性，退回各指标独立
+            EDGESTELLE_LOG_ERR("⚠️  %s，指标改为独立模拟", sim.error().to_string().c_str());
+            sim = CorrelatedSimulator::create(std::move(dynamics), {}, 1, rng_());
+        }
+        sim_.emplace(std::move(sim).value());
+
+        waveforms_.clear();
+        vectors_.clear();
+        histograms_.clear();
+        for (uint32_t i = 0; i < tmpl->metrics.size(); ++i) {
+            const MetricSpec& m = tmpl->metrics[i];
+            if (m.kind == MetricKind::waveform) {
+                waveforms_.push_back(WaveformChannel{
+                    WaveformAnalyzer(m.waveform),
+                    VibrationSynth(m.waveform.sample_rate_hz, static_cast<uint32_t>(rng_())),
+                    std::vector<float>(m.waveform.block_size)});
+            } else if (m.kind == MetricKind::vector) {
+                // 每个元素一条 lane：同一组 AR(1) 参数、互相独立
+                auto elems = CorrelatedSimulator::create({profile(m.name)}, {}, m.vector.length, rng_());
+                vectors_.push_back(VectorChannel{std::move(elems).value(),
+                                                 std::vector<double>(m.vector.length)});
+            } else if (m.kind == MetricKind::histogram) {
+                histograms_.emplace_back(m.histogram);
+            }
+        }
+        rules_.bind(tmpl, 1);
+        bound_tmpl_ = tmpl;   // 持有引用，避免地址复用导致误命中
+    }
+
+    struct WaveformChannel {
+        WaveformAnalyzer   analyzer;
+        VibrationSynth     synth;
+        std::vector<float> scratch;   // 一块样本
     };
+
+    static void sample_waveform(WaveformChannel& ch, uint32_t metric, const WaveformSpec& spec,
+                                double level, Report& report) {
+        EDGESTELLE_TRACE_SCOPE("waveform");
+        for (uint32_t b = 0; b < spec.blocks; ++b) {
+            ch.synth.generate(ch.scratch.data(), ch.scratch.size(), level);
+            ch.analyzer.process(ch.scratch.data(), ch.scratch.size());
+        }
+        ch.analyzer.emit(metric, report);
+        auto round4 = [](double v) { return std::round(v * 1e4) / 1e4; };
+        MetricResult& r = report.results.back();
+        r.value = round4(r.value);
+        report.elements[r.first + waveform_slot::peak]  = round4(report.elements[r.first + waveform_slot::peak]);
+        report.elements[r.first + waveform_slot::crest] = round4(report.elements[r.first + waveform_slot::crest]);
+    }
+
+    struct VectorChannel {
+        CorrelatedSimulator elements;
+        std::vector<double> scratch;
+    };
+
+    static constexpr int    kHistogramSamples = 256;
+    static constexpr double kHistogramSigma   = 0.6;   // 对数正态形状参数 (长尾)
+
+    static double round2(double v) { return std::round(v * 100.0) / 100.0; }
+
+    static void sample_vector(VectorChannel& ch, uint32_t metric, bool dropped, Report& report) {
+        ch.elements.step();
+        if (dropped) return;
+        for (size_t e = 0; e < ch.scratch.size(); ++e) ch.scratch[e] = round2(ch.elements.value(0, e));
+        append_vector(report, metric, ch.scratch.data(), ch.scratch.size());
+        report.results.back().value = round2(report.results.back().value);
+    }
+
+    void sample_histogram(Histogram& hist, uint32_t metric, const HistogramSpec& spec, double median,
+                          Report& report) {
+        std::lognormal_distribution<double> dist(std::log(std::max(median, 1e-6)), kHistogramSigma);
+        for (int k = 0; k < kHistogramSamples; ++k) hist.observe(dist(rng_));
+        hist.emit(metric, report);
+        MetricResult& r = report.results.back();
+        r.value = round2(r.value);
+        for (uint32_t k = histogram_slot::quantiles(spec); k < r.count; ++k) {
+            report.elements[r.first + k] = round2(report.elements[r.first + k]);
+        }
+    }
+
+    struct Correlation { const char* a; const char* b; double rho; };
+
+    static Profile profile(const std::string& name) {
+        // {均值, 标准差, 下限, 上限, 一阶自相关}
+        static const std::unordered_map<std::string, Profile> profiles = {
+            {"cpu_temperature",   {48.0, 12.0, 25.0, 95.0,  0.97}},
+            {"memory_usage",      {55.0, 15.0,  5.0, 99.0,  0.95}},
+            {"network_latency",   {35.0, 25.0,  1.0, 500.0, 0.6}},
+            {"packet_loss_rate",  { 0.8,  1.2,  0.0, 15.0,  0.5}},
+            {"disk_usage",        {60.0, 20.0,  1.0, 99.0,  0.995}},
+            {"cpu_usage",         {40.0, 20.0,  0.0, 100.0, 0.8}},
+            {"cpu_core_usage",    {40.0, 25.0,  0.0, 100.0, 0.8}},
+            {"request_latency",   {120.0, 40.0, 5.0, 2000.0, 0.9}},
+        };
+        static const Profile default_profile = {50.0, 15.0, 0.0, 100.0, 0.9};
+        auto it = profiles.find(name);
+        return it != profiles.end() ? it->second : default_profile;
+    }
+
+    // 指标间扰动的相关系数
+    static const std::vector<Correlation>& correlations() {
+        static const std::vector<Correlation> table = {
+            {"cpu_usage",       "cpu_temperature",  0.8},
+            {"cpu_usage",       "memory_usage",     0.4},
+            {"network_latency", "packet_loss_rate", 0.6},
+        };
+        return table;
+    }
+
+    TemplatePtr                        bound_tmpl_;
+    std::optional<CorrelatedSimulator> sim_;
+    std::vector<WaveformChannel>       waveforms_;   // 按指标顺序，只含波形指标
+    std::vector<VectorChannel>         vectors_;     // 同上，只含向量指标
+    std::vector<Histogram>             histograms_;  // 同上，只含直方图指标
+    detail::RuleEngine                 rules_;
+
+    std::mt19937 rng_;
 };
 
+namespace detail {
+
+/**
+ * 按模板阈值重新计算 report.anomalies。
+ */
+inline void detect_anomalies(Report& report) {
+    const auto& metrics = report.tmpl->metrics;
+    report.anomalies.clear();
+    for (const auto& r : report.results) {
+        const MetricSpec& m = metrics[r.metric];
+        const double*     e = report.elements.data() + r.first;
+        if (m.kind == MetricKind::vector && r.count > 0) {
+            // 阈值逐元素比较 (只上报 value 时退化为标量比较)
+            for (uint32_t k = 0; k < r.count; ++k) {
+                if (m.has_max && e[k] > m.threshold_max) {
+                    report.anomalies.push_back(Anomaly{r.metric, AnomalyKind::element_above_max, k});
+                } else if (m.has_min && e[k] < m.threshold_min) {
+                    report.anomalies.push_back(Anomaly{r.metric, AnomalyKind::element_below_min, k});
+                }
+            }
+            continue;
+        }
+        if (m.has_max && r.value > m.threshold_max) {
+            report.anomalies.push_back(Anomaly{r.metric, AnomalyKind::above_max});
+        }
+        if (m.has_min && r.value < m.threshold_min) {
+            report.anomalies.push_back(Anomaly{r.metric, AnomalyKind::below_min});
+        }
+        if (m.kind == MetricKind::histogram && r.count > 0) {
+            const auto& qs = m.histogram.quantiles;
+            const double* q = e + histogram_slot::quantiles(m.histogram);
+            for (uint32_t k = 0; k < qs.size(); ++k) {
+                if (qs[k].has_max && q[k] > qs[k].threshold_max) {
+                    report.anomalies.push_back(Anomaly{r.metric, AnomalyKind::quantile_above_max, k});
+                }
+            }
+            continue;
+        }
+        if (m.kind != MetricKind::waveform || r.count == 0) continue;
+
+        const WaveformSpec& w = m.waveform;
+        if (w.has_peak_max && e[waveform_slot::peak] > w.peak_max) {
+            report.anomalies.push_back(Anomaly{r.metric, AnomalyKind::peak_above_max});
+        }
+        if (w.has_crest_max && e[waveform_slot::crest] > w.crest_max) {
+            report.anomalies.push_back(Anomaly{r.metric, AnomalyKind::crest_above_max});
+        }
+        for (uint32_t b = 0; b < w.bands.size(); ++b) {
+            if (w.bands[b].has_max && e[waveform_slot::bands + b] > w.bands[b].threshold_max) {
+                report.anomalies.push_back(Anomaly{r.metric, AnomalyKind::band_above_max, b});
+            }
+        }
+    }
+}
+
+/**
+ * 把时刻 now 以 UTC ISO 8601 写入报告；micros 为 true 时带 6 位小数秒。
+ */
+inline void stamp(Report& report, Clock::time_point now, bool micros = false) {
+    std::time_t t = std::chrono::system_clock::to_time_t(now);
+    std::tm tm{};
+    gmtime_r(&t, &tm);
+    if (!micros) {
+        std::strftime(report.timestamp, sizeof(report.timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+        return;
+    }
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                  now - std::chrono::system_clock::from_time_t(t)).count();
+    size_t n = std::strftime(report.timestamp, sizeof(report.timestamp), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::snprintf(report.timestamp + n, sizeof(report.timestamp) - n, ".%06lldZ", static_cast<long long>(us));
+}
+
+/**
+ * 采样一轮并就地填充 report：结果、派生指标、阈值与规则异常、ISO 8601 时间戳
+ * (复用其 vector 容量；micros 见 stamp())。
+ */
+inline void fill_report(TestSimulator& simulator, const TemplatePtr& tmpl,
+                        bool drop_low_priority, Clock::time_point now, Report& report, bool micros = false) {
+    report.tmpl = tmpl;
+    report.extensions.clear();
+    simulator.run_tests(tmpl, drop_low_priority, report);
+    RuleEngine& rules = simulator.rules();
+    if (rules.active()) {
+        rules.load(0, report.results);
+        rules.evaluate(now);
+        rules.store(0, report.results);
+    }
+    detect_anomalies(report);
+    if (rules.active()) rules.append_anomalies(0, report);
+    stamp(report, now, micros);
+}
+
+} // namespace detail
+
 // ═════════════════════════════════════════════════════
 //  SDK 主类
 // ═════════════════════════════════════════════════════
 
+/**
+ * 单次 run() 的阶段耗时 (毫秒)。
+ *
+ * time_to_first_report_ms 为从 run() 进入到 broker 确认发布的总耗时，
+ * 对"启动 → 上报一次 → 休眠"的设备而言直接决定每次唤醒的电量开销。
+ */
+struct RunTimings {
+    double fetch_ms                = 0.0;
+    double test_ms                 = 0.0;
+    double connect_wait_ms         = 0.0;  // 测试完成后仍需等待 MQTT 连接的时间
+    double publish_ms              = 0.0;
+    double time_to_first_report_ms = 0.0;
+};
+
 class EdgeStelleDevice {
 public:
-    explicit EdgeStelleDevice(const DeviceConfig& cfg) : config_(cfg), simulator_() {}
+    explicit EdgeStelleDevice(const DeviceConfig& cfg)
+        : config_(cfg), simulator_(TestSimulator::for_device(cfg)), http_(cfg.tls), mqtt_(cfg),
+          topic_(cfg.mqtt_report_topic()), flight_topic_(topic_ + "/flight") {
+        payload_.reserve(EDGESTELLE_MAX_PAYLOAD_BYTES);
+    }
+
+    ~EdgeStelleDevice() { disconnect(); }
+
+    EdgeStelleDevice(const EdgeStelleDevice&)            = delete;
+    EdgeStelleDevice& operator=(const EdgeStelleDevice&) = delete;
 
     /**
-     * 从云端拉取测试模板。
+     * 发起 MQTT 连接但不等待完成，可与模板拉取、测试执行并行。
+     * 已连接或连接进行中时直接返回。
      */
-    json fetch_template(const std::string& template_id) {
-        std::string url = config_.api_base_url + "/api/v1/templates/" + template_id;
-        std::cout << "[SDK] 📥 拉取模板: " << url << std::endl;
+    Result<void> connect_async() {
+        if (mqtt_.connected() || mqtt_.connecting()) return {};
+        auto started = mqtt_.connect_async();
+        EDGESTELLE_LOG("📡 连接 MQTT: %s", mqtt_.uri().c_str());
+        return started;
+    }
 
-        std::string body = detail::http_get(url);
-        return json::parse(body);
+    /**
+     * 断开 MQTT 连接 (如有)。
+     */
+    void disconnect() { mqtt_.disconnect(); }
+
+    /**
+     * 替换报告时间戳与周期休眠所用的时钟 (如 VirtualClock 快进运行)。
+     * clock 须在设备对象之后析构。
+     */
+    void set_clock(Clock& clock) { clock_ = &clock; }
+
+    /**
+     * 模板经 registry 拉取并与同进程的其他设备共享 (见 edgestelle_registry.hpp)。
+     * 已注册的模板不再请求云端；registry 须在设备对象之后析构。
+     */
+    void set_template_registry(TemplateRegistry& registry) { registry_ = &registry; }
+
+    // ───────────── 无异常接口 (稳态路径) ─────────────
+
+    /**
+     * 从云端拉取测试模板并编译。
+     */
+    Result<TemplatePtr> try_fetch_template(const std::string& template_id) {
+        if (registry_) {
+            return registry_->acquire(template_id, [this](const std::string& id) { return fetch_template_body(id); });
+        }
+        auto body = fetch_template_body(template_id);
+        if (!body) return body.error();
+        return compile_template(body.value());
     }
 
     /**
-     * 根据模板执行测试并组装报告。
+     * 重新拉取模板。使用注册表时得到的新版本对同进程的其他设备同样可见。
      */
-    json execute_test(const json& tmpl) {
-        const auto& metrics = tmpl["schema_definition"]["metrics"];
-        std::cout << "[SDK] 🧪 执行测试 — " << metrics.size() << " 个指标" << std::endl;
+    Result<TemplatePtr> refresh_template(const std::string& template_id) {
+        if (!registry_) return try_fetch_template(template_id);
+        return registry_->refresh(template_id, [this](const std::string& id) { return fetch_template_body(id); });
+    }
 
-        json results = simulator_.run_tests(metrics);
+    /**
+     * 根据已编译模板执行测试并组装报告。
+     */
+    Result<Report> try_execute_test(const TemplatePtr& tmpl) {
+        if (!tmpl) return Error{Errc::template_invalid, "模板为空"};
+        Report report;
+        build_report(tmpl, report);
+        return report;
+    }
 
-        // 检测异常
-        json anomalies = json::array();
-        for (const auto& r : results) {
-            if (r.contains("threshold_max") && r["value"].get<double>() > r["threshold_max"].get<double>()) {
-                anomalies.push_back(r["name"].get<std::string>() + " 超标");
-            }
-            if (r.contains("threshold_min") && r["value"].get<double>() < r["threshold_min"].get<double>()) {
-                anomalies.push_back(r["name"].get<std::string>() + " 低于下限");
+    /**
+     * 通过 MQTT 发布测试报告。qos 默认为 1：单次上报 (try_run() / run()) 发布后随即断开，
+     * 须等 broker 确认；run_loop() 的队列按报告是否越界传入 config.alert_lane / routine_lane 的 QoS。
+     *
+     * 复用已建立 (或 connect_async() 发起中) 的连接；尚未连接时就地连接。
+     * 序列化缓冲在设备对象内复用，按 EDGESTELLE_MAX_PAYLOAD_BYTES 预留。
+     *
+     * 报告超出 config.max_message_bytes 时边序列化边分块发布，缓冲只需容纳一块。
+     * 中途失败时整份报告留待重发并换用新的 report_id，已送达的残块由订阅端超时丢弃。
+     */
+    Result<void> try_publish_report(const Report& report, int qos = 1) {
+        EDGESTELLE_TRACE_SCOPE("publish_report");
+        if (config_.max_message_bytes == 0) {
+            {
+                EDGESTELLE_TRACE_SCOPE("serialize");
+                ReportSerializer::write(report, config_.device_id, payload_);
             }
+            return publish_payload(report.tmpl->id.c_str(), topic_, payload_, qos);
         }
+        return ReportSerializer::write_chunked(
+            report, config_.device_id, next_report_id(), config_.max_message_bytes, payload_,
+            [&](const std::string& chunk) { return publish_payload(report.tmpl->id.c_str(), topic_, chunk, qos); });
+    }
 
-        // ISO 8601 时间戳
-        auto now = std::chrono::system_clock::now();
-        auto t   = std::chrono::system_clock::to_time_t(now);
-        std::ostringstream ts;
-        ts << std::put_time(std::gmtime(&t), "%Y-%m-%dT%H:%M:%SZ");
-
-        return {
-            {"template_id", tmpl["id"]},
-            {"device_id",   config_.device_id},
-            {"timestamp",   ts.str()},
-            {"results",     results},
-            {"has_anomaly", !anomalies.empty()},
-            {"anomaly_summary", anomalies},
+    /**
+     * 完整流程：拉取 → 测试 → 上报。
+     *
+     * MQTT 连接在拉取模板之前发起，握手与 HTTP 请求、测试执行重叠进行；
+     * 冷启动路径耗时取两者较大值而非之和。无论成功与否，返回前都断开连接。
+     */
+    Result<Report> try_run(const std::string& template_id) {
+        using clock = std::chrono::steady_clock;
+        auto ms_since = [](clock::time_point from) {
+            return std::chrono::duration<double, std::milli>(clock::now() - from).count();
         };
+
+        timings_ = RunTimings{};
+        auto t0 = clock::now();
+        // 连接失败不阻断拉取，发布前由 ensure_connected() 重试一次
+        connect_async();
+        struct DisconnectOnExit {
+            EdgeStelleDevice* device;
+            ~DisconnectOnExit() { device->disconnect(); }
+        } disconnect_on_exit{this};
+
+        auto t = clock::now();
+        auto tmpl = try_fetch_template(template_id);
+        timings_.fetch_ms = ms_since(t);
+        if (!tmpl) return tmpl.error();
+
+        t = clock::now();
+        Report report;
+        build_report(tmpl.value(), report);
+        timings_.test_ms = ms_since(t);
+
+        t = clock::now();
+        auto conn = ensure_connected();
+        timings_.connect_wait_ms = ms_since(t);
+        if (!conn) return conn.error();
+
+        t = clock::now();
+        auto sent = try_publish_report(report);
+        timings_.publish_ms = ms_since(t);
+        timings_.time_to_first_report_ms = ms_since(t0);
+        if (!sent) return sent.error();
+
+        EDGESTELLE_LOG("⏱️  time-to-first-report: %.1f ms (fetch %.1f / test %.1f / 等待连接 %.1f / publish %.1f)",
+                       timings_.time_to_first_report_ms, timings_.fetch_ms, timings_.test_ms,
+                       timings_.connect_wait_ms, timings_.publish_ms);
+        return report;
     }
 
     /**
-     * 通过 MQTT 发布测试报告。
+     * 把报告序列化为 JSON 文本 (与发布的载荷一致)。
      */
+    std::string serialize(const Report& report) const {
+        std::string out;
+        ReportSerializer::write(report, config_.device_id, out);
+        return out;
+    }
+
+    // ───────────── json 便捷接口 (抛异常) ─────────────
+
+#if !defined(EDGESTELLE_NO_EXCEPTIONS) && !defined(EDGESTELLE_MINIMAL)
+    json fetch_template(const std::string& template_id) {
+        return json::parse(detail::value_or_throw(fetch_template_body(template_id)));
+    }
+
+    json execute_test(const json& tmpl) {
+        auto compiled = detail::value_or_throw(compile_template(tmpl.dump()));
+        return json::parse(serialize(detail::value_or_throw(try_execute_test(compiled))));
+    }
+
     void publish_report(const json& report) {
-        std::string uri = config_.mqtt_broker_uri;
-        std::string client_id = "device-" + config_.device_id;
+        detail::value_or_throw(publish_payload("", topic_, report.dump(), 1));
+    }
+
+    json run(const std::string& template_id) {
+        return json::parse(serialize(detail::value_or_throw(try_run(template_id))));
+    }
+#endif
+
+    /**
+     * 最近一次 run() 的阶段耗时。
+     */
+    const RunTimings& last_timings() const { return timings_; }
 
-        mqtt::async_client client(uri, client_id);
+    /**
+     * 连续运行的初始化：拉取并编译模板、发起 MQTT 连接，并按模板指标数与
+     * config.queue_depth / alert_queue_depth 一次性分配全部缓冲 (报告槽位、结果数组、序列化缓冲)。
+     *
+     * 定义 EDGESTELLE_FIXED_MEMORY 时，报告 (分块发布时为单块) 的最坏序列化长度超出
+     * EDGESTELLE_MAX_PAYLOAD_BYTES 即返回错误，而不是在运行中扩容。
+     */
+    Result<void> prepare(const std::string& template_id) {
+        auto fetched = try_fetch_template(template_id);
+        if (!fetched) return fetched.error();
+        TemplatePtr tmpl = std::move(fetched).value();
 
-        auto connOpts = mqtt::connect_options_builder()
-            .clean_session(true)
-            .finalize();
+        size_t bound = config_.max_message_bytes == 0
+            ? ReportSerializer::max_size(*tmpl, config_.device_id, kExtensionBytes)
+            : ReportSerializer::max_chunk_size(*tmpl, config_.device_id, kExtensionBytes,
+                                               config_.max_message_bytes);
+        if (bound > EDGESTELLE_MAX_PAYLOAD_BYTES) {
+#ifdef EDGESTELLE_FIXED_MEMORY
+            return Error{Errc::template_invalid,
+                         "报告最大长度 " + std::to_string(bound) + " 字节超出 EDGESTELLE_MAX_PAYLOAD_BYTES"};
+#else
+            EDGESTELLE_LOG_ERR("⚠️  报告最大长度 %zu 字节超出预留缓冲，运行中可能扩容", bound);
+#endif
+        }
 
-        if (!config_.mqtt_username.empty()) {
-            connOpts.set_user_name(config_.mqtt_username);
-            connOpts.set_password(config_.mqtt_password);
+        tmpl_ = std::move(tmpl);
+        queue_.reset(static_cast<size_t>(std::max(1, config_.alert_queue_depth)),
+                     static_cast<size_t>(std::max(1, config_.queue_depth)), *tmpl_, kExtensionBytes);
+        buckets_[static_cast<size_t>(Lane::alert)].reset(config_.alert_lane);
+        buckets_[static_cast<size_t>(Lane::routine)].reset(config_.routine_lane);
+        payload_.reserve(std::min<size_t>(bound, EDGESTELLE_MAX_PAYLOAD_BYTES));
+        simulator_.prepare(tmpl_);
+        governor_.emplace(config_.budget, config_.sample_interval_ms, config_.batch_size);
+        n_adjustments_ = 0;
+        open_recorder();
+        open_store();
+#ifndef EDGESTELLE_NO_EXPORTER
+        exporter_.reset();
+        if (config_.metrics_port > 0) {
+            exporter_.emplace(tmpl_, config_.device_id);
+            if (store_) {
+                exporter_->set_query_handler(
+                    [this](std::string_view params, std::string& out) { return query_store(params, out); });
+            }
+            if (auto started = exporter_->start(config_.metrics_bind, config_.metrics_port); !started) {
+                log_error("启动指标端点", started.error());   // 不影响上报
+                exporter_.reset();
+            }
         }
+#endif
+        connect_async();
+        return {};
+    }
+
+    /**
+     * 执行一个采样周期 (不含休眠)：开销调节 → 采样 → 入队，攒够批量后发布。
+     * 越界报告进入 alert 道并在本周期立即发布，不等批量。
+     * 需先成功调用 prepare()；成功路径上不申请堆内存 (本地时序库换段时除外)。
+     *
+     * @return 下一周期前应休眠的毫秒数
+     */
+    int step() {
+        const auto& st = governor_->state();
+        if (governor_->on_cycle()) {
+            EDGESTELLE_LOG("🐢 开销调节: %s", governor_->last_adjustment());
+            note_adjustment(governor_->last_adjustment());
+            EDGESTELLE_PROBE3(governor__adjust, st.sample_interval_ms, st.batch_size,
+                              static_cast<int>(st.drop_low_priority));
+        }
+
+        drop_low_priority_ = st.drop_low_priority;
+        Report& report = queue_.staging();
+        build_report(tmpl_, report);
+        auto now = clock_->now();
+        if (store_feed_) store_feed_->push(now, report);
+        else if (store_) append_store(now, report);
+        if (recorder_) {
+            recorder_->record(now, report);
+            if (report.has_anomaly() && recorder_->freeze(report)) {
+                EDGESTELLE_LOG("🛩️  飞行记录器已冻结最近 %zu 个周期",
+                               static_cast<size_t>(std::min<uint64_t>(recorder_->written(), recorder_->capacity())));
+            }
+        }
+        write_overhead(report);
+        n_adjustments_ = 0;
+        [[maybe_unused]] const Report& queued = queue_.commit();
+        ++stats_.reports;
+#ifndef EDGESTELLE_NO_EXPORTER
+        if (exporter_) {
+            const auto& smp = governor_->sample();
+            stats_.cpu_fraction       = smp.cpu_fraction;
+            stats_.rss_bytes          = smp.rss_bytes;
+            stats_.sample_interval_ms = st.sample_interval_ms;
+            stats_.batch_size         = st.batch_size;
+            stats_.drop_low_priority  = st.drop_low_priority;
+            stats_.queued_reports     = queue_.size();
+            exporter_->publish(queued, stats_, clock_->now());
+        }
+#endif
+        EDGESTELLE_TRACE_INSTANT("enqueue");
+        EDGESTELLE_PROBE2(queue__enqueue, queue_.size(), st.batch_size);
+
+        bool routine_due = static_cast<int>(queue_.lane(Lane::routine).size()) >= st.batch_size;
+        if (routine_due || !queue_.lane(Lane::alert).empty() || flight_pending()) flush(routine_due);
+        return st.sample_interval_ms;
+    }
+
+    /**
+     * 连续运行：prepare() 之后按采样周期循环 step()，攒够 batch 后集中发布。
+     *
+     * 每个周期由 OverheadGovernor 测量 SDK 自身的 CPU / RSS，
+     * 超出 config.budget 时自动放慢采样、加大批量或丢弃 priority=low 的指标；
+     * 调整记录随下一份报告的 sdk_overhead 字段上报。
+     *
+     * 网络错误不会终止循环：拉取失败在下个周期重试，发布失败的报告
+     * 留在队列中随下一批重发 (常规报告最多保留 config.queue_depth 份、越界报告
+     * config.alert_queue_depth 份，超出覆盖最旧的)。
+     *
+     * config.realtime 启用时，首次 prepare() 成功后在本线程上应用实时调度
+     * (见 edgestelle_realtime.hpp)，周期按绝对时刻对齐并测量唤醒延迟，退出前恢复。
+     * 此时本地时序库改由默认调度的写入线程追加，采样线程只把点放入 StoreFeed，
+     * 不与 GET /query 争用 store_mutex_。
+     * 使用 VirtualClock 时不应用，照常快进。
+     *
+     * @param cycles  运行周期数，<0 表示直到 stop()
+     */
+    void run_loop(const std::string& template_id, int cycles = -1) {
+        stop_ = false;
+        connect_async();
+        bool precise = config_.realtime.enabled() && clock_ == &SystemClock::instance();
+        std::optional<RealtimeGuard> realtime;
+        PeriodicTimer timer;
 
-        std::cout << "[SDK] 📡 连接 MQTT: " << uri << std::endl;
-        client.connect(connOpts)->wait();
+        for (int i = 0; (cycles < 0 || i < cycles) && !stop_; ++i) {
+            if (!tmpl_) {
+                auto ready = prepare(template_id);
+                if (!ready) {
+                    log_error("拉取模板", ready.error());
+                    clock_->sleep_for(std::chrono::milliseconds(config_.sample_interval_ms), stop_);
+                    continue;
+                }
+            }
+            if (precise && !realtime) {   // 缓冲已全部分配，此时锁定的内存覆盖稳态所需
+                start_store_writer();       // 先于实时调度创建，写入线程保持默认调度
+                realtime.emplace();
+                enter_realtime(*realtime);
+                timer.start();
+            }
+            if (!realtime) {
+                int sleep_ms = step();
+                trace::Tracer::instance().poll();
+                clock_->sleep_for(std::chrono::milliseconds(sleep_ms), stop_);
+                continue;
+            }
+            auto t = std::chrono::steady_clock::now();
+            int sleep_ms = step();
+            stats_.cycle_work.observe(std::chrono::duration<double, std::milli>(
+                                          std::chrono::steady_clock::now() - t).count());
+            trace::Tracer::instance().poll();
+            if (auto late = timer.wait_next(std::chrono::milliseconds(sleep_ms), stop_)) {
+                stats_.wake_latency.observe(*late);
+            }
+            stats_.overruns = timer.overruns();
+            if (store_feed_) stats_.store_dropped = store_feed_->dropped();
+        }
 
-        std::string topic   = config_.mqtt_report_topic();
-        std::string payload = report.dump();
+        if (realtime) {
+            log_jitter();
+            realtime.reset();
+        }
+        stop_store_writer();
+        flush(true, false);
+        drop_low_priority_ = false;
+        disconnect();
+#ifndef EDGESTELLE_NO_EXPORTER
+        exporter_.reset();
+#endif
+    }
 
-        auto msg = mqtt::make_message(topic, payload, 1 /* QoS */, false);
-        client.publish(msg)->wait();
+    /**
+     * 请求 run_loop() 在当前周期结束后退出 (可在信号处理或其他线程中调用)。
+     */
+    void stop() { stop_ = true; }
 
-        std::cout << "[SDK] ✅ 报告已发布到 " << topic
-                  << " (" << payload.size() << " bytes)" << std::endl;
+    /**
+     * 连续运行的自身统计 (含实时调度启用时的唤醒延迟与处理耗时分布)。
+     * 只应在 run_loop() 所在线程或其结束后读取；运行中经指标端点导出。
+     */
+    const SdkStats& stats() const { return stats_; }
 
-        client.disconnect()->wait();
+    /**
+     * 持锁调用 f(const TimeSeriesStore&)，可与 run_loop() 并发；本地时序库未启用时返回 false。
+     */
+    template <class F>
+    bool with_store(F&& f) const {
+        std::lock_guard<std::mutex> lock(store_mutex_);
+        if (!store_) return false;
+        f(static_cast<const TimeSeriesStore&>(*store_));
+        return true;
     }
 
     /**
-     * 完整流程：拉取 → 测试 → 上报。
+     * 按 URL 查询串查询本地时序库 (参数见 TimeSeriesStore::query)，指标端点的 GET /query 即调用此处。
      */
-    json run(const std::string& template_id) {
-        auto tmpl  = fetch_template(template_id);
-        auto report = execute_test(tmpl);
-        publish_report(report);
-        return report;
+    Result<void> query_store(std::string_view params, std::string& out) const {
+        std::lock_guard<std::mutex> lock(store_mutex_);
+        if (!store_) return Error{Errc::storage_io, "本地时序库未启用"};
+        return store_->query(params, out);
     }
 
 private:
-    DeviceConfig  config_;
-    TestSimulator simulator_;
+    Result<std::string> fetch_template_body(const std::string& template_id) {
+        EDGESTELLE_TRACE_SCOPE("fetch_template");
+        [[maybe_unused]] probes::PhaseTimer timer(EDGESTELLE_PROBE_ENABLED(fetch_template__done));
+        EDGESTELLE_PROBE1(fetch_template__start, template_id.c_str());
+
+        std::string url = config_.api_base_url + "/api/v1/templates/" + template_id;
+        EDGESTELLE_LOG("📥 拉取模板: %s", url.c_str());
+
+        Result<std::string> body = [&] {
+            EDGESTELLE_TRACE_SCOPE("http_get");
+            return http_.get(url);
+        }();
+        if (!body) return body;
+        http_.save_sessions();
+        EDGESTELLE_PROBE3(fetch_template__done, template_id.c_str(),
+                          body.value().size(), timer.elapsed_us());
+        return body;
+    }
+
+    /**
+     * 执行一轮测试，结果就地写入 report (复用其 vector 容量)。
+     */
+    void build_report(const TemplatePtr& tmpl, Report& report) {
+        EDGESTELLE_TRACE_SCOPE("execute_test");
+        [[maybe_unused]] probes::PhaseTimer timer(EDGESTELLE_PROBE_ENABLED(execute_test__done));
+        EDGESTELLE_PROBE2(execute_test__start, tmpl->id.c_str(), tmpl->metrics.size());
+        EDGESTELLE_LOG("🧪 执行测试 — %zu 个指标", tmpl->metrics.size());
+
+        detail::fill_report(simulator_, tmpl, drop_low_priority_, clock_->now(), report, config_.realtime.enabled());
+
+        EDGESTELLE_PROBE4(execute_test__done, tmpl->id.c_str(),
+                          report.results.size(), report.anomalies.size(), timer.elapsed_us());
+    }
+
+    Result<void> publish_payload([[maybe_unused]] const char* template_id, const std::string& topic,
+                                 const std::string& payload, int qos) {
+        [[maybe_unused]] probes::PhaseTimer timer(EDGESTELLE_PROBE_ENABLED(publish_report__done));
+        auto conn = ensure_connected();
+        if (!conn) return conn;
+
+        EDGESTELLE_PROBE2(publish_report__start, template_id, payload.size());
+
+        Result<void> sent = [&] {
+            EDGESTELLE_TRACE_SCOPE("mqtt_publish");
+            alloc::ThirdPartyScope third_party;
+            return mqtt_.publish(topic, payload, qos);
+        }();
+        if (!sent) return sent;
+        published_bytes_ += payload.size();
+        EDGESTELLE_PROBE3(publish_report__done, template_id, payload.size(), timer.elapsed_us());
+
+        EDGESTELLE_LOG("✅ 报告已发布到 %s (%zu bytes)", topic.c_str(), payload.size());
+        return {};
+    }
+
+    void enter_realtime(RealtimeGuard& guard) {
+        const auto& rt = config_.realtime;
+        if (auto applied = guard.apply(rt); !applied) log_error("实时调度设置", applied.error());
+        EDGESTELLE_LOG("⏲️  实时采样线程: SCHED_FIFO %s，绑核 %s，内存锁定 %s",
+                       guard.fifo() ? std::to_string(rt.priority).c_str() : "否",
+                       guard.pinned() ? "是" : "否", guard.locked() ? "是" : "否");
+    }
+
+    void log_jitter() const {
+        const auto& w = stats_.wake_latency;
+        const auto& c = stats_.cycle_work;
+        EDGESTELLE_LOG("⏲️  唤醒延迟 (us，%llu 次): p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f；"
+                       "处理耗时 p99 %.1f us；超出周期 %llu 次；时序库丢弃 %llu 份",
+                       static_cast<unsigned long long>(w.count()), w.quantile(0.5) * 1e3, w.quantile(0.99) * 1e3,
+                       w.quantile(0.999) * 1e3, w.max() * 1e3, c.quantile(0.99) * 1e3,
+                       static_cast<unsigned long long>(stats_.overruns),
+                       static_cast<unsigned long long>(stats_.store_dropped));
+    }
+
+    void note_adjustment(const char* what) {
+        // 定长记录，多于 kMaxAdjustments 条时丢弃较新的 (调节器每周期至多调整一级)
+        if (n_adjustments_ >= kMaxAdjustments) return;
+        std::snprintf(adjustments_[n_adjustments_], sizeof(adjustments_[0]), "%s", what);
+        ++n_adjustments_;
+    }
+
+    void write_overhead(Report& report) const {
+        const auto& st  = governor_->state();
+        const auto& smp = governor_->sample();
+        JsonWriter w(report.extensions);
+        w.key("sdk_overhead");
+        w.begin_object();
+        w.key("cpu_pct");            w.value(smp.cpu_fraction * 100.0);
+        w.key("rss_kb");             w.value(static_cast<int64_t>(smp.rss_bytes / 1024));
+        w.key("budget_cpu_pct");     w.value(config_.budget.cpu_fraction * 100.0);
+        w.key("sample_interval_ms"); w.value(static_cast<int64_t>(st.sample_interval_ms));
+        w.key("batch_size");         w.value(static_cast<int64_t>(st.batch_size));
+        w.key("drop_low_priority");  w.value(st.drop_low_priority);
+        w.key("adjustments");
+        w.begin_array();
+        for (int i = 0; i < n_adjustments_; ++i) w.value(adjustments_[i]);
+        w.end_array();
+        w.end_object();
+    }
+
+    /**
+     * 先发完 alert 道，再 (routine 为 true 时) 发 routine 道；遇到失败即停止，
+     * 剩余报告留待下一批。shaped 为 false 时忽略令牌桶 (退出前清空队列)。
+     * 飞行记录只在 alert 道发空后发布，保证排在触发它的越界报告之后 (订阅端按
+     * 已收到的报告归属记录)；alert 道因配额用尽仍有积压时留待下一周期。
+     */
+    void flush(bool routine, bool shaped = true) {
+        if (queue_.empty() && !flight_pending()) return;
+        EDGESTELLE_TRACE_SCOPE("flush_batch");
+        EDGESTELLE_PROBE1(queue__flush, queue_.size());
+        auto now = detail::TokenBucket::clock::now();
+        if (!drain_lane(Lane::alert, now, shaped)) return;
+        if (queue_.lane(Lane::alert).empty() && !publish_flight()) return;
+        if (!routine) return;
+        drain_lane(Lane::routine, now, shaped);
+    }
+
+    bool flight_pending() const { return recorder_ && recorder_->pending(); }
+
+    /**
+     * 发布已冻结的飞行记录 (紧随触发它的越界报告，QoS 同 alert 道，不受令牌桶限制)，
+     * 失败时返回 false 并留待下一周期重发。
+     */
+    bool publish_flight() {
+        if (!flight_pending()) return true;
+        size_t before = published_bytes_;
+        auto r = publish_payload(tmpl_->id.c_str(), flight_topic_, recorder_->burst(), config_.alert_lane.qos);
+        buckets_[static_cast<size_t>(Lane::alert)].consume(published_bytes_ - before);
+        if (!r) {
+            ++stats_.publish_failures;
+            log_error("发布飞行记录", r.error());
+            return false;
+        }
+        ++stats_.flight_bursts;
+        recorder_->release();
+        return true;
+    }
+
+    /**
+     * 按 config.store_* 打开本地时序库；失败时记录日志并不启用。
+     */
+    void open_store() {
+        std::lock_guard<std::mutex> lock(store_mutex_);
+        store_.reset();
+        if (config_.store_dir.empty()) return;
+        auto opened = TimeSeriesStore::open(config_.store_dir, tmpl_, config_.store_tiers, config_.store_segment_bytes);
+        if (!opened) {
+            log_error("打开本地时序库", opened.error());
+            return;
+        }
+        store_.emplace(std::move(opened).value());
+        EDGESTELLE_LOG("🗄️  本地时序库: %s (%zu 个段)", config_.store_dir.c_str(), store_->segments());
+    }
+
+    void append_store(Clock::time_point now, const Report& report) {
+        std::lock_guard<std::mutex> lock(store_mutex_);
+        if (auto r = store_->append(now, report); !r) {
+            log_error("写入本地时序库", r.error());   // 如磁盘已满：停用，不影响上报
+            store_.reset();
+        }
+    }
+
+    /**
+     * 本地时序库已启用时创建写入交接缓冲 (容纳约 kStoreFeedMs 的报告) 与写入线程。
+     * 写入线程每 kStoreWriterPollMs 持 store_mutex_ 取空缓冲，查询占着锁时只有它等待。
+     */
+    void start_store_writer() {
+        if (!store_) return;
+        int cycles = std::max(64, kStoreFeedMs / std::max(1, config_.sample_interval_ms));
+        store_feed_.emplace(static_cast<size_t>(cycles) * std::max<size_t>(1, tmpl_->metrics.size()));
+        store_writer_stop_ = false;
+        store_writer_ = std::thread([this] {
+            while (!store_writer_stop_.load(std::memory_order_relaxed)) {
+                drain_store_feed();
+                std::this_thread::sleep_for(std::chrono::milliseconds(kStoreWriterPollMs));
+            }
+            drain_store_feed();
+        });
+    }
+
+    void stop_store_writer() {
+        if (!store_writer_.joinable()) return;
+        store_writer_stop_ = true;
+        store_writer_.join();
+        store_feed_.reset();
+    }
+
+    void drain_store_feed() {
+        std::lock_guard<std::mutex> lock(store_mutex_);
+        Result<void> ok;
+        store_feed_->drain([&](const StorePoint& p) {
+            if (store_ && ok) ok = store_->append(p.metric, p.t_ms, p.value);
+        });
+        if (!ok) {
+            log_error("写入本地时序库", ok.error());   // 同 append_store：停用，不影响上报
+            store_.reset();
+        }
+    }
+
+    /**
+     * 按 config.flight_recorder_* 打开飞行记录器；失败时记录日志并不启用 (不影响上报)。
+     */
+    void open_recorder() {
+        recorder_.reset();
+        if (config_.flight_recorder_samples <= 0) return;
+        auto opened = FlightRecorder::open(config_.flight_recorder_path, tmpl_,
+                                           static_cast<size_t>(config_.flight_recorder_samples), config_.device_id);
+        if (!opened) {
+            log_error("打开飞行记录器", opened.error());
+            return;
+        }
+        recorder_.emplace(std::move(opened).value());
+        if (recorder_->recovered() > 0) {
+            EDGESTELLE_LOG("🛩️  飞行记录器沿用 %s 中的 %zu 个周期", config_.flight_recorder_path.c_str(),
+                           recorder_->recovered());
+        }
+        size_t bound = FlightRecorder::burst_bound(*tmpl_, config_.device_id, recorder_->capacity());
+        if (config_.max_message_bytes > 0 && bound > config_.max_message_bytes) {
+            EDGESTELLE_LOG_ERR("⚠️  飞行记录最大长度 %zu 字节超出单条消息上限 %zu，可能被 broker 拒收",
+                               bound, config_.max_message_bytes);
+        }
+    }
+
+    /**
+     * 发布一道中的报告直到清空或令牌用尽，发布失败时返回 false。
+     */
+    bool drain_lane(Lane lane, detail::TokenBucket::clock::time_point now, bool shaped) {
+        ReportQueue& q = queue_.lane(lane);
+        detail::TokenBucket& bucket = buckets_[static_cast<size_t>(lane)];
+        while (!q.empty()) {
+            if (shaped && !bucket.ready(now)) return true;   // 配额用尽，留待下一周期
+            size_t before = published_bytes_;
+            auto r = try_publish_report(q.front(), config_.report_qos(q.front().has_anomaly()));
+            bucket.consume(published_bytes_ - before);
+            if (!r) {
+                ++stats_.publish_failures;
+                log_error("发布报告", r.error());
+                return false;
+            }
+            ++stats_.reports_published;
+            q.pop();
+        }
+        return true;
+    }
+
+    Result<void> ensure_connected() {
+        auto started = connect_async();
+        if (!started) return started;
+        EDGESTELLE_TRACE_SCOPE("mqtt_connect_wait");
+        return mqtt_.wait_connected();
+    }
+
+    /**
+     * 分块报告的 report_id：首次取当前时钟的毫秒数，之后逐份递增
+     * (重启后不与上次运行重复；VirtualClock 下可复现)。
+     */
+    uint64_t next_report_id() {
+        if (next_report_id_ == 0) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock_->now().time_since_epoch());
+            next_report_id_ = static_cast<uint64_t>(std::max<int64_t>(1, ms.count()));
+        }
+        return next_report_id_++;
+    }
+
+    static void log_error(const char* what, const Error& err) {
+        EDGESTELLE_LOG_ERR("⚠️  %s失败: %s", what, err.to_string().c_str());
+    }
+
+    DeviceConfig        config_;
+    TestSimulator       simulator_;
+    detail::HttpClient  http_;
+    detail::FailoverChannel mqtt_;
+    RunTimings          timings_;
+    std::string         payload_;   // 序列化缓冲，跨周期复用
+    std::string         topic_;     // 上报 topic，构造时拼好
+    std::string         flight_topic_;   // 飞行记录 topic: <topic_>/flight
+    Clock*              clock_ = &SystemClock::instance();
+    TemplateRegistry*   registry_ = nullptr;
+    uint64_t            next_report_id_ = 0;
+
+    // 连续运行状态，prepare() 时一次性分配
+    static constexpr int    kMaxAdjustments = 8;
+    static constexpr size_t kExtensionBytes = 256 + kMaxAdjustments * 2 * 96;
+
+    TemplatePtr                     tmpl_;
+    LanedReportQueue                queue_;
+    detail::TokenBucket             buckets_[kLanes];
+    size_t                          published_bytes_ = 0;   // 累计发出的载荷字节，令牌桶按差值扣减
+    std::optional<OverheadGovernor> governor_;
+    char                            adjustments_[kMaxAdjustments][96] = {};
+    int                             n_adjustments_ = 0;
+    SdkStats                        stats_;
+    std::optional<FlightRecorder>   recorder_;
+    std::optional<TimeSeriesStore>  store_;        // 采样线程 (实时调度时为写入线程) 写入，端点线程查询，均持 store_mutex_
+    mutable std::mutex              store_mutex_;
+    static constexpr int            kStoreFeedMs       = 2000;
+    static constexpr int            kStoreWriterPollMs = 10;
+    std::optional<StoreFeed>        store_feed_;   // 实时调度时采样线程 → 写入线程，其余时候为空
+    std::thread                     store_writer_;
+    std::atomic<bool>               store_writer_stop_{false};
+#ifndef EDGESTELLE_NO_EXPORTER
+    std::optional<MetricsExporter>  exporter_;
+#endif
+
+    std::atomic<bool> stop_{false};
+    bool              drop_low_priority_ = false;
 };
 
 } // namespace edgestelle
@@ -0,0 +1,528 @@
+/*
+ * EdgeStelle — C++ Device SDK: Prometheus 指标端点
+ *
+ * 供"抓取而非推送"的站点使用：DeviceConfig::metrics_port 非 0 时，run_loop() 在该端口
+ * 提供 GET /metrics，以 Prometheus 文本格式 (0.0.4) 输出最近一份报告的各指标值与
+ * SDK 自身统计 (CPU、RSS、调节器状态、队列深度、发布计数)。
+ *
+ * 采样线程每个周期把报告复制进双缓冲快照的后台槽位并原子切换前台下标；抓取线程
+ * 只读前台槽位。读者登记在槽位上，采样线程遇到仍有读者的后台槽位时跳过本次快照
+ * (计入 edgestelle_sdk_snapshot_skipped_total) 而不是等待，两侧互不阻塞。
+ *
+ * 快照与输出缓冲在构造时按模板一次性预留，各时间序列的标签部分预先拼好，
+ * 稳态下发布快照与渲染都不申请堆内存。
+ *
+ * 设置了查询回调 (set_query_handler) 时另提供 GET /query?<参数>，由回调在服务线程上
+ * 作答，返回 JSON (EdgeStelleDevice 用它暴露本地时序库，见 edgestelle_tsdb.hpp)。
+ *
+ * 定义 EDGESTELLE_NO_EXPORTER 时 EdgeStelleDevice 不启动端点 (metrics_port 被忽略)。
+ */
+
+#ifndef EDGESTELLE_EXPORTER_HPP
+#define EDGESTELLE_EXPORTER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "edgestelle_latency.hpp"
+#include "edgestelle_log.hpp"
+#include "edgestelle_report.hpp"
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+
+/**
+ * 随快照导出的 SDK 自身统计，由采样线程填写。计数均为累计。
+ */
+struct SdkStats {
+    double   cpu_fraction       = 0.0;
+    size_t   rss_bytes          = 0;
+    int      sample_interval_ms = 0;
+    int      batch_size         = 0;
+    bool     drop_low_priority  = false;
+    size_t   queued_reports     = 0;
+    uint64_t reports            = 0;
+    uint64_t reports_published  = 0;
+    uint64_t publish_failures   = 0;
+    uint64_t flight_bursts      = 0;
+    // 实时调度启用时 (DeviceConfig::realtime) 的累计分布，毫秒
+    LatencyHistogram wake_latency;    // 唤醒时刻晚于周期起点的时长
+    LatencyHistogram cycle_work;      // 每周期 step() 的耗时
+    uint64_t         overruns = 0;    // 处理超出采样周期、未休眠即开始下一周期的次数
+    uint64_t         store_dropped = 0;   // 写入交接缓冲满、未写入本地时序库的报告数
+};
+
+/**
+ * 一份可供抓取的快照。index[m] 为指标 m 在 results 中的下标，-1 表示本周期未采样
+ * (如 drop_low_priority 丢弃)。
+ */
+struct MetricsSnapshot {
+    std::vector<MetricResult> results;
+    std::vector<double>       elements;
+    std::vector<int32_t>      index;
+    std::vector<uint8_t>      anomalous;   // 按指标下标
+    SdkStats                  stats;
+    double                    timestamp_s = 0.0;
+    bool                      valid       = false;
+};
+
+namespace detail {
+
+/**
+ * 单写多读的双缓冲快照。写者只由采样线程调用，读者可在任意线程。
+ */
+class SnapshotBuffer {
+public:
+    void reset(const CompiledTemplate& tmpl) {
+        auto bounds = report_bounds(tmpl);
+        for (auto& s : slots_) {
+            s.results.reserve(bounds.results);
+            s.elements.reserve(bounds.elements);
+            s.index.reserve(tmpl.metrics.size());
+            s.anomalous.reserve(tmpl.metrics.size());
+            s.valid = false;
+        }
+    }
+
+    /**
+     * 写入后台槽位并切换为前台。后台槽位仍有读者时跳过，返回 false。
+     */
+    bool publish(const Report& report, const SdkStats& stats, double timestamp_s) {
+        int back = 1 - front_.load();
+        if (readers_[back].load() != 0) {
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        MetricsSnapshot& s = slots_[back];
+        size_t metrics = report.tmpl->metrics.size();
+        s.results.assign(report.results.begin(), report.results.end());
+        s.elements.assign(report.elements.begin(), report.elements.end());
+        s.index.assign(metrics, -1);
+        s.anomalous.assign(metrics, 0);
+        for (size_t r = 0; r < report.results.size(); ++r) s.index[report.results[r].metric] = static_cast<int32_t>(r);
+        for (const auto& a : report.anomalies) s.anomalous[a.metric] = 1;
+        s.stats       = stats;
+        s.timestamp_s = timestamp_s;
+        s.valid       = true;
+        front_.store(back);
+        published_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * 以当前前台快照调用 fn。读取期间该槽位不会被写者覆盖。
+     */
+    template <class Fn>
+    void read(Fn&& fn) {
+        for (;;) {
+            int f = front_.load();
+            readers_[f].fetch_add(1);
+            // 登记后再确认仍是前台：写者在切换后检查读者数，二者 (seq_cst) 至少一方看到对方
+            if (front_.load() == f) {
+                fn(static_cast<const MetricsSnapshot&>(slots_[f]));
+                readers_[f].fetch_sub(1);
+                return;
+            }
+            readers_[f].fetch_sub(1);
+        }
+    }
+
+    uint64_t published() const { return published_.load(std::memory_order_relaxed); }
+    uint64_t skipped()   const { return skipped_.load(std::memory_order_relaxed); }
+
+private:
+    MetricsSnapshot       slots_[2];
+    std::atomic<int>      front_{0};
+    std::atomic<int>      readers_[2] = {};
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> skipped_{0};
+};
+
+} // namespace detail
+
+// ═════════════════════════════════════════════════════
+//  指标端点
+// ═════════════════════════════════════════════════════
+
+class MetricsExporter {
+public:
+    /**
+     * @param tmpl       已编译模板，决定导出的时间序列
+     * @param device_id  写入每条序列的 device 标签
+     */
+    MetricsExporter(TemplatePtr tmpl, const std::string& device_id) : tmpl_(std::move(tmpl)) {
+        std::string device = "device=\"" + escape(device_id) + "\"";
+        size_t bound = 4096;   // HELP / TYPE 行与 SDK 统计
+        for (double le : kLatencyBoundsMs) {
+            char buf[32];
+            auto r = std::to_chars(buf, buf + sizeof(buf), le / 1000.0);
+            le_.push_back("{" + device + ",le=\"" + std::string(buf, r.ptr) + "\"}");
+            bound += 2 * (le_.back().size() + kSeriesBytes + 48);
+        }
+        le_.push_back("{" + device + ",le=\"+Inf\"}");
+        bound += 2 * (le_.back().size() + 3 * kSeriesBytes + 96);
+        for (uint32_t m = 0; m < tmpl_->metrics.size(); ++m) {
+            const auto& spec = tmpl_->metrics[m];
+            std::string base = device + ",metric=\"" + escape(spec.name) + "\"";
+            values_.push_back("{" + base + ",unit=\"" + escape(spec.unit) + "\"}");
+            anomaly_.push_back("{" + base + "}");
+            bound += values_.back().size() + anomaly_.back().size() + 2 * kSeriesBytes;
+
+            auto element = [&](uint32_t slot, std::string_view label) {
+                elements_.push_back(Series{m, slot, "{" + base + ",element=\"" + escape(label) + "\"}"});
+                bound += elements_.back().labels.size() + kSeriesBytes;
+            };
+            if (spec.kind == MetricKind::waveform) {
+                element(waveform_slot::peak, "peak");
+                element(waveform_slot::crest, "crest_factor");
+                for (uint32_t b = 0; b < spec.waveform.bands.size(); ++b) {
+                    element(waveform_slot::bands + b, spec.waveform.bands[b].name);
+                }
+            } else if (spec.kind == MetricKind::vector) {
+                for (uint32_t i = 0; i < spec.vector.length; ++i) {
+                    element(i, i < spec.vector.labels.size() ? spec.vector.labels[i] : std::to_string(i));
+                }
+            } else if (spec.kind == MetricKind::histogram) {
+                // 桶计数是单个周期的分布而非累计值，不套用 Prometheus histogram 语义，只导出分位数
+                uint32_t first = histogram_slot::quantiles(spec.histogram);
+                for (uint32_t q = 0; q < spec.histogram.quantiles.size(); ++q) {
+                    char buf[32];
+                    auto r = std::to_chars(buf, buf + sizeof(buf), spec.histogram.quantiles[q].q);
+                    quantiles_.push_back(Series{m, first + q, "{" + base + ",quantile=\"" +
+                                                              std::string(buf, r.ptr) + "\"}"});
+                    bound += quantiles_.back().labels.size() + kSeriesBytes;
+                }
+            }
+        }
+        device_ = "{" + device + "}";
+        snapshots_.reset(*tmpl_);
+        out_.reserve(bound);
+    }
+
+    ~MetricsExporter() { stop(); }
+
+    MetricsExporter(const MetricsExporter&)            = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    /**
+     * 监听 bind_addr:port (port 为 0 时由系统分配，见 port()) 并启动服务线程。
+     */
+    Result<void> start(const std::string& bind_addr, int port) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons(static_cast<uint16_t>(port));
+        if (inet_pton(AF_INET, bind_addr.c_str(), &addr.sin_addr) != 1) {
+            return Error{Errc::exporter_bind, "无效的监听地址 " + bind_addr};
+        }
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return Error{Errc::exporter_bind, std::string("socket: ") + std::strerror(errno)};
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, 8) != 0) {
+            std::string why = std::strerror(errno);
+            ::close(fd);
+            return Error{Errc::exporter_bind, bind_addr + ":" + std::to_string(port) + ": " + why};
+        }
+        socklen_t len = sizeof(addr);
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_      = ntohs(addr.sin_port);
+        listen_fd_ = fd;
+        stop_      = false;
+        thread_    = std::thread([this] { serve(); });
+        EDGESTELLE_LOG("📈 指标端点: http://%s:%d/metrics", bind_addr.c_str(), port_);
+        return {};
+    }
+
+    void stop() {
+        stop_ = true;
+        if (thread_.joinable()) thread_.join();
+        if (listen_fd_ >= 0) ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+
+    int port() const { return port_; }
+
+    // 查询回调：参数为 URL 查询串，JSON 结果写入第二个参数；返回错误时以 400 回应
+    using QueryHandler = std::function<Result<void>(std::string_view, std::string&)>;
+
+    /**
+     * 启用 GET /query，须在 start() 之前设置。
+     */
+    void set_query_handler(QueryHandler handler) { query_ = std::move(handler); }
+
+    /**
+     * 采样线程调用：发布本周期的报告与统计。不阻塞、不申请堆内存。
+     */
+    void publish(const Report& report, const SdkStats& stats, std::chrono::system_clock::time_point now) {
+        snapshots_.publish(report, stats, std::chrono::duration<double>(now.time_since_epoch()).count());
+    }
+
+    /**
+     * 按 Prometheus 文本格式渲染当前快照。返回的视图在下次 render() 前有效；
+     * 只应由单个线程调用 (服务线程，或未 start() 时的调用方)。
+     */
+    std::string_view render() {
+        out_.clear();
+        snapshots_.read([&](const MetricsSnapshot& s) { render(s); });
+        return out_;
+    }
+
+    uint64_t scrapes()           const { return scrapes_.load(std::memory_order_relaxed); }
+    uint64_t snapshots_skipped() const { return snapshots_.skipped(); }
+
+private:
+    static constexpr size_t kSeriesBytes = 64;   // 名称之外的值、空格与换行
+
+    // 延迟直方图导出的桶上界 (毫秒)
+    static constexpr double kLatencyBoundsMs[] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+                                                  1, 2.5, 5, 10, 25, 50, 100};
+
+    struct Series {
+        uint32_t    metric;
+        uint32_t    slot;     // 在该指标 elements 段内的偏移
+        std::string labels;   // 含花括号
+    };
+
+    static std::string escape(std::string_view v) {
+        std::string out;
+        for (char c : v) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') {
+                out += "\\n";
+                continue;
+            }
+            out += c;
+        }
+        return out;
+    }
+
+    void family(const char* name, const char* type, const char* help) {
+        out_ += "# HELP ";
+        out_ += name;
+        out_ += ' ';
+        out_ += help;
+        out_ += "\n# TYPE ";
+        out_ += name;
+        out_ += ' ';
+        out_ += type;
+        out_ += '\n';
+    }
+
+    void sample(const char* name, std::string_view labels, double v) {
+        out_ += name;
+        out_.append(labels.data(), labels.size());
+        out_ += ' ';
+        if (std::isnan(v)) {
+            out_ += "NaN";
+        } else if (std::isinf(v)) {
+            out_ += v > 0 ? "+Inf" : "-Inf";
+        } else {
+            char buf[32];
+            auto r = std::to_chars(buf, buf + sizeof(buf), v);
+            out_.append(buf, r.ptr);
+        }
+        out_ += '\n';
+    }
+
+    void render(const MetricsSnapshot& s) {
+        if (s.valid) render_metrics(s);
+
+        const SdkStats& st = s.stats;
+        family("edgestelle_sdk_cpu_ratio", "gauge", "SDK 自身 CPU 占用 (单核占比，平滑值)");
+        sample("edgestelle_sdk_cpu_ratio", device_, st.cpu_fraction);
+        family("edgestelle_sdk_rss_bytes", "gauge", "SDK 进程常驻内存");
+        sample("edgestelle_sdk_rss_bytes", device_, static_cast<double>(st.rss_bytes));
+        family("edgestelle_sdk_sample_interval_seconds", "gauge", "开销调节器当前的采样周期");
+        sample("edgestelle_sdk_sample_interval_seconds", device_, st.sample_interval_ms / 1000.0);
+        family("edgestelle_sdk_batch_size", "gauge", "开销调节器当前的发布批量");
+        sample("edgestelle_sdk_batch_size", device_, st.batch_size);
+        family("edgestelle_sdk_drop_low_priority", "gauge", "是否丢弃 priority=low 的指标");
+        sample("edgestelle_sdk_drop_low_priority", device_, st.drop_low_priority ? 1.0 : 0.0);
+        family("edgestelle_sdk_queued_reports", "gauge", "待发布的报告数");
+        sample("edgestelle_sdk_queued_reports", device_, static_cast<double>(st.queued_reports));
+        family("edgestelle_sdk_reports_total", "counter", "已生成的报告数");
+        sample("edgestelle_sdk_reports_total", device_, static_cast<double>(st.reports));
+        family("edgestelle_sdk_reports_published_total", "counter", "已发布的报告数");
+        sample("edgestelle_sdk_reports_published_total", device_, static_cast<double>(st.reports_published));
+        family("edgestelle_sdk_publish_failures_total", "counter", "发布失败次数");
+        sample("edgestelle_sdk_publish_failures_total", device_, static_cast<double>(st.publish_failures));
+        family("edgestelle_sdk_flight_bursts_total", "counter", "已发布的飞行记录器突发数");
+        sample("edgestelle_sdk_flight_bursts_total", device_, static_cast<double>(st.flight_bursts));
+        family("edgestelle_sdk_snapshots_total", "counter", "已发布到端点的快照数");
+        sample("edgestelle_sdk_snapshots_total", device_, static_cast<double>(snapshots_.published()));
+        family("edgestelle_sdk_snapshot_skipped_total", "counter", "因抓取占用后台槽位而跳过的快照数");
+        sample("edgestelle_sdk_snapshot_skipped_total", device_, static_cast<double>(snapshots_.skipped()));
+        family("edgestelle_sdk_scrapes_total", "counter", "本端点被抓取的次数");
+        sample("edgestelle_sdk_scrapes_total", device_, static_cast<double>(scrapes_.load(std::memory_order_relaxed)));
+        if (st.wake_latency.count() > 0 || st.cycle_work.count() > 0) {
+            family("edgestelle_sdk_wake_latency_seconds", "histogram", "实时采样线程唤醒晚于周期起点的时长");
+            latency("edgestelle_sdk_wake_latency_seconds_bucket", "edgestelle_sdk_wake_latency_seconds_sum",
+                    "edgestelle_sdk_wake_latency_seconds_count", st.wake_latency);
+            family("edgestelle_sdk_cycle_work_seconds", "histogram", "实时采样线程每周期的处理耗时");
+            latency("edgestelle_sdk_cycle_work_seconds_bucket", "edgestelle_sdk_cycle_work_seconds_sum",
+                    "edgestelle_sdk_cycle_work_seconds_count", st.cycle_work);
+            family("edgestelle_sdk_cycle_overruns_total", "counter", "处理超出采样周期的次数");
+            sample("edgestelle_sdk_cycle_overruns_total", device_, static_cast<double>(st.overruns));
+            family("edgestelle_sdk_store_dropped_total", "counter", "实时采样时因写入缓冲满未写入本地时序库的报告数");
+            sample("edgestelle_sdk_store_dropped_total", device_, static_cast<double>(st.store_dropped));
+        }
+    }
+
+    /**
+     * 以 Prometheus histogram 写出 h (毫秒 → 秒)；桶计数按 LatencyHistogram 的桶上界近似。
+     */
+    void latency(const char* bucket, const char* sum, const char* count, const LatencyHistogram& h) {
+        size_t i = 0;
+        for (double le : kLatencyBoundsMs) sample(bucket, le_[i++], static_cast<double>(h.count_le(le)));
+        sample(bucket, le_[i], static_cast<double>(h.count()));
+        sample(sum, device_, h.sum() / 1000.0);
+        sample(count, device_, static_cast<double>(h.count()));
+    }
+
+    void render_metrics(const MetricsSnapshot& s) {
+        family("edgestelle_report_timestamp_seconds", "gauge", "最近一份报告的采样时刻");
+        sample("edgestelle_report_timestamp_seconds", device_, s.timestamp_s);
+
+        family("edgestelle_metric", "gauge", "模板指标的最新值 (波形为 RMS，向量为均值，直方图为中位数)");
+        for (size_t m = 0; m < values_.size(); ++m) {
+            if (s.index[m] >= 0) sample("edgestelle_metric", values_[m], s.results[s.index[m]].value);
+        }
+        if (!elements_.empty()) {
+            family("edgestelle_metric_element", "gauge", "向量元素与波形特征 (峰值、峰值因数、频带能量)");
+            for (const auto& e : elements_) {
+                if (s.index[e.metric] < 0) continue;
+                const auto& r = s.results[s.index[e.metric]];
+                if (e.slot < r.count) sample("edgestelle_metric_element", e.labels, s.elements[r.first + e.slot]);
+            }
+        }
+        if (!quantiles_.empty()) {
+            family("edgestelle_metric_quantile", "gauge", "直方图指标的分位数估计");
+            for (const auto& q : quantiles_) {
+                if (s.index[q.metric] < 0) continue;
+                const auto& r = s.results[s.index[q.metric]];
+                if (q.slot < r.count) sample("edgestelle_metric_quantile", q.labels, s.elements[r.first + q.slot]);
+            }
+        }
+        family("edgestelle_metric_anomaly", "gauge", "最近一份报告中该指标是否越界");
+        for (size_t m = 0; m < anomaly_.size(); ++m) {
+            if (s.index[m] >= 0) sample("edgestelle_metric_anomaly", anomaly_[m], s.anomalous[m]);
+        }
+    }
+
+    // ───────────── HTTP ─────────────
+
+    void serve() {
+        while (!stop_) {
+            pollfd p{listen_fd_, POLLIN, 0};
+            if (::poll(&p, 1, 200) <= 0) continue;
+            int conn = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (conn < 0) continue;
+            timeval tv{1, 0};   // 慢客户端不拖住服务线程
+            ::setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            ::setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+            handle(conn);
+            ::close(conn);
+        }
+    }
+
+    void handle(int conn) {
+        char   req[2048];
+        size_t n = 0;
+        while (n < sizeof(req) - 1) {
+            ssize_t got = ::recv(conn, req + n, sizeof(req) - 1 - n, 0);
+            if (got <= 0) break;
+            n += static_cast<size_t>(got);
+            req[n] = '\0';
+            if (std::strstr(req, "\r\n\r\n")) break;
+        }
+        req[n] = '\0';
+
+        std::string_view line(req, n);
+        line = line.substr(0, line.find("\r\n"));
+        bool head = line.rfind("HEAD ", 0) == 0;
+        if (!head && line.rfind("GET ", 0) != 0) {
+            respond(conn, "405 Method Not Allowed", "text/plain", "method not allowed\n", false);
+            return;
+        }
+        std::string_view target = line.substr(line.find(' ') + 1);
+        target = target.substr(0, target.find(' '));
+        std::string_view path = target.substr(0, target.find('?'));
+        if (path == "/query" && query_) {
+            size_t q = target.find('?');
+            auto answered = query_(q == std::string_view::npos ? std::string_view{} : target.substr(q + 1), query_out_);
+            if (!answered) {
+                query_out_ = answered.error().message + "\n";
+                respond(conn, "400 Bad Request", "text/plain; charset=utf-8", query_out_, head);
+                return;
+            }
+            respond(conn, "200 OK", "application/json", query_out_, head);
+            return;
+        }
+        if (path != "/metrics") {
+            respond(conn, "404 Not Found", "text/plain", "not found\n", false);
+            return;
+        }
+        scrapes_.fetch_add(1, std::memory_order_relaxed);
+        respond(conn, "200 OK", "text/plain; version=0.0.4; charset=utf-8", render(), head);
+    }
+
+    static void respond(int conn, const char* status, const char* type, std::string_view body, bool head) {
+        char header[256];
+        int len = std::snprintf(header, sizeof(header),
+                                "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                                status, type, body.size());
+        if (!send_all(conn, header, static_cast<size_t>(len)) || head) return;
+        send_all(conn, body.data(), body.size());
+    }
+
+    static bool send_all(int conn, const char* data, size_t len) {
+        while (len > 0) {
+            ssize_t sent = ::send(conn, data, len, MSG_NOSIGNAL);
+            if (sent <= 0) return false;
+            data += sent;
+            len  -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    TemplatePtr              tmpl_;
+    std::string              device_;      // {device="..."}
+    std::vector<std::string> values_;      // 按指标下标
+    std::vector<std::string> anomaly_;
+    std::vector<Series>      elements_;
+    std::vector<Series>      quantiles_;
+    std::vector<std::string> le_;          // 延迟直方图各桶的标签，末尾为 +Inf
+    detail::SnapshotBuffer   snapshots_;
+    std::string              out_;         // 渲染缓冲，构造时按最坏长度预留
+    QueryHandler             query_;
+    std::string              query_out_;   // 仅服务线程使用
+
+    int                   listen_fd_ = -1;
+    int                   port_      = 0;
+    std::thread           thread_;
+    std::atomic<bool>     stop_{false};
+    std::atomic<uint64_t> scrapes_{0};
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_EXPORTER_HPP
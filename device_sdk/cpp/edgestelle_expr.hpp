@@ -0,0 +1,456 @@
+/*
+ * EdgeStelle — C++ Device SDK: 派生指标与规则表达式
+ *
+ * 模板中的派生指标 ("expression": "mem_used / mem_total * 100") 与复合规则
+ * ("when": "cpu_temperature > 70 && cpu_usage < 10") 在编译模板时一次性编译为
+ * 栈式字节码 (ExprProgram)，每周期由 ExprEvaluator 在指标值矩阵上求值。
+ *
+ * 语法 (优先级由低到高):
+ *   a || b    a && b    == != < <= > >=    + -    * /    一元 - !
+ *   数值常量、指标名、括号，以及函数:
+ *     abs(x)  sqrt(x)  min(a, b)  max(a, b)
+ *     delta(m)   指标 m 与上一周期之差
+ *     rate(m)    指标 m 每秒的变化率 (delta(m) / 两周期间隔秒数)
+ *   比较与逻辑运算的结果为 1 / 0，逻辑运算把非 0 视为真。首个周期没有上一周期值，
+ *   delta / rate 为 NaN；缺失的指标 (如被丢弃的低优先级指标) 也是 NaN，表示"未知":
+ *   NaN 参与比较 (含 !=) 与 ! 的结果仍为 NaN；&& / || 按三值逻辑，另一侧已能决定结果时
+ *   (0 && NaN 为 0，1 || NaN 为 1) 取该结果，否则为 NaN。规则只在结果为非 NaN 的非 0 值时
+ *   触发，因此 "x != 3"、"!(x > 5)" 都不会因 x 缺失而触发。
+ *
+ * 求值按 lane 批量进行：指标值矩阵按指标主序存放 (values[metric * lanes + lane])，
+ * 每条指令对全部 lane 做一遍紧凑循环，舰队模式以 lanes = 设备数一次求值全体设备，
+ * 单设备时 lanes = 1。常量子表达式在编译期折叠。
+ */
+
+#ifndef EDGESTELLE_EXPR_HPP
+#define EDGESTELLE_EXPR_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+
+// ═════════════════════════════════════════════════════
+//  字节码
+// ═════════════════════════════════════════════════════
+
+enum class ExprOp : uint8_t {
+    constant,      // 压入 constants[arg]
+    load,          // 压入指标 arg 的本周期值
+    delta,         // 压入指标 arg 的本周期值 - 上周期值
+    rate,          // 压入 delta / 周期间隔秒数
+    neg, not_, abs, sqrt,
+    add, sub, mul, div, min, max,
+    lt, le, gt, ge, eq, ne, and_, or_,
+};
+
+struct ExprInsn {
+    ExprOp   op;
+    uint32_t arg = 0;
+};
+
+/**
+ * 编译后的表达式。inputs 为引用到的指标下标 (按首次出现顺序、不重复)。
+ */
+struct ExprProgram {
+    std::vector<ExprInsn> code;
+    std::vector<double>   constants;
+    std::vector<uint32_t> inputs;
+    uint32_t              max_depth = 0;      // 求值栈的最大深度
+    bool                  uses_prev = false;  // 含 delta / rate，需要保留上一周期的值
+
+    bool empty() const { return code.empty(); }
+};
+
+namespace detail {
+
+constexpr double kMissing = std::numeric_limits<double>::quiet_NaN();
+
+/**
+ * 比较结果：任一侧为 NaN 时为 NaN，否则为 1 / 0。
+ */
+inline double compared(bool holds, double a, double b) {
+    return (a == a) & (b == b) ? static_cast<double>(holds) : kMissing;
+}
+
+/**
+ * 对 n 个 lane 执行一条一元 / 二元指令：a = op(a[, b])。
+ */
+inline void apply_op(ExprOp op, double* a, const double* b, size_t n) {
+    switch (op) {
+        case ExprOp::neg:  for (size_t i = 0; i < n; ++i) a[i] = -a[i]; break;
+        case ExprOp::not_:
+            for (size_t i = 0; i < n; ++i) a[i] = a[i] == a[i] ? static_cast<double>(a[i] == 0.0) : kMissing;
+            break;
+        case ExprOp::abs:  for (size_t i = 0; i < n; ++i) a[i] = std::fabs(a[i]); break;
+        case ExprOp::sqrt: for (size_t i = 0; i < n; ++i) a[i] = std::sqrt(a[i]); break;
+        case ExprOp::add:  for (size_t i = 0; i < n; ++i) a[i] += b[i]; break;
+        case ExprOp::sub:  for (size_t i = 0; i < n; ++i) a[i] -= b[i]; break;
+        case ExprOp::mul:  for (size_t i = 0; i < n; ++i) a[i] *= b[i]; break;
+        case ExprOp::div:  for (size_t i = 0; i < n; ++i) a[i] /= b[i]; break;
+        case ExprOp::min:  for (size_t i = 0; i < n; ++i) a[i] = std::fmin(a[i], b[i]); break;
+        case ExprOp::max:  for (size_t i = 0; i < n; ++i) a[i] = std::fmax(a[i], b[i]); break;
+        case ExprOp::lt:   for (size_t i = 0; i < n; ++i) a[i] = compared(a[i] <  b[i], a[i], b[i]); break;
+        case ExprOp::le:   for (size_t i = 0; i < n; ++i) a[i] = compared(a[i] <= b[i], a[i], b[i]); break;
+        case ExprOp::gt:   for (size_t i = 0; i < n; ++i) a[i] = compared(a[i] >  b[i], a[i], b[i]); break;
+        case ExprOp::ge:   for (size_t i = 0; i < n; ++i) a[i] = compared(a[i] >= b[i], a[i], b[i]); break;
+        case ExprOp::eq:   for (size_t i = 0; i < n; ++i) a[i] = compared(a[i] == b[i], a[i], b[i]); break;
+        case ExprOp::ne:   for (size_t i = 0; i < n; ++i) a[i] = compared(a[i] != b[i], a[i], b[i]); break;
+        case ExprOp::and_:   // 任一侧确定为假 → 0；否则有 NaN → NaN
+            for (size_t i = 0; i < n; ++i) {
+                bool known = (a[i] == a[i]) & (b[i] == b[i]);
+                a[i] = (a[i] == 0.0) | (b[i] == 0.0) ? 0.0 : known ? 1.0 : kMissing;
+            }
+            break;
+        case ExprOp::or_:    // 任一侧确定为真 → 1；否则有 NaN → NaN
+            for (size_t i = 0; i < n; ++i) {
+                bool known = (a[i] == a[i]) & (b[i] == b[i]);
+                a[i] = (std::fabs(a[i]) > 0.0) | (std::fabs(b[i]) > 0.0) ? 1.0 : known ? 0.0 : kMissing;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * 递归下降解析器，边解析边生成字节码。
+ */
+class ExprCompiler {
+public:
+    static constexpr uint32_t kUnknown  = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t   kMaxChars = 4096;
+    static constexpr int      kMaxNest  = 64;
+
+    using Resolver = std::function<uint32_t(std::string_view)>;
+
+    ExprCompiler(std::string_view src, const Resolver& resolve) : src_(src), resolve_(resolve) {}
+
+    Result<ExprProgram> compile() {
+        if (src_.size() > kMaxChars) return fail("表达式超过 " + std::to_string(kMaxChars) + " 个字符");
+        skip_space();
+        if (pos_ == src_.size()) return fail("表达式为空");
+        if (!parse_or()) return error_;
+        if (pos_ != src_.size()) return fail("多余的内容");
+        return std::move(prog_);
+    }
+
+private:
+    // ── 语法 ──
+
+    bool parse_or() {
+        if (!parse_and()) return false;
+        while (accept("||")) {
+            if (!parse_and()) return false;
+            emit_binary(ExprOp::or_);
+        }
+        return true;
+    }
+
+    bool parse_and() {
+        if (!parse_compare()) return false;
+        while (accept("&&")) {
+            if (!parse_compare()) return false;
+            emit_binary(ExprOp::and_);
+        }
+        return true;
+    }
+
+    bool parse_compare() {
+        if (!parse_sum()) return false;
+        for (;;) {
+            ExprOp op;
+            if (accept("<="))      op = ExprOp::le;
+            else if (accept(">=")) op = ExprOp::ge;
+            else if (accept("==")) op = ExprOp::eq;
+            else if (accept("!=")) op = ExprOp::ne;
+            else if (accept("<"))  op = ExprOp::lt;
+            else if (accept(">"))  op = ExprOp::gt;
+            else return true;
+            if (!parse_sum()) return false;
+            emit_binary(op);
+        }
+    }
+
+    bool parse_sum() {
+        if (!parse_product()) return false;
+        for (;;) {
+            ExprOp op;
+            if (accept("+"))      op = ExprOp::add;
+            else if (accept("-")) op = ExprOp::sub;
+            else return true;
+            if (!parse_product()) return false;
+            emit_binary(op);
+        }
+    }
+
+    bool parse_product() {
+        if (!parse_unary()) return false;
+        for (;;) {
+            ExprOp op;
+            if (accept("*"))      op = ExprOp::mul;
+            else if (accept("/")) op = ExprOp::div;
+            else return true;
+            if (!parse_unary()) return false;
+            emit_binary(op);
+        }
+    }
+
+    bool parse_unary() {
+        if (++nest_ > kMaxNest) return fail_at("嵌套过深");
+        bool ok;
+        if (accept("-")) {
+            ok = parse_unary() && (emit_unary(ExprOp::neg), true);
+        } else if (src_.compare(pos_, 2, "!=") != 0 && accept("!")) {
+            ok = parse_unary() && (emit_unary(ExprOp::not_), true);
+        } else {
+            ok = parse_primary();
+        }
+        --nest_;
+        return ok;
+    }
+
+    bool parse_primary() {
+        if (pos_ == src_.size()) return fail_at("表达式不完整");
+        char c = src_[pos_];
+        if (accept("(")) {
+            if (!parse_or()) return false;
+            return expect(")");
+        }
+        if ((c >= '0' && c <= '9') || c == '.') return parse_number();
+        if (!ident_start(c)) return fail_at(std::string("无法识别的字符 '") + c + "'");
+
+        size_t start = pos_;
+        while (pos_ < src_.size() && ident_char(src_[pos_])) ++pos_;
+        std::string_view name = src_.substr(start, pos_ - start);
+        skip_space();
+        if (!accept("(")) return emit_load(ExprOp::load, name, start);
+        return parse_call(name, start);
+    }
+
+    bool parse_call(std::string_view fn, size_t at) {
+        if (fn == "delta" || fn == "rate") {
+            size_t start = pos_;
+            while (pos_ < src_.size() && ident_char(src_[pos_])) ++pos_;
+            std::string_view name = src_.substr(start, pos_ - start);
+            skip_space();
+            if (name.empty() || !ident_start(name[0])) {
+                pos_ = start;
+                return fail_at(std::string(fn) + "() 的参数须为指标名");
+            }
+            if (!emit_load(fn == "delta" ? ExprOp::delta : ExprOp::rate, name, start)) return false;
+            return expect(")");
+        }
+
+        int arity;
+        ExprOp op;
+        if (fn == "abs")       { arity = 1; op = ExprOp::abs; }
+        else if (fn == "sqrt") { arity = 1; op = ExprOp::sqrt; }
+        else if (fn == "min")  { arity = 2; op = ExprOp::min; }
+        else if (fn == "max")  { arity = 2; op = ExprOp::max; }
+        else {
+            pos_ = at;
+            return fail_at("未知函数 " + std::string(fn));
+        }
+        for (int k = 0; k < arity; ++k) {
+            if (k > 0 && !expect(",")) return false;
+            if (!parse_or()) return false;
+        }
+        if (!expect(")")) return false;
+        if (arity == 1) emit_unary(op);
+        else            emit_binary(op);
+        return true;
+    }
+
+    bool parse_number() {
+        double v = 0.0;
+        const char* first = src_.data() + pos_;
+        auto r = std::from_chars(first, src_.data() + src_.size(), v);
+        if (r.ec != std::errc()) return fail_at("数值格式错误");
+        pos_ += static_cast<size_t>(r.ptr - first);
+        skip_space();
+        emit_constant(v);
+        return true;
+    }
+
+    // ── 生成 ──
+
+    bool emit_load(ExprOp op, std::string_view name, size_t at) {
+        uint32_t metric = resolve_(name);
+        if (metric == kUnknown) {
+            pos_ = at;
+            return fail_at("未知指标 " + std::string(name));
+        }
+        if (std::find(prog_.inputs.begin(), prog_.inputs.end(), metric) == prog_.inputs.end()) {
+            prog_.inputs.push_back(metric);
+        }
+        if (op != ExprOp::load) prog_.uses_prev = true;
+        push(ExprInsn{op, metric});
+        return true;
+    }
+
+    void emit_constant(double v) {
+        prog_.constants.push_back(v);
+        push(ExprInsn{ExprOp::constant, static_cast<uint32_t>(prog_.constants.size() - 1)});
+    }
+
+    // 操作数为常量时直接折叠
+    void emit_unary(ExprOp op) {
+        ExprInsn& a = prog_.code.back();
+        if (a.op == ExprOp::constant) {
+            double& v = prog_.constants[a.arg];
+            apply_op(op, &v, nullptr, 1);
+            return;
+        }
+        prog_.code.push_back(ExprInsn{op});
+    }
+
+    void emit_binary(ExprOp op) {
+        size_t n = prog_.code.size();
+        if (prog_.code[n - 2].op == ExprOp::constant && prog_.code[n - 1].op == ExprOp::constant) {
+            double& a = prog_.constants[prog_.code[n - 2].arg];
+            apply_op(op, &a, &prog_.constants[prog_.code[n - 1].arg], 1);
+            prog_.constants.pop_back();
+            prog_.code.pop_back();
+        } else {
+            prog_.code.push_back(ExprInsn{op});
+        }
+        --depth_;
+    }
+
+    void push(ExprInsn insn) {
+        prog_.code.push_back(insn);
+        prog_.max_depth = std::max(prog_.max_depth, ++depth_);
+    }
+
+private:
+    // ── 词法 ──
+
+    static bool ident_start(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+    static bool ident_char(char c)  { return ident_start(c) || (c >= '0' && c <= '9') || c == '.'; }
+
+    void skip_space() {
+        while (pos_ < src_.size() && (src_[pos_] == ' ' || src_[pos_] == '\t' || src_[pos_] == '\n')) ++pos_;
+    }
+
+    bool accept(std::string_view tok) {
+        if (src_.compare(pos_, tok.size(), tok) != 0) return false;
+        pos_ += tok.size();
+        skip_space();
+        return true;
+    }
+
+    bool expect(std::string_view tok) {
+        if (accept(tok)) return true;
+        return fail_at("缺少 '" + std::string(tok) + "'");
+    }
+
+    Error fail(std::string message) {
+        error_ = Error{Errc::template_invalid, "表达式 \"" + std::string(src_) + "\": " + std::move(message)};
+        return error_;
+    }
+
+    bool fail_at(const std::string& message) {
+        fail("位置 " + std::to_string(pos_) + ": " + message);
+        return false;
+    }
+
+    std::string_view src_;
+    const Resolver&  resolve_;
+    size_t           pos_   = 0;
+    int              nest_  = 0;
+    uint32_t         depth_ = 0;
+    ExprProgram      prog_;
+    Error            error_;
+};
+
+} // namespace detail
+
+/**
+ * 编译表达式。resolve 把指标名映射为指标下标，未知指标返回 UINT32_MAX。
+ */
+inline Result<ExprProgram> compile_expression(std::string_view src,
+                                              const std::function<uint32_t(std::string_view)>& resolve) {
+    return detail::ExprCompiler(src, resolve).compile();
+}
+
+// ═════════════════════════════════════════════════════
+//  批量求值
+// ═════════════════════════════════════════════════════
+
+/**
+ * 按 lane 批量求值的栈机。求值栈在 reserve() 时一次性分配，run() 不申请堆内存。
+ */
+class ExprEvaluator {
+public:
+    void reserve(uint32_t max_depth, size_t lanes) {
+        lanes_ = lanes;
+        stack_.assign(static_cast<size_t>(max_depth) * lanes, 0.0);
+    }
+
+    /**
+     * 对 lanes 个 lane 求值 program，结果写入 out[0, lanes)。
+     *
+     * @param values  本周期指标值，values[metric * lanes + lane]
+     * @param prev    上一周期指标值 (同布局)；program.uses_prev 为 false 时可为 nullptr
+     * @param dt_s    两周期的间隔秒数 (rate 使用)
+     */
+    void run(const ExprProgram& program, const double* values, const double* prev, double dt_s, double* out) {
+        const size_t n = lanes_;
+        double* sp = stack_.data();   // 指向下一个空槽
+        for (const ExprInsn& insn : program.code) {
+            switch (insn.op) {
+                case ExprOp::constant: {
+                    double k = program.constants[insn.arg];
+                    for (size_t i = 0; i < n; ++i) sp[i] = k;
+                    sp += n;
+                    break;
+                }
+                case ExprOp::load:
+                    std::memcpy(sp, values + insn.arg * n, n * sizeof(double));
+                    sp += n;
+                    break;
+                case ExprOp::delta:
+                case ExprOp::rate: {
+                    const double* cur = values + insn.arg * n;
+                    const double* old = prev + insn.arg * n;
+                    double scale = insn.op == ExprOp::rate ? 1.0 / dt_s : 1.0;
+                    for (size_t i = 0; i < n; ++i) sp[i] = (cur[i] - old[i]) * scale;
+                    sp += n;
+                    break;
+                }
+                case ExprOp::neg:
+                case ExprOp::not_:
+                case ExprOp::abs:
+                case ExprOp::sqrt:
+                    detail::apply_op(insn.op, sp - n, nullptr, n);
+                    break;
+                default:
+                    sp -= n;
+                    detail::apply_op(insn.op, sp - n, sp, n);
+                    break;
+            }
+        }
+        std::memcpy(out, sp - n, n * sizeof(double));
+    }
+
+    size_t lanes() const { return lanes_; }
+
+private:
+    std::vector<double> stack_;
+    size_t              lanes_ = 0;
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_EXPR_HPP
@@ -0,0 +1,1057 @@
+/*
+ * EdgeStelle — C++ Device SDK: 舰队模拟
+ *
+ * 单进程模拟 N 台设备：模板拉取一次，CorrelatedSimulator 以 lanes = N 一次推进
+ * 全体设备，故障场景 (edgestelle_scenario.hpp) 叠加在采样结果上，模板的派生指标与
+ * 规则 (edgestelle_expr.hpp) 同样以 lanes = N 对全体设备批量求值，再按设备
+ * 序列化并发布到各自的 topic (mqtt_topic_prefix/<device_id>)。
+ *
+ * 单个事件循环会先于 broker 把一个核跑满。FleetConfig::partitions > 1 时设备按序号
+ * 切成连续的几段 (核分区)，每个分区一个线程、各自的事件循环，拥有自己的模拟器、
+ * 规则求值状态、场景状态、序列化缓冲与 broker 连接，分区之间不共享可写状态、不加锁:
+ *   - 分区线程先绑定到一个 CPU (FleetConfig::cpus，为空时依次取进程允许的 CPU)，
+ *     再在本线程上分配全部状态，按 Linux 默认的首次访问策略落在该 CPU 所在的 NUMA
+ *     节点；编译后的模板只读共享；
+ *   - 模拟器与场景按设备的全局序号取随机数，任意分区数下每台设备的数值与单分区相同；
+ *   - 各分区每个 tick 的汇总 (及捕获模式下的报告行) 写入自己的单生产者环，调用 run()
+ *     的线程按 tick 归并后写时间线与捕获文件，不在分区的热路径上。某个分区领先最慢的
+ *     分区超过 kRingTicks 个 tick 时等待。
+ *
+ * 配置多个 broker (DeviceConfig::mqtt_brokers) 时每个 broker 一个分片：设备按 id 一致性
+ * 哈希 (edgestelle_brokers.hpp) 落到分片，各分片有独立的连接与在途窗口。分片断开时
+ * 只有它的设备改投环上的下一个在线分片，重连成功后迁回；在途窗口顶满的分片丢弃
+ * 本 tick 落在它上面的常规报告 (计入 shed)，不拖慢其余分片，越界报告则等待名额。
+ * 多个核分区时每个分区各自连接全部 broker。
+ * 与单设备相同，越界报告按 alert_lane.qos (默认 1)、常规报告按 routine_lane.qos (默认 0) 发布。
+ *
+ * 发布异步进行，每个连接的在途消息数由 FleetConfig::max_in_flight 限制；只有一个
+ * broker 时在途数顶满后 tick 本身会变慢。每个 tick 可写一行 CSV 时间线 (各分区之和，
+ * tick_ms 取最慢的分区):
+ *
+ *   t_s,active_faults,sampled,published,dropped,anomalous,in_flight,acked,failed,tick_ms
+ *
+ * 配合后端入库统计 (backend/app/mqtt_listener.py) 观察异常风暴下的排队情况。
+ * set_shard_timeline() 另写每个连接每 tick 一行 (计数均为累计；多个核分区时 shard 为
+ * 分区号 × broker 数 + broker 序号):
+ *
+ *   t_s,shard,uri,up,devices,published,acked,failed,shed,in_flight
+ *
+ * 舰队只模拟标量；波形指标上报其幅度系数，不做 FFT 特征提取，向量与直方图指标只上报 value。
+ *
+ * 回归基准: set_clock(VirtualClock) 快进 (tick 之间不休眠，场景时刻与报告时间戳
+ * 都取虚拟时间；各分区从同一时刻起各自推进一份副本)，set_capture() 把报告按
+ * "<topic> <payload>" 逐行写入文件而不发布。种子与起始时刻相同时，捕获文件多次运行
+ * 逐字节一致，且与分区数无关。
+ *
+ * 分布式压测 (edgestelle_cluster.hpp) 中每个 worker 以 FleetConfig::first_device 运行
+ * 舰队的一段；run() 结束后 summary() 与 tick_histogram() 给出本进程的累计与 tick 耗时分布。
+ */
+
+#ifndef EDGESTELLE_FLEET_HPP
+#define EDGESTELLE_FLEET_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "edgestelle_brokers.hpp"
+#include "edgestelle_device.hpp"
+#include "edgestelle_latency.hpp"
+#include "edgestelle_registry.hpp"
+#include "edgestelle_scenario.hpp"
+
+namespace edgestelle {
+
+struct FleetConfig {
+    size_t      devices       = 100;
+    size_t      first_device  = 0;        // 本进程第一台设备的全局序号 (分布式压测中各 worker 各负责一段)
+    std::string id_prefix     = "sim-";   // 设备 id = id_prefix + 全局序号
+    int         tick_ms       = 1000;     // 每台设备的采样周期
+    // 每个 tick 发布的报告数 (各分区按设备数分摊，小数部分累积到后续 tick)，设备轮流发布；
+    // 0 表示每台设备每 tick 一份。分布式压测以此实现协调端下发的速率
+    double      reports_per_tick = 0.0;
+    int         max_in_flight = 256;      // 每个 broker 连接未确认的发布上限
+    uint64_t    seed          = 42;
+
+    // 核分区数 (每个分区一个线程)，0 表示每个可用 CPU 一个；不超过设备数
+    size_t           partitions = 1;
+    std::vector<int> cpus;                // 分区 k 绑定到 cpus[k % cpus.size()]
+    bool             pin        = true;   // 多分区或给出 cpus 时绑定 CPU
+};
+
+namespace detail {
+
+/**
+ * 在途发布计数。done() 在 Paho 回调线程上执行。
+ */
+class PublishWindow : public MqttCompletion {
+public:
+    explicit PublishWindow(int limit) : limit_(std::max(1, limit)) {}
+
+    /**
+     * 占用一个在途名额，已满时阻塞等待确认。
+     */
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [&] { return in_flight_ < limit_; });
+        ++in_flight_;
+    }
+
+    /**
+     * 占用一个在途名额，已满时立即返回 false。
+     */
+    bool try_acquire() {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (in_flight_ >= limit_) return false;
+        ++in_flight_;
+        return true;
+    }
+
+    /**
+     * 发布未能发出时归还名额 (不计入 acked / failed)。
+     */
+    void cancel() { finish(); }
+
+    void done(Result<void> result) override {
+        ++(result ? acked_ : failed_);
+        finish();
+    }
+
+    /**
+     * 等待全部在途发布完成，超时返回 false。
+     */
+    bool drain(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mu_);
+        return cv_.wait_for(lock, timeout, [&] { return in_flight_ == 0; });
+    }
+
+    int in_flight() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        return in_flight_;
+    }
+    uint64_t acked()  const { return acked_; }
+    uint64_t failed() const { return failed_; }
+
+private:
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            --in_flight_;
+        }
+        cv_.notify_all();
+    }
+
+    const int               limit_;
+    mutable std::mutex      mu_;
+    std::condition_variable cv_;
+    int                     in_flight_ = 0;
+    std::atomic<uint64_t>   acked_{0};
+    std::atomic<uint64_t>   failed_{0};
+};
+
+/**
+ * 一个 broker 分片：独立的连接、在途窗口与健康状态，计数均为累计。
+ */
+struct FleetShard {
+    FleetShard(const DeviceConfig& cfg, std::string uri, std::string client_id, int max_in_flight)
+        : mqtt(std::make_unique<MqttChannel>(cfg, std::move(uri), std::move(client_id))),
+          window(std::make_unique<PublishWindow>(max_in_flight)),
+          probe(std::make_unique<ConnectProbe>()) {}
+
+    std::unique_ptr<MqttChannel>   mqtt;
+    std::unique_ptr<PublishWindow> window;
+    std::unique_ptr<ConnectProbe>  probe;
+    BrokerHealth                   health;
+    bool                           connecting = false;   // connect_async 已发起，尚未收尾
+    size_t                         devices    = 0;       // 当前路由到本分片的设备数
+    uint64_t                       published     = 0;
+    uint64_t                       shed          = 0;    // 窗口顶满丢弃
+    uint64_t                       send_failures = 0;
+};
+
+} // namespace detail
+
+/**
+ * 每个 tick 的汇总，对应时间线中的一行。
+ */
+struct FleetTick {
+    double   t_s           = 0.0;
+    int      active_faults = 0;
+    uint64_t sampled       = 0;
+    uint64_t published     = 0;
+    uint64_t dropped       = 0;   // 场景 packet_loss 丢弃
+    uint64_t shed          = 0;   // 分片在途窗口顶满丢弃 (多 broker 时)
+    uint64_t anomalous     = 0;
+    int      in_flight     = 0;
+    uint64_t acked         = 0;   // 累计
+    uint64_t failed        = 0;   // 累计，含发出失败与无在线分片而未发出的报告
+    double   tick_ms       = 0.0;
+
+    /**
+     * 并入另一个分区同一 tick 的汇总。
+     */
+    void merge(const FleetTick& o) {
+        active_faults  = std::max(active_faults, o.active_faults);
+        sampled       += o.sampled;
+        published     += o.published;
+        dropped       += o.dropped;
+        shed          += o.shed;
+        anomalous     += o.anomalous;
+        in_flight     += o.in_flight;
+        acked         += o.acked;
+        failed        += o.failed;
+        tick_ms        = std::max(tick_ms, o.tick_ms);
+    }
+};
+
+namespace detail {
+
+/**
+ * 一个 broker 连接在某个 tick 的状态，对应分片时间线中的一行。
+ */
+struct ShardRow {
+    std::string_view uri;
+    bool             up        = false;
+    size_t           devices   = 0;
+    uint64_t         published = 0;
+    uint64_t         acked     = 0;
+    uint64_t         failed    = 0;
+    uint64_t         shed      = 0;
+    int              in_flight = 0;
+};
+
+/**
+ * 分区交给归并线程的一个 tick。
+ */
+struct TickRecord {
+    FleetTick             tick;
+    std::string           capture;   // 捕获模式下本 tick 的 "<topic> <payload>\n" 行
+    std::vector<ShardRow> shards;
+};
+
+/**
+ * 单生产者 (分区线程) / 单消费者 (归并线程) 的定长环，槽位及其缓冲跨 tick 复用。
+ */
+class TickRing {
+public:
+    explicit TickRing(size_t capacity) : slots_(capacity) {}
+
+    /**
+     * 下一个可写的槽位，环满时返回 nullptr。
+     */
+    TickRecord* slot() {
+        uint64_t h = head_.load(std::memory_order_relaxed);
+        if (h - tail_.load(std::memory_order_acquire) == slots_.size()) return nullptr;
+        return &slots_[h % slots_.size()];
+    }
+
+    void push() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /**
+     * 最早的未读槽位，环空时返回 nullptr。
+     */
+    TickRecord* front() {
+        uint64_t t = tail_.load(std::memory_order_relaxed);
+        if (t == head_.load(std::memory_order_acquire)) return nullptr;
+        return &slots_[t % slots_.size()];
+    }
+
+    void pop() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+    std::vector<TickRecord> slots_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+};
+
+/**
+ * 核分区：全局序号 [first, first + count) 的一段设备及其全部可写状态 (模拟器、场景、
+ * 规则求值、序列化缓冲、broker 连接)。只由一个线程使用。
+ */
+class FleetPartition {
+public:
+    /**
+     * @param index       分区号
+     * @param partitions  分区总数 (多于一个时 MQTT client id 追加 "-p<分区号>")
+     */
+    FleetPartition(const DeviceConfig& cfg, const FleetConfig& fleet, size_t index, size_t partitions,
+                   size_t first, size_t count)
+        : config_(cfg), fleet_(fleet), index_(index), first_(first), count_(count),
+          ring_(cfg.broker_uris()), ticks_(kRingTicks) {
+        auto uris = cfg.broker_uris();
+        std::string client_id = "device-" + cfg.device_id;
+        if (partitions > 1) client_id += "-p" + std::to_string(index);
+        shards_.reserve(uris.size());
+        for (size_t k = 0; k < uris.size(); ++k) {
+            shards_.emplace_back(cfg, uris[k], uris.size() == 1 ? client_id : client_id + "-s" + std::to_string(k),
+                                 fleet.max_in_flight);
+        }
+        up_.assign(shards_.size(), false);
+    }
+
+    ~FleetPartition() {
+        for (auto& s : shards_) s.mqtt->disconnect();
+    }
+
+    FleetPartition(const FleetPartition&)            = delete;
+    FleetPartition& operator=(const FleetPartition&) = delete;
+
+    /**
+     * 按本分区的设备数分配全部状态 (在分区线程上调用，内存落在本地 NUMA 节点)。
+     */
+    Result<void> prepare(const TemplatePtr& tmpl, const std::optional<Scenario>& scenario) {
+        tmpl_ = tmpl;
+        auto sim = CorrelatedSimulator::create(TestSimulator::dynamics_for(*tmpl_),
+                                               TestSimulator::correlation_for(*tmpl_),
+                                               count_, fleet_.seed, first_);
+        if (!sim) return sim.error();
+        sim_.emplace(std::move(sim).value());
+
+        if (scenario) engine_.emplace(*scenario, *tmpl_, count_, first_);
+
+        ids_.clear();
+        topics_.clear();
+        ids_.reserve(count_);
+        topics_.reserve(count_);
+        for (size_t d = 0; d < count_; ++d) {
+            ids_.push_back(fleet_.id_prefix + std::to_string(first_ + d));
+            topics_.push_back(config_.mqtt_topic_prefix + "/" + ids_.back());
+        }
+        reroute(false);
+        report_.tmpl = tmpl_;
+        report_.results.reserve(tmpl_->metrics.size());
+        report_.anomalies.reserve(detail::report_bounds(*tmpl_).anomalies);
+        rules_.bind(tmpl_, count_);
+        delivered_.assign(count_, 0);
+        payload_.reserve(ReportSerializer::max_size(*tmpl_, ids_.back(), 0));
+        return {};
+    }
+
+    /**
+     * 本分区全体设备推进一个采样周期并发布；capture 非空时报告行追加到 capture 而不发布。
+     * FleetConfig::reports_per_tick 非 0 时只有本 tick 轮到的设备计入采样并发布，
+     * 其余设备照常推进模拟器、场景与规则。
+     * 没有任何分片在线时照常采样、推进模拟器与场景 (回放不因断网而错位)，
+     * 本应发布的报告计为未发布 (FleetTick::failed)。
+     *
+     * @param t_s  自模拟开始的秒数，决定哪些故障生效
+     */
+    FleetTick tick(double t_s, const Clock& clock, std::string* capture) {
+        auto start = std::chrono::steady_clock::now();
+        FleetTick out;
+        out.t_s = t_s;
+        out.active_faults = engine_ ? engine_->active_faults(t_s) : 0;
+
+        bool offline = !capture && !refresh_shards();
+        if (offline && !offline_) {
+            EDGESTELLE_LOG_ERR("⚠️  分区 %zu 的 broker 全部断开，报告计为未发布直至重连", index_);
+        }
+        offline_ = offline;
+
+        // 本 tick 轮到的设备：自 cursor_ 起 due 台 (环绕)
+        size_t due = count_;
+        if (fleet_.reports_per_tick > 0.0) {
+            quota_ += fleet_.reports_per_tick * static_cast<double>(count_) / static_cast<double>(fleet_.devices);
+            due = std::min(count_, static_cast<size_t>(quota_));
+            quota_ -= static_cast<double>(due);
+        }
+        size_t from = cursor_;
+        cursor_ = (cursor_ + due) % count_;
+
+        sim_->step();
+        const auto& metrics = tmpl_->metrics;
+        auto now = clock.now();
+        detail::stamp(report_, now);
+        // 第一遍：采样并叠加故障，结果按设备写入求值矩阵
+        for (size_t d = 0; d < count_; ++d) {
+            report_.results.clear();
+            for (uint32_t i = 0; i < metrics.size(); ++i) {
+                report_.results.push_back(
+                    MetricResult{i, std::round(sim_->value(i, d) * 100.0) / 100.0});
+            }
+            delivered_[d] = !engine_ || engine_->apply(t_s, tick_, first_ + d, report_.results);
+            rules_.load(d, report_.results);
+        }
+        out.sampled = due;
+        rules_.evaluate(now);
+
+        // 第二遍：读回轮到设备的结果 (含派生指标)，判定异常并发布
+        for (size_t j = 0; j < due; ++j) {
+            size_t d = (from + j) % count_;
+            if (!delivered_[d]) {
+                ++out.dropped;
+                continue;
+            }
+            report_.results.clear();
+            for (uint32_t i = 0; i < metrics.size(); ++i) {
+                report_.results.push_back(MetricResult{i, rules_.value(i, d)});
+            }
+            detail::detect_anomalies(report_);
+            rules_.append_anomalies(d, report_);
+            if (report_.has_anomaly()) ++out.anomalous;
+            if (offline) {
+                ++unrouted_;
+                continue;
+            }
+
+            ReportSerializer::write(report_, ids_[d], payload_);
+            if (capture) {
+                capture->append(topics_[d]);
+                capture->push_back(' ');
+                capture->append(payload_);
+                capture->push_back('\n');
+                ++out.published;
+                continue;
+            }
+            if (publish_routed(d, out)) continue;
+            if (!any_up()) {   // 全部分片断开，本 tick 余下的报告计为失败，下个 tick 重连
+                uint64_t rest = 0;
+                for (size_t k = j + 1; k < due; ++k) {
+                    if (delivered_[(from + k) % count_]) {
+                        ++rest;
+                    } else {
+                        ++out.dropped;
+                    }
+                }
+                unrouted_ += rest;
+                EDGESTELLE_LOG_ERR("⚠️  分区 %zu 的 broker 全部断开，本 tick 余下 %llu 份报告未发布", index_,
+                                   static_cast<unsigned long long>(rest + 1));
+                break;
+            }
+        }
+        ++tick_;
+
+        totals(out);
+        out.tick_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start).count();
+        return out;
+    }
+
+    /**
+     * 检查各分片连接：断开的标记为下线，退避到期的发起连接，已完成的连接收尾。
+     * 在线集合变化时重算路由。只在没有任何分片在线时阻塞等待进行中的连接。
+     *
+     * @return 至少一个分片在线
+     */
+    bool refresh_shards(bool block = true) {
+        auto now = detail::BrokerHealth::clock::now();
+        bool changed = false;
+        for (size_t k = 0; k < shards_.size(); ++k) {
+            auto& s = shards_[k];
+            if (s.connecting) {
+                if (s.probe->finished()) changed |= finish_connect(k, now);
+                continue;
+            }
+            if (up_[k] && s.mqtt->connected()) continue;
+            if (up_[k]) {
+                EDGESTELLE_LOG_ERR("⚠️  broker %s 连接断开", s.mqtt->uri().c_str());
+                set_down(k, now);
+                changed = true;
+            }
+            if (!s.health.available(now)) continue;
+            EDGESTELLE_LOG("📡 连接 MQTT: %s", s.mqtt->uri().c_str());
+            s.probe->reset();
+            auto started = s.mqtt->connect_async(s.probe.get());
+            if (!started) {
+                log_error("连接 MQTT", started.error());
+                s.health.mark_down(now);
+                continue;
+            }
+            s.connecting = true;
+        }
+        if (block && !any_up()) {
+            for (size_t k = 0; k < shards_.size(); ++k) {
+                if (shards_[k].connecting) changed |= finish_connect(k, detail::BrokerHealth::clock::now());
+            }
+        }
+        if (changed) reroute(true);
+        return any_up();
+    }
+
+    /**
+     * 等待全部在途发布完成 (每个连接至多 10 秒) 并断开。
+     */
+    void finish() {
+        for (size_t k = 0; k < shards_.size(); ++k) {
+            auto& s = shards_[k];
+            if (!s.window->drain(std::chrono::seconds(10))) {
+                EDGESTELLE_LOG_ERR("⚠️  %s 仍有 %d 条发布未确认", s.mqtt->uri().c_str(), s.window->in_flight());
+            }
+            s.mqtt->disconnect();
+            up_[k] = false;
+        }
+    }
+
+    /**
+     * 各连接的当前状态写入 out (复用其容量)。
+     */
+    void shard_rows(std::vector<ShardRow>& out) const {
+        out.resize(shards_.size());
+        for (size_t k = 0; k < shards_.size(); ++k) {
+            const auto& s = shards_[k];
+            out[k] = ShardRow{s.mqtt->uri(), up_[k], s.devices, s.published, s.window->acked(),
+                              s.window->failed() + s.send_failures, s.shed, s.window->in_flight()};
+        }
+    }
+
+    /**
+     * 当前的 in_flight 与累计 acked / failed 写入 out。failed 按报告计：在途窗口中失败的、
+     * 重试后仍未发出的，以及因无在线分片而未能发出的。
+     */
+    void totals(FleetTick& out) const {
+        out.in_flight = 0;
+        out.acked     = 0;
+        out.failed    = 0;
+        for (const auto& s : shards_) {
+            out.in_flight += s.window->in_flight();
+            out.acked     += s.window->acked();
+            out.failed    += s.window->failed();
+        }
+        out.failed += send_failed_ + unrouted_;
+    }
+
+    size_t    index()  const { return index_; }
+    size_t    first()  const { return first_; }
+    size_t    count()  const { return count_; }
+    TickRing& ticks()        { return ticks_; }
+
+    /**
+     * 分区线程已退出其循环 (之前的 tick 都已写入环)。
+     */
+    std::atomic<bool>& done() { return done_; }
+
+    // 归并线程领先分区线程时，分区最多积压的 tick 数
+    static constexpr size_t kRingTicks = 64;
+
+private:
+    /**
+     * 收尾一个已发起的连接 (连接未完成时阻塞)，返回分片是否转为在线。
+     */
+    bool finish_connect(size_t k, detail::BrokerHealth::clock::time_point now) {
+        auto& s = shards_[k];
+        s.connecting = false;
+        auto conn = s.mqtt->wait_connected();
+        if (!conn) {
+            log_error("连接 MQTT", conn.error());
+            s.health.mark_down(now);
+            return false;
+        }
+        s.health.mark_up();
+        up_[k] = true;
+        return true;
+    }
+
+    void set_down(size_t k, detail::BrokerHealth::clock::time_point now) {
+        shards_[k].health.mark_down(now);
+        up_[k] = false;
+    }
+
+    bool any_up() const { return std::find(up_.begin(), up_.end(), true) != up_.end(); }
+
+    /**
+     * 按当前在线分片重算每台设备的落点；只有落在下线分片上的设备会移动。
+     */
+    void reroute(bool log) {
+        route_.resize(ids_.size());
+        for (auto& s : shards_) s.devices = 0;
+        for (size_t d = 0; d < ids_.size(); ++d) {
+            route_[d] = static_cast<uint32_t>(shards_.size() == 1 ? 0 : ring_.owner(ids_[d], up_));
+            ++shards_[route_[d]].devices;
+        }
+        if (log && shards_.size() > 1) {
+            for (size_t k = 0; k < shards_.size(); ++k) {
+                EDGESTELLE_LOG("🧩 %s %s: %zu 台设备", shards_[k].mqtt->uri().c_str(), up_[k] ? "在线" : "离线",
+                               shards_[k].devices);
+            }
+        }
+    }
+
+    /**
+     * 经设备所在分片发布 payload_ (report_ 为其报告)。分片发出失败时标记下线、重算路由并在
+     * 新分片上重试一次；多分片时常规报告遇窗口顶满直接丢弃，单分片或越界报告阻塞等待名额。
+     *
+     * @return 已发出或已计入 shed
+     */
+    bool publish_routed(size_t d, FleetTick& out) {
+        bool alert = report_.has_anomaly();
+        int  qos   = config_.report_qos(alert);
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            size_t k = route_[d];
+            auto& s = shards_[k];
+            if (!up_[k]) {
+                ++(attempt == 0 ? unrouted_ : send_failed_);   // 重试时本报告已发出失败过一次
+                return false;
+            }
+            if (shards_.size() == 1 || alert) {
+                s.window->acquire();
+            } else if (!s.window->try_acquire()) {
+                ++s.shed;
+                ++out.shed;
+                return true;
+            }
+            auto sent = s.mqtt->publish_async(topics_[d], payload_, qos, *s.window);
+            if (sent) {
+                ++s.published;
+                ++out.published;
+                return true;
+            }
+            s.window->cancel();
+            ++s.send_failures;
+            log_error("发布", sent.error());
+            set_down(k, detail::BrokerHealth::clock::now());   // 连接已丢弃，退避后重连
+            reroute(true);
+        }
+        ++send_failed_;
+        return false;
+    }
+
+    static void log_error(const char* what, const Error& err) {
+        EDGESTELLE_LOG_ERR("⚠️  %s失败: %s", what, err.to_string().c_str());
+    }
+
+    const DeviceConfig&                config_;
+    const FleetConfig&                 fleet_;
+    size_t                             index_;
+    size_t                             first_;
+    size_t                             count_;
+    detail::HashRing                   ring_;
+    std::vector<detail::FleetShard>    shards_;
+    std::vector<bool>                  up_;       // 分片在线状态，供 HashRing::owner 使用
+    std::vector<uint32_t>              route_;    // 设备 → 分片
+
+    TemplatePtr                        tmpl_;
+    std::optional<CorrelatedSimulator> sim_;         // lanes = 本分区设备数，扰动按全局序号
+    std::optional<ScenarioEngine>      engine_;
+    detail::RuleEngine                 rules_;       // lanes = 本分区设备数
+    std::vector<uint8_t>               delivered_;   // 本 tick 各设备的报告未被 packet_loss 丢弃
+    std::vector<std::string>           ids_;
+    std::vector<std::string>           topics_;
+    Report                             report_;
+    std::string                        payload_;
+    uint64_t                           tick_        = 0;
+    double                             quota_       = 0.0;     // reports_per_tick 的分摊累积
+    size_t                             cursor_      = 0;       // 下一个轮到发布的设备
+    uint64_t                           unrouted_    = 0;
+    uint64_t                           send_failed_ = 0;       // 重试后仍未发出的报告数 (分片的 send_failures 按发送次数计)
+    bool                               offline_     = false;   // 上个 tick 没有任何分片在线
+
+    TickRing                           ticks_;
+    std::atomic<bool>                  done_{false};
+};
+
+} // namespace detail
+
+class FleetSimulator {
+public:
+    /**
+     * @param cfg       broker / API 地址等沿用单设备配置，device_id 用作 MQTT client id
+     *                  (多个核分区时追加 "-p<分区号>"，多个 broker 时再追加 "-s<分片号>")
+     * @param fleet     舰队规模、节奏与核分区
+     * @param scenario  故障场景，为空表示只有正常波动
+     */
+    FleetSimulator(const DeviceConfig& cfg, FleetConfig fleet, std::optional<Scenario> scenario = {})
+        : config_(cfg), fleet_(std::move(fleet)), scenario_(std::move(scenario)), http_(cfg.tls) {}
+
+    FleetSimulator(const FleetSimulator&)            = delete;
+    FleetSimulator& operator=(const FleetSimulator&) = delete;
+
+    /**
+     * 替换场景时刻、报告时间戳与 tick 间休眠所用的时钟。clock 须比本对象存活更久。
+     * VirtualClock 在 run() 中由各分区从同一时刻起各自推进一份副本，clock 本身不前进。
+     */
+    void set_clock(Clock& clock) { clock_ = &clock; }
+
+    /**
+     * 报告写入 capture (每行 "<topic> <payload>") 而不经 MQTT 发布；nullptr 恢复发布。
+     */
+    void set_capture(std::FILE* capture) { capture_ = capture; }
+
+    /**
+     * 每个 tick 为每个连接写一行 CSV (表头见文件头注释)；nullptr 关闭。
+     */
+    void set_shard_timeline(std::FILE* timeline) { shard_timeline_ = timeline; }
+
+    /**
+     * 模板经 registry 取得 (见 edgestelle_registry.hpp)，已注册时不再请求云端。
+     * registry 须比本对象存活更久。
+     */
+    void set_template_registry(TemplateRegistry& registry) { registry_ = &registry; }
+
+    /**
+     * run() 在全部分区就绪之后、开始计时之前调用 gate (在调用 run() 的线程上)，gate 返回后
+     * 才开始第一个 tick；返回错误时 run() 放弃运行并返回该错误。分布式压测用它让各 worker
+     * 同时开始 (见 edgestelle_cluster.hpp)。
+     */
+    void set_start_gate(std::function<Result<void>()> gate) { start_gate_ = std::move(gate); }
+
+    /**
+     * 实际的核分区数 (FleetConfig::partitions 为 0 时取可用 CPU 数，且不超过设备数)。
+     */
+    size_t partitions() const {
+        size_t n = fleet_.partitions == 0 ? detail::allowed_cpus().size() : fleet_.partitions;
+        return std::max<size_t>(1, std::min(n, fleet_.devices));
+    }
+
+    /**
+     * 拉取模板并在调用线程上按舰队规模分配全部状态，供逐个调用 tick()。
+     * run() 自行完成这一步 (各分区在自己的线程上分配)。
+     */
+    Result<void> prepare(const std::string& template_id) {
+        auto loaded = load_template(template_id);
+        if (!loaded) return loaded;
+        reset_summary();
+        parts_.clear();
+        size_t n = partitions();
+        for (size_t k = 0; k < n; ++k) {
+            parts_.push_back(make_partition(k, n));
+            if (auto ready = parts_.back()->prepare(tmpl_, scenario_); !ready) return ready;
+        }
+        log_ready(n);
+        return {};
+    }
+
+    /**
+     * 全体设备推进一个采样周期并发布 (各分区依次在调用线程上执行)。
+     *
+     * @param t_s  自模拟开始的秒数，决定哪些故障生效
+     */
+    FleetTick tick(double t_s) {
+        FleetTick out;
+        out.t_s = t_s;
+        for (auto& p : parts_) {
+            capture_buf_.clear();
+            FleetTick part = p->tick(t_s, *clock_, capture_ ? &capture_buf_ : nullptr);
+            tick_hist_.observe(part.tick_ms);
+            out.merge(part);
+            if (capture_) std::fwrite(capture_buf_.data(), 1, capture_buf_.size(), capture_);
+        }
+        account(out);
+        return out;
+    }
+
+    /**
+     * 连续运行 ticks 个周期 (<0 表示直到 stop())，每个周期一行写入 timeline (可为 nullptr)。
+     * 各分区在自己的线程上运行，调用线程归并各分区的 tick 并写时间线与捕获文件。
+     * tick 超出采样周期时不补偿，下一 tick 立即开始。
+     */
+    Result<void> run(const std::string& template_id, int ticks, std::FILE* timeline = nullptr) {
+        stop_ = false;
+        auto loaded = load_template(template_id);
+        if (!loaded) return loaded;
+        reset_summary();
+
+        size_t n = partitions();
+        bool   pin  = fleet_.pin && (n > 1 || !fleet_.cpus.empty());
+        auto   cpus = fleet_.cpus.empty() ? detail::allowed_cpus() : fleet_.cpus;
+        parts_.clear();
+        parts_.resize(n);
+
+        // 启动：各分区绑核、分配并报告就绪，全部就绪后同时开始
+        std::promise<void> go;
+        std::shared_future<void> started = go.get_future().share();
+        std::vector<std::future<Result<void>>> ready;
+        std::vector<std::thread> threads;
+        for (size_t k = 0; k < n; ++k) {
+            std::promise<Result<void>> prepared;
+            ready.push_back(prepared.get_future());
+            int cpu = pin ? cpus[k % cpus.size()] : -1;
+            threads.emplace_back([this, k, n, cpu, ticks, started, p = std::move(prepared)]() mutable {
+                run_partition(k, n, cpu, ticks, std::move(p), started);
+            });
+        }
+        Result<void> status;
+        for (auto& r : ready) {
+            auto res = r.get();
+            if (!res && status) status = res;
+        }
+        if (status) {
+            log_ready(n);
+            if (start_gate_) status = start_gate_();
+        }
+        if (!status) stop_ = true;
+
+        if (timeline) {
+            std::fputs("t_s,active_faults,sampled,published,dropped,anomalous,"
+                       "in_flight,acked,failed,tick_ms\n", timeline);
+        }
+        if (shard_timeline_) {
+            std::fputs("t_s,shard,uri,up,devices,published,acked,failed,shed,in_flight\n", shard_timeline_);
+        }
+        t0_ = clock_->now();
+        go.set_value();
+        if (status) collect(timeline);
+        for (auto& t : threads) t.join();
+        if (!status) return status;
+
+        // 分区已等待在途发布完成，确认数以此时为准
+        if (!capture_) {
+            summary_.in_flight = 0;
+            summary_.acked     = 0;
+            summary_.failed    = 0;
+            for (auto& p : parts_) {
+                FleetTick t;
+                p->totals(t);
+                summary_.in_flight += t.in_flight;
+                summary_.acked     += t.acked;
+                summary_.failed    += t.failed;
+            }
+        }
+
+        if (config_.broker_uris().size() > 1 && !capture_) log_shard_totals();
+        return {};
+    }
+
+    /**
+     * 请求 run() 在当前周期结束后退出 (可在信号处理或其他线程中调用)。
+     */
+    void stop() { stop_ = true; }
+
+    /**
+     * 上次 run() (或 prepare() 以来各次 tick()) 的累计：计数为各 tick 之和，acked / failed /
+     * in_flight 为结束时的值，active_faults 与 tick_ms 取最大值。
+     */
+    const FleetTick& summary() const { return summary_; }
+
+    /**
+     * 同一区间内各分区每个 tick 的耗时分布。
+     */
+    const LatencyHistogram& tick_histogram() const { return tick_hist_; }
+
+private:
+    Result<void> load_template(const std::string& template_id) {
+        if (fleet_.devices == 0) return Error{Errc::sim_config, "舰队规模必须大于 0"};
+        auto fetch = [this](const std::string& id) {
+            std::string url = config_.api_base_url + "/api/v1/templates/" + id;
+            EDGESTELLE_LOG("📥 拉取模板: %s", url.c_str());
+            return http_.get(url);
+        };
+        auto compiled = registry_ ? registry_->acquire(template_id, fetch) : [&]() -> Result<TemplatePtr> {
+            auto body = fetch(template_id);
+            if (!body) return body.error();
+            return compile_template(body.value());
+        }();
+        if (!compiled) return compiled.error();
+        tmpl_ = std::move(compiled).value();
+        return {};
+    }
+
+    std::unique_ptr<detail::FleetPartition> make_partition(size_t k, size_t n) const {
+        size_t first = fleet_.devices * k / n;
+        size_t last  = fleet_.devices * (k + 1) / n;
+        return std::make_unique<detail::FleetPartition>(config_, fleet_, k, n, fleet_.first_device + first,
+                                                        last - first);
+    }
+
+    void log_ready(size_t n) const {
+        EDGESTELLE_LOG("🚚 舰队就绪: %zu 台设备，%zu 个指标，%zu 个故障，%zu 个核分区",
+                       fleet_.devices, tmpl_->metrics.size(),
+                       scenario_ ? scenario_->faults.size() : size_t{0}, n);
+    }
+
+    /**
+     * 分区线程：绑核后在本线程上分配分区状态，等待统一开始，然后按自己的节奏循环，
+     * 每个 tick 的汇总写入分区的环。
+     */
+    void run_partition(size_t k, size_t n, int cpu, int ticks, std::promise<Result<void>> prepared,
+                       std::shared_future<void> started) {
+        if (cpu >= 0) {
+            if (auto pinned = detail::pin_current_thread(cpu); !pinned) log_error("绑定核分区", pinned.error());
+        }
+        parts_[k] = make_partition(k, n);
+        detail::FleetPartition& part = *parts_[k];
+        auto ready = part.prepare(tmpl_, scenario_);
+        bool ok = static_cast<bool>(ready);
+        prepared.set_value(std::move(ready));
+        started.wait();
+        if (!ok || stop_) {
+            part.done() = true;
+            return;
+        }
+
+        // VirtualClock 不加锁，各分区从同一起点推进自己的副本
+        std::unique_ptr<Clock> own = clock_->fork();
+        Clock* clock = own ? own.get() : clock_;
+
+        if (!capture_) part.refresh_shards(false);
+        auto period = std::chrono::milliseconds(fleet_.tick_ms);
+        auto next = t0_;
+        for (int i = 0; (ticks < 0 || i < ticks) && !stop_; ++i) {
+            detail::TickRecord* rec;
+            while (!(rec = part.ticks().slot()) && !stop_) {   // 归并线程落后
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (!rec) break;
+
+            double t_s = std::chrono::duration<double>(clock->now() - t0_).count();
+            rec->capture.clear();
+            rec->tick = part.tick(t_s, *clock, capture_ ? &rec->capture : nullptr);
+            if (shard_timeline_ && !capture_) part.shard_rows(rec->shards);
+            part.ticks().push();
+
+            next += period;
+            auto now = clock->now();
+            if (next < now) next = now;
+            clock->sleep_for(std::chrono::duration_cast<std::chrono::milliseconds>(next - now), stop_);
+        }
+        if (!capture_) part.finish();
+        part.done().store(true, std::memory_order_release);
+    }
+
+    /**
+     * 归并线程 (调用 run() 的线程)：各分区的第 i 个 tick 都到齐 (或该分区已结束) 后
+     * 汇总写出，直到所有分区结束且环已读空。
+     */
+    void collect(std::FILE* timeline) {
+        std::vector<detail::TickRecord*> rows(parts_.size());
+        for (;;) {
+            bool   waiting = false;
+            size_t live    = 0;
+            for (size_t k = 0; k < parts_.size() && !waiting; ++k) {
+                // 先读 done：为真时该分区此前写入的 tick 都已可见
+                bool done = parts_[k]->done().load(std::memory_order_acquire);
+                rows[k] = parts_[k]->ticks().front();
+                if (rows[k]) ++live;
+                else if (!done) waiting = true;
+            }
+            if (waiting) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            if (live == 0) return;
+
+            FleetTick r;
+            bool first = true;
+            for (auto* rec : rows) {
+                if (!rec) continue;
+                if (first) r.t_s = rec->tick.t_s;
+                first = false;
+                r.merge(rec->tick);
+                tick_hist_.observe(rec->tick.tick_ms);
+                if (capture_) std::fwrite(rec->capture.data(), 1, rec->capture.size(), capture_);
+            }
+            account(r);
+            if (timeline) {
+                std::fprintf(timeline, "%.3f,%d,%llu,%llu,%llu,%llu,%d,%llu,%llu,%.2f\n",
+                             r.t_s, r.active_faults,
+                             static_cast<unsigned long long>(r.sampled),
+                             static_cast<unsigned long long>(r.published),
+                             static_cast<unsigned long long>(r.dropped),
+                             static_cast<unsigned long long>(r.anomalous), r.in_flight,
+                             static_cast<unsigned long long>(r.acked),
+                             static_cast<unsigned long long>(r.failed), r.tick_ms);
+                std::fflush(timeline);
+            }
+            if (shard_timeline_ && !capture_) write_shard_timeline(r.t_s, rows);
+            EDGESTELLE_LOG("🚚 t=%.0fs 故障 %d 已发布 %llu 异常 %llu 丢弃 %llu 在途 %d (%.1f ms)",
+                           r.t_s, r.active_faults, static_cast<unsigned long long>(r.published),
+                           static_cast<unsigned long long>(r.anomalous),
+                           static_cast<unsigned long long>(r.dropped), r.in_flight, r.tick_ms);
+            for (size_t k = 0; k < rows.size(); ++k) {
+                if (rows[k]) parts_[k]->ticks().pop();
+            }
+        }
+    }
+
+    void write_shard_timeline(double t_s, const std::vector<detail::TickRecord*>& rows) {
+        for (size_t p = 0; p < rows.size(); ++p) {
+            if (!rows[p]) continue;
+            const auto& shards = rows[p]->shards;
+            for (size_t k = 0; k < shards.size(); ++k) {
+                const auto& s = shards[k];
+                std::fprintf(shard_timeline_, "%.3f,%zu,%.*s,%d,%zu,%llu,%llu,%llu,%llu,%d\n", t_s,
+                             p * shards.size() + k, static_cast<int>(s.uri.size()), s.uri.data(),
+                             s.up ? 1 : 0, s.devices,
+                             static_cast<unsigned long long>(s.published),
+                             static_cast<unsigned long long>(s.acked),
+                             static_cast<unsigned long long>(s.failed),
+                             static_cast<unsigned long long>(s.shed), s.in_flight);
+            }
+        }
+        std::fflush(shard_timeline_);
+    }
+
+    /**
+     * 各 broker 在全部分区上的累计 (分区线程均已结束)。
+     */
+    void log_shard_totals() {
+        std::vector<detail::ShardRow> rows, total;
+        for (auto& p : parts_) {
+            p->shard_rows(rows);
+            total.resize(rows.size());
+            for (size_t k = 0; k < rows.size(); ++k) {
+                total[k].uri        = rows[k].uri;
+                total[k].published += rows[k].published;
+                total[k].acked     += rows[k].acked;
+                total[k].failed    += rows[k].failed;
+                total[k].shed      += rows[k].shed;
+            }
+        }
+        for (const auto& s : total) {
+            EDGESTELLE_LOG("🧩 %.*s: 已发布 %llu 确认 %llu 失败 %llu 丢弃 %llu",
+                           static_cast<int>(s.uri.size()), s.uri.data(),
+                           static_cast<unsigned long long>(s.published),
+                           static_cast<unsigned long long>(s.acked),
+                           static_cast<unsigned long long>(s.failed),
+                           static_cast<unsigned long long>(s.shed));
+        }
+    }
+
+    void reset_summary() {
+        summary_   = FleetTick{};
+        tick_hist_ = LatencyHistogram{};
+    }
+
+    /**
+     * 并入一个已归并的 tick (计数累加，累计量取最新值)。
+     */
+    void account(const FleetTick& r) {
+        uint64_t acked = r.acked, failed = r.failed;
+        summary_.merge(r);
+        summary_.t_s       = r.t_s;
+        summary_.in_flight = r.in_flight;
+        summary_.acked     = acked;
+        summary_.failed    = failed;
+    }
+
+    static void log_error(const char* what, const Error& err) {
+        EDGESTELLE_LOG_ERR("⚠️  %s失败: %s", what, err.to_string().c_str());
+    }
+
+    DeviceConfig                       config_;
+    FleetConfig                        fleet_;
+    std::optional<Scenario>            scenario_;
+    detail::HttpClient                 http_;
+    TemplateRegistry*                  registry_ = nullptr;
+    Clock*                             clock_   = &SystemClock::instance();
+    Clock::time_point                  t0_;
+    std::FILE*                         capture_ = nullptr;
+    std::FILE*                         shard_timeline_ = nullptr;
+    std::function<Result<void>()>      start_gate_;
+
+    TemplatePtr                        tmpl_;
+    std::vector<std::unique_ptr<detail::FleetPartition>> parts_;
+    std::string                        capture_buf_;   // tick() 的捕获缓冲
+    FleetTick                          summary_;
+    LatencyHistogram                   tick_hist_;
+
+    std::atomic<bool> stop_{false};
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_FLEET_HPP
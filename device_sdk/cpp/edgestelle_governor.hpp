@@ -0,0 +1,224 @@
+/*
+ * EdgeStelle — C++ Device SDK: 自身开销调节器
+ *
+ * 每个采样周期通过 getrusage / procfs 统计 SDK 进程自身的 CPU 时间与 RSS，
+ * 超出预算时按"降低采样频率 → 加大批量 → 丢弃低优先级指标"的顺序逐级降载，
+ * 持续低于预算一半后再逐级恢复。
+ */
+
+#ifndef EDGESTELLE_GOVERNOR_HPP
+#define EDGESTELLE_GOVERNOR_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace edgestelle {
+
+/**
+ * 开销预算。cpu_fraction 以单核为基准，0.02 即单核 2%。
+ */
+struct OverheadBudget {
+    double cpu_fraction     = 0.02;
+    size_t rss_limit_bytes  = 0;       // 0 表示不限制
+    int    max_interval_ms  = 60000;   // 降载时采样周期上限
+    int    max_batch_size   = 32;      // 降载时批量上限
+    int    recover_cycles   = 10;      // 连续低于预算一半多少个周期后恢复一级
+};
+
+/**
+ * 调节器当前生效的参数。
+ */
+struct GovernorState {
+    int  sample_interval_ms = 1000;
+    int  batch_size         = 1;
+    bool drop_low_priority  = false;
+};
+
+/**
+ * 最近一个周期的自身开销测量值。
+ */
+struct OverheadSample {
+    double cpu_fraction = 0.0;   // 平滑后的单核占比
+    double cpu_ms       = 0.0;   // 本周期消耗的 CPU 时间
+    size_t rss_bytes    = 0;
+};
+
+namespace detail {
+
+inline double process_cpu_seconds() {
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)
+         + static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+inline size_t process_rss_bytes() {
+    // /proc/self/statm 第二列为常驻页数；无 procfs 时退回 ru_maxrss (峰值)
+    // 用 open/read 读入栈缓冲，避免 fopen 每周期申请 FILE 结构
+    int fd = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        char buf[128];
+        ssize_t n = ::read(fd, buf, sizeof(buf) - 1);
+        ::close(fd);
+        if (n > 0) {
+            buf[n] = '\0';
+            char* end = nullptr;
+            std::strtoul(buf, &end, 10);
+            unsigned long resident = std::strtoul(end, &end, 10);
+            if (resident > 0) return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        }
+    }
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return static_cast<size_t>(ru.ru_maxrss) * 1024;
+}
+
+} // namespace detail
+
+class OverheadGovernor {
+public:
+    OverheadGovernor(const OverheadBudget& budget, int base_interval_ms, int base_batch_size)
+        : budget_(budget) {
+        base_.sample_interval_ms = std::max(1, base_interval_ms);
+        base_.batch_size         = std::max(1, base_batch_size);
+        state_ = base_;
+        last_wall_ = std::chrono::steady_clock::now();
+        last_cpu_  = detail::process_cpu_seconds();
+    }
+
+    /**
+     * 在每个周期边界调用一次 (包含上一周期的休眠时间)。
+     * 参数发生调整时返回 true (每次至多调整一级)，说明可通过 last_adjustment() 取出。
+     */
+    bool on_cycle() {
+        auto   now  = std::chrono::steady_clock::now();
+        double cpu  = detail::process_cpu_seconds();
+        double wall = std::chrono::duration<double>(now - last_wall_).count();
+        double used = cpu - last_cpu_;
+        last_wall_ = now;
+        last_cpu_  = cpu;
+        if (wall <= 0.0) return false;
+
+        double frac = used / wall;
+        sample_.cpu_fraction = primed_ ? 0.7 * sample_.cpu_fraction + 0.3 * frac : frac;
+        sample_.cpu_ms       = used * 1000.0;
+        sample_.rss_bytes    = detail::process_rss_bytes();
+        primed_ = true;
+
+        bool rss_over = budget_.rss_limit_bytes > 0 && sample_.rss_bytes > budget_.rss_limit_bytes;
+        bool cpu_over = sample_.cpu_fraction > budget_.cpu_fraction;
+
+        if (rss_over) {
+            calm_cycles_ = 0;
+            return shed_memory();
+        }
+        if (cpu_over) {
+            calm_cycles_ = 0;
+            return shed_cpu();
+        }
+        if (sample_.cpu_fraction < budget_.cpu_fraction * 0.5 && ++calm_cycles_ >= budget_.recover_cycles) {
+            calm_cycles_ = 0;
+            return recover();
+        }
+        return false;
+    }
+
+    const GovernorState&  state()  const { return state_; }
+    const OverheadSample& sample() const { return sample_; }
+    const OverheadBudget& budget() const { return budget_; }
+
+    /**
+     * 最近一次调整的说明 (定长缓冲，on_cycle() 不申请堆内存)。
+     */
+    const char* last_adjustment() const { return adjustment_; }
+
+private:
+    bool shed_cpu() {
+        if (state_.sample_interval_ms < budget_.max_interval_ms) {
+            int next = std::min(budget_.max_interval_ms, state_.sample_interval_ms * 2);
+            note("采样周期 %d→%d ms", state_.sample_interval_ms, next);
+            state_.sample_interval_ms = next;
+            return true;
+        }
+        if (state_.batch_size < budget_.max_batch_size) {
+            int next = std::min(budget_.max_batch_size, state_.batch_size * 2);
+            note("批量 %d→%d", state_.batch_size, next);
+            state_.batch_size = next;
+            return true;
+        }
+        if (!state_.drop_low_priority) {
+            note("丢弃低优先级指标");
+            state_.drop_low_priority = true;
+            return true;
+        }
+        return false;
+    }
+
+    bool shed_memory() {
+        // 攒批会占用内存，先丢指标再把批量收回到基线
+        if (!state_.drop_low_priority) {
+            note("RSS 超限，丢弃低优先级指标");
+            state_.drop_low_priority = true;
+            return true;
+        }
+        if (state_.batch_size > base_.batch_size) {
+            note("RSS 超限，批量 %d→%d", state_.batch_size, base_.batch_size);
+            state_.batch_size = base_.batch_size;
+            return true;
+        }
+        return false;
+    }
+
+    bool recover() {
+        // 按降载的逆序恢复
+        if (state_.drop_low_priority) {
+            note("恢复低优先级指标");
+            state_.drop_low_priority = false;
+            return true;
+        }
+        if (state_.batch_size > base_.batch_size) {
+            int next = std::max(base_.batch_size, state_.batch_size / 2);
+            note("批量 %d→%d", state_.batch_size, next);
+            state_.batch_size = next;
+            return true;
+        }
+        if (state_.sample_interval_ms > base_.sample_interval_ms) {
+            int next = std::max(base_.sample_interval_ms, state_.sample_interval_ms / 2);
+            note("采样周期 %d→%d ms", state_.sample_interval_ms, next);
+            state_.sample_interval_ms = next;
+            return true;
+        }
+        return false;
+    }
+
+    __attribute__((format(printf, 2, 3)))
+    void note(const char* fmt, ...) {
+        va_list ap;
+        va_start(ap, fmt);
+        std::vsnprintf(adjustment_, sizeof(adjustment_), fmt, ap);
+        va_end(ap);
+    }
+
+    OverheadBudget budget_;
+    GovernorState  base_;
+    GovernorState  state_;
+    OverheadSample sample_;
+
+    std::chrono::steady_clock::time_point last_wall_;
+    double last_cpu_    = 0.0;
+    bool   primed_      = false;
+    int    calm_cycles_ = 0;
+
+    char adjustment_[96] = {};
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_GOVERNOR_HPP
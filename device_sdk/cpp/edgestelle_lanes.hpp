@@ -0,0 +1,118 @@
+/*
+ * EdgeStelle — C++ Device SDK: 发布分道
+ *
+ * 待发布报告按是否越界分两道：alert 道 (has_anomaly) 与 routine 道。每次发布先清空
+ * alert 道，再按批量发 routine 道，越界报告不必排在积压的常规报告之后，告警延迟与
+ * 积压长度无关。两道的 QoS 与带宽各自配置 (LaneConfig)：默认 alert 道 QoS 1、
+ * routine 道 QoS 0，bytes_per_s 非 0 时以令牌桶整形。
+ *
+ * 令牌桶按已发出的字节扣减，允许最后一份报告透支 (报告长度在序列化后才知道)，
+ * 余额不为正时该道停发，留待下一周期。
+ */
+
+#ifndef EDGESTELLE_LANES_HPP
+#define EDGESTELLE_LANES_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "edgestelle_config.hpp"
+#include "edgestelle_report.hpp"
+
+namespace edgestelle {
+
+enum class Lane : uint8_t { alert = 0, routine = 1 };
+
+constexpr size_t kLanes = 2;
+
+namespace detail {
+
+/**
+ * 字节令牌桶 (steady_clock，不受 VirtualClock 影响)。
+ */
+class TokenBucket {
+public:
+    using clock = std::chrono::steady_clock;
+
+    void reset(const LaneConfig& cfg, clock::time_point now = clock::now()) {
+        rate_   = std::max(0.0, cfg.bytes_per_s);
+        burst_  = cfg.burst_bytes > 0 ? static_cast<double>(cfg.burst_bytes) : rate_;
+        tokens_ = burst_;
+        last_   = now;
+    }
+
+    bool unlimited() const { return rate_ <= 0.0; }
+
+    /**
+     * 补充令牌，余额为正 (或不整形) 时可以发送。
+     */
+    bool ready(clock::time_point now) {
+        if (unlimited()) return true;
+        double dt = std::chrono::duration<double>(now - last_).count();
+        last_   = now;
+        tokens_ = std::min(burst_, tokens_ + dt * rate_);
+        return tokens_ > 0.0;
+    }
+
+    void consume(size_t bytes) {
+        if (!unlimited()) tokens_ -= static_cast<double>(bytes);
+    }
+
+    double tokens() const { return tokens_; }
+
+private:
+    double            rate_   = 0.0;
+    double            burst_  = 0.0;
+    double            tokens_ = 0.0;
+    clock::time_point last_{};
+};
+
+} // namespace detail
+
+/**
+ * 分道的定长报告队列。新报告先写入 staging()，commit() 后按 has_anomaly 换入
+ * 对应道的槽位 (交换 vector，不复制、不申请堆内存)。
+ */
+class LanedReportQueue {
+public:
+    void reset(size_t alert_depth, size_t routine_depth, const CompiledTemplate& tmpl, size_t extension_bytes) {
+        lanes_[index(Lane::alert)].reset(alert_depth, tmpl, extension_bytes);
+        lanes_[index(Lane::routine)].reset(routine_depth, tmpl, extension_bytes);
+        ReportQueue staging;
+        staging.reset(1, tmpl, extension_bytes);
+        staging_ = std::move(staging.push());
+    }
+
+    /**
+     * 下一份报告的写入位置，内容由调用方覆盖写入。
+     */
+    Report& staging() { return staging_; }
+
+    /**
+     * 把 staging() 中的报告放入所属道的队尾 (该道满时覆盖最旧的)，返回入队后的报告。
+     */
+    Report& commit() {
+        Report& slot = lane(staging_.has_anomaly() ? Lane::alert : Lane::routine).push();
+        std::swap(slot, staging_);
+        return slot;
+    }
+
+    ReportQueue&       lane(Lane l)       { return lanes_[index(l)]; }
+    const ReportQueue& lane(Lane l) const { return lanes_[index(l)]; }
+
+    size_t size()  const { return lanes_[0].size() + lanes_[1].size(); }
+    bool   empty() const { return size() == 0; }
+
+private:
+    static size_t index(Lane l) { return static_cast<size_t>(l); }
+
+    ReportQueue lanes_[kLanes];
+    Report      staging_;
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_LANES_HPP
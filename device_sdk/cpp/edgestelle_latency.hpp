@@ -0,0 +1,140 @@
+/*
+ * EdgeStelle — C++ Device SDK: 可合并的耗时直方图
+ *
+ * 舰队 tick 耗时 (edgestelle_fleet.hpp，分布式压测时跨进程合并) 与实时采样线程的
+ * 唤醒延迟 (edgestelle_realtime.hpp) 共用。桶边界固定，合并即逐桶相加。
+ */
+
+#ifndef EDGESTELLE_LATENCY_HPP
+#define EDGESTELLE_LATENCY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+
+/**
+ * 可合并的耗时直方图 (毫秒)：每个 2 的幂区间分 kSub 个对数桶，分位数的相对误差约 9%，
+ * 覆盖约 1 µs 到 17 分钟，超出的计入两端的桶。各分区、各进程的直方图逐桶相加即合并。
+ */
+class LatencyHistogram {
+public:
+    static constexpr int    kSub     = 8;
+    static constexpr int    kMinExp  = -10;   // 最小桶上界 2^-10 ms
+    static constexpr int    kOctaves = 30;
+    static constexpr size_t kBuckets = kOctaves * kSub + 1;
+
+    void observe(double ms) {
+        ++counts_[index(ms)];
+        min_ = count_ == 0 ? ms : std::min(min_, ms);
+        max_ = count_ == 0 ? ms : std::max(max_, ms);
+        ++count_;
+        sum_ += ms;
+    }
+
+    void merge(const LatencyHistogram& o) {
+        if (o.count_ == 0) return;
+        for (size_t i = 0; i < kBuckets; ++i) counts_[i] += o.counts_[i];
+        min_ = count_ == 0 ? o.min_ : std::min(min_, o.min_);
+        max_ = count_ == 0 ? o.max_ : std::max(max_, o.max_);
+        count_ += o.count_;
+        sum_   += o.sum_;
+    }
+
+    uint64_t count() const { return count_; }
+    double   min()   const { return min_; }
+    double   max()   const { return max_; }
+    double   sum()   const { return sum_; }
+    double   mean()  const { return count_ ? sum_ / static_cast<double>(count_) : 0.0; }
+
+    /**
+     * q 分位数的估计 (所在桶的上界，限制在 [min, max] 内)；无观测时为 0。
+     */
+    double quantile(double q) const {
+        if (count_ == 0) return 0.0;
+        auto     rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count_)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= std::max<uint64_t>(rank, 1)) return std::clamp(upper(i), min_, max_);
+        }
+        return max_;
+    }
+
+    /**
+     * 不大于 ms 的观测数 (按桶上界计，桶跨越 ms 时整桶不计)，用于导出累积桶。
+     */
+    uint64_t count_le(double ms) const {
+        uint64_t n = 0;
+        for (size_t i = 0; i < kBuckets && upper(i) <= ms; ++i) n += counts_[i];
+        return n;
+    }
+
+    /**
+     * 不含空白的文本形式 "count,sum,min,max;桶:计数;..." (只列非空桶)，供跨进程传输。
+     */
+    std::string encode() const {
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), "%llu,%.17g,%.17g,%.17g", static_cast<unsigned long long>(count_),
+                      sum_, min_, max_);
+        std::string out = buf;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            if (counts_[i] == 0) continue;
+            std::snprintf(buf, sizeof(buf), ";%zu:%llu", i, static_cast<unsigned long long>(counts_[i]));
+            out += buf;
+        }
+        return out;
+    }
+
+    static Result<LatencyHistogram> decode(const std::string& text) {
+        LatencyHistogram h;
+        const char* p = text.c_str();
+        char* end = nullptr;
+        h.count_ = std::strtoull(p, &end, 10);
+        if (*end != ',') return malformed(text);
+        h.sum_ = std::strtod(end + 1, &end);
+        if (*end != ',') return malformed(text);
+        h.min_ = std::strtod(end + 1, &end);
+        if (*end != ',') return malformed(text);
+        h.max_ = std::strtod(end + 1, &end);
+        uint64_t total = 0;
+        while (*end == ';') {
+            unsigned long long i = std::strtoull(end + 1, &end, 10);
+            if (*end != ':' || i >= kBuckets) return malformed(text);
+            h.counts_[i] = std::strtoull(end + 1, &end, 10);
+            total += h.counts_[i];
+        }
+        if (*end != '\0' || total != h.count_) return malformed(text);
+        return h;
+    }
+
+private:
+    static size_t index(double ms) {
+        if (!(ms > upper(0))) return 0;
+        auto i = 1 + static_cast<long>(std::floor((std::log2(ms) - kMinExp) * kSub));
+        return static_cast<size_t>(std::clamp<long>(i, 1, static_cast<long>(kBuckets) - 1));
+    }
+
+    static double upper(size_t i) { return std::exp2(kMinExp + static_cast<double>(i) / kSub); }
+
+    static Error malformed(const std::string& text) {
+        return Error{Errc::cluster, "无法解析直方图: " + text.substr(0, 64)};
+    }
+
+    std::array<uint64_t, kBuckets> counts_{};
+    uint64_t count_ = 0;
+    double   sum_   = 0.0;
+    double   min_   = 0.0;
+    double   max_   = 0.0;
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_LATENCY_HPP
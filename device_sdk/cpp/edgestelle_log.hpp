@@ -0,0 +1,34 @@
+/*
+ * EdgeStelle — C++ Device SDK: 日志
+ *
+ * 基于 stdio 的 printf 风格日志，不依赖 iostream / locale，
+ * 嵌入式构建可省去整套流库。
+ */
+
+#ifndef EDGESTELLE_LOG_HPP
+#define EDGESTELLE_LOG_HPP
+
+#include <cstdarg>
+#include <cstdio>
+
+namespace edgestelle {
+namespace detail {
+
+__attribute__((format(printf, 2, 3)))
+inline void log_line(FILE* out, const char* fmt, ...) {
+    std::fputs("[SDK] ", out);
+    va_list ap;
+    va_start(ap, fmt);
+    std::vfprintf(out, fmt, ap);
+    va_end(ap);
+    std::fputc('\n', out);
+    std::fflush(out);
+}
+
+} // namespace detail
+} // namespace edgestelle
+
+#define EDGESTELLE_LOG(...)     ::edgestelle::detail::log_line(stdout, __VA_ARGS__)
+#define EDGESTELLE_LOG_ERR(...) ::edgestelle::detail::log_line(stderr, __VA_ARGS__)
+
+#endif // EDGESTELLE_LOG_HPP
@@ -0,0 +1,145 @@
+/*
+ * EdgeStelle — C++ Device SDK: mmap 映射区
+ *
+ * 飞行记录器 (edgestelle_recorder.hpp) 与本地时序库 (edgestelle_tsdb.hpp) 共用的
+ * 文件 / 匿名映射封装。
+ */
+
+#ifndef EDGESTELLE_MMAP_HPP
+#define EDGESTELLE_MMAP_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+namespace detail {
+
+/**
+ * 已映射的一段内存 (文件或匿名)，析构时解除映射。
+ */
+class MappedRegion {
+public:
+    MappedRegion() = default;
+    ~MappedRegion() { reset(); }
+
+    MappedRegion(MappedRegion&& o) noexcept
+        : data_(std::exchange(o.data_, nullptr)), size_(std::exchange(o.size_, 0)) {}
+
+    MappedRegion& operator=(MappedRegion&& o) noexcept {
+        if (this != &o) {
+            reset();
+            data_ = std::exchange(o.data_, nullptr);
+            size_ = std::exchange(o.size_, 0);
+        }
+        return *this;
+    }
+
+    /**
+     * 映射 size 字节并预先缺页 (稳态写入不再触发缺页)。path 为空时匿名映射；
+     * 否则映射该文件 (长度不符时截断重建)，existed 返回文件原本是否恰为 size 字节。
+     * 文件的磁盘块用 posix_fallocate 预先分配：稀疏文件在磁盘写满后首次写入空洞
+     * 会以 SIGBUS 终止进程，预分配则在此返回 storage_io (ENOSPC)。分配失败时删除
+     * 本次新建 / 重建的文件。
+     */
+    static Result<MappedRegion> map(const std::string& path, size_t size, bool& existed) {
+        existed = false;
+        MappedRegion region;
+        if (path.empty()) {
+            void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+            if (p == MAP_FAILED) return failure("mmap", path);
+            region.data_ = static_cast<uint8_t*>(p);
+            region.size_ = size;
+            return region;
+        }
+
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) return failure("open", path);
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            Error err = failure("fstat", path);
+            ::close(fd);
+            return err;
+        }
+        existed = static_cast<size_t>(st.st_size) == size;
+        if (!existed && (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+            Error err = failure("ftruncate", path);
+            ::close(fd);
+            return err;
+        }
+        if (int rc = ::posix_fallocate(fd, 0, static_cast<off_t>(size)); rc != 0) {
+            errno = rc;   // posix_fallocate 不设置 errno，直接返回错误码
+            Error err = failure("posix_fallocate", path);
+            ::close(fd);
+            if (!existed) ::unlink(path.c_str());
+            return err;
+        }
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        ::close(fd);   // 映射保持有效
+        if (p == MAP_FAILED) return failure("mmap", path);
+        region.data_ = static_cast<uint8_t*>(p);
+        region.size_ = size;
+        return region;
+    }
+
+    /**
+     * 映射一个已存在的文件 (按其当前长度，可读写)。
+     */
+    static Result<MappedRegion> map_existing(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) return failure("open", path);
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            Error err = st.st_size <= 0 ? Error{Errc::storage_io, "空文件 " + path} : failure("fstat", path);
+            ::close(fd);
+            return err;
+        }
+        auto size = static_cast<size_t>(st.st_size);
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return failure("mmap", path);
+        MappedRegion region;
+        region.data_ = static_cast<uint8_t*>(p);
+        region.size_ = size;
+        return region;
+    }
+
+    uint8_t* data() const { return data_; }
+    size_t   size() const { return size_; }
+
+    /**
+     * 异步回写文件映射 (匿名映射无操作)。
+     */
+    void sync_async() const {
+        if (data_) ::msync(data_, size_, MS_ASYNC);
+    }
+
+    void reset() {
+        if (data_) ::munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+private:
+    static Error failure(const char* what, const std::string& path) {
+        return Error{Errc::storage_io, std::string(what) + " " + (path.empty() ? "(匿名)" : path) + ": "
+                                           + std::strerror(errno)};
+    }
+
+    uint8_t* data_ = nullptr;
+    size_t   size_ = 0;
+};
+
+} // namespace detail
+} // namespace edgestelle
+
+#endif // EDGESTELLE_MMAP_HPP
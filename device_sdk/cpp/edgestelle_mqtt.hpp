@@ -0,0 +1,435 @@
+/*
+ * EdgeStelle — C++ Device SDK: MQTT 通道
+ *
+ * 持有到 broker 的长连接，所有失败以 Result 返回。两种后端:
+ *   - 默认: Eclipse Paho MQTT C++ (mqtt::async_client)，异常在本层边界转换为 Error；
+ *   - EDGESTELLE_NO_EXCEPTIONS: Paho C 异步 API (MQTTAsync)，
+ *     Paho C++ 头文件依赖异常，无法在 -fno-exceptions 下编译。
+ *
+ * connect_async() / publish_async() 可附带 MqttCompletion，完成时在 Paho 回调线程上通知，
+ * 供协程执行器 (edgestelle_coro.hpp) 挂起等待而不阻塞线程。
+ *
+ * 一个 MqttChannel 只连一个 broker；多 broker 的故障转移与分片见 edgestelle_brokers.hpp。
+ */
+
+#ifndef EDGESTELLE_MQTT_HPP
+#define EDGESTELLE_MQTT_HPP
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "edgestelle_config.hpp"
+#include "edgestelle_result.hpp"
+
+#ifdef EDGESTELLE_NO_EXCEPTIONS
+#include <MQTTAsync.h>
+#else
+#include <mqtt/async_client.h>
+#endif
+
+namespace edgestelle {
+namespace detail {
+
+/**
+ * 异步操作完成通知。由调用方持有并保证存活到 done() 被调用；
+ * done() 在 Paho 回调线程上执行，实现方只应做转交 (如投递回执行器)。
+ */
+class MqttCompletion {
+public:
+    virtual void done(Result<void> result) = 0;
+
+protected:
+    ~MqttCompletion() = default;
+};
+
+#ifndef EDGESTELLE_NO_EXCEPTIONS
+
+class MqttChannel {
+public:
+    explicit MqttChannel(const DeviceConfig& cfg)
+        : MqttChannel(cfg, cfg.mqtt_broker_uri, "device-" + cfg.device_id) {}
+
+    /**
+     * 连接指定 broker，使用给定的 client id。
+     */
+    MqttChannel(const DeviceConfig& cfg, std::string uri, std::string client_id)
+        : cfg_(cfg), uri_(std::move(uri)), client_id_(std::move(client_id)) {}
+
+    ~MqttChannel() { disconnect(); }
+
+    MqttChannel(const MqttChannel&)            = delete;
+    MqttChannel& operator=(const MqttChannel&) = delete;
+
+    const std::string& uri() const { return uri_; }
+
+    bool connected()  const { return client_ && client_->is_connected(); }
+    bool connecting() const { return static_cast<bool>(connect_tok_); }
+
+    /**
+     * 发起连接但不等待。已连接或连接进行中时直接返回 (此时不会通知 notify)。
+     * 连接完成后仍需收尾：wait_connected()，或以 notify 收到的结果调用 complete_connect()。
+     */
+    Result<void> connect_async(MqttCompletion* notify = nullptr) {
+        if (connected() || connecting()) return {};
+        std::unique_ptr<Listener> listener;
+        if (notify) listener = std::make_unique<Listener>(notify, Errc::mqtt_connect);
+        try {
+            client_ = std::make_unique<mqtt::async_client>(uri_, client_id_);
+
+            auto connOpts = mqtt::connect_options_builder()
+                .clean_session(true)
+                .finalize();
+
+            if (!cfg_.mqtt_username.empty()) {
+                connOpts.set_user_name(cfg_.mqtt_username);
+                connOpts.set_password(cfg_.mqtt_password);
+            }
+
+            // Paho 未暴露 TLS 会话复用接口；对 MQTT 的"热握手"依靠长连接保持
+            if (DeviceConfig::uri_uses_tls(uri_)) {
+                const auto& tls = cfg_.tls;
+                auto sslOpts = mqtt::ssl_options_builder()
+                    .enable_server_cert_auth(tls.verify_peer)
+                    .verify(tls.verify_peer)
+                    .finalize();
+                if (!tls.ca_file.empty())   sslOpts.set_trust_store(tls.ca_file);
+                if (!tls.cert_file.empty()) sslOpts.set_key_store(tls.cert_file);
+                if (!tls.key_file.empty())  sslOpts.set_private_key(tls.key_file);
+                connOpts.set_ssl(sslOpts);
+            }
+
+            connect_tok_ = listener ? client_->connect(connOpts, nullptr, *listener)
+                                    : client_->connect(connOpts);
+        } catch (const mqtt::exception& e) {
+            client_.reset();
+            return Error{Errc::mqtt_connect, e.what()};
+        }
+        listener.release();   // 回调后自行释放
+        return {};
+    }
+
+    /**
+     * 等待挂起的连接完成。
+     */
+    Result<void> wait_connected() {
+        if (!connect_tok_) {
+            return connected() ? Result<void>{} : Error{Errc::mqtt_connect, "not connected"};
+        }
+        auto tok = std::move(connect_tok_);
+        try {
+            tok->wait();
+        } catch (const mqtt::exception& e) {
+            client_.reset();
+            return Error{Errc::mqtt_connect, e.what()};
+        }
+        return {};
+    }
+
+    /**
+     * 以 connect_async() 的通知结果收尾，不等待 (供已在完成回调后恢复的协程使用)。
+     */
+    Result<void> complete_connect(Result<void> completed) {
+        connect_tok_.reset();
+        if (!completed) client_.reset();
+        return completed;
+    }
+
+    Result<void> publish(const std::string& topic, const std::string& payload, int qos) {
+        try {
+            client_->publish(mqtt::make_message(topic, payload, qos, false))->wait();
+        } catch (const mqtt::exception& e) {
+            // 连接多半已断开，丢弃客户端以便下次重连
+            client_.reset();
+            return Error{Errc::mqtt_publish, e.what()};
+        }
+        return {};
+    }
+
+    /**
+     * 发布但不等待确认，完成时通知 notify。
+     */
+    Result<void> publish_async(const std::string& topic, const std::string& payload, int qos,
+                               MqttCompletion& notify) {
+        auto listener = std::make_unique<Listener>(&notify, Errc::mqtt_publish);
+        try {
+            client_->publish(mqtt::make_message(topic, payload, qos, false), nullptr, *listener);
+        } catch (const mqtt::exception& e) {
+            client_.reset();
+            return Error{Errc::mqtt_publish, e.what()};
+        }
+        listener.release();
+        return {};
+    }
+
+    void disconnect() {
+        if (!client_) return;
+        try {
+            if (connect_tok_) connect_tok_->wait();
+            if (client_->is_connected()) client_->disconnect()->wait();
+        } catch (const mqtt::exception&) {
+            // 断开失败无需上报，连接随客户端一并释放
+        }
+        connect_tok_.reset();
+        client_.reset();
+    }
+
+private:
+    /**
+     * 把 Paho C++ 回调转交给 MqttCompletion，回调后自行释放。
+     */
+    class Listener : public mqtt::iaction_listener {
+    public:
+        Listener(MqttCompletion* notify, Errc code) : notify_(notify), code_(code) {}
+
+    private:
+        void on_success(const mqtt::token&) override {
+            notify_->done({});
+            delete this;
+        }
+        void on_failure(const mqtt::token& tok) override {
+            notify_->done(Error{code_, "rc=" + std::to_string(tok.get_return_code())});
+            delete this;
+        }
+
+        MqttCompletion* notify_;
+        Errc            code_;
+    };
+
+    DeviceConfig                        cfg_;
+    std::string                         uri_;
+    std::string                         client_id_;
+    std::unique_ptr<mqtt::async_client> client_;
+    mqtt::token_ptr                     connect_tok_;
+};
+
+#else // EDGESTELLE_NO_EXCEPTIONS
+
+class MqttChannel {
+public:
+    explicit MqttChannel(const DeviceConfig& cfg)
+        : MqttChannel(cfg, cfg.mqtt_broker_uri, "device-" + cfg.device_id) {}
+
+    MqttChannel(const DeviceConfig& cfg, std::string uri, std::string client_id)
+        : cfg_(cfg), uri_(std::move(uri)), client_id_(std::move(client_id)) {}
+
+    ~MqttChannel() { disconnect(); }
+
+    MqttChannel(const MqttChannel&)            = delete;
+    MqttChannel& operator=(const MqttChannel&) = delete;
+
+    const std::string& uri() const { return uri_; }
+
+    bool connected()  const { return client_ && MQTTAsync_isConnected(client_); }
+    bool connecting() const { return connect_pending_; }
+
+    Result<void> connect_async(MqttCompletion* notify = nullptr) {
+        if (connected() || connecting()) return {};
+        destroy();
+
+        int rc = MQTTAsync_create(&client_, uri_.c_str(), client_id_.c_str(),
+                                  MQTTCLIENT_PERSISTENCE_NONE, nullptr);
+        if (rc != MQTTASYNC_SUCCESS) {
+            client_ = nullptr;
+            return Error{Errc::mqtt_connect, "MQTTAsync_create rc=" + std::to_string(rc)};
+        }
+
+        MQTTAsync_connectOptions opts = MQTTAsync_connectOptions_initializer;
+        opts.cleansession = 1;
+        opts.onSuccess    = &MqttChannel::on_connect_success;
+        opts.onFailure    = &MqttChannel::on_connect_failure;
+        opts.context      = this;
+        if (!cfg_.mqtt_username.empty()) {
+            opts.username = cfg_.mqtt_username.c_str();
+            opts.password = cfg_.mqtt_password.c_str();
+        }
+
+        MQTTAsync_SSLOptions ssl = MQTTAsync_SSLOptions_initializer;
+        if (DeviceConfig::uri_uses_tls(uri_)) {
+            const auto& tls = cfg_.tls;
+            ssl.enableServerCertAuth = tls.verify_peer ? 1 : 0;
+            ssl.verify               = tls.verify_peer ? 1 : 0;
+            if (!tls.ca_file.empty())   ssl.trustStore = tls.ca_file.c_str();
+            if (!tls.cert_file.empty()) ssl.keyStore   = tls.cert_file.c_str();
+            if (!tls.key_file.empty())  ssl.privateKey = tls.key_file.c_str();
+            opts.ssl = &ssl;
+        }
+
+        connect_waiter_.reset();
+        connect_notify_ = notify;
+        rc = MQTTAsync_connect(client_, &opts);
+        if (rc != MQTTASYNC_SUCCESS) {
+            destroy();
+            return Error{Errc::mqtt_connect, "MQTTAsync_connect rc=" + std::to_string(rc)};
+        }
+        connect_pending_ = true;
+        return {};
+    }
+
+    Result<void> wait_connected() {
+        if (!connect_pending_) {
+            return connected() ? Result<void>{} : Error{Errc::mqtt_connect, "not connected"};
+        }
+        connect_pending_ = false;
+        if (!connect_waiter_.wait()) {
+            destroy();
+            return Error{Errc::mqtt_connect, connect_waiter_.message};
+        }
+        return {};
+    }
+
+    Result<void> complete_connect(Result<void> completed) {
+        connect_pending_ = false;
+        if (!completed) destroy();
+        return completed;
+    }
+
+    Result<void> publish(const std::string& topic, const std::string& payload, int qos) {
+        Waiter waiter;
+        MQTTAsync_responseOptions ropts = MQTTAsync_responseOptions_initializer;
+        ropts.onSuccess = &Waiter::on_success;
+        ropts.onFailure = &Waiter::on_failure;
+        ropts.context   = &waiter;
+
+        int rc = MQTTAsync_send(client_, topic.c_str(), static_cast<int>(payload.size()),
+                                payload.data(), qos, 0, &ropts);
+        if (rc != MQTTASYNC_SUCCESS) {
+            destroy();
+            return Error{Errc::mqtt_publish, "MQTTAsync_send rc=" + std::to_string(rc)};
+        }
+        if (!waiter.wait()) {
+            destroy();
+            return Error{Errc::mqtt_publish, waiter.message};
+        }
+        return {};
+    }
+
+    Result<void> publish_async(const std::string& topic, const std::string& payload, int qos,
+                               MqttCompletion& notify) {
+        MQTTAsync_responseOptions ropts = MQTTAsync_responseOptions_initializer;
+        ropts.onSuccess = &MqttChannel::on_publish_success;
+        ropts.onFailure = &MqttChannel::on_publish_failure;
+        ropts.context   = &notify;
+
+        int rc = MQTTAsync_send(client_, topic.c_str(), static_cast<int>(payload.size()),
+                                payload.data(), qos, 0, &ropts);
+        if (rc != MQTTASYNC_SUCCESS) {
+            destroy();
+            return Error{Errc::mqtt_publish, "MQTTAsync_send rc=" + std::to_string(rc)};
+        }
+        return {};
+    }
+
+    void disconnect() {
+        if (!client_) return;
+        if (connect_pending_) {
+            connect_pending_ = false;
+            connect_waiter_.wait();
+        }
+        if (MQTTAsync_isConnected(client_)) {
+            Waiter waiter;
+            MQTTAsync_disconnectOptions dopts = MQTTAsync_disconnectOptions_initializer;
+            dopts.timeout   = 2000;
+            dopts.onSuccess = &Waiter::on_disconnect;
+            dopts.onFailure = &Waiter::on_disconnect_failure;
+            dopts.context   = &waiter;
+            if (MQTTAsync_disconnect(client_, &dopts) == MQTTASYNC_SUCCESS) waiter.wait();
+        }
+        destroy();
+    }
+
+private:
+    /**
+     * 把 Paho C 回调转换为同步等待。
+     */
+    struct Waiter {
+        std::mutex              mu;
+        std::condition_variable cv;
+        bool                    done = false;
+        bool                    ok   = false;
+        std::string             message;
+
+        void reset() {
+            std::lock_guard<std::mutex> lock(mu);
+            done = false;
+            ok   = false;
+            message.clear();
+        }
+
+        bool wait() {
+            std::unique_lock<std::mutex> lock(mu);
+            cv.wait(lock, [this] { return done; });
+            return ok;
+        }
+
+        void finish(bool success, const char* msg, int code) {
+            std::lock_guard<std::mutex> lock(mu);
+            done = true;
+            ok   = success;
+            if (!success) {
+                message = msg ? msg : "rc=" + std::to_string(code);
+            }
+            cv.notify_all();
+        }
+
+        static void on_success(void* ctx, MQTTAsync_successData*) {
+            static_cast<Waiter*>(ctx)->finish(true, nullptr, 0);
+        }
+        static void on_failure(void* ctx, MQTTAsync_failureData* resp) {
+            static_cast<Waiter*>(ctx)->finish(false, resp ? resp->message : nullptr,
+                                              resp ? resp->code : -1);
+        }
+        static void on_disconnect(void* ctx, MQTTAsync_successData*) {
+            static_cast<Waiter*>(ctx)->finish(true, nullptr, 0);
+        }
+        static void on_disconnect_failure(void* ctx, MQTTAsync_failureData*) {
+            static_cast<Waiter*>(ctx)->finish(false, "disconnect failed", -1);
+        }
+    };
+
+    static Error failure(Errc code, MQTTAsync_failureData* resp) {
+        if (resp && resp->message) return Error{code, resp->message};
+        return Error{code, "rc=" + std::to_string(resp ? resp->code : -1)};
+    }
+
+    static void on_connect_success(void* ctx, MQTTAsync_successData* data) {
+        auto* self = static_cast<MqttChannel*>(ctx);
+        MqttCompletion* notify = self->connect_notify_;
+        Waiter::on_success(&self->connect_waiter_, data);
+        if (notify) notify->done({});
+    }
+    static void on_connect_failure(void* ctx, MQTTAsync_failureData* resp) {
+        auto* self = static_cast<MqttChannel*>(ctx);
+        MqttCompletion* notify = self->connect_notify_;
+        Waiter::on_failure(&self->connect_waiter_, resp);
+        if (notify) notify->done(failure(Errc::mqtt_connect, resp));
+    }
+    static void on_publish_success(void* ctx, MQTTAsync_successData*) {
+        static_cast<MqttCompletion*>(ctx)->done({});
+    }
+    static void on_publish_failure(void* ctx, MQTTAsync_failureData* resp) {
+        static_cast<MqttCompletion*>(ctx)->done(failure(Errc::mqtt_publish, resp));
+    }
+
+    void destroy() {
+        if (client_) MQTTAsync_destroy(&client_);
+        client_ = nullptr;
+        connect_pending_ = false;
+    }
+
+    DeviceConfig    cfg_;
+    std::string     uri_;
+    std::string     client_id_;
+    MQTTAsync       client_          = nullptr;
+    bool            connect_pending_ = false;
+    Waiter          connect_waiter_;
+    MqttCompletion* connect_notify_  = nullptr;
+};
+
+#endif // EDGESTELLE_NO_EXCEPTIONS
+
+} // namespace detail
+} // namespace edgestelle
+
+#endif // EDGESTELLE_MQTT_HPP
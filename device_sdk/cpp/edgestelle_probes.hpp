@@ -0,0 +1,106 @@
+/*
+ * EdgeStelle — C++ Device SDK: USDT 静态探针
+ *
+ * 基于 systemtap 的 <sys/sdt.h>。探针在未被附加时只是一条 nop，
+ * 无需重新编译即可在生产设备上用 perf / bpftrace 临时观测:
+ *
+ *   bpftrace -e 'usdt:./edgestelle_device:edgestelle:publish_report__done
+ *                { @lat = hist(arg2); }'
+ *   perf probe -x ./edgestelle_device sdt_edgestelle:fetch_template__done
+ *
+ * 探针一览 (参数顺序):
+ *   fetch_template__start   (template_id)
+ *   fetch_template__done    (template_id, body_bytes, latency_us)
+ *   execute_test__start     (template_id, metric_count)
+ *   execute_test__done      (template_id, metric_count, anomaly_count, latency_us)
+ *   publish_report__start   (template_id, payload_bytes)
+ *   publish_report__done    (template_id, payload_bytes, latency_us)
+ *   queue__enqueue          (depth, batch_size)
+ *   queue__flush            (depth)
+ *   governor__adjust        (sample_interval_ms, batch_size, drop_low_priority)
+ *
+ * 构建时定义 EDGESTELLE_USDT 且系统存在 <sys/sdt.h> (systemtap-sdt-dev) 才会生成探针，
+ * 否则所有宏展开为空，参数不求值。
+ *
+ * 探针带 semaphore (.probes 段中的计数，perf / bpftrace 附加时由内核递增)：
+ * EDGESTELLE_PROBE_ENABLED(name) 只在有人附加时为真，阶段计时据此决定是否读时钟，
+ * 未附加时每个阶段只多一次内存读。
+ */
+
+#ifndef EDGESTELLE_PROBES_HPP
+#define EDGESTELLE_PROBES_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(EDGESTELLE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define EDGESTELLE_HAS_USDT 1
+#endif
+#endif
+
+#ifdef EDGESTELLE_HAS_USDT
+// sdt.h 按 <provider>_<name>_semaphore 引用 semaphore；inline 使多个翻译单元共用同一份
+#define EDGESTELLE_PROBE_SEMAPHORE(name) \
+    inline volatile unsigned short edgestelle_##name##_semaphore __attribute__((unused, section(".probes"))) = 0;
+
+extern "C" {
+EDGESTELLE_PROBE_SEMAPHORE(fetch_template__start)
+EDGESTELLE_PROBE_SEMAPHORE(fetch_template__done)
+EDGESTELLE_PROBE_SEMAPHORE(execute_test__start)
+EDGESTELLE_PROBE_SEMAPHORE(execute_test__done)
+EDGESTELLE_PROBE_SEMAPHORE(publish_report__start)
+EDGESTELLE_PROBE_SEMAPHORE(publish_report__done)
+EDGESTELLE_PROBE_SEMAPHORE(queue__enqueue)
+EDGESTELLE_PROBE_SEMAPHORE(queue__flush)
+EDGESTELLE_PROBE_SEMAPHORE(governor__adjust)
+}
+
+#define EDGESTELLE_PROBE_ENABLED(name)      __builtin_expect(edgestelle_##name##_semaphore != 0, 0)
+#define EDGESTELLE_PROBE1(name, a)          DTRACE_PROBE1(edgestelle, name, a)
+#define EDGESTELLE_PROBE2(name, a, b)       DTRACE_PROBE2(edgestelle, name, a, b)
+#define EDGESTELLE_PROBE3(name, a, b, c)    DTRACE_PROBE3(edgestelle, name, a, b, c)
+#define EDGESTELLE_PROBE4(name, a, b, c, d) DTRACE_PROBE4(edgestelle, name, a, b, c, d)
+#else
+#define EDGESTELLE_PROBE_ENABLED(name)      false
+#define EDGESTELLE_PROBE1(name, a)          ((void)0)
+#define EDGESTELLE_PROBE2(name, a, b)       ((void)0)
+#define EDGESTELLE_PROBE3(name, a, b, c)    ((void)0)
+#define EDGESTELLE_PROBE4(name, a, b, c, d) ((void)0)
+#endif
+
+namespace edgestelle {
+namespace probes {
+
+/**
+ * 探针用的阶段计时。enabled 为 false (未附加 tracer 或未生成探针) 时不读时钟，
+ * elapsed_us() 恒为 0；传入 EDGESTELLE_PROBE_ENABLED(<阶段>__done)。
+ */
+class PhaseTimer {
+public:
+#ifdef EDGESTELLE_HAS_USDT
+    explicit PhaseTimer(bool enabled) {
+        if (enabled) start_ = std::chrono::steady_clock::now();
+    }
+
+    int64_t elapsed_us() const {
+        if (start_ == std::chrono::steady_clock::time_point{}) return 0;
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_{};
+#else
+    explicit PhaseTimer(bool) {}
+
+    int64_t elapsed_us() const { return 0; }
+#endif
+};
+
+} // namespace probes
+} // namespace edgestelle
+
+#endif // EDGESTELLE_PROBES_HPP
@@ -0,0 +1,247 @@
+/*
+ * EdgeStelle — C++ Device SDK: 采样线程的实时调度
+ *
+ * 控制面设备上的采样抖动主要来自缺页与调度抢占。DeviceConfig::realtime 启用后，
+ * run_loop() 在模板与全部缓冲分配完成后，于采样线程上依次:
+ *
+ *   1. 绑定到 realtime.cpus (pthread_setaffinity_np)，之后的预触碰落在该 CPU 的 NUMA 节点；
+ *   2. mlockall(MCL_CURRENT | MCL_FUTURE)，关闭 malloc 的归还与 mmap 分配，再预先触碰
+ *      stack_prefault_bytes 的栈与 heap_prefault_bytes 的堆，运行中不再缺页；
+ *   3. 切换为 SCHED_FIFO (realtime.priority)，普通进程无法抢占采样线程。
+ *
+ * 某一步失败 (通常是缺少 CAP_SYS_NICE / CAP_IPC_LOCK 或 RLIMIT_MEMLOCK 过小) 时记录
+ * 警告并继续其余步骤。run_loop() 结束时恢复原调度策略与 CPU 集合并解除内存锁定。
+ *
+ * 启用后周期按 CLOCK_MONOTONIC 上的绝对时刻对齐 (PeriodicTimer，clock_nanosleep
+ * TIMER_ABSTIME)，不随每周期的处理耗时漂移；每次唤醒晚于预定时刻的时长计入唤醒延迟
+ * 直方图，step() 的耗时计入处理耗时直方图 (SdkStats，指标端点以 Prometheus histogram
+ * 导出)，报告时间戳精确到微秒。
+ */
+
+#ifndef EDGESTELLE_REALTIME_HPP
+#define EDGESTELLE_REALTIME_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "edgestelle_config.hpp"
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+
+namespace detail {
+
+/**
+ * 进程允许运行的 CPU 列表 (sched_getaffinity)。
+ */
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+    if (cpus.empty()) cpus.push_back(0);
+    return cpus;
+}
+
+/**
+ * 把调用线程绑定到 cpus 中的任一 CPU。
+ */
+inline Result<void> pin_current_thread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::string list;
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return Error{Errc::realtime, "无效的 CPU 编号 " + std::to_string(cpu)};
+        CPU_SET(cpu, &set);
+        list += (list.empty() ? "" : ",") + std::to_string(cpu);
+    }
+    if (int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); rc != 0) {
+        return Error{Errc::realtime, "绑定 CPU " + list + " 失败: " + std::strerror(rc)};
+    }
+    return {};
+}
+
+inline Result<void> pin_current_thread(int cpu) { return pin_current_thread(std::vector<int>{cpu}); }
+
+constexpr size_t kPrefaultChunk = 16 * 1024;
+constexpr size_t kPageBytes     = 4096;
+
+/**
+ * 逐页写入 bytes 的栈空间 (递归分块，避免编译器优化为单个栈帧)。
+ */
+[[gnu::noinline]] inline void prefault_stack(size_t bytes) {
+    volatile char chunk[kPrefaultChunk];
+    for (size_t i = 0; i < sizeof(chunk); i += kPageBytes) chunk[i] = 0;
+    if (bytes > sizeof(chunk)) prefault_stack(bytes - sizeof(chunk));
+    chunk[0] = chunk[0];   // 递归之后仍访问本帧，阻止尾调用
+}
+
+/**
+ * 申请并逐页写入 bytes 的堆后释放；关闭归还后这些页留在 malloc 的空闲区中。
+ */
+inline void prefault_heap(size_t bytes) {
+    if (bytes == 0) return;
+    auto* p = static_cast<volatile char*>(std::malloc(bytes));
+    if (!p) return;
+    for (size_t i = 0; i < bytes; i += kPageBytes) p[i] = 0;
+    std::free(const_cast<char*>(p));
+}
+
+} // namespace detail
+
+/**
+ * 在调用线程上应用 RealtimeConfig，析构 (或 restore()) 时恢复。只应在同一线程上使用。
+ */
+class RealtimeGuard {
+public:
+    RealtimeGuard() = default;
+    ~RealtimeGuard() { restore(); }
+
+    RealtimeGuard(const RealtimeGuard&)            = delete;
+    RealtimeGuard& operator=(const RealtimeGuard&) = delete;
+
+    /**
+     * 依次绑核、锁定内存并预触碰、切换 SCHED_FIFO；某一步失败不影响其余步骤，返回第一个错误。
+     */
+    Result<void> apply(const RealtimeConfig& cfg) {
+        Result<void> first;
+        auto note = [&](Result<void> r) {
+            if (!r && first) first = std::move(r);
+        };
+        if (!cfg.cpus.empty()) note(pin(cfg.cpus));
+        if (cfg.lock_memory)   note(lock(cfg));
+        if (cfg.priority > 0)  note(fifo(cfg.priority));
+        return first;
+    }
+
+    void restore() {
+        if (fifo_) {
+            pthread_setschedparam(pthread_self(), old_policy_, &old_param_);
+            fifo_ = false;
+        }
+        if (locked_) {
+            munlockall();
+            locked_ = false;
+        }
+        if (pinned_) {
+            pthread_setaffinity_np(pthread_self(), sizeof(old_cpus_), &old_cpus_);
+            pinned_ = false;
+        }
+    }
+
+    bool pinned() const { return pinned_; }
+    bool locked() const { return locked_; }
+    bool fifo()   const { return fifo_; }
+
+private:
+    Result<void> pin(const std::vector<int>& cpus) {
+        CPU_ZERO(&old_cpus_);
+        pthread_getaffinity_np(pthread_self(), sizeof(old_cpus_), &old_cpus_);
+        auto r = detail::pin_current_thread(cpus);
+        pinned_ = static_cast<bool>(r);
+        return r;
+    }
+
+    Result<void> lock(const RealtimeConfig& cfg) {
+        // 释放的堆不归还系统、大块不走 mmap：预触碰过的页保持驻留 (进程级设置，restore() 不还原)
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            return Error{Errc::realtime, std::string("mlockall 失败: ") + std::strerror(errno)};
+        }
+        locked_ = true;
+        detail::prefault_stack(cfg.stack_prefault_bytes);
+        detail::prefault_heap(cfg.heap_prefault_bytes);
+        return {};
+    }
+
+    Result<void> fifo(int priority) {
+        pthread_getschedparam(pthread_self(), &old_policy_, &old_param_);
+        sched_param p{};
+        p.sched_priority = std::clamp(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+        if (int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &p); rc != 0) {
+            return Error{Errc::realtime, "SCHED_FIFO " + std::to_string(p.sched_priority) + " 失败: " +
+                                             std::strerror(rc)};
+        }
+        fifo_ = true;
+        return {};
+    }
+
+    bool        pinned_     = false;
+    bool        locked_     = false;
+    bool        fifo_       = false;
+    cpu_set_t   old_cpus_{};
+    int         old_policy_ = SCHED_OTHER;
+    sched_param old_param_{};
+};
+
+/**
+ * 按 CLOCK_MONOTONIC 绝对时刻对齐的周期等待。
+ */
+class PeriodicTimer {
+public:
+    /**
+     * 以当前时刻为第一个周期的起点。
+     */
+    void start() { next_ = now_ns(); }
+
+    /**
+     * 休眠到下一个周期起点 (上个起点 + period)，返回醒来时刻晚于起点的毫秒数。
+     * 本周期的处理已超出 period 时不休眠，从当前时刻重新对齐 (计入 overruns()，不补错过
+     * 的周期) 并返回 nullopt；stop 置位时也提前返回 nullopt。
+     */
+    std::optional<double> wait_next(std::chrono::nanoseconds period, const std::atomic<bool>& stop) {
+        next_ += period.count();
+        int64_t t = now_ns();
+        if (t >= next_) {
+            ++overruns_;
+            next_ = t;
+            return std::nullopt;
+        }
+        // 长于 kSlice 的等待分片进行，保证 stop 能及时生效；最后一片直接睡到起点
+        while (!stop) {
+            int64_t target = std::min(next_, now_ns() + kSliceNs);
+            timespec ts{static_cast<time_t>(target / 1000000000), static_cast<long>(target % 1000000000)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+            if (target == next_) break;
+        }
+        if (stop) return std::nullopt;
+        return static_cast<double>(now_ns() - next_) / 1e6;
+    }
+
+    uint64_t overruns() const { return overruns_; }
+
+private:
+    static constexpr int64_t kSliceNs = 100 * 1000000LL;
+
+    static int64_t now_ns() {
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    int64_t  next_     = 0;
+    uint64_t overruns_ = 0;
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_REALTIME_HPP
@@ -0,0 +1,281 @@
+/*
+ * EdgeStelle — C++ Device SDK: 飞行记录器
+ *
+ * 定长的 mmap 环，逐周期记录全部指标的结果值 (未经报告批量、按原始精度)，保留最近
+ * samples 个周期。报告越界时 freeze() 把整个窗口冻结：时间戳按二阶差分、各指标按
+ * XOR 压缩 (edgestelle_codec.hpp)，Base64 后写成一条 JSON 突发消息，由设备在该越界
+ * 报告之后发布到 <report topic>/flight:
+ *
+ *   {"template_id":…,"device_id":…,"timestamp":<触发报告的时间戳>,
+ *    "flight_recorder":{"encoding":"gorilla","samples":N,"timestamps":"<b64>",
+ *                       "metrics":[{"name":…,"values":"<b64>"[,"scale":S]},…]}}
+ *
+ * 十进制定点的指标 (窗口内每个值乘以 S = 1 / 10 / … / 10000 后都是整数，且除回去
+ * 逐位相等) 的尾数低位近似随机，XOR 几乎不省空间；这类列改为把 value × S 当作整数
+ * 按二阶差分编码，并带 "scale":S。窗口内有 NaN (未采样) 的列总是按 XOR 编码。
+ *
+ * 订阅端的解码与归并见 backend/app/mqtt_listener.py。
+ *
+ * 稳态开销为每周期写一行 (指标数 × 8 字节)，不申请堆内存；压缩与序列化缓冲在 open()
+ * 时按最坏长度一次性分配。冻结的窗口发出前不再冻结新的窗口，发出后须等环完整翻新一遍
+ * 才会再次冻结，持续越界时不会重复上传重叠的数据。
+ *
+ * path 非空时映射到文件：进程崩溃后环中的数据仍在页缓存 / 磁盘上，重启时指标布局一致
+ * 即沿用 (recovered())，否则清空重建。path 为空时使用匿名映射。
+ */
+
+#ifndef EDGESTELLE_RECORDER_HPP
+#define EDGESTELLE_RECORDER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "edgestelle_clock.hpp"
+#include "edgestelle_codec.hpp"
+#include "edgestelle_mmap.hpp"
+#include "edgestelle_report.hpp"
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+
+namespace detail {
+
+/**
+ * 模板指标布局的指纹 (指标名序列的 FNV-1a)，用于判断 mmap 文件能否沿用。
+ */
+inline uint64_t metrics_fingerprint(const CompiledTemplate& tmpl) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const auto& m : tmpl.metrics) {
+        for (char c : m.name) h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        h = (h ^ 0xFF) * 0x100000001b3ULL;   // 名称分隔
+    }
+    return h;
+}
+
+} // namespace detail
+
+class FlightRecorder {
+public:
+    /**
+     * 打开 (或创建) 保留 samples 个周期的记录器，并按最坏长度分配突发消息缓冲。
+     */
+    static Result<FlightRecorder> open(const std::string& path, const TemplatePtr& tmpl, size_t samples,
+                                       const std::string& device_id) {
+        if (samples < 2) return Error{Errc::sim_config, "飞行记录器至少保留 2 个周期"};
+        size_t metrics = tmpl->metrics.size();
+        size_t bytes   = sizeof(Header) + samples * sizeof(int64_t) + samples * metrics * sizeof(double);
+
+        bool existed = false;
+        auto region = detail::MappedRegion::map(path, bytes, existed);
+        if (!region) return region.error();
+
+        FlightRecorder rec;
+        rec.region_    = std::move(region).value();
+        rec.tmpl_      = tmpl;
+        rec.device_id_ = device_id;
+        rec.capacity_  = samples;
+        rec.metrics_   = metrics;
+        rec.header_    = reinterpret_cast<Header*>(rec.region_.data());
+        rec.times_     = reinterpret_cast<int64_t*>(rec.region_.data() + sizeof(Header));
+        rec.values_    = reinterpret_cast<double*>(rec.times_ + samples);
+
+        uint64_t layout = detail::metrics_fingerprint(*tmpl);
+        Header&  h      = *rec.header_;
+        if (existed && std::memcmp(h.magic, kMagic, sizeof(h.magic)) == 0 && h.version == kVersion
+            && h.metrics == metrics && h.capacity == samples && h.layout == layout) {
+            rec.recovered_ = static_cast<size_t>(std::min<uint64_t>(h.written, samples));
+        } else {
+            std::memcpy(h.magic, kMagic, sizeof(h.magic));
+            h.version  = kVersion;
+            h.metrics  = static_cast<uint32_t>(metrics);
+            h.capacity = samples;
+            h.layout   = layout;
+            h.written  = 0;
+        }
+
+        size_t column = std::max(codec::xor_bound(samples), codec::delta_bound(samples));
+        rec.bits_.resize(column);
+        rec.b64_.reserve(codec::base64_size(column));
+        rec.payload_.reserve(burst_bound(*tmpl, device_id, samples));
+        return rec;
+    }
+
+    FlightRecorder() = default;
+    FlightRecorder(FlightRecorder&&) noexcept            = default;
+    FlightRecorder& operator=(FlightRecorder&&) noexcept = default;
+
+    /**
+     * 记录一个周期：report 中没有的指标 (如被丢弃的低优先级指标) 记为 NaN。
+     */
+    void record(Clock::time_point now, const Report& report) {
+        uint64_t n   = header_->written;
+        size_t   row = static_cast<size_t>(n % capacity_);
+        times_[row] = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        double* v = values_ + row * metrics_;
+        std::fill(v, v + metrics_, std::numeric_limits<double>::quiet_NaN());
+        for (const auto& r : report.results) v[r.metric] = r.value;
+        // 行写完再推进计数，进程在两者之间崩溃时重启后不会读到半行
+        std::atomic_signal_fence(std::memory_order_release);
+        header_->written = n + 1;
+    }
+
+    /**
+     * 冻结当前窗口并生成突发消息 (见文件头注释)，timestamp 取触发报告。
+     *
+     * @return false 表示未冻结：上一次的突发尚未发出、窗口尚未翻新或环为空
+     */
+    bool freeze(const Report& report) {
+        uint64_t n = header_->written;
+        if (pending_ || n == 0 || (frozen_ && n < frozen_at_ + capacity_)) return false;
+        size_t   count = static_cast<size_t>(std::min<uint64_t>(n, capacity_));
+        uint64_t first = n - count;
+
+        const CompiledTemplate& tmpl = *tmpl_;
+        payload_.clear();
+        JsonWriter w(payload_);
+        w.begin_object();
+        w.key("template_id");
+        if (tmpl.id_is_string) w.value(tmpl.id);
+        else                   w.raw(tmpl.id);
+        w.key("device_id");  w.value(device_id_);
+        w.key("timestamp");  w.value(report.timestamp);
+        w.key("flight_recorder");
+        w.begin_object();
+        w.key("encoding");   w.value("gorilla");
+        w.key("samples");    w.value(static_cast<int64_t>(count));
+        w.key("timestamps");
+        {
+            codec::BitWriter bw(bits_.data(), bits_.size());
+            codec::DeltaState st;
+            for (size_t k = 0; k < count; ++k) codec::put_time(bw, st, times_[row(first + k)]);
+            write_base64(w, bw.bytes());
+        }
+        w.key("metrics");
+        w.begin_array();
+        for (size_t m = 0; m < metrics_; ++m) {
+            codec::BitWriter bw(bits_.data(), bits_.size());
+            int64_t scale = decimal_scale(m, first, count);
+            if (scale > 0) {
+                codec::DeltaState st;
+                for (size_t k = 0; k < count; ++k) {
+                    double v = values_[row(first + k) * metrics_ + m];
+                    codec::put_time(bw, st, codec::to_fixed(v, scale));
+                }
+            } else {
+                codec::XorState st;
+                for (size_t k = 0; k < count; ++k) codec::put_value(bw, st, values_[row(first + k) * metrics_ + m]);
+            }
+            w.begin_object();
+            w.key("name");   w.value(tmpl.metrics[m].name);
+            w.key("values");
+            write_base64(w, bw.bytes());
+            if (scale > 0) {
+                w.key("scale");
+                w.value(scale);
+            }
+            w.end_object();
+        }
+        w.end_array();
+        w.end_object();
+        w.end_object();
+
+        region_.sync_async();
+        pending_   = true;
+        frozen_    = true;
+        frozen_at_ = n;
+        ++bursts_;
+        return true;
+    }
+
+    bool               pending() const { return pending_; }
+    const std::string& burst()   const { return payload_; }
+
+    /**
+     * 突发消息已发出，允许冻结下一个窗口。
+     */
+    void release() { pending_ = false; }
+
+    size_t   capacity()  const { return capacity_; }
+    uint64_t written()   const { return header_ ? header_->written : 0; }
+    size_t   recovered() const { return recovered_; }
+    uint64_t bursts()    const { return bursts_; }
+
+    /**
+     * 突发消息的最大长度。
+     */
+    static size_t burst_bound(const CompiledTemplate& tmpl, const std::string& device_id, size_t samples) {
+        constexpr size_t kEscape = 6;
+        size_t column = codec::base64_size(codec::xor_bound(samples));
+        size_t n = 256 + kEscape * (tmpl.id.size() + device_id.size())
+                 + codec::base64_size(codec::delta_bound(samples));
+        for (const auto& m : tmpl.metrics) n += 32 + kEscape * m.name.size() + column;
+        return n;
+    }
+
+private:
+    static constexpr char     kMagic[8] = {'E', 'S', 'F', 'L', 'I', 'G', 'H', 'T'};
+    static constexpr uint32_t kVersion  = 1;
+
+    // 文件布局: Header | int64 时间戳 (ms) × capacity | double 值 × capacity × metrics (按行)
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t metrics;
+        uint64_t capacity;
+        uint64_t layout;    // metrics_fingerprint()
+        uint64_t written;   // 累计写入的周期数
+    };
+
+    size_t row(uint64_t seq) const { return static_cast<size_t>(seq % capacity_); }
+
+    /**
+     * 指标 m 在窗口内是否为十进制定点：返回使每个值都能按整数 / scale 逐位还原的
+     * 最小 scale，不是 (含 NaN、超出 ±2^53 / scale) 时返回 0。
+     */
+    int64_t decimal_scale(size_t m, uint64_t first, size_t count) const {
+        for (int64_t scale : codec::kDecimalScales) {
+            bool exact = true;
+            for (size_t k = 0; k < count && exact; ++k) {
+                exact = codec::fits_scale(values_[row(first + k) * metrics_ + m], scale);
+            }
+            if (exact) return scale;
+        }
+        return 0;
+    }
+
+    void write_base64(JsonWriter& w, size_t bytes) {
+        b64_.clear();
+        codec::append_base64(bits_.data(), bytes, b64_);
+        w.value(b64_);
+    }
+
+    detail::MappedRegion region_;
+    TemplatePtr          tmpl_;
+    std::string          device_id_;
+    Header*              header_   = nullptr;
+    int64_t*             times_    = nullptr;
+    double*              values_   = nullptr;
+    size_t               capacity_ = 0;
+    size_t               metrics_  = 0;
+    size_t               recovered_ = 0;
+
+    std::vector<uint8_t> bits_;      // 单列压缩结果
+    std::string          b64_;
+    std::string          payload_;   // 突发消息
+    bool                 pending_   = false;
+    bool                 frozen_    = false;
+    uint64_t             frozen_at_ = 0;
+    uint64_t             bursts_    = 0;
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_RECORDER_HPP
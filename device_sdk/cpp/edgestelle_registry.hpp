@@ -0,0 +1,276 @@
+/*
+ * EdgeStelle — C++ Device SDK: 进程内共享模板注册表
+ *
+ * 网关或舰队进程里成千上万台逻辑设备运行同一批模板。各设备自己拉取、编译时，内存与
+ * 冷启动耗时随设备数线性增长；注册表让它们共享不可变的 CompiledTemplate:
+ *
+ *   auto& reg = TemplateRegistry::shared();
+ *   dev.set_template_registry(reg);          // EdgeStelleDevice / coro::AsyncDevice
+ *
+ *   - 每个模板 id 一个 Slot，持有当前实例；读取 (Slot::current()) 是一次原子 load，
+ *     不加锁，设备拿到的 TemplatePtr 与注册表共享引用计数；
+ *   - 同一 id 的拉取在 Slot 内串行：并发 acquire() 只有第一个真正请求云端，其余等待后
+ *     直接取用结果；
+ *   - 编译结果按 (id, version) 去重 (version 为空时按响应体指纹)：不同的请求 id 指向
+ *     同一模板、或重复拉取到同一版本时沿用已有实例，不再保留第二份；
+ *   - refresh() / publish() 得到新版本时原子替换 Slot 中的指针 (RCU 式发布)：之后的
+ *     读取拿到新实例，仍持有旧实例的设备照常运行，最后一个引用释放时旧实例才析构。
+ *
+ * 同一 (id, version) 视为同一模板：服务端修改模板内容须递增 version，否则已注册的
+ * 实例不会被替换。内存随不同模板数而非设备数增长。
+ */
+
+#ifndef EDGESTELLE_REGISTRY_HPP
+#define EDGESTELLE_REGISTRY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "edgestelle_log.hpp"
+#include "edgestelle_report.hpp"
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+
+namespace detail {
+
+/**
+ * 可原子读写的 TemplatePtr：C++20 起用 std::atomic<std::shared_ptr>，之前用
+ * std::atomic_load / atomic_store 自由函数。
+ */
+class AtomicTemplatePtr {
+public:
+    TemplatePtr load() const {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        return ptr_.load(std::memory_order_acquire);
+#else
+        return std::atomic_load_explicit(&ptr_, std::memory_order_acquire);
+#endif
+    }
+
+    void store(TemplatePtr p) {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        ptr_.store(std::move(p), std::memory_order_release);
+#else
+        std::atomic_store_explicit(&ptr_, std::move(p), std::memory_order_release);
+#endif
+    }
+
+private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<TemplatePtr> ptr_;
+#else
+    TemplatePtr ptr_;
+#endif
+};
+
+inline uint64_t body_fingerprint(std::string_view body) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : body) h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    return h;
+}
+
+} // namespace detail
+
+class TemplateRegistry {
+public:
+    /**
+     * 一个模板 id 的发布点。地址在注册表存活期内不变，可长期持有。
+     */
+    class Slot {
+    public:
+        /**
+         * 当前实例 (尚未拉取时为空)，无锁。
+         */
+        TemplatePtr current() const { return ptr_.load(); }
+
+        const std::string& template_id() const { return id_; }
+
+    private:
+        friend class TemplateRegistry;
+
+        std::string               id_;
+        detail::AtomicTemplatePtr ptr_;
+        std::mutex                fetch_mu_;       // 同一 id 的拉取与替换串行
+        uint64_t                  body_hash_ = 0;  // 当前实例的响应体指纹，fetch_mu_ 下读写
+    };
+
+    /**
+     * 进程级共享注册表。
+     */
+    static TemplateRegistry& shared() {
+        static TemplateRegistry registry;
+        return registry;
+    }
+
+    TemplateRegistry() = default;
+    TemplateRegistry(const TemplateRegistry&)            = delete;
+    TemplateRegistry& operator=(const TemplateRegistry&) = delete;
+
+    /**
+     * 查找 (或创建) template_id 的 Slot。
+     */
+    Slot& slot(const std::string& template_id) {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto& s = slots_[template_id];
+        if (!s) {
+            s = std::make_unique<Slot>();
+            s->id_ = template_id;
+        }
+        return *s;
+    }
+
+    /**
+     * 取模板：已注册时直接返回当前实例，否则经 fetch(template_id) 拉取响应体并编译。
+     * fetch 须返回 Result<std::string>；同一 id 的并发调用只拉取一次。
+     */
+    template <class Fetch>
+    Result<TemplatePtr> acquire(const std::string& template_id, Fetch&& fetch) {
+        Slot& s = slot(template_id);
+        if (auto p = s.current()) {
+            ++hits_;
+            return p;
+        }
+        std::lock_guard<std::mutex> lock(s.fetch_mu_);
+        if (auto p = s.current()) {   // 等锁期间已由其他线程拉取
+            ++hits_;
+            return p;
+        }
+        return fetch_locked(s, fetch);
+    }
+
+    /**
+     * 重新拉取 template_id：响应体未变时不重新编译，得到新版本时原子替换。
+     * 拉取或编译失败时保留当前实例。
+     */
+    template <class Fetch>
+    Result<TemplatePtr> refresh(const std::string& template_id, Fetch&& fetch) {
+        Slot& s = slot(template_id);
+        std::lock_guard<std::mutex> lock(s.fetch_mu_);
+        return fetch_locked(s, fetch);
+    }
+
+    /**
+     * 以已取得的响应体注册 template_id (如协程设备自行完成的 HTTP 请求)。
+     */
+    Result<TemplatePtr> publish(const std::string& template_id, std::string_view body) {
+        Slot& s = slot(template_id);
+        std::lock_guard<std::mutex> lock(s.fetch_mu_);
+        return publish_locked(s, body);
+    }
+
+    /**
+     * 释放只被注册表引用的模板 (Slot 本身保留)，返回释放的个数。
+     *
+     * 锁顺序与拉取路径一致 (fetch_mu_ 在前、mu_ 在后)：先在 mu_ 下取出 Slot 列表并释放，
+     * 再逐个加 fetch_mu_，可与 acquire() / refresh() / publish() 并发调用。
+     */
+    size_t prune() {
+        std::vector<Slot*> slots;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            slots.reserve(slots_.size());
+            for (auto& [id, s] : slots_) slots.push_back(s.get());   // Slot 从不删除，地址稳定
+        }
+        size_t n = 0;
+        for (Slot* s : slots) {
+            std::lock_guard<std::mutex> fetch_lock(s->fetch_mu_);
+            TemplatePtr p = s->current();
+            // 局部变量 p 与 Slot 各持一份引用
+            if (p && p.use_count() == 2) {
+                s->ptr_.store(nullptr);
+                s->body_hash_ = 0;
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    /**
+     * 存活的不同模板实例数 (按 (id, version) 计)。
+     */
+    size_t templates() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        size_t n = 0;
+        for (const auto& [key, w] : interned_) n += w.expired() ? 0 : 1;
+        return n;
+    }
+
+    uint64_t fetches()  const { return fetches_; }
+    uint64_t compiles() const { return compiles_; }
+    uint64_t hits()     const { return hits_; }
+
+private:
+    template <class Fetch>
+    Result<TemplatePtr> fetch_locked(Slot& s, Fetch& fetch) {
+        ++fetches_;
+        Result<std::string> body = fetch(s.id_);
+        if (!body) return body.error();
+        return publish_locked(s, body.value());
+    }
+
+    Result<TemplatePtr> publish_locked(Slot& s, std::string_view body) {
+        uint64_t    hash = detail::body_fingerprint(body);
+        TemplatePtr cur  = s.current();
+        if (cur && hash == s.body_hash_) return cur;
+
+        auto compiled = compile_template(body);
+        if (!compiled) return compiled.error();
+        ++compiles_;
+        TemplatePtr p = intern(std::move(compiled).value(), hash);
+        s.body_hash_ = hash;
+        if (p != cur) {
+            if (cur) {
+                EDGESTELLE_LOG("🔄 模板 %s 更新: 版本 %s → %s", s.id_.c_str(), cur->version.c_str(),
+                               p->version.c_str());
+            }
+            s.ptr_.store(p);
+        }
+        return p;
+    }
+
+    /**
+     * 按 (id, version) 去重：已有存活实例时丢弃 fresh 并返回已有实例。
+     */
+    TemplatePtr intern(TemplatePtr fresh, uint64_t hash) {
+        std::string key = fresh->id;
+        key += '\0';
+        if (fresh->version.empty()) {
+            char buf[20];
+            std::snprintf(buf, sizeof(buf), "#%016llx", static_cast<unsigned long long>(hash));
+            key += buf;
+        } else {
+            key += fresh->version;
+        }
+
+        std::lock_guard<std::mutex> lock(mu_);
+        for (auto it = interned_.begin(); it != interned_.end();) {
+            it = it->second.expired() ? interned_.erase(it) : std::next(it);
+        }
+        auto& w = interned_[key];
+        if (auto existing = w.lock()) return existing;
+        w = fresh;
+        return fresh;
+    }
+
+    // 锁顺序：Slot::fetch_mu_ → mu_ (intern() 在 fetch_mu_ 下取 mu_)，不得反向持有
+    mutable std::mutex                                 mu_;        // slots_ 与 interned_
+    std::map<std::string, std::unique_ptr<Slot>>       slots_;
+    std::map<std::string, std::weak_ptr<const CompiledTemplate>> interned_;
+
+    std::atomic<uint64_t> fetches_{0};
+    std::atomic<uint64_t> compiles_{0};
+    std::atomic<uint64_t> hits_{0};
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_REGISTRY_HPP
@@ -0,0 +1,1157 @@
+/*
+ * EdgeStelle — C++ Device SDK: 编译后的模板与类型化报告
+ *
+ * 模板在拉取时经 SAX 解析一次性编译为 CompiledTemplate (不构建 JSON DOM)；
+ * 每个周期只产生 MetricResult 数组，由 ReportSerializer 直接写出 JSON 文本，
+ * 输出缓冲跨周期复用。
+ */
+
+#ifndef EDGESTELLE_REPORT_HPP
+#define EDGESTELLE_REPORT_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "edgestelle_config.hpp"
+#include "edgestelle_expr.hpp"
+#include "edgestelle_result.hpp"
+
+#if defined(EDGESTELLE_NO_EXCEPTIONS) && !defined(JSON_NOEXCEPTION)
+#define JSON_NOEXCEPTION
+#endif
+#include <nlohmann/json.hpp>
+
+namespace edgestelle {
+
+// ═════════════════════════════════════════════════════
+//  编译后的模板
+// ═════════════════════════════════════════════════════
+
+enum class MetricKind : uint8_t { scalar, waveform, vector, histogram };
+
+/**
+ * 波形指标的一个频带 [low_hz, high_hz)，带内能量 (均方值) 超过 threshold_max 即异常。
+ */
+struct BandSpec {
+    std::string name;
+    double      low_hz        = 0.0;
+    double      high_hz       = 0.0;
+    double      threshold_max = 0.0;
+    bool        has_max       = false;
+};
+
+/**
+ * 波形指标的采集与分析参数。每 block_size 个样本做一次 FFT，
+ * 一份报告汇总 blocks 个块 (模拟器每周期生成 blocks × block_size 个样本)。
+ */
+struct WaveformSpec {
+    uint32_t              sample_rate_hz = 0;
+    uint32_t              block_size     = 1024;   // 2 的幂
+    uint32_t              blocks         = 8;
+    double                peak_max       = 0.0;
+    double                crest_max      = 0.0;
+    bool                  has_peak_max   = false;
+    bool                  has_crest_max  = false;
+    std::vector<BandSpec> bands;
+};
+
+/**
+ * 定长向量指标 (如各核 CPU 使用率、各磁盘使用率)。labels 可省略，省略时以下标称呼元素。
+ */
+struct VectorSpec {
+    uint32_t                 length = 0;
+    std::vector<std::string> labels;
+};
+
+/**
+ * 直方图的一个分位数阈值，如 {"q": 0.99, "threshold_max": 200}。
+ */
+struct QuantileSpec {
+    double q             = 0.0;
+    double threshold_max = 0.0;
+    bool   has_max       = false;
+};
+
+/**
+ * 直方图指标 (如延迟分布)。bounds 为各桶的上界 (严格递增)，
+ * 另有一个隐含的溢出桶 (bounds.back(), +∞)；第一个桶的下界为 0。
+ */
+struct HistogramSpec {
+    std::vector<double>       bounds;
+    std::vector<QuantileSpec> quantiles;
+};
+
+struct MetricSpec {
+    std::string   name = "unknown";
+    std::string   unit;
+    double        threshold_max = 0.0;
+    double        threshold_min = 0.0;
+    bool          has_max       = false;
+    bool          has_min       = false;
+    bool          low_priority  = false;
+    MetricKind    kind          = MetricKind::scalar;
+    WaveformSpec  waveform;     // kind == waveform 时有效；threshold_max / min 作用于 RMS
+    VectorSpec    vector;       // kind == vector 时有效；threshold_max / min 逐元素比较
+    HistogramSpec histogram;    // kind == histogram 时有效；threshold_max / min 作用于中位数
+    std::string   expression;   // 非空时为派生指标：不模拟，每周期由此表达式计算 (见 edgestelle_expr.hpp)
+    ExprProgram   program;      // expression 编译后的字节码
+
+    bool derived() const { return !expression.empty(); }
+};
+
+/**
+ * 复合规则，如 {"name": "idle_but_hot", "when": "cpu_temperature > 70 && cpu_usage < 10"}。
+ * when 为真 (非 0) 时报告一条异常，归属于表达式引用的第一个指标。
+ */
+struct RuleSpec {
+    std::string name;
+    std::string when;
+    ExprProgram program;
+    uint32_t    metric = 0;
+};
+
+/**
+ * 不可变的已编译模板。报告通过 shared_ptr 引用它，模板本身不随报告复制。
+ */
+struct CompiledTemplate {
+    std::string             id;                  // 原始 id 文本
+    bool                    id_is_string = true;
+    std::string             version;
+    std::vector<MetricSpec> metrics;
+    std::vector<RuleSpec>   rules;
+
+    bool has_expressions() const {
+        return !rules.empty() || std::any_of(metrics.begin(), metrics.end(),
+                                             [](const MetricSpec& m) { return m.derived(); });
+    }
+};
+
+using TemplatePtr = std::shared_ptr<const CompiledTemplate>;
+
+namespace detail {
+
+/**
+ * 只提取 SDK 关心字段的 SAX 处理器，其他字段 (analysis_config、description 等)
+ * 直接跳过，不分配内存。
+ */
+class TemplateSax : public nlohmann::json_sax<nlohmann::json> {
+public:
+    explicit TemplateSax(CompiledTemplate& out) : out_(out) {}
+
+    const Error& error() const { return error_; }
+    bool saw_id()      const { return saw_id_; }
+    bool saw_metrics() const { return saw_metrics_; }
+
+    bool null() override { return scalar(Scalar{}); }
+    bool boolean(bool) override { return scalar(Scalar{}); }
+    bool number_integer(number_integer_t v) override {
+        return scalar(Scalar{Scalar::Number, static_cast<double>(v), {}});
+    }
+    bool number_unsigned(number_unsigned_t v) override {
+        return scalar(Scalar{Scalar::Number, static_cast<double>(v), {}});
+    }
+    bool number_float(number_float_t v, const string_t&) override {
+        return scalar(Scalar{Scalar::Number, v, {}});
+    }
+    bool string(string_t& v) override { return scalar(Scalar{Scalar::String, 0.0, v}); }
+    bool binary(binary_t&) override { return scalar(Scalar{}); }
+
+    bool start_object(std::size_t) override {
+        Kind kind = Kind::Skip;
+        if (stack_.empty()) {
+            kind = Kind::Top;
+        } else if (top().kind == Kind::Top && top().key == "schema_definition") {
+            kind = Kind::Schema;
+        } else if (top().kind == Kind::Metrics) {
+            if (out_.metrics.size() >= EDGESTELLE_MAX_METRICS) {
+                return fail("指标数超过上限 " + std::to_string(EDGESTELLE_MAX_METRICS));
+            }
+            out_.metrics.emplace_back();
+            kind = Kind::Metric;
+        } else if (top().kind == Kind::Bands) {
+            out_.metrics.back().waveform.bands.emplace_back();
+            kind = Kind::Band;
+        } else if (top().kind == Kind::Quantiles) {
+            out_.metrics.back().histogram.quantiles.emplace_back();
+            kind = Kind::Quantile;
+        } else if (top().kind == Kind::Rules) {
+            if (out_.rules.size() >= kMaxRules) return fail("规则数超过上限 " + std::to_string(kMaxRules));
+            out_.rules.emplace_back();
+            kind = Kind::Rule;
+        }
+        stack_.push_back(Frame{kind, {}});
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        Kind kind = Kind::Skip;
+        if (!stack_.empty() && top().kind == Kind::Schema && top().key == "metrics") {
+            kind = Kind::Metrics;
+            saw_metrics_ = true;
+        } else if (!stack_.empty() && top().kind == Kind::Schema && top().key == "rules") {
+            kind = Kind::Rules;
+        } else if (!stack_.empty() && top().kind == Kind::Metric) {
+            const std::string& key = top().key;
+            if (key == "bands")          kind = Kind::Bands;
+            else if (key == "quantiles") kind = Kind::Quantiles;
+            else if (key == "labels")    kind = Kind::Labels;
+            else if (key == "buckets")   kind = Kind::Buckets;
+        } else if (stack_.empty()) {
+            return fail("模板须为 JSON 对象");
+        }
+        stack_.push_back(Frame{kind, {}});
+        return true;
+    }
+
+    bool end_object() override { stack_.pop_back(); return true; }
+    bool end_array()  override { stack_.pop_back(); return true; }
+
+    bool key(string_t& k) override {
+        top().key = k;
+        return true;
+    }
+
+    bool parse_error(std::size_t pos, const std::string&, const nlohmann::detail::exception& e) override {
+        error_ = Error{Errc::template_parse, "位置 " + std::to_string(pos) + ": " + e.what()};
+        return false;
+    }
+
+private:
+    static constexpr size_t kMaxRules = 256;
+
+    enum class Kind {
+        Top, Schema, Metrics, Metric, Bands, Band, Quantiles, Quantile, Labels, Buckets, Rules, Rule, Skip
+    };
+
+    struct Frame {
+        Kind        kind;
+        std::string key;
+    };
+
+    struct Scalar {
+        enum Type { Other, Number, String } type = Other;
+        double      number = 0.0;
+        std::string text;
+    };
+
+    Frame& top() { return stack_.back(); }
+
+    bool fail(std::string message) {
+        error_ = Error{Errc::template_invalid, std::move(message)};
+        return false;
+    }
+
+    bool scalar(const Scalar& v) {
+        if (stack_.empty()) return fail("模板须为 JSON 对象");
+        const Frame& f = top();
+        if (f.kind == Kind::Top) return top_field(f.key, v);
+        if (f.kind == Kind::Metric) return metric_field(out_.metrics.back(), f.key, v);
+        if (f.kind == Kind::Band)   return band_field(out_.metrics.back().waveform.bands.back(), f.key, v);
+        if (f.kind == Kind::Quantile) {
+            return quantile_field(out_.metrics.back().histogram.quantiles.back(), f.key, v);
+        }
+        if (f.kind == Kind::Labels || f.kind == Kind::Buckets) return list_item(out_.metrics.back(), f.kind, v);
+        if (f.kind == Kind::Rule)      return rule_field(out_.rules.back(), f.key, v);
+        if (f.kind == Kind::Metrics)   return fail("指标定义须为对象");
+        if (f.kind == Kind::Bands)     return fail("频带定义须为对象");
+        if (f.kind == Kind::Quantiles) return fail("分位数定义须为对象");
+        if (f.kind == Kind::Rules)     return fail("规则定义须为对象");
+        return true;
+    }
+
+    bool top_field(const std::string& key, const Scalar& v) {
+        if (key == "id") {
+            if (v.type == Scalar::String) {
+                out_.id = v.text;
+            } else if (v.type == Scalar::Number) {
+                char buf[32];
+                auto r = std::to_chars(buf, buf + sizeof(buf), v.number);
+                out_.id.assign(buf, r.ptr);
+                out_.id_is_string = false;
+            } else {
+                return fail("id 须为字符串或数值");
+            }
+            saw_id_ = true;
+        } else if (key == "version" && v.type == Scalar::String) {
+            out_.version = v.text;
+        }
+        return true;
+    }
+
+    bool metric_field(MetricSpec& m, const std::string& key, const Scalar& v) {
+        WaveformSpec& w = m.waveform;
+        if (key == "name" || key == "unit" || key == "priority" || key == "type" || key == "expression") {
+            if (v.type != Scalar::String) return fail(key + " 须为字符串");
+            if (key == "name")             m.name = v.text;
+            else if (key == "expression")  m.expression = v.text;
+            else if (key == "unit")        m.unit = v.text;
+            else if (key == "priority")    m.low_priority = (v.text == "low");
+            else if (v.text == "waveform")  m.kind = MetricKind::waveform;
+            else if (v.text == "vector")    m.kind = MetricKind::vector;
+            else if (v.text == "histogram") m.kind = MetricKind::histogram;
+            else if (v.text != "scalar")    return fail("未知指标类型: " + v.text);
+        } else if (key == "threshold_max" || key == "threshold_min") {
+            if (v.type != Scalar::Number) return fail(key + " 须为数值");
+            if (key == "threshold_max") { m.threshold_max = v.number; m.has_max = true; }
+            else                        { m.threshold_min = v.number; m.has_min = true; }
+        } else if (key == "sample_rate_hz" || key == "block_size" || key == "blocks") {
+            if (v.type != Scalar::Number || !(v.number >= 1 && v.number <= 1e7)) {
+                return fail(key + " 须为正整数");
+            }
+            auto n = static_cast<uint32_t>(v.number);
+            if (key == "sample_rate_hz")  w.sample_rate_hz = n;
+            else if (key == "block_size") w.block_size = n;
+            else                          w.blocks = n;
+        } else if (key == "peak_max" || key == "crest_factor_max") {
+            if (v.type != Scalar::Number) return fail(key + " 须为数值");
+            if (key == "peak_max") { w.peak_max  = v.number; w.has_peak_max  = true; }
+            else                   { w.crest_max = v.number; w.has_crest_max = true; }
+        } else if (key == "length") {
+            if (v.type != Scalar::Number || !(v.number >= 1 && v.number <= 4096)) {
+                return fail("length 须为 1 ~ 4096 的整数");
+            }
+            m.vector.length = static_cast<uint32_t>(v.number);
+        }
+        return true;
+    }
+
+    bool band_field(BandSpec& b, const std::string& key, const Scalar& v) {
+        if (key == "name") {
+            if (v.type != Scalar::String) return fail("频带 name 须为字符串");
+            b.name = v.text;
+        } else if (key == "low_hz" || key == "high_hz" || key == "threshold_max") {
+            if (v.type != Scalar::Number) return fail("频带 " + key + " 须为数值");
+            if (key == "low_hz")       b.low_hz  = v.number;
+            else if (key == "high_hz") b.high_hz = v.number;
+            else                       { b.threshold_max = v.number; b.has_max = true; }
+        }
+        return true;
+    }
+
+    bool quantile_field(QuantileSpec& q, const std::string& key, const Scalar& v) {
+        if (key == "q" || key == "threshold_max") {
+            if (v.type != Scalar::Number) return fail("分位数 " + key + " 须为数值");
+            if (key == "q") q.q = v.number;
+            else            { q.threshold_max = v.number; q.has_max = true; }
+        }
+        return true;
+    }
+
+    bool rule_field(RuleSpec& r, const std::string& key, const Scalar& v) {
+        if (key == "name" || key == "when") {
+            if (v.type != Scalar::String) return fail("规则 " + key + " 须为字符串");
+            if (key == "name") r.name = v.text;
+            else               r.when = v.text;
+        }
+        return true;
+    }
+
+    // labels: 字符串数组；buckets: 数值数组
+    bool list_item(MetricSpec& m, Kind kind, const Scalar& v) {
+        if (kind == Kind::Labels) {
+            if (v.type != Scalar::String) return fail("labels 元素须为字符串");
+            if (m.vector.labels.size() >= 4096) return fail("labels 超过 4096 个");
+            m.vector.labels.push_back(v.text);
+        } else {
+            if (v.type != Scalar::Number) return fail("buckets 元素须为数值");
+            if (m.histogram.bounds.size() >= 256) return fail("buckets 超过 256 个");
+            m.histogram.bounds.push_back(v.number);
+        }
+        return true;
+    }
+
+    CompiledTemplate&  out_;
+    std::vector<Frame> stack_;
+    Error              error_;
+    bool               saw_id_      = false;
+    bool               saw_metrics_ = false;
+};
+
+/**
+ * 校验波形指标参数 (SAX 阶段只做类型检查)。
+ */
+inline Result<void> check_waveform(const MetricSpec& m) {
+    const WaveformSpec& w = m.waveform;
+    const std::string where = "波形指标 " + m.name + ": ";
+    if (w.sample_rate_hz == 0) return Error{Errc::template_invalid, where + "缺少 sample_rate_hz"};
+    if (w.block_size < 16 || w.block_size > 65536 || (w.block_size & (w.block_size - 1)) != 0) {
+        return Error{Errc::template_invalid, where + "block_size 须为 16 ~ 65536 间的 2 的幂"};
+    }
+    if (w.blocks > 4096)     return Error{Errc::template_invalid, where + "blocks 超过 4096"};
+    if (w.bands.size() > 64) return Error{Errc::template_invalid, where + "频带数超过 64"};
+    double nyquist = w.sample_rate_hz / 2.0;
+    for (const auto& b : w.bands) {
+        if (b.name.empty() || !(b.low_hz >= 0.0 && b.low_hz < b.high_hz && b.high_hz <= nyquist)) {
+            return Error{Errc::template_invalid,
+                         where + "频带 " + b.name + " 须满足 0 <= low_hz < high_hz <= 采样率/2"};
+        }
+    }
+    return {};
+}
+
+/**
+ * 校验向量指标参数。
+ */
+inline Result<void> check_vector(const MetricSpec& m) {
+    const VectorSpec& v = m.vector;
+    const std::string where = "向量指标 " + m.name + ": ";
+    if (v.length == 0) return Error{Errc::template_invalid, where + "缺少 length"};
+    if (!v.labels.empty() && v.labels.size() != v.length) {
+        return Error{Errc::template_invalid, where + "labels 个数须等于 length"};
+    }
+    return {};
+}
+
+/**
+ * 校验直方图指标参数。
+ */
+inline Result<void> check_histogram(const MetricSpec& m) {
+    const HistogramSpec& h = m.histogram;
+    const std::string where = "直方图指标 " + m.name + ": ";
+    if (h.bounds.empty()) return Error{Errc::template_invalid, where + "缺少 buckets"};
+    for (size_t i = 0; i < h.bounds.size(); ++i) {
+        if (!(h.bounds[i] > (i == 0 ? 0.0 : h.bounds[i - 1])) || !std::isfinite(h.bounds[i])) {
+            return Error{Errc::template_invalid, where + "buckets 须为严格递增的正数"};
+        }
+    }
+    if (h.quantiles.size() > 16) return Error{Errc::template_invalid, where + "分位数超过 16 个"};
+    for (const auto& q : h.quantiles) {
+        if (!(q.q > 0.0 && q.q < 1.0)) return Error{Errc::template_invalid, where + "q 须在 (0, 1) 内"};
+    }
+    return {};
+}
+
+/**
+ * 编译派生指标与规则的表达式。派生指标须为标量，且只能引用在它之前声明的指标
+ * (求值按声明顺序进行)；规则可引用任意指标，但至少引用一个。
+ */
+inline Result<void> compile_expressions(CompiledTemplate& tmpl) {
+    uint32_t limit = 0;   // 当前表达式可引用的指标下标上界 (不含)
+    auto resolve = [&](std::string_view name) {
+        for (uint32_t i = 0; i < limit; ++i) {
+            if (tmpl.metrics[i].name == name) return i;
+        }
+        return ExprCompiler::kUnknown;
+    };
+
+    for (uint32_t i = 0; i < tmpl.metrics.size(); ++i) {
+        MetricSpec& m = tmpl.metrics[i];
+        if (!m.derived()) continue;
+        const std::string where = "派生指标 " + m.name + ": ";
+        if (m.kind != MetricKind::scalar) return Error{Errc::template_invalid, where + "只能是标量"};
+        limit = i;
+        auto program = compile_expression(m.expression, resolve);
+        if (!program) return Error{Errc::template_invalid, where + program.error().message};
+        m.program = std::move(program).value();
+    }
+
+    limit = static_cast<uint32_t>(tmpl.metrics.size());
+    for (RuleSpec& r : tmpl.rules) {
+        if (r.name.empty() || r.when.empty()) {
+            return Error{Errc::template_invalid, "规则须有 name 与 when"};
+        }
+        auto program = compile_expression(r.when, resolve);
+        if (!program) return Error{Errc::template_invalid, "规则 " + r.name + ": " + program.error().message};
+        if (program.value().inputs.empty()) {
+            return Error{Errc::template_invalid, "规则 " + r.name + ": 须引用至少一个指标"};
+        }
+        r.program = std::move(program).value();
+        r.metric  = r.program.inputs.front();
+    }
+    return {};
+}
+
+/**
+ * 直方图分位数估计 (桶内线性插值，与 Prometheus histogram_quantile 一致)。
+ * counts 有 bounds.size() + 1 个桶；落在溢出桶时返回最大上界。
+ */
+inline double histogram_quantile(const std::vector<double>& bounds, const double* counts, double q) {
+    size_t buckets = bounds.size() + 1;
+    double total = 0.0;
+    for (size_t i = 0; i < buckets; ++i) total += counts[i];
+    if (total <= 0.0) return 0.0;
+
+    double rank = q * total;
+    double seen = 0.0;
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        if (seen + counts[i] >= rank && counts[i] > 0.0) {
+            double lo = i == 0 ? 0.0 : bounds[i - 1];
+            return lo + (bounds[i] - lo) * (rank - seen) / counts[i];
+        }
+        seen += counts[i];
+    }
+    return bounds.back();
+}
+
+} // namespace detail
+
+/**
+ * 把模板 JSON 文本编译为 CompiledTemplate。
+ */
+inline Result<TemplatePtr> compile_template(std::string_view body) {
+    auto tmpl = std::make_shared<CompiledTemplate>();
+    detail::TemplateSax sax(*tmpl);
+    bool ok = nlohmann::json::sax_parse(body.begin(), body.end(), &sax,
+                                        nlohmann::json::input_format_t::json, /*strict=*/true);
+    if (!ok) {
+        Error err = sax.error();
+        if (err.code == Errc::ok) err = Error{Errc::template_parse, "模板不是合法 JSON"};
+        return err;
+    }
+    if (!sax.saw_id())      return Error{Errc::template_invalid, "缺少 id"};
+    if (!sax.saw_metrics()) return Error{Errc::template_invalid, "schema_definition.metrics 须为数组"};
+    for (const auto& m : tmpl->metrics) {
+        Result<void> checked;
+        if (m.kind == MetricKind::waveform)       checked = detail::check_waveform(m);
+        else if (m.kind == MetricKind::vector)    checked = detail::check_vector(m);
+        else if (m.kind == MetricKind::histogram) checked = detail::check_histogram(m);
+        if (!checked) return checked.error();
+    }
+    if (auto compiled = detail::compile_expressions(*tmpl); !compiled) return compiled.error();
+    return TemplatePtr(std::move(tmpl));
+}
+
+// ═════════════════════════════════════════════════════
+//  类型化报告
+// ═════════════════════════════════════════════════════
+
+/**
+ * 单个指标的结果。标量指标只有 value，其余类型的附加数值存放在
+ * Report::elements[first, first + count) 中:
+ *   waveform   value 为 RMS，附加特征布局见 waveform_slot
+ *   vector     value 为元素均值，附加 length 个元素
+ *   histogram  value 为中位数估计，附加 bounds.size() + 1 个桶计数，
+ *              其后为模板 quantiles 各分位数的估计值 (见 histogram_slot)
+ */
+struct MetricResult {
+    uint32_t metric;      // CompiledTemplate::metrics 下标
+    double   value;
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+// 波形结果的附加特征: [peak, crest_factor, band_0 能量, band_1 能量, ...]
+namespace waveform_slot {
+constexpr uint32_t peak  = 0;
+constexpr uint32_t crest = 1;
+constexpr uint32_t bands = 2;
+} // namespace waveform_slot
+
+// 直方图结果的附加数值: [桶计数 × (bounds.size() + 1), 分位数估计 × quantiles.size()]
+namespace histogram_slot {
+inline uint32_t quantiles(const HistogramSpec& h) { return static_cast<uint32_t>(h.bounds.size() + 1); }
+inline uint32_t size(const HistogramSpec& h) { return quantiles(h) + static_cast<uint32_t>(h.quantiles.size()); }
+} // namespace histogram_slot
+
+enum class AnomalyKind : uint8_t {
+    above_max, below_min,
+    peak_above_max, crest_above_max, band_above_max,
+    element_above_max, element_below_min, quantile_above_max,
+    rule_fired,
+};
+
+struct Anomaly {
+    uint32_t    metric;
+    AnomalyKind kind;
+    uint32_t    element = 0;   // band_above_max: 频带下标；element_*: 元素下标；quantile_above_max: 分位数下标；
+                               // rule_fired: 规则下标 (metric 为规则引用的第一个指标)
+};
+
+struct Report {
+    TemplatePtr               tmpl;
+    char                      timestamp[32] = {};   // ISO 8601, "YYYY-MM-DDTHH:MM:SSZ"
+                                                    // (实时调度启用时为 "...:SS.ffffffZ")
+    std::vector<MetricResult> results;
+    std::vector<Anomaly>      anomalies;
+    std::vector<double>       elements;             // 非标量结果的附加数值，见 MetricResult
+    std::string               extensions;           // 额外的顶层字段，已序列化为 "k":v,... 形式
+
+    bool has_anomaly() const { return !anomalies.empty(); }
+};
+
+/**
+ * 追加一个向量指标结果 (value 取元素均值)。
+ */
+inline void append_vector(Report& report, uint32_t metric, const double* values, size_t n) {
+    double sum = 0.0;
+    auto first = static_cast<uint32_t>(report.elements.size());
+    for (size_t i = 0; i < n; ++i) {
+        report.elements.push_back(values[i]);
+        sum += values[i];
+    }
+    report.results.push_back(MetricResult{metric, n ? sum / static_cast<double>(n) : 0.0,
+                                          first, static_cast<uint32_t>(n)});
+}
+
+/**
+ * 直方图累加器：observe() 逐个计入观测值，emit() 写出一份结果
+ * (桶计数 + 分位数估计) 并清零，以便下一周期复用。
+ */
+class Histogram {
+public:
+    explicit Histogram(const HistogramSpec& spec)
+        : spec_(spec), counts_(spec.bounds.size() + 1, 0.0) {}
+
+    void observe(double v) {
+        auto it = std::lower_bound(spec_.bounds.begin(), spec_.bounds.end(), v);
+        counts_[static_cast<size_t>(it - spec_.bounds.begin())] += 1.0;
+    }
+
+    void emit(uint32_t metric, Report& report) {
+        auto first = static_cast<uint32_t>(report.elements.size());
+        report.elements.insert(report.elements.end(), counts_.begin(), counts_.end());
+        for (const auto& q : spec_.quantiles) {
+            report.elements.push_back(detail::histogram_quantile(spec_.bounds, counts_.data(), q.q));
+        }
+        double median = detail::histogram_quantile(spec_.bounds, counts_.data(), 0.5);
+        report.results.push_back(MetricResult{metric, median, first, histogram_slot::size(spec_)});
+        std::fill(counts_.begin(), counts_.end(), 0.0);
+    }
+
+private:
+    HistogramSpec       spec_;
+    std::vector<double> counts_;
+};
+
+namespace detail {
+
+/**
+ * 一份报告在给定模板下各数组的容量上限。
+ */
+struct ReportBounds {
+    size_t results   = 0;
+    size_t elements  = 0;
+    size_t anomalies = 0;
+};
+
+inline ReportBounds report_bounds(const CompiledTemplate& tmpl) {
+    ReportBounds b;
+    b.results   = tmpl.metrics.size();
+    b.anomalies = tmpl.metrics.size() * 2 + tmpl.rules.size();   // 上下限可能同时越界
+    for (const auto& m : tmpl.metrics) {
+        if (m.kind == MetricKind::waveform) {
+            b.elements  += waveform_slot::bands + m.waveform.bands.size();
+            b.anomalies += 2 + m.waveform.bands.size();
+        } else if (m.kind == MetricKind::vector) {
+            b.elements  += m.vector.length;
+            b.anomalies += m.vector.length;   // 每个元素至多越一侧
+        } else if (m.kind == MetricKind::histogram) {
+            b.elements  += histogram_slot::size(m.histogram);
+            b.anomalies += m.histogram.quantiles.size();
+        }
+    }
+    return b;
+}
+
+} // namespace detail
+
+/**
+ * 定长报告环形队列。
+ *
+ * 槽位在 reset() 时按模板指标数一次性分配并预留容量；之后 push() / pop()
+ * 只复用槽位内已有的 vector / string，不再申请堆内存。队满时覆盖最旧的报告。
+ */
+class ReportQueue {
+public:
+    void reset(size_t depth, const CompiledTemplate& tmpl, size_t extension_bytes) {
+        auto bounds = detail::report_bounds(tmpl);
+        slots_.clear();
+        slots_.resize(std::max<size_t>(1, depth));
+        for (auto& r : slots_) {
+            r.results.reserve(bounds.results);
+            r.anomalies.reserve(bounds.anomalies);
+            r.elements.reserve(bounds.elements);
+            r.extensions.reserve(extension_bytes);
+        }
+        head_ = 0;
+        size_ = 0;
+    }
+
+    size_t capacity() const { return slots_.size(); }
+    size_t size()     const { return size_; }
+    bool   empty()    const { return size_ == 0; }
+
+    /**
+     * 取一个空闲槽位追加到队尾；内容由调用方覆盖写入。
+     */
+    Report& push() {
+        if (size_ == slots_.size()) pop();
+        Report& r = slots_[(head_ + size_) % slots_.size()];
+        ++size_;
+        return r;
+    }
+
+    Report& front() { return slots_[head_]; }
+
+    void pop() {
+        head_ = (head_ + 1) % slots_.size();
+        --size_;
+    }
+
+private:
+    std::vector<Report> slots_;
+    size_t              head_ = 0;
+    size_t              size_ = 0;
+};
+
+// ═════════════════════════════════════════════════════
+//  JSON 写出
+// ═════════════════════════════════════════════════════
+
+/**
+ * 追加式 JSON 写出器，只负责分隔符与转义，不做结构校验。
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    void begin_object() { sep(); out_ += '{'; needs_comma_ = false; }
+    void end_object()   { out_ += '}'; needs_comma_ = true; }
+    void begin_array()  { sep(); out_ += '['; needs_comma_ = false; }
+    void end_array()    { out_ += ']'; needs_comma_ = true; }
+
+    void key(std::string_view k) {
+        sep();
+        write_string(k);
+        out_ += ':';
+        after_key_ = true;
+    }
+
+    void value(std::string_view s) { sep(); write_string(s); needs_comma_ = true; }
+    void value(const char* s)       { value(std::string_view(s)); }
+    void value(bool b)              { sep(); out_ += b ? "true" : "false"; needs_comma_ = true; }
+
+    void value(double d) {
+        sep();
+        if (!std::isfinite(d)) {
+            out_ += "null";
+        } else {
+            char buf[32];
+            auto r = std::to_chars(buf, buf + sizeof(buf), d);
+            out_.append(buf, r.ptr);
+        }
+        needs_comma_ = true;
+    }
+
+    void value(int64_t v) {
+        sep();
+        char buf[24];
+        auto r = std::to_chars(buf, buf + sizeof(buf), v);
+        out_.append(buf, r.ptr);
+        needs_comma_ = true;
+    }
+
+    /**
+     * 写入已序列化的 JSON 片段 (作为值，或以 "k":v 形式作为若干成员)。
+     */
+    void raw(std::string_view fragment) {
+        if (fragment.empty()) return;
+        sep();
+        out_.append(fragment.data(), fragment.size());
+        needs_comma_ = true;
+    }
+
+    /**
+     * 写入各段拼接而成的字符串值，省去拼接临时字符串 (如 "cpu_usage 超标")。
+     */
+    void value_concat(std::initializer_list<std::string_view> parts) {
+        sep();
+        out_ += '"';
+        for (auto p : parts) append_escaped(p);
+        out_ += '"';
+        needs_comma_ = true;
+    }
+
+    std::string& out() { return out_; }
+
+    /**
+     * 清空输出并重置分隔状态，复用同一缓冲写下一个文档。
+     */
+    void clear() {
+        out_.clear();
+        needs_comma_ = false;
+        after_key_   = false;
+    }
+
+private:
+    void sep() {
+        if (after_key_) {
+            after_key_ = false;
+            return;
+        }
+        if (needs_comma_) out_ += ',';
+    }
+
+    void append_escaped(std::string_view s) {
+        for (char c : s) {
+            auto u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                out_ += '\\';
+                out_ += c;
+            } else if (u < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                out_ += "\\u00";
+                out_ += hex[u >> 4];
+                out_ += hex[u & 0xF];
+            } else {
+                out_ += c;
+            }
+        }
+    }
+
+    void write_string(std::string_view s) {
+        out_ += '"';
+        append_escaped(s);
+        out_ += '"';
+    }
+
+    std::string& out_;
+    bool         needs_comma_ = false;
+    bool         after_key_   = false;
+};
+
+/**
+ * 把 Report 写为与后端约定一致的 JSON:
+ *   template_id / device_id / timestamp / results[] / has_anomaly / anomaly_summary[]
+ *
+ * 超大模板 (数万指标) 可用 write_chunked() 按消息大小上限分块写出，见其注释。
+ */
+class ReportSerializer {
+public:
+    /**
+     * 按最坏情况 (每字节都需 \u00XX 转义、上下限同时越界) 估算序列化长度上限，
+     * 用于在初始化时一次性预留输出缓冲。
+     */
+    static size_t max_size(const CompiledTemplate& tmpl, const std::string& device_id,
+                           size_t extension_bytes) {
+        size_t n = header_bound(tmpl, device_id) + trailer_bound(tmpl, extension_bytes);
+        for (const auto& m : tmpl.metrics) n += result_bound(m);
+        return n;
+    }
+
+    /**
+     * write_chunked() 单块长度的上限：首部 + 块预算 + 最长的单个结果或异常摘要 + 扩展字段，
+     * 且不超过整份报告的 max_size()。
+     */
+    static size_t max_chunk_size(const CompiledTemplate& tmpl, const std::string& device_id,
+                                 size_t extension_bytes, size_t chunk_bytes) {
+        size_t whole = max_size(tmpl, device_id, extension_bytes);
+        if (chunk_bytes >= whole) return whole;
+        size_t largest = 0;
+        for (const auto& m : tmpl.metrics) largest = std::max({largest, result_bound(m), anomaly_bound(m)});
+        for (const auto& r : tmpl.rules)   largest = std::max(largest, rule_bound(r));
+        return std::min(whole, header_bound(tmpl, device_id) + kChunkFieldBytes + chunk_bytes + largest
+                                   + extension_bytes);
+    }
+
+    static void write(const Report& report, const std::string& device_id, std::string& out) {
+        out.clear();
+        JsonWriter w(out);
+        write_header(w, *report.tmpl, device_id, report.timestamp);
+        for (const auto& r : report.results) write_result(w, *report.tmpl, r, report.elements);
+        w.end_array();
+        begin_summary(w, report);
+        for (const auto& a : report.anomalies) write_anomaly(w, *report.tmpl, a);
+        w.end_array();
+        w.raw(report.extensions);
+        w.end_object();
+    }
+
+    /**
+     * 分块写出：results 与 anomaly_summary 按 chunk_bytes 切段，每块都是独立的 JSON 对象，
+     * 写满一块即交给 sink(const std::string&) -> Result<void> 发送，out 随即复用，
+     * 峰值内存约为 max_chunk_size() 而非整份报告。
+     *
+     * 整份报告加上 kChunkFieldBytes 的余量不超过 chunk_bytes 时只产生一块，与 write() 的输出
+     * 逐字节相同。否则每块末尾追加 "chunk": {"report_id": id, "seq": i, "last": bool}:
+     *   - 每块都带 template_id / device_id / timestamp 与 results 的一段 (可能为空)；
+     *   - 写完全部结果之后的块另带 has_anomaly 与 anomaly_summary 的一段；
+     *   - 只有最后一块 (last 为 true，seq = 块数 - 1) 带扩展字段 (如 sdk_overhead)；
+     *   - results、anomaly_summary 各自按 seq 拼接即完整数组；
+     *   - 块长连同封口 (收尾的 ]、has_anomaly、"chunk" 字段与 }，末块另加扩展字段) 不超过
+     *     chunk_bytes；只有单个结果 / 摘要 (不拆分) 或扩展字段本身放不下时例外。
+     * 订阅端的重组语义见 backend/app/mqtt_listener.py 的 ChunkAssembler。
+     *
+     * @param report_id  同一设备内唯一，订阅端以 (device_id, report_id) 归并各块
+     * @return sink 返回的第一个错误，此后的块不再写出
+     */
+    template <class Sink>
+    static Result<void> write_chunked(const Report& report, const std::string& device_id, uint64_t report_id,
+                                      size_t chunk_bytes, std::string& out, Sink&& sink) {
+        const CompiledTemplate& tmpl = *report.tmpl;
+        uint32_t seq      = 0;
+        size_t   in_chunk = 0;   // 当前块已写入的结果 / 摘要条数
+
+        JsonWriter w(out);
+        w.clear();
+        write_header(w, tmpl, device_id, report.timestamp);
+        for (const auto& r : report.results) {
+            size_t mark = out.size();
+            write_result(w, tmpl, r, report.elements);
+            if (out.size() + kChunkFieldBytes <= chunk_bytes || in_chunk == 0) {
+                ++in_chunk;
+                continue;
+            }
+            // 本结果写不下：回退，封口当前块并发送，在新块中重写
+            out.resize(mark);
+            if (auto sent = flush_chunk(w, report_id, seq++, sink); !sent) return sent;
+            write_header(w, tmpl, device_id, report.timestamp);
+            write_result(w, tmpl, r, report.elements);
+            in_chunk = 1;
+        }
+        w.end_array();
+        begin_summary(w, report);
+
+        for (const auto& a : report.anomalies) {
+            size_t mark = out.size();
+            write_anomaly(w, tmpl, a);
+            if (out.size() + kChunkFieldBytes <= chunk_bytes || in_chunk == 0) {
+                ++in_chunk;
+                continue;
+            }
+            out.resize(mark);
+            if (auto sent = flush_chunk(w, report_id, seq++, sink); !sent) return sent;
+            write_header(w, tmpl, device_id, report.timestamp);
+            w.end_array();
+            begin_summary(w, report);
+            write_anomaly(w, tmpl, a);
+            in_chunk = 1;
+        }
+        // 末块还要带扩展字段：放不下时当前块照常封口，扩展字段单独成块 (results、摘要均为空)
+        if (in_chunk > 0 && out.size() + kChunkFieldBytes + report.extensions.size() > chunk_bytes) {
+            if (auto sent = flush_chunk(w, report_id, seq++, sink); !sent) return sent;
+            write_header(w, tmpl, device_id, report.timestamp);
+            w.end_array();
+            begin_summary(w, report);
+        }
+        w.end_array();
+        w.raw(report.extensions);
+        if (seq > 0) write_chunk_field(w, report_id, seq, true);
+        w.end_object();
+        return sink(static_cast<const std::string&>(out));
+    }
+
+private:
+    static constexpr size_t kEscape          = 6;    // 单字节转义后的最大长度
+    static constexpr size_t kNumber          = 32;   // to_chars(double) 的缓冲长度
+    static constexpr size_t kChunkFieldBytes = 128;  // 块的封口：]、has_anomaly、空摘要数组、"chunk":{…} 与 }
+
+    static size_t header_bound(const CompiledTemplate& tmpl, const std::string& device_id) {
+        return 192 + kEscape * (tmpl.id.size() + device_id.size());
+    }
+
+    // has_anomaly、anomaly_summary (每个指标的最坏越界条数) 与扩展字段
+    static size_t trailer_bound(const CompiledTemplate& tmpl, size_t extension_bytes) {
+        size_t n = extension_bytes;
+        for (const auto& m : tmpl.metrics) {
+            n += 2 * (24 + kEscape * m.name.size());
+            if (m.kind == MetricKind::waveform) {
+                n += 2 * (32 + kEscape * m.name.size());
+                for (const auto& b : m.waveform.bands) n += 32 + kEscape * (m.name.size() + b.name.size());
+            } else if (m.kind == MetricKind::vector) {
+                size_t label = 0;
+                for (const auto& l : m.vector.labels) label = std::max(label, l.size());
+                n += m.vector.length * (32 + kEscape * (m.name.size() + label) + 12);
+            } else if (m.kind == MetricKind::histogram) {
+                n += m.histogram.quantiles.size() * (32 + kEscape * m.name.size() + kNumber);
+            }
+        }
+        for (const auto& r : tmpl.rules) n += rule_bound(r);
+        return n;
+    }
+
+    // 该指标单条异常摘要的最大长度
+    static size_t anomaly_bound(const MetricSpec& m) {
+        size_t n = 32 + kEscape * m.name.size() + kNumber;
+        for (const auto& b : m.waveform.bands) n = std::max(n, 32 + kEscape * (m.name.size() + b.name.size()));
+        for (const auto& l : m.vector.labels)  n = std::max(n, 44 + kEscape * (m.name.size() + l.size()));
+        return n;
+    }
+
+    // 规则触发的异常摘要 ("规则 <name> 触发")
+    static size_t rule_bound(const RuleSpec& r) { return 32 + kEscape * r.name.size(); }
+
+    // results 中单个指标对象
+    static size_t result_bound(const MetricSpec& m) {
+        size_t n = 80 + kEscape * (m.name.size() + m.unit.size()) + 3 * kNumber;
+        if (m.kind == MetricKind::waveform) {
+            n += 128 + 5 * kNumber;
+            for (const auto& b : m.waveform.bands) n += 64 + kEscape * b.name.size() + 4 * kNumber;
+        } else if (m.kind == MetricKind::vector) {
+            n += 16 + m.vector.length * (kNumber + 1);
+        } else if (m.kind == MetricKind::histogram) {
+            const auto& h = m.histogram;
+            n += 48 + (2 * h.bounds.size() + 1) * (kNumber + 1);
+            n += h.quantiles.size() * (16 + 2 * kNumber);
+        }
+        return n;
+    }
+
+    // {"template_id":…,"device_id":…,"timestamp":…,"results":[
+    static void write_header(JsonWriter& w, const CompiledTemplate& tmpl, const std::string& device_id,
+                             const char* timestamp) {
+        w.begin_object();
+        w.key("template_id");
+        if (tmpl.id_is_string) w.value(tmpl.id);
+        else                   w.raw(tmpl.id);
+        w.key("device_id");
+        w.value(device_id);
+        w.key("timestamp");
+        w.value(timestamp);
+        w.key("results");
+        w.begin_array();
+    }
+
+    static void write_result(JsonWriter& w, const CompiledTemplate& tmpl, const MetricResult& r,
+                             const std::vector<double>& elements) {
+        const MetricSpec& m = tmpl.metrics[r.metric];
+        w.begin_object();
+        w.key("name");  w.value(m.name);
+        w.key("unit");  w.value(m.unit);
+        w.key("value"); w.value(r.value);
+        if (m.has_max) { w.key("threshold_max"); w.value(m.threshold_max); }
+        if (m.has_min) { w.key("threshold_min"); w.value(m.threshold_min); }
+        if (r.count > 0) {
+            const double* e = elements.data() + r.first;
+            if (m.kind == MetricKind::waveform)       write_features(w, m.waveform, e);
+            else if (m.kind == MetricKind::vector)    write_values(w, e, r.count);
+            else if (m.kind == MetricKind::histogram) write_histogram(w, m.histogram, e);
+        }
+        w.end_object();
+    }
+
+    // "has_anomaly":…,"anomaly_summary":[ (调用方已写完 results 的 ']')
+    static void begin_summary(JsonWriter& w, const Report& report) {
+        w.key("has_anomaly");
+        w.value(report.has_anomaly());
+        w.key("anomaly_summary");
+        w.begin_array();
+    }
+
+    static void write_anomaly(JsonWriter& w, const CompiledTemplate& tmpl, const Anomaly& a) {
+        const MetricSpec& m = tmpl.metrics[a.metric];
+        switch (a.kind) {
+            case AnomalyKind::above_max:       w.value_concat({m.name, " 超标"}); break;
+            case AnomalyKind::below_min:       w.value_concat({m.name, " 低于下限"}); break;
+            case AnomalyKind::peak_above_max:  w.value_concat({m.name, " 峰值超标"}); break;
+            case AnomalyKind::crest_above_max: w.value_concat({m.name, " 峰值因数超标"}); break;
+            case AnomalyKind::band_above_max:
+                w.value_concat({m.name, "[", m.waveform.bands[a.element].name, "] 频带能量超标"});
+                break;
+            case AnomalyKind::element_above_max:
+            case AnomalyKind::element_below_min: {
+                const char* what = a.kind == AnomalyKind::element_above_max ? "] 超标" : "] 低于下限";
+                if (!m.vector.labels.empty()) {
+                    w.value_concat({m.name, "[", m.vector.labels[a.element], what});
+                } else {
+                    char buf[12];
+                    auto r = std::to_chars(buf, buf + sizeof(buf), a.element);
+                    w.value_concat({m.name, "[", std::string_view(buf, static_cast<size_t>(r.ptr - buf)), what});
+                }
+                break;
+            }
+            case AnomalyKind::quantile_above_max: {
+                char buf[32];
+                w.value_concat({m.name, " ", quantile_name(m.histogram.quantiles[a.element].q, buf), " 超标"});
+                break;
+            }
+            case AnomalyKind::rule_fired:
+                w.value_concat({"规则 ", tmpl.rules[a.element].name, " 触发"});
+                break;
+        }
+    }
+
+    static void write_chunk_field(JsonWriter& w, uint64_t report_id, uint32_t seq, bool last) {
+        w.key("chunk");
+        w.begin_object();
+        w.key("report_id"); w.value(static_cast<int64_t>(report_id & 0x7FFFFFFFFFFFFFFFULL));
+        w.key("seq");       w.value(static_cast<int64_t>(seq));
+        w.key("last");      w.value(last);
+        w.end_object();
+    }
+
+    // 封口当前块 (非最后一块，收起正在写的 results 或 anomaly_summary)、交给 sink，并清空缓冲
+    template <class Sink>
+    static Result<void> flush_chunk(JsonWriter& w, uint64_t report_id, uint32_t seq, Sink& sink) {
+        w.end_array();
+        write_chunk_field(w, report_id, seq, false);
+        w.end_object();
+        Result<void> sent = sink(static_cast<const std::string&>(w.out()));
+        w.clear();
+        return sent;
+    }
+
+    // "features": {peak, crest_factor, sample_rate_hz, bands: [{name, low_hz, high_hz, energy, threshold_max}]}
+    static void write_features(JsonWriter& w, const WaveformSpec& spec, const double* e) {
+        w.key("features");
+        w.begin_object();
+        w.key("peak");           w.value(e[waveform_slot::peak]);
+        if (spec.has_peak_max)  { w.key("peak_max");         w.value(spec.peak_max); }
+        w.key("crest_factor");   w.value(e[waveform_slot::crest]);
+        if (spec.has_crest_max) { w.key("crest_factor_max"); w.value(spec.crest_max); }
+        w.key("sample_rate_hz"); w.value(static_cast<int64_t>(spec.sample_rate_hz));
+        w.key("bands");
+        w.begin_array();
+        for (size_t b = 0; b < spec.bands.size(); ++b) {
+            const BandSpec& band = spec.bands[b];
+            w.begin_object();
+            w.key("name");    w.value(band.name);
+            w.key("low_hz");  w.value(band.low_hz);
+            w.key("high_hz"); w.value(band.high_hz);
+            w.key("energy");  w.value(e[waveform_slot::bands + b]);
+            if (band.has_max) { w.key("threshold_max"); w.value(band.threshold_max); }
+            w.end_object();
+        }
+        w.end_array();
+        w.end_object();
+    }
+
+    // "values": [v_0, v_1, ...]
+    static void write_values(JsonWriter& w, const double* e, uint32_t n) {
+        w.key("values");
+        w.begin_array();
+        for (uint32_t i = 0; i < n; ++i) w.value(e[i]);
+        w.end_array();
+    }
+
+    // "bounds": [...], "counts": [...], "quantiles": {"p50": x, "p99": y, ...}
+    static void write_histogram(JsonWriter& w, const HistogramSpec& spec, const double* e) {
+        w.key("bounds");
+        w.begin_array();
+        for (double b : spec.bounds) w.value(b);
+        w.end_array();
+        w.key("counts");
+        w.begin_array();
+        for (uint32_t i = 0; i < histogram_slot::quantiles(spec); ++i) w.value(static_cast<int64_t>(e[i]));
+        w.end_array();
+        if (spec.quantiles.empty()) return;
+        const double* q = e + histogram_slot::quantiles(spec);
+        w.key("quantiles");
+        w.begin_object();
+        for (size_t i = 0; i < spec.quantiles.size(); ++i) {
+            char buf[32];
+            w.key(quantile_name(spec.quantiles[i].q, buf));
+            w.value(q[i]);
+        }
+        w.end_object();
+    }
+
+    // 0.99 -> "p99"，0.999 -> "p99.9"
+    static std::string_view quantile_name(double q, char (&buf)[32]) {
+        buf[0] = 'p';
+        double pct = std::round(q * 1e6) / 1e4;
+        auto r = std::to_chars(buf + 1, buf + sizeof(buf), pct);
+        return std::string_view(buf, static_cast<size_t>(r.ptr - buf));
+    }
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_REPORT_HPP
@@ -0,0 +1,132 @@
+/*
+ * EdgeStelle — C++ Device SDK: 无异常错误返回
+ *
+ * 稳态路径 (拉取 / 测试 / 发布) 的所有失败都以 Result<T> 返回，
+ * 不经过异常展开，网络抖动时延迟可预测。
+ *
+ * 以 -fno-exceptions 编译时 (或显式定义 EDGESTELLE_NO_EXCEPTIONS)，
+ * SDK 只提供 try_* 接口，抛异常的便捷包装随之移除。
+ */
+
+#ifndef EDGESTELLE_RESULT_HPP
+#define EDGESTELLE_RESULT_HPP
+
+#include <optional>
+#include <string>
+#include <utility>
+
+#if !defined(EDGESTELLE_NO_EXCEPTIONS) && !defined(__cpp_exceptions)
+#define EDGESTELLE_NO_EXCEPTIONS 1
+#endif
+
+#ifndef EDGESTELLE_NO_EXCEPTIONS
+#include <stdexcept>
+#endif
+
+namespace edgestelle {
+
+enum class Errc {
+    ok = 0,
+    http_init,          // curl 句柄创建失败
+    http_transport,     // 连接 / 超时 / TLS 等传输错误
+    http_status,        // 非 2xx 响应
+    template_parse,     // 模板不是合法 JSON
+    template_invalid,   // 模板缺少必要字段或类型不符
+    mqtt_connect,
+    mqtt_publish,
+    mqtt_disconnect,
+    sim_config,         // 模拟器参数非法 (如相关矩阵非正定)
+    exporter_bind,      // 指标端点监听失败
+    storage_io,         // 本地 mmap 文件 (飞行记录器等) 打开或映射失败
+    cluster,            // 分布式压测：协调端 / worker 的连接或协议错误
+    realtime,           // 实时调度设置失败 (SCHED_FIFO / 绑核 / mlockall)
+};
+
+inline const char* errc_name(Errc c) {
+    switch (c) {
+        case Errc::ok:               return "ok";
+        case Errc::http_init:        return "http_init";
+        case Errc::http_transport:   return "http_transport";
+        case Errc::http_status:      return "http_status";
+        case Errc::template_parse:   return "template_parse";
+        case Errc::template_invalid: return "template_invalid";
+        case Errc::mqtt_connect:     return "mqtt_connect";
+        case Errc::mqtt_publish:     return "mqtt_publish";
+        case Errc::mqtt_disconnect:  return "mqtt_disconnect";
+        case Errc::sim_config:       return "sim_config";
+        case Errc::exporter_bind:    return "exporter_bind";
+        case Errc::storage_io:       return "storage_io";
+        case Errc::cluster:          return "cluster";
+        case Errc::realtime:         return "realtime";
+    }
+    return "unknown";
+}
+
+struct Error {
+    Errc        code = Errc::ok;
+    std::string message;
+
+    std::string to_string() const { return std::string(errc_name(code)) + ": " + message; }
+};
+
+/**
+ * expected 风格的返回值：要么是 T，要么是 Error。
+ * 未检查 ok() 就调用 value() 属于调用方错误。
+ */
+template <class T>
+class Result {
+public:
+    Result(T value) : value_(std::move(value)) {}
+    Result(Error err) : error_(std::move(err)) {}
+
+    bool ok() const { return value_.has_value(); }
+    explicit operator bool() const { return ok(); }
+
+    T&        value() &      { return *value_; }
+    const T&  value() const& { return *value_; }
+    T&&       value() &&     { return std::move(*value_); }
+
+    const Error& error() const { return error_; }
+
+private:
+    std::optional<T> value_;
+    Error            error_;
+};
+
+template <>
+class Result<void> {
+public:
+    Result() = default;
+    Result(Error err) : error_(std::move(err)) {}
+
+    bool ok() const { return error_.code == Errc::ok; }
+    explicit operator bool() const { return ok(); }
+
+    const Error& error() const { return error_; }
+
+private:
+    Error error_;
+};
+
+#ifndef EDGESTELLE_NO_EXCEPTIONS
+namespace detail {
+
+/**
+ * 供抛异常的便捷接口使用：失败时转换为 std::runtime_error。
+ */
+template <class T>
+T value_or_throw(Result<T>&& r) {
+    if (!r.ok()) throw std::runtime_error(r.error().to_string());
+    return std::move(r).value();
+}
+
+inline void value_or_throw(Result<void>&& r) {
+    if (!r.ok()) throw std::runtime_error(r.error().to_string());
+}
+
+} // namespace detail
+#endif
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_RESULT_HPP
@@ -0,0 +1,257 @@
+/*
+ * EdgeStelle — C++ Device SDK: 故障注入场景
+ *
+ * 在舰队模拟 (edgestelle_fleet.hpp) 的采样结果上按时间叠加故障，
+ * 用于压测下游异常链路 (has_anomaly 报告 → 入库 → AI 分析)。场景文件为 JSON:
+ *
+ *   {"seed": 7, "faults": [
+ *     {"kind": "breach",      "metric": "cpu_temperature", "start_s": 60,  "duration_s": 300,
+ *      "fleet_pct": 20, "magnitude": 0.1},
+ *     {"kind": "drift",       "metric": "memory_usage",    "start_s": 0,   "duration_s": 600,
+ *      "fleet_pct": 5,  "magnitude": 40},
+ *     {"kind": "stuck",       "metric": "disk_usage",      "start_s": 120, "duration_s": 60,
+ *      "fleet_pct": 10},
+ *     {"kind": "packet_loss",                              "start_s": 300, "duration_s": 30,
+ *      "fleet_pct": 50, "magnitude": 25}
+ *   ]}
+ *
+ * 故障语义:
+ *   breach       指标取 threshold_max × (1 + magnitude)，模板未定义上限的指标不受影响
+ *   drift        指标叠加线性漂移，在 duration_s 内从 0 爬升到 magnitude
+ *   stuck        指标冻结在故障开始时的数值
+ *   packet_loss  packet_loss_rate 指标 (如有) 取 magnitude%，且按同样概率丢弃整份报告
+ *
+ * 受影响设备按 (seed, 故障序号, 设备序号) 哈希确定性选取，同一场景多次运行结果一致。
+ */
+
+#ifndef EDGESTELLE_SCENARIO_HPP
+#define EDGESTELLE_SCENARIO_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "edgestelle_report.hpp"
+#include "edgestelle_result.hpp"
+#include "edgestelle_sim.hpp"
+
+namespace edgestelle {
+
+enum class FaultKind : uint8_t { breach, drift, stuck, packet_loss };
+
+struct Fault {
+    FaultKind   kind       = FaultKind::breach;
+    std::string metric;              // packet_loss 可省略
+    double      start_s    = 0.0;
+    double      duration_s = 0.0;
+    double      fleet_pct  = 100.0;  // 受影响设备占比 (%)
+    double      magnitude  = 0.0;
+};
+
+struct Scenario {
+    uint64_t           seed = 1;
+    std::vector<Fault> faults;
+};
+
+/**
+ * 解析场景 JSON。字段类型不符 (如 "start_s": "60") 时返回 Errc::sim_config。
+ */
+inline Result<Scenario> parse_scenario(std::string_view text) {
+    nlohmann::json doc = nlohmann::json::parse(text.begin(), text.end(), nullptr, false);
+    if (doc.is_discarded() || !doc.is_object()) {
+        return Error{Errc::sim_config, "场景不是合法的 JSON 对象"};
+    }
+
+    Scenario sc;
+    if (doc.contains("seed")) {
+        if (!doc["seed"].is_number_unsigned()) return Error{Errc::sim_config, "seed 须为非负整数"};
+        sc.seed = doc["seed"].get<uint64_t>();
+    }
+    if (!doc.contains("faults") || !doc["faults"].is_array()) {
+        return Error{Errc::sim_config, "场景缺少 faults 数组"};
+    }
+
+    // 可选字段：缺省取 def；存在但类型不符时返回 false (value() 会抛 type_error)
+    auto text_field = [](const nlohmann::json& f, const char* key, std::string& out) {
+        auto it = f.find(key);
+        if (it == f.end()) return true;
+        if (!it->is_string()) return false;
+        out = it->get<std::string>();
+        return true;
+    };
+    auto number_field = [](const nlohmann::json& f, const char* key, double def, double& out) {
+        auto it = f.find(key);
+        out = def;
+        if (it == f.end()) return true;
+        if (!it->is_number()) return false;
+        out = it->get<double>();
+        return std::isfinite(out);
+    };
+
+    for (const auto& f : doc["faults"]) {
+        if (!f.is_object()) return Error{Errc::sim_config, "faults 元素须为对象"};
+        Fault fault;
+        std::string kind;
+        if (!text_field(f, "kind", kind)) return Error{Errc::sim_config, "故障 kind 须为字符串"};
+        if      (kind == "breach")      fault.kind = FaultKind::breach;
+        else if (kind == "drift")       fault.kind = FaultKind::drift;
+        else if (kind == "stuck")       fault.kind = FaultKind::stuck;
+        else if (kind == "packet_loss") fault.kind = FaultKind::packet_loss;
+        else return Error{Errc::sim_config, "未知故障类型: " + kind};
+
+        if (!text_field(f, "metric", fault.metric)) {
+            return Error{Errc::sim_config, "故障 " + kind + " 的 metric 须为字符串"};
+        }
+        const struct { const char* key; double def; double& out; } numbers[] = {
+            {"start_s",    0.0,   fault.start_s},
+            {"duration_s", 0.0,   fault.duration_s},
+            {"fleet_pct",  100.0, fault.fleet_pct},
+            {"magnitude",  fault.kind == FaultKind::breach ? 0.1 : 0.0, fault.magnitude},
+        };
+        for (const auto& n : numbers) {
+            if (!number_field(f, n.key, n.def, n.out)) {
+                return Error{Errc::sim_config, "故障 " + kind + " 的 " + n.key + " 须为有限数值"};
+            }
+        }
+
+        if (fault.metric.empty() && fault.kind != FaultKind::packet_loss) {
+            return Error{Errc::sim_config, "故障 " + kind + " 需要 metric"};
+        }
+        if (fault.duration_s <= 0.0 || fault.fleet_pct < 0.0 || fault.fleet_pct > 100.0) {
+            return Error{Errc::sim_config, "故障 " + kind + " 的 duration_s / fleet_pct 非法"};
+        }
+        sc.faults.push_back(std::move(fault));
+    }
+    return sc;
+}
+
+/**
+ * 把场景绑定到模板与舰队规模后逐报告施加。设备以全局序号标识；只负责
+ * [first_device, first_device + devices) 一段时 (舰队的核分区) 按段分配状态。
+ */
+class ScenarioEngine {
+public:
+    ScenarioEngine(Scenario scenario, const CompiledTemplate& tmpl, size_t devices, size_t first_device = 0)
+        : scenario_(std::move(scenario)), first_(first_device) {
+        seed_ = static_cast<uint32_t>(scenario_.seed ^ (scenario_.seed >> 32));
+        loss_metric_ = find_metric(tmpl, "packet_loss_rate");
+        for (const auto& f : scenario_.faults) {
+            Bound b;
+            b.metric = f.metric.empty() ? kNone : find_metric(tmpl, f.metric);
+            if (b.metric != kNone && f.kind == FaultKind::breach) {
+                const MetricSpec& m = tmpl.metrics[b.metric];
+                if (m.has_max) b.breach_value = m.threshold_max * (1.0 + f.magnitude);
+                else           b.metric = kNone;   // 无上限可越
+            }
+            if (f.kind == FaultKind::stuck) {
+                b.frozen.assign(devices, std::numeric_limits<double>::quiet_NaN());
+            }
+            bound_.push_back(std::move(b));
+        }
+    }
+
+    const Scenario& scenario() const { return scenario_; }
+
+    /**
+     * 对设备 device 在时刻 t_s (自模拟开始的秒数) 的结果施加当前生效的故障。
+     *
+     * @return false 表示该报告因 packet_loss 被丢弃
+     */
+    bool apply(double t_s, uint64_t tick, size_t device, std::vector<MetricResult>& results) {
+        bool deliver = true;
+        for (size_t k = 0; k < bound_.size(); ++k) {
+            const Fault& f = scenario_.faults[k];
+            Bound&       b = bound_[k];
+            bool active = t_s >= f.start_s && t_s < f.start_s + f.duration_s && selected(k, device, f);
+            if (!active) {
+                if (!b.frozen.empty()) b.frozen[device - first_] = std::numeric_limits<double>::quiet_NaN();
+                continue;
+            }
+
+            if (f.kind == FaultKind::packet_loss) {
+                if (MetricResult* r = find_result(results, loss_metric_)) r->value = f.magnitude;
+                if (unit(detail::mix32(seed_ ^ detail::mix32(static_cast<uint32_t>(tick) * 0x9E3779B9U
+                                                             + static_cast<uint32_t>(device))))
+                    < f.magnitude / 100.0) {
+                    deliver = false;
+                }
+                continue;
+            }
+
+            MetricResult* r = find_result(results, b.metric);
+            if (!r) continue;
+            switch (f.kind) {
+                case FaultKind::breach:
+                    r->value = b.breach_value;
+                    break;
+                case FaultKind::drift:
+                    r->value += f.magnitude * std::min(1.0, (t_s - f.start_s) / f.duration_s);
+                    break;
+                case FaultKind::stuck:
+                    if (std::isnan(b.frozen[device - first_])) b.frozen[device - first_] = r->value;
+                    r->value = b.frozen[device - first_];
+                    break;
+                case FaultKind::packet_loss:
+                    break;
+            }
+        }
+        return deliver;
+    }
+
+    /**
+     * 时刻 t_s 正在生效的故障数 (用于时间线输出)。
+     */
+    int active_faults(double t_s) const {
+        int n = 0;
+        for (const auto& f : scenario_.faults) {
+            if (t_s >= f.start_s && t_s < f.start_s + f.duration_s) ++n;
+        }
+        return n;
+    }
+
+private:
+    static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+    struct Bound {
+        uint32_t            metric       = kNone;
+        double              breach_value = 0.0;
+        std::vector<double> frozen;   // stuck: 各设备冻结值，NaN 表示未冻结
+    };
+
+    static uint32_t find_metric(const CompiledTemplate& tmpl, const std::string& name) {
+        for (uint32_t i = 0; i < tmpl.metrics.size(); ++i) {
+            if (tmpl.metrics[i].name == name) return i;
+        }
+        return kNone;
+    }
+
+    static MetricResult* find_result(std::vector<MetricResult>& results, uint32_t metric) {
+        if (metric == kNone) return nullptr;
+        for (auto& r : results) {
+            if (r.metric == metric) return &r;
+        }
+        return nullptr;
+    }
+
+    static double unit(uint32_t h) { return static_cast<double>(h) / 4294967296.0; }
+
+    bool selected(size_t k, size_t device, const Fault& f) const {
+        uint32_t h = detail::mix32(seed_ ^ detail::mix32(static_cast<uint32_t>(k) * 0x85EBCA6BU
+                                                         + static_cast<uint32_t>(device)));
+        return unit(h) < f.fleet_pct / 100.0;
+    }
+
+    Scenario           scenario_;
+    size_t             first_ = 0;
+    uint32_t           seed_ = 0;
+    uint32_t           loss_metric_ = kNone;
+    std::vector<Bound> bound_;
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_SCENARIO_HPP
@@ -0,0 +1,211 @@
+/*
+ * EdgeStelle — C++ Device SDK: 相关时间序列模拟
+ *
+ * 每个指标是一个平稳 AR(1) 过程
+ *
+ *   x_t = μ + φ (x_{t-1} − μ) + σ √(1 − φ²) z_t,   z_t = L ε_t,  L Lᵀ = R
+ *
+ * 相邻报告的数值连续变化，不同指标的扰动按相关矩阵 R 联动 (如 cpu_usage 与
+ * cpu_temperature)。状态按 [指标][设备] 的 SoA 布局存放，一次 step() 推进 lanes
+ * 台设备，内层循环沿设备维连续、无分支，由编译器向量化 (-O3，可配合 -march=native)。
+ *
+ * 扰动 ε 由无状态的 32 位计数器哈希生成 (同一 seed 结果可复现)，
+ * 以 12 个均匀分布求和近似标准正态，尾部截断在 ±6σ。
+ */
+
+#ifndef EDGESTELLE_SIM_HPP
+#define EDGESTELLE_SIM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+
+/**
+ * 单个指标的动态参数。mean / stddev 为平稳分布的均值与标准差，
+ * phi 为一阶自相关系数 (0 = 独立采样，越接近 1 变化越平缓)。
+ */
+struct MetricDynamics {
+    double mean    = 50.0;
+    double stddev  = 15.0;
+    double min_val = 0.0;
+    double max_val = 100.0;
+    double phi     = 0.9;
+};
+
+namespace detail {
+
+inline uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * 对称正定矩阵 (n×n 行主序) 的 Cholesky 分解，结果为下三角 L。
+ */
+inline bool cholesky(const std::vector<double>& a, size_t n, std::vector<double>& l) {
+    l.assign(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            double sum = a[i * n + j];
+            for (size_t k = 0; k < j; ++k) sum -= l[i * n + k] * l[j * n + k];
+            if (i == j) {
+                if (sum <= 0.0) return false;
+                l[i * n + i] = std::sqrt(sum);
+            } else {
+                l[i * n + j] = sum / l[j * n + j];
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace detail
+
+class CorrelatedSimulator {
+public:
+    /**
+     * @param metrics      各指标参数
+     * @param correlation  n×n 行主序相关矩阵；为空表示各指标独立
+     * @param lanes        同时推进的设备数
+     * @param seed         随机种子
+     * @param first_lane   第一个 lane 的全局序号：扰动按全局序号生成，把设备切成几段
+     *                     分别模拟 (如舰队的核分区) 时结果与整体模拟逐位相同
+     */
+    static Result<CorrelatedSimulator> create(std::vector<MetricDynamics> metrics,
+                                              const std::vector<double>& correlation,
+                                              size_t lanes, uint64_t seed, size_t first_lane = 0) {
+        size_t n = metrics.size();
+        if (lanes == 0) return Error{Errc::sim_config, "lanes 必须大于 0"};
+
+        std::vector<double> r = correlation;
+        if (r.empty()) {
+            r.assign(n * n, 0.0);
+            for (size_t i = 0; i < n; ++i) r[i * n + i] = 1.0;
+        }
+        if (r.size() != n * n) return Error{Errc::sim_config, "相关矩阵尺寸与指标数不符"};
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                if (std::fabs(r[i * n + j] - r[j * n + i]) > 1e-9) {
+                    return Error{Errc::sim_config, "相关矩阵不对称"};
+                }
+            }
+        }
+        for (const auto& m : metrics) {
+            if (!(m.phi >= 0.0 && m.phi < 1.0)) return Error{Errc::sim_config, "phi 须在 [0, 1) 内"};
+        }
+
+        std::vector<double> l;
+        if (!detail::cholesky(r, n, l)) return Error{Errc::sim_config, "相关矩阵非正定"};
+        return CorrelatedSimulator(std::move(metrics), l, lanes, seed, first_lane);
+    }
+
+    /**
+     * 所有设备的所有指标推进一个采样周期。不申请堆内存。
+     */
+    void step() { advance(false); }
+
+    size_t metrics() const { return n_; }
+    size_t lanes()   const { return lanes_; }
+
+    /**
+     * 指标 metric 在设备 lane 上的当前值 (已按 min / max 截断)。
+     */
+    double value(size_t metric, size_t lane) const {
+        const auto& m = params_[metric];
+        double v = state_[metric * lanes_ + lane];
+        return std::max(m.min_val, std::min(m.max_val, v));
+    }
+
+    /**
+     * 指标 metric 在所有设备上的原始状态 (未截断，lanes() 个连续 float)。
+     */
+    const float* row(size_t metric) const { return state_.data() + metric * lanes_; }
+
+private:
+    CorrelatedSimulator(std::vector<MetricDynamics> metrics, const std::vector<double>& l,
+                        size_t lanes, uint64_t seed, size_t first_lane)
+        : n_(metrics.size()), lanes_(lanes), params_(std::move(metrics)),
+          seed_(static_cast<uint32_t>(seed ^ (seed >> 32))), first_(static_cast<uint32_t>(first_lane)) {
+        chol_.resize(n_ * n_);
+        for (size_t i = 0; i < n_ * n_; ++i) chol_[i] = static_cast<float>(l[i]);
+        state_.assign(n_ * lanes_, 0.0f);
+        eps_.resize(n_ * lanes_);
+        z_.resize(lanes_);
+        lane_keys_.resize(6 * lanes_);
+        for (size_t i = 0; i < lane_keys_.size(); ++i) {
+            lane_keys_[i] = detail::mix32(first_ * 6U + static_cast<uint32_t>(i));
+        }
+        advance(true);   // 从平稳分布取初值，避免开头一段从均值爬升
+    }
+
+    void advance(bool initial) {
+        const size_t lanes = lanes_;
+
+        // 1) 独立标准正态扰动 ε[j][d]。(指标, 周期) 与 (设备, 分量) 各自散列后再混合：
+        //    若直接以 key + 6d + k 为计数器，不同 (指标, 周期) 的随机 key 会让各设备的计数
+        //    窗口互相重叠，不同设备 / 周期取到相同的 ε
+        for (size_t j = 0; j < n_; ++j) {
+            uint32_t key = detail::mix32(seed_ ^ detail::mix32(
+                static_cast<uint32_t>(tick_) * 0x9E3779B9U + static_cast<uint32_t>(j)));
+            float* __restrict eps = eps_.data() + j * lanes;
+            const uint32_t* __restrict lk = lane_keys_.data();
+            for (size_t d = 0; d < lanes; ++d) {
+                uint32_t s = 0;
+                for (uint32_t k = 0; k < 6; ++k) {
+                    uint32_t h = detail::mix32(key ^ lk[d * 6 + k]);
+                    s += (h & 0xFFFFU) + (h >> 16);
+                }
+                eps[d] = static_cast<float>(s) * (1.0f / 65536.0f) - 6.0f;
+            }
+        }
+
+        // 2) z = L ε，逐指标更新 AR(1) 状态
+        for (size_t i = 0; i < n_; ++i) {
+            const auto& m = params_[i];
+            float mu = static_cast<float>(m.mean);
+            float a  = initial ? 0.0f : static_cast<float>(m.phi);
+            float b  = static_cast<float>(initial ? m.stddev
+                                                  : m.stddev * std::sqrt(1.0 - m.phi * m.phi));
+
+            float* __restrict z = z_.data();
+            std::fill(z, z + lanes, 0.0f);
+            for (size_t j = 0; j <= i; ++j) {
+                float lij = chol_[i * n_ + j];
+                if (lij == 0.0f) continue;
+                const float* __restrict eps = eps_.data() + j * lanes;
+                for (size_t d = 0; d < lanes; ++d) z[d] += lij * eps[d];
+            }
+
+            float* __restrict x = state_.data() + i * lanes;
+            for (size_t d = 0; d < lanes; ++d) x[d] = mu + a * (x[d] - mu) + b * z[d];
+        }
+        ++tick_;
+    }
+
+    size_t                      n_;
+    size_t                      lanes_;
+    std::vector<MetricDynamics> params_;
+    std::vector<float>          chol_;    // 下三角 L，n×n
+    std::vector<float>          state_;   // [指标][设备]
+    std::vector<float>          eps_;     // 本周期扰动，[指标][设备]
+    std::vector<float>          z_;
+    std::vector<uint32_t>       lane_keys_;   // [设备][6]，按全局序号散列的 (设备, 分量)
+    uint32_t                    seed_;
+    uint32_t                    first_;   // 第一个 lane 的全局序号
+    uint64_t                    tick_ = 0;
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_SIM_HPP
@@ -0,0 +1,270 @@
+/*
+ * EdgeStelle — C++ Device SDK: Chrome / Perfetto 轨迹导出
+ *
+ * 每个线程持有一个固定容量的环形事件缓冲，只有该线程写入 (无锁)；
+ * 导出时把所有线程的缓冲合并为 Chrome trace JSON，可直接在
+ * chrome://tracing 或 ui.perfetto.dev 中打开。
+ *
+ * 关闭时热路径只有一次 relaxed 原子读；开启时每个事件额外一次
+ * steady_clock 读取和一个 32 字节槽位的写入 (relaxed 原子存储，x86 上即普通写)，
+ * 可常开于预发布设备群。
+ *
+ * 定义 EDGESTELLE_NO_TRACE 可在编译期移除全部埋点。
+ */
+
+#ifndef EDGESTELLE_TRACE_HPP
+#define EDGESTELLE_TRACE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace edgestelle {
+namespace trace {
+
+struct Event {
+    const char* name;     // 必须是静态生命周期字符串
+    int64_t     ts_ns;
+    char        phase;    // 'B' / 'E' / 'i'
+};
+
+/**
+ * 单线程写入的环形缓冲。写满后覆盖最旧事件。
+ *
+ * 每个槽位带序号 (seqlock)：写第 n 个事件前置为 2n+1，写完置为 2n+2。字段均为
+ * relaxed 原子量，导出线程读取时不构成数据竞争；读前读后序号都等于 2n+2 才采用，
+ * 正在被改写或已被覆盖的槽位据此识别并丢弃。
+ */
+class ThreadBuffer {
+public:
+    static constexpr size_t kCapacity = 1 << 14;   // 必须为 2 的幂
+
+    ThreadBuffer(uint32_t tid, std::string thread_name)
+        : tid_(tid), name_(std::move(thread_name)), slots_(kCapacity) {}
+
+    void push(const char* name, char phase, int64_t ts_ns) {
+        uint64_t h = head_.load(std::memory_order_relaxed);
+        Slot& s = slots_[h & (kCapacity - 1)];
+        s.seq.store(2 * h + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.name.store(name, std::memory_order_relaxed);
+        s.ts_ns.store(ts_ns, std::memory_order_relaxed);
+        s.phase.store(phase, std::memory_order_relaxed);
+        s.seq.store(2 * h + 2, std::memory_order_release);
+        head_.store(h + 1, std::memory_order_release);
+    }
+
+    uint32_t           tid()  const { return tid_; }
+    const std::string& name() const { return name_; }
+
+    /**
+     * 拷贝出当前可见的事件 (至多最近 kCapacity 个，按写入顺序)。写入线程可同时继续
+     * 写入，拷贝期间被改写的槽位不计入结果。
+     */
+    std::vector<Event> snapshot() const {
+        uint64_t h     = head_.load(std::memory_order_acquire);
+        uint64_t count = h < kCapacity ? h : kCapacity;
+        std::vector<Event> out;
+        out.reserve(count);
+        for (uint64_t i = h - count; i < h; ++i) {
+            const Slot& s = slots_[i & (kCapacity - 1)];
+            uint64_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2) continue;
+            Event e{s.name.load(std::memory_order_relaxed), s.ts_ns.load(std::memory_order_relaxed),
+                    s.phase.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != seq) continue;
+            out.push_back(e);
+        }
+        return out;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t>    seq{0};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<int64_t>     ts_ns{0};
+        std::atomic<char>        phase{0};
+    };
+
+    uint32_t              tid_;
+    std::string           name_;
+    std::vector<Slot>     slots_;
+    std::atomic<uint64_t> head_{0};
+};
+
+class Tracer {
+public:
+    static Tracer& instance() {
+        static Tracer t;
+        return t;
+    }
+
+    void enable(const std::string& output_path) {
+        std::lock_guard<std::mutex> lock(mu_);
+        path_ = output_path;
+        epoch_ns_ = now_ns();
+        enabled_.store(true, std::memory_order_release);
+    }
+
+    void disable() { enabled_.store(false, std::memory_order_release); }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * 为当前线程命名 (显示在 Perfetto 的线程轨道上)，需在该线程首个事件之前调用。
+     */
+    void set_thread_name(const char* name) { local(name); }
+
+    void record(const char* name, char phase) {
+        if (!enabled()) return;
+        local(nullptr)->push(name, phase, now_ns());
+    }
+
+    /**
+     * 安装信号处理：收到 sig 后在下一次 poll() 时导出。
+     * 信号处理函数中只置位标志，文件写入不在信号上下文中进行。
+     */
+    void install_signal_handler(int sig = SIGUSR2) {
+        std::signal(sig, [](int) { instance().dump_requested_.store(true, std::memory_order_relaxed); });
+    }
+
+    /**
+     * 若有挂起的导出请求则写出轨迹文件，由运行循环周期性调用。
+     */
+    void poll() {
+        if (dump_requested_.exchange(false, std::memory_order_relaxed)) write();
+    }
+
+    /**
+     * 立即把所有线程的事件写为 Chrome trace JSON。
+     */
+    bool write() {
+        std::string path;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            path    = path_;
+            buffers = buffers_;
+        }
+        if (path.empty()) return false;
+
+        std::string tmp = path + ".tmp";
+        FILE* f = std::fopen(tmp.c_str(), "w");
+        if (!f) return false;
+
+        long pid = static_cast<long>(getpid());
+        std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        for (const auto& buf : buffers) {
+            std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%u,"
+                            "\"args\":{\"name\":",
+                         first ? "" : ",\n", pid, buf->tid());
+            write_string(f, buf->name().c_str());
+            std::fprintf(f, "}}");
+            first = false;
+            for (const auto& e : buf->snapshot()) {
+                double ts_us = static_cast<double>(e.ts_ns - epoch_ns_) / 1000.0;
+                std::fprintf(f, ",\n{\"name\":");
+                write_string(f, e.name);
+                std::fprintf(f, ",\"cat\":\"sdk\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%ld,\"tid\":%u%s}",
+                             e.phase, ts_us, pid, buf->tid(), e.phase == 'i' ? ",\"s\":\"t\"" : "");
+            }
+        }
+        std::fprintf(f, "\n]}\n");
+        bool ok = std::fclose(f) == 0;
+        return ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+private:
+    Tracer() = default;
+
+    /**
+     * 以 JSON 字符串写出 s (引号、反斜杠与控制字符转义)。
+     */
+    static void write_string(FILE* f, const char* s) {
+        std::fputc('"', f);
+        for (; *s; ++s) {
+            auto u = static_cast<unsigned char>(*s);
+            if (*s == '"' || *s == '\\') {
+                std::fputc('\\', f);
+                std::fputc(*s, f);
+            } else if (u < 0x20) {
+                std::fprintf(f, "\\u%04x", u);
+            } else {
+                std::fputc(*s, f);
+            }
+        }
+        std::fputc('"', f);
+    }
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    ThreadBuffer* local(const char* name) {
+        thread_local ThreadBuffer* buf = nullptr;
+        if (!buf) {
+            auto tid = static_cast<uint32_t>(syscall(SYS_gettid));
+            auto owned = std::make_shared<ThreadBuffer>(
+                tid, name ? std::string(name) : "thread-" + std::to_string(tid));
+            std::lock_guard<std::mutex> lock(mu_);
+            buffers_.push_back(owned);   // 线程退出后缓冲仍由 Tracer 持有
+            buf = owned.get();
+        }
+        return buf;
+    }
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<bool> dump_requested_{false};
+    int64_t           epoch_ns_ = 0;
+
+    std::mutex                                 mu_;
+    std::string                                path_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+};
+
+/**
+ * RAII 区间：构造时记录 'B'，析构时记录 'E'。
+ */
+class Scope {
+public:
+    explicit Scope(const char* name) : name_(name) { Tracer::instance().record(name_, 'B'); }
+    ~Scope() { Tracer::instance().record(name_, 'E'); }
+
+    Scope(const Scope&)            = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name_;
+};
+
+} // namespace trace
+} // namespace edgestelle
+
+#define EDGESTELLE_TRACE_CONCAT_(a, b) a##b
+#define EDGESTELLE_TRACE_CONCAT(a, b)  EDGESTELLE_TRACE_CONCAT_(a, b)
+
+#ifdef EDGESTELLE_NO_TRACE
+#define EDGESTELLE_TRACE_SCOPE(name)   ((void)0)
+#define EDGESTELLE_TRACE_INSTANT(name) ((void)0)
+#else
+#define EDGESTELLE_TRACE_SCOPE(name) \
+    ::edgestelle::trace::Scope EDGESTELLE_TRACE_CONCAT(edgestelle_trace_scope_, __LINE__)(name)
+#define EDGESTELLE_TRACE_INSTANT(name) \
+    ::edgestelle::trace::Tracer::instance().record(name, 'i')
+#endif
+
+#endif // EDGESTELLE_TRACE_HPP
@@ -0,0 +1,903 @@
+/*
+ * EdgeStelle — C++ Device SDK: 本地时序库
+ *
+ * 设备端的列式时序存储，断网期间也能回答"过去一小时发生了什么"。每个指标的每个
+ * 粒度 (tier) 一条序列，序列由若干定长 mmap 段文件组成，只追加:
+ *
+ *   <dir>/<指标键>.<tier>.<序号>.seg      指标键 = 规整后的指标名 + 名称哈希
+ *                                          tier   = raw 或 <桶宽>ms
+ *
+ *   段文件 = SegmentHeader | 位流 (segment_bytes 字节)
+ *   原始点: 时间戳 (二阶差分) + 值，见 edgestelle_codec.hpp。值按段选编码：段内首个值
+ *           是十进制定点时整段按 value × scale 的二阶差分编码，遇到不符合的值即换新段；
+ *           否则按 XOR
+ *   rollup: 桶起点 + min / max / sum / count 四列 (各自 XOR)
+ *
+ * 原始点写入 tiers[0] (interval_ms = 0)，同时按各 rollup 粒度在内存中累积当前桶，
+ * 桶结束时写入对应序列。段写满即封存 (摘要写入段头) 并新建下一段；各序列按自身
+ * retention_ms 删除最新时间之前过期的整段，每条序列至少保留一段。
+ *
+ * 段头的 bit_pos 是唯一的提交点：位流先写、bit_pos 后写，进程在中途崩溃时重启后从
+ * 上一个完整的点续写。打开时扫描活动段重建编码状态与摘要，并按原始点补齐各 rollup
+ * 未写出的桶。
+ *
+ * 查询 (半开区间 [from, to)，毫秒):
+ *   range()       原始点
+ *   aggregate()   count / min / max / sum；完全落在区间内的封存段直接取段头摘要，
+ *                 超出原始点保留期的部分依次改用更粗的 rollup (按桶边界对齐)
+ *   downsample()  按 step 分桶，取 interval 不大于 step 且覆盖起点的最细 tier
+ *   query()       以上三者的 URL 参数 / JSON 形式，供指标端点的 GET /query 使用
+ *
+ * 非线程安全：EdgeStelleDevice 以互斥锁串行化采样线程的写入与端点线程的查询。
+ * 实时调度下采样线程不持该锁，点经 StoreFeed 交给默认调度的写入线程。
+ * 稳态追加不申请堆内存；段轮转 (每 segment_bytes) 时创建新文件。
+ */
+
+#ifndef EDGESTELLE_TSDB_HPP
+#define EDGESTELLE_TSDB_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "edgestelle_clock.hpp"
+#include "edgestelle_codec.hpp"
+#include "edgestelle_config.hpp"
+#include "edgestelle_log.hpp"
+#include "edgestelle_mmap.hpp"
+#include "edgestelle_report.hpp"
+#include "edgestelle_result.hpp"
+
+namespace edgestelle {
+
+struct Aggregate {
+    uint64_t count = 0;
+    double   min   = std::numeric_limits<double>::infinity();
+    double   max   = -std::numeric_limits<double>::infinity();
+    double   sum   = 0.0;
+
+    void add(double v) {
+        ++count;
+        min = std::min(min, v);
+        max = std::max(max, v);
+        sum += v;
+    }
+
+    void merge(const Aggregate& o) {
+        count += o.count;
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+        sum += o.sum;
+    }
+
+    double mean() const {
+        return count ? sum / static_cast<double>(count) : std::numeric_limits<double>::quiet_NaN();
+    }
+};
+
+struct SeriesPoint {
+    int64_t t_ms;
+    double  value;
+};
+
+struct SeriesBucket {
+    int64_t   t_ms;   // 桶起点
+    Aggregate agg;
+};
+
+namespace detail {
+
+// ═════════════════════════════════════════════════════
+//  段
+// ═════════════════════════════════════════════════════
+
+struct SegmentHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t columns;       // 1: 原始点；4: rollup 桶 (min, max, sum, count)
+    int64_t  interval_ms;
+    int64_t  scale;         // 原始点的十进制定点倍数，0 表示 XOR 编码
+    uint64_t capacity;      // 位流字节数
+    uint64_t bit_pos;       // 提交点
+    uint32_t sealed;
+    uint32_t reserved;
+    // 以下仅在 sealed 时有效
+    uint64_t points;
+    int64_t  min_t;
+    int64_t  max_t;
+    uint64_t count;
+    double   min;
+    double   max;
+    double   sum;
+};
+
+class Segment {
+public:
+    static constexpr char     kMagic[8]   = {'E', 'S', 'T', 'S', 'D', 'B', 'S', 'G'};
+    static constexpr uint32_t kVersion    = 1;
+    static constexpr uint32_t kMaxColumns = 4;
+
+    static Result<Segment> create(const std::string& path, int64_t interval_ms, int64_t scale, size_t capacity) {
+        bool existed = false;
+        auto region = MappedRegion::map(path, sizeof(SegmentHeader) + capacity, existed);
+        if (!region) return region.error();
+        Segment seg;
+        seg.region_ = std::move(region).value();
+        seg.path_   = path;
+        SegmentHeader& h = seg.header();
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, kMagic, sizeof(h.magic));
+        h.version     = kVersion;
+        h.columns     = interval_ms > 0 ? 4 : 1;
+        h.interval_ms = interval_ms;
+        h.scale       = interval_ms > 0 ? 0 : scale;
+        h.capacity    = capacity;
+        return seg;
+    }
+
+    /**
+     * 打开已有的段：封存段直接采用段头摘要，活动段扫描位流重建编码状态与摘要。
+     */
+    static Result<Segment> load(const std::string& path) {
+        auto region = MappedRegion::map_existing(path);
+        if (!region) return region.error();
+        Segment seg;
+        seg.region_ = std::move(region).value();
+        seg.path_   = path;
+        if (seg.region_.size() < sizeof(SegmentHeader)) return invalid(path, "长度不足");
+        const SegmentHeader& h = seg.header();
+        if (std::memcmp(h.magic, kMagic, sizeof(h.magic)) != 0 || h.version != kVersion) {
+            return invalid(path, "格式不符");
+        }
+        if ((h.columns != 1 && h.columns != kMaxColumns) || (h.columns == 1) != (h.interval_ms == 0)
+            || h.scale < 0 || (h.scale > 0 && h.columns != 1)
+            || seg.region_.size() != sizeof(SegmentHeader) + h.capacity || h.bit_pos > h.capacity * 8) {
+            return invalid(path, "段头损坏");
+        }
+
+        if (h.sealed) {
+            seg.points_ = h.points;
+            seg.min_t_  = h.min_t;
+            seg.max_t_  = h.max_t;
+            seg.summary_ = Aggregate{h.count, h.min, h.max, h.sum};
+            return seg;
+        }
+        // 清掉提交点之后的残位 (崩溃前写了一半的点)，续写时按位或入同一字节
+        if (h.bit_pos & 7) {
+            seg.data()[h.bit_pos >> 3] &= static_cast<uint8_t>(0xFF00u >> (h.bit_pos & 7));
+        }
+        bool ok = seg.scan([&](int64_t t, const double* cols) { seg.account(t, cols); },
+                           &seg.time_, &seg.fixed_, seg.values_);
+        if (!ok) return invalid(path, "位流损坏");
+        return seg;
+    }
+
+    Segment() = default;
+    Segment(Segment&&) noexcept            = default;
+    Segment& operator=(Segment&&) noexcept = default;
+
+    /**
+     * 追加一个点 (columns 个值)。段已满、已封存或值不符合本段的定点倍数时返回 false。
+     */
+    bool append(int64_t t, const double* cols) {
+        SegmentHeader& h = header();
+        uint64_t worst = codec::kMaxTimeBits + h.columns * codec::kMaxValueBits;
+        if (h.sealed || h.capacity * 8 - h.bit_pos < worst) return false;
+        if (h.scale > 0 && !codec::fits_scale(cols[0], h.scale)) return false;
+        codec::BitWriter w(data(), h.capacity, h.bit_pos);
+        codec::put_time(w, time_, t);
+        if (h.scale > 0) {
+            codec::put_time(w, fixed_, codec::to_fixed(cols[0], h.scale));
+        } else {
+            for (uint32_t c = 0; c < h.columns; ++c) codec::put_value(w, values_[c], cols[c]);
+        }
+        account(t, cols);
+        // 位流写完再推进提交点
+        std::atomic_signal_fence(std::memory_order_release);
+        h.bit_pos = w.bits();
+        return true;
+    }
+
+    /**
+     * 封存：写入摘要，之后只读。
+     */
+    void seal() {
+        SegmentHeader& h = header();
+        if (h.sealed) return;
+        h.points = points_;
+        h.min_t  = min_t_;
+        h.max_t  = max_t_;
+        h.count  = summary_.count;
+        h.min    = summary_.min;
+        h.max    = summary_.max;
+        h.sum    = summary_.sum;
+        std::atomic_signal_fence(std::memory_order_release);
+        h.sealed = 1;
+        region_.sync_async();
+    }
+
+    /**
+     * 依次解码各点：f(t, cols)。可选地输出解码结束时的编码状态 (用于续写)。
+     */
+    template <class F>
+    bool scan(F&& f, codec::DeltaState* time_out = nullptr, codec::DeltaState* fixed_out = nullptr,
+              codec::XorState* values_out = nullptr) const {
+        const SegmentHeader& h = header();
+        codec::BitReader   r(data(), h.capacity);
+        codec::DeltaState  ts, fs;
+        codec::XorState    vs[kMaxColumns];
+        double             cols[kMaxColumns];
+        auto               scale = static_cast<double>(h.scale);
+        while (r.bits() < h.bit_pos) {
+            int64_t t, x;
+            if (!codec::get_time(r, ts, t)) return false;
+            if (h.scale > 0) {
+                if (!codec::get_time(r, fs, x)) return false;
+                cols[0] = static_cast<double>(x) / scale;
+            } else {
+                for (uint32_t c = 0; c < h.columns; ++c) {
+                    if (!codec::get_value(r, vs[c], cols[c])) return false;
+                }
+            }
+            if (r.bits() > h.bit_pos) return false;
+            f(t, static_cast<const double*>(cols));
+        }
+        if (time_out) *time_out = ts;
+        if (fixed_out) *fixed_out = fs;
+        if (values_out) std::copy(vs, vs + kMaxColumns, values_out);
+        return true;
+    }
+
+    /**
+     * 解除映射并删除文件。
+     */
+    void remove() {
+        region_.reset();
+        ::unlink(path_.c_str());
+    }
+
+    void sync_async() const { region_.sync_async(); }
+
+    bool             empty()   const { return points_ == 0; }
+    bool             sealed()  const { return header().sealed != 0; }
+    uint64_t         points()  const { return points_; }
+    int64_t          min_t()   const { return min_t_; }
+    int64_t          max_t()   const { return max_t_; }
+    const Aggregate& summary() const { return summary_; }
+    size_t           bytes()   const { return static_cast<size_t>((header().bit_pos + 7) / 8); }
+
+private:
+    static Error invalid(const std::string& path, const char* why) {
+        return Error{Errc::storage_io, "段文件 " + path + " " + why};
+    }
+
+    SegmentHeader&       header()       { return *reinterpret_cast<SegmentHeader*>(region_.data()); }
+    const SegmentHeader& header() const { return *reinterpret_cast<const SegmentHeader*>(region_.data()); }
+    uint8_t*             data()   const { return region_.data() + sizeof(SegmentHeader); }
+
+    void account(int64_t t, const double* cols) {
+        min_t_ = points_ ? std::min(min_t_, t) : t;
+        max_t_ = points_ ? std::max(max_t_, t) : t;
+        ++points_;
+        if (header().columns == 1) {
+            summary_.add(cols[0]);
+        } else {
+            summary_.merge(Aggregate{static_cast<uint64_t>(cols[3]), cols[0], cols[1], cols[2]});
+        }
+    }
+
+    MappedRegion      region_;
+    std::string       path_;
+    codec::DeltaState time_;
+    codec::DeltaState fixed_;   // scale > 0 时的值
+    codec::XorState   values_[kMaxColumns];
+    uint64_t          points_ = 0;
+    int64_t           min_t_  = 0;
+    int64_t           max_t_  = 0;
+    Aggregate         summary_;
+};
+
+// ═════════════════════════════════════════════════════
+//  序列
+// ═════════════════════════════════════════════════════
+
+inline int64_t floor_to(int64_t t, int64_t step) {
+    int64_t q = t / step;
+    if (t % step != 0 && t < 0) --q;
+    return q * step;
+}
+
+inline int64_t ceil_to(int64_t t, int64_t step) {
+    int64_t f = floor_to(t, step);
+    return f == t ? t : f + step;
+}
+
+/**
+ * 一个指标在一个 tier 上的段序列 (按创建先后)。rollup 序列另持有内存中的当前桶。
+ */
+class Series {
+public:
+    Series(std::string dir, std::string prefix, StoreTier tier, size_t segment_bytes)
+        : dir_(std::move(dir)), prefix_(std::move(prefix)), tier_(tier), segment_bytes_(segment_bytes) {}
+
+    /**
+     * 载入目录中属于本序列的段 (names 为目录项文件名)。损坏的段跳过并保留文件。
+     */
+    void load(const std::vector<std::string>& names) {
+        std::vector<uint64_t> seqs;
+        for (const auto& n : names) {
+            if (n.size() <= prefix_.size() + 4 || n.compare(0, prefix_.size(), prefix_) != 0
+                || n.compare(n.size() - 4, 4, ".seg") != 0) {
+                continue;
+            }
+            char* end = nullptr;
+            uint64_t seq = std::strtoull(n.c_str() + prefix_.size(), &end, 10);
+            if (end != n.c_str() + n.size() - 4) continue;
+            seqs.push_back(seq);
+            next_seq_ = std::max(next_seq_, seq + 1);
+        }
+        std::sort(seqs.begin(), seqs.end());
+        for (uint64_t seq : seqs) {
+            auto seg = Segment::load(path(seq));
+            if (!seg) {
+                EDGESTELLE_LOG_ERR("⚠️  跳过时序段: %s", seg.error().to_string().c_str());
+                continue;
+            }
+            // 中间的活动段 (上次封存前崩溃) 不再续写
+            if (!segments_.empty()) segments_.back().seal();
+            segments_.push_back(std::move(seg).value());
+        }
+    }
+
+    Result<void> append(int64_t t, const double* cols) {
+        if (!segments_.empty() && segments_.back().append(t, cols)) return {};
+        if (!segments_.empty()) segments_.back().seal();
+        int64_t scale = tier_.interval_ms == 0 ? codec::decimal_scale(cols[0]) : 0;
+        auto seg = Segment::create(path(next_seq_), tier_.interval_ms, scale, segment_bytes_);
+        if (!seg) return seg.error();
+        ++next_seq_;
+        segments_.push_back(std::move(seg).value());
+        segments_.back().append(t, cols);
+        expire();
+        return {};
+    }
+
+    /**
+     * rollup 序列：计入一个原始点，进入新桶时写出上一个桶。
+     */
+    Result<void> accumulate(int64_t t, double v) {
+        int64_t start = floor_to(t, tier_.interval_ms);
+        if (bucket_.count > 0 && start != bucket_start_) {
+            double cols[4] = {bucket_.min, bucket_.max, bucket_.sum, static_cast<double>(bucket_.count)};
+            bucket_ = Aggregate{};
+            if (auto r = append(bucket_start_, cols); !r) return r;
+        }
+        bucket_start_ = start;
+        bucket_.add(v);
+        return {};
+    }
+
+    /**
+     * rollup 序列重启后应从哪个时刻起用原始点补齐当前桶。
+     */
+    int64_t resume_from() const {
+        int64_t t = std::numeric_limits<int64_t>::min();
+        for (const auto& s : segments_) {
+            if (!s.empty()) t = std::max(t, s.max_t() + tier_.interval_ms);
+        }
+        return t;
+    }
+
+    /**
+     * 区间 [from, to) 内的点依次交给 f(t, cols)。
+     */
+    template <class F>
+    void scan(int64_t from, int64_t to, F&& f) const {
+        for (const auto& s : segments_) {
+            if (s.empty() || s.max_t() < from || s.min_t() >= to) continue;
+            s.scan([&](int64_t t, const double* cols) {
+                if (t >= from && t < to) f(t, cols);
+            });
+        }
+    }
+
+    /**
+     * [from, to) 的聚合；rollup 桶与区间相交即整桶计入。
+     */
+    void aggregate(int64_t from, int64_t to, Aggregate& agg) const {
+        bool raw = tier_.interval_ms == 0;
+        if (!raw) from -= tier_.interval_ms - 1;
+        for (const auto& s : segments_) {
+            if (s.empty() || s.max_t() < from || s.min_t() >= to) continue;
+            if (s.min_t() >= from && s.max_t() < to) {
+                agg.merge(s.summary());
+                continue;
+            }
+            s.scan([&](int64_t t, const double* cols) {
+                if (t < from || t >= to) return;
+                if (raw) agg.add(cols[0]);
+                else     agg.merge(Aggregate{static_cast<uint64_t>(cols[3]), cols[0], cols[1], cols[2]});
+            });
+        }
+    }
+
+    /**
+     * 最早的点 (无数据时为 int64 最大值)。
+     */
+    int64_t oldest() const {
+        int64_t t = std::numeric_limits<int64_t>::max();
+        for (const auto& s : segments_) {
+            if (!s.empty()) t = std::min(t, s.min_t());
+        }
+        return t;
+    }
+
+    const StoreTier&            tier()     const { return tier_; }
+    const std::vector<Segment>& segments() const { return segments_; }
+
+    void sync_async() const {
+        if (!segments_.empty()) segments_.back().sync_async();
+    }
+
+private:
+    std::string path(uint64_t seq) const {
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), "%010llu.seg", static_cast<unsigned long long>(seq));
+        return dir_ + "/" + prefix_ + buf;
+    }
+
+    /**
+     * 删除整段早于 (最新时间 - retention) 的封存段。
+     */
+    void expire() {
+        if (tier_.retention_ms <= 0) return;
+        int64_t newest = std::numeric_limits<int64_t>::min();
+        for (const auto& s : segments_) {
+            if (!s.empty()) newest = std::max(newest, s.max_t());
+        }
+        size_t keep = 0;
+        while (keep + 1 < segments_.size() && segments_[keep].max_t() < newest - tier_.retention_ms) ++keep;
+        if (keep == 0) return;
+        for (size_t i = 0; i < keep; ++i) segments_[i].remove();
+        segments_.erase(segments_.begin(), segments_.begin() + static_cast<std::ptrdiff_t>(keep));
+    }
+
+    std::string          dir_;
+    std::string          prefix_;   // <指标键>.<tier>.
+    StoreTier            tier_;
+    size_t               segment_bytes_;
+    std::vector<Segment> segments_;
+    uint64_t             next_seq_ = 0;
+    Aggregate            bucket_;
+    int64_t              bucket_start_ = 0;
+};
+
+/**
+ * 文件名中的指标键：非 [A-Za-z0-9_-] 替换为 '_'，附名称的 FNV-1a 以免规整后重名。
+ */
+inline std::string series_key(const std::string& name) {
+    std::string key;
+    uint32_t    h = 2166136261u;
+    for (char c : name) {
+        bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        key += safe ? c : '_';
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "-%08x", h);
+    return key.substr(0, 64) + buf;
+}
+
+/**
+ * 取 URL 查询串中 name 参数的值 (百分号解码)，不存在时返回 false。
+ */
+inline bool query_param(std::string_view query, std::string_view name, std::string& out) {
+    while (!query.empty()) {
+        std::string_view pair = query.substr(0, query.find('&'));
+        query.remove_prefix(std::min(query.size(), pair.size() + 1));
+        size_t eq = pair.find('=');
+        if (pair.substr(0, eq) != name) continue;
+        out.clear();
+        std::string_view v = eq == std::string_view::npos ? std::string_view{} : pair.substr(eq + 1);
+        for (size_t i = 0; i < v.size(); ++i) {
+            if (v[i] == '+') {
+                out += ' ';
+            } else if (v[i] == '%' && i + 2 < v.size()) {
+                char hex[3] = {v[i + 1], v[i + 2], 0};
+                out += static_cast<char>(std::strtol(hex, nullptr, 16));
+                i += 2;
+            } else {
+                out += v[i];
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+} // namespace detail
+
+// ═════════════════════════════════════════════════════
+//  时序库
+// ═════════════════════════════════════════════════════
+
+class TimeSeriesStore {
+public:
+    /**
+     * 在 dir (不存在时创建一级目录) 中打开模板各指标的序列。tiers[0] 须为原始点，
+     * 其后 rollup 桶宽递增。
+     */
+    static Result<TimeSeriesStore> open(const std::string& dir, const TemplatePtr& tmpl,
+                                        std::vector<StoreTier> tiers, size_t segment_bytes) {
+        if (tiers.empty() || tiers[0].interval_ms != 0) {
+            return Error{Errc::sim_config, "时序库的第一个 tier 须为原始点 (interval_ms = 0)"};
+        }
+        for (size_t k = 1; k < tiers.size(); ++k) {
+            if (tiers[k].interval_ms <= tiers[k - 1].interval_ms) {
+                return Error{Errc::sim_config, "时序库 rollup 的 interval_ms 须递增"};
+            }
+        }
+        if (segment_bytes < 256) return Error{Errc::sim_config, "时序库段长度至少 256 字节"};
+        if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            return Error{Errc::storage_io, "mkdir " + dir + ": " + std::strerror(errno)};
+        }
+
+        std::vector<std::string> names;
+        DIR* d = ::opendir(dir.c_str());
+        if (!d) return Error{Errc::storage_io, "opendir " + dir + ": " + std::strerror(errno)};
+        while (dirent* e = ::readdir(d)) names.emplace_back(e->d_name);
+        ::closedir(d);
+
+        TimeSeriesStore store;
+        store.tmpl_  = tmpl;
+        store.tiers_ = std::move(tiers);
+        size_t nt = store.tiers_.size();
+        store.series_.reserve(tmpl->metrics.size() * nt);
+        for (const auto& m : tmpl->metrics) {
+            std::string key = detail::series_key(m.name) + ".";
+            for (const auto& tier : store.tiers_) {
+                std::string label = tier.interval_ms == 0 ? "raw" : std::to_string(tier.interval_ms) + "ms";
+                store.series_.emplace_back(dir, key + label + ".", tier, segment_bytes);
+                store.series_.back().load(names);
+            }
+        }
+
+        // 用原始点补齐各 rollup 在上次退出时尚未写出的桶
+        for (size_t m = 0; m < tmpl->metrics.size(); ++m) {
+            const detail::Series& raw = store.series_[m * nt];
+            for (size_t k = 1; k < nt; ++k) {
+                detail::Series& s = store.series_[m * nt + k];
+                Result<void> fed;
+                raw.scan(s.resume_from(), std::numeric_limits<int64_t>::max(), [&](int64_t t, const double* v) {
+                    if (fed) fed = s.accumulate(t, v[0]);
+                });
+                if (!fed) return fed.error();
+            }
+        }
+        return store;
+    }
+
+    TimeSeriesStore() = default;
+    TimeSeriesStore(TimeSeriesStore&&) noexcept            = default;
+    TimeSeriesStore& operator=(TimeSeriesStore&&) noexcept = default;
+
+    /**
+     * 写入一份报告的各指标结果 (非有限值跳过)，时间取 now。
+     */
+    Result<void> append(Clock::time_point now, const Report& report) {
+        int64_t t = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        for (const auto& r : report.results) {
+            if (auto ok = append(r.metric, t, r.value); !ok) return ok;
+        }
+        return {};
+    }
+
+    Result<void> append(uint32_t metric, int64_t t_ms, double value) {
+        if (!std::isfinite(value)) return {};
+        size_t nt = tiers_.size();
+        if (auto r = series_[metric * nt].append(t_ms, &value); !r) return r;
+        for (size_t k = 1; k < nt; ++k) {
+            if (auto r = series_[metric * nt + k].accumulate(t_ms, value); !r) return r;
+        }
+        return {};
+    }
+
+    /**
+     * 指标下标，不存在时返回 -1。
+     */
+    int find(std::string_view name) const {
+        const auto& metrics = tmpl_->metrics;
+        for (size_t i = 0; i < metrics.size(); ++i) {
+            if (metrics[i].name == name) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    /**
+     * [from, to) 内的原始点，至多 limit 个，追加到 out。
+     */
+    size_t range(uint32_t metric, int64_t from, int64_t to, std::vector<SeriesPoint>& out,
+                 size_t limit = std::numeric_limits<size_t>::max()) const {
+        size_t n = 0;
+        series_[metric * tiers_.size()].scan(from, to, [&](int64_t t, const double* v) {
+            if (n < limit) {
+                out.push_back(SeriesPoint{t, v[0]});
+                ++n;
+            }
+        });
+        return n;
+    }
+
+    /**
+     * [from, to) 的聚合。原始点已过期的部分依次用更粗的 rollup 补上：每个 tier 负责
+     * 自其最早数据 (向上对齐到下一 tier 的桶边界) 起的一段，与区间相交的桶整桶计入。
+     */
+    Aggregate aggregate(uint32_t metric, int64_t from, int64_t to) const {
+        constexpr int64_t kNone = std::numeric_limits<int64_t>::max();
+        Aggregate agg;
+        size_t    nt  = tiers_.size();
+        int64_t   end = to;
+        for (size_t k = 0; k < nt && from < end; ++k) {
+            const detail::Series& s = series_[metric * nt + k];
+            int64_t oldest = s.oldest();
+            if (oldest == kNone) continue;
+            // 更粗的 tier 都还没有数据时由本 tier 负责到 from
+            bool coarser = false;
+            for (size_t j = k + 1; j < nt && !coarser; ++j) coarser = series_[metric * nt + j].oldest() != kNone;
+            int64_t cut = coarser ? detail::ceil_to(oldest, tiers_[k + 1].interval_ms)
+                                  : std::numeric_limits<int64_t>::min();
+            s.aggregate(std::max(from, cut), end, agg);
+            end = cut;
+        }
+        return agg;
+    }
+
+    /**
+     * 按 step (毫秒) 对 [from, to) 分桶，非空桶追加到 out。数据取 interval 不大于 step
+     * 且最早数据不晚于 from 的最细 tier (都不覆盖时取其中最粗的)。
+     *
+     * @return 所用 tier 的 interval_ms (0 为原始点)
+     */
+    int64_t downsample(uint32_t metric, int64_t from, int64_t to, int64_t step,
+                       std::vector<SeriesBucket>& out) const {
+        size_t nt   = tiers_.size();
+        size_t pick = 0;
+        for (size_t k = 0; k < nt && tiers_[k].interval_ms <= step; ++k) {
+            pick = k;
+            if (series_[metric * nt + k].oldest() <= from) break;
+        }
+        const detail::Series& s = series_[metric * nt + pick];
+        size_t first = out.size();
+        int64_t base = detail::floor_to(from, step);
+        size_t  n    = static_cast<size_t>((to - base + step - 1) / step);
+        out.resize(first + n);
+        for (size_t i = 0; i < n; ++i) out[first + i].t_ms = base + static_cast<int64_t>(i) * step;
+        bool raw = pick == 0;
+        s.scan(from, to, [&](int64_t t, const double* cols) {
+            Aggregate& a = out[first + static_cast<size_t>((t - base) / step)].agg;
+            if (raw) a.add(cols[0]);
+            else     a.merge(Aggregate{static_cast<uint64_t>(cols[3]), cols[0], cols[1], cols[2]});
+        });
+        out.erase(std::remove_if(out.begin() + static_cast<std::ptrdiff_t>(first), out.end(),
+                                 [](const SeriesBucket& b) { return b.agg.count == 0; }),
+                  out.end());
+        return tiers_[pick].interval_ms;
+    }
+
+    /**
+     * 按 URL 查询串回答查询，结果 (JSON) 写入 out:
+     *   metric=<名称>  必填
+     *   to=<ms>        默认为最新原始点之后
+     *   from=<ms>      默认为 to 前一小时；为负时表示相对 to 的偏移
+     *   step=<ms>      给出时返回 buckets [[t, count, min, max, mean], …]，否则返回
+     *                  points [[t, value], …] (至多 limit 个，默认 10000)
+     */
+    Result<void> query(std::string_view params, std::string& out) const {
+        constexpr size_t kMaxBuckets = 100000;
+        std::string arg;
+        if (!detail::query_param(params, "metric", arg)) return Error{Errc::sim_config, "缺少 metric 参数"};
+        int metric = find(arg);
+        if (metric < 0) return Error{Errc::sim_config, "未知指标: " + arg};
+        auto m = static_cast<uint32_t>(metric);
+
+        const detail::Series& raw = series_[m * tiers_.size()];
+        int64_t newest = std::numeric_limits<int64_t>::min();
+        for (const auto& s : raw.segments()) {
+            if (!s.empty()) newest = std::max(newest, s.max_t());
+        }
+        int64_t to = newest == std::numeric_limits<int64_t>::min() ? 0 : newest + 1;
+        int64_t from, step = 0;
+        size_t  limit = 10000;
+        if (detail::query_param(params, "to", arg))    to = std::strtoll(arg.c_str(), nullptr, 10);
+        from = to - 3600 * 1000;
+        if (detail::query_param(params, "from", arg)) {
+            from = std::strtoll(arg.c_str(), nullptr, 10);
+            if (from < 0) from += to;
+        }
+        if (detail::query_param(params, "step", arg))  step  = std::strtoll(arg.c_str(), nullptr, 10);
+        if (detail::query_param(params, "limit", arg)) limit = std::strtoull(arg.c_str(), nullptr, 10);
+        if (from >= to) return Error{Errc::sim_config, "from 须小于 to"};
+        if (step < 0 || (step > 0 && static_cast<uint64_t>((to - from) / step) >= kMaxBuckets)) {
+            return Error{Errc::sim_config, "step 非法或分桶过多"};
+        }
+
+        out.clear();
+        JsonWriter w(out);
+        w.begin_object();
+        w.key("metric"); w.value(tmpl_->metrics[m].name);
+        w.key("from");   w.value(from);
+        w.key("to");     w.value(to);
+        w.key("aggregate");
+        write_aggregate(w, aggregate(m, from, to));
+        if (step > 0) {
+            std::vector<SeriesBucket> buckets;
+            int64_t resolution = downsample(m, from, to, step, buckets);
+            w.key("step");       w.value(step);
+            w.key("resolution"); w.value(resolution);
+            w.key("buckets");
+            w.begin_array();
+            for (const auto& b : buckets) {
+                w.begin_array();
+                w.value(b.t_ms);
+                w.value(static_cast<int64_t>(b.agg.count));
+                w.value(b.agg.min);
+                w.value(b.agg.max);
+                w.value(b.agg.mean());
+                w.end_array();
+            }
+            w.end_array();
+        } else {
+            std::vector<SeriesPoint> points;
+            range(m, from, to, points, limit);
+            w.key("points");
+            w.begin_array();
+            for (const auto& p : points) {
+                w.begin_array();
+                w.value(p.t_ms);
+                w.value(p.value);
+                w.end_array();
+            }
+            w.end_array();
+        }
+        w.end_object();
+        return {};
+    }
+
+    /**
+     * 异步回写各序列的活动段。
+     */
+    void sync_async() const {
+        for (const auto& s : series_) s.sync_async();
+    }
+
+    size_t segments() const {
+        size_t n = 0;
+        for (const auto& s : series_) n += s.segments().size();
+        return n;
+    }
+
+    /**
+     * 已写入的压缩字节数 (不含段头与未用空间)。
+     */
+    size_t stored_bytes() const {
+        size_t n = 0;
+        for (const auto& s : series_) {
+            for (const auto& seg : s.segments()) n += seg.bytes();
+        }
+        return n;
+    }
+
+    const std::vector<StoreTier>& tiers() const { return tiers_; }
+
+private:
+    static void write_aggregate(JsonWriter& w, const Aggregate& a) {
+        w.begin_object();
+        w.key("count"); w.value(static_cast<int64_t>(a.count));
+        w.key("min");   w.value(a.count ? a.min : std::numeric_limits<double>::quiet_NaN());
+        w.key("max");   w.value(a.count ? a.max : std::numeric_limits<double>::quiet_NaN());
+        w.key("sum");   w.value(a.sum);
+        w.key("mean");  w.value(a.mean());
+        w.end_object();
+    }
+
+    TemplatePtr                  tmpl_;
+    std::vector<StoreTier>       tiers_;
+    std::vector<detail::Series>  series_;   // [指标 × tier]
+};
+
+// ═════════════════════════════════════════════════════
+//  写入交接
+// ═════════════════════════════════════════════════════
+
+struct StorePoint {
+    uint32_t metric = 0;
+    int64_t  t_ms   = 0;
+    double   value  = 0.0;
+};
+
+/**
+ * 单生产者 (实时采样线程) / 单消费者 (写入线程) 的定长点缓冲。采样线程只入队、
+ * 从不等待时序库的锁，查询再久也不会拖住它；空间不足时整份报告丢弃并计数。
+ */
+class StoreFeed {
+public:
+    /**
+     * @param capacity  点数，向上取整为 2 的幂
+     */
+    explicit StoreFeed(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        buf_.resize(n);
+        mask_ = n - 1;
+    }
+
+    size_t capacity() const { return buf_.size(); }
+
+    /**
+     * 写入一份报告的有限值结果，时间取 now；放不下时整份丢弃。
+     *
+     * @return 是否写入
+     */
+    bool push(Clock::time_point now, const Report& report) {
+        int64_t t = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        size_t room = buf_.size() - static_cast<size_t>(head - tail);
+        size_t n = 0;
+        for (const auto& r : report.results) n += std::isfinite(r.value) ? 1 : 0;
+        if (n > room) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        for (const auto& r : report.results) {
+            if (std::isfinite(r.value)) buf_[head++ & mask_] = StorePoint{r.metric, t, r.value};
+        }
+        head_.store(head, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * 取出当前全部点，依次调用 f(const StorePoint&)。
+     *
+     * @return 取出的点数
+     */
+    template <class F>
+    size_t drain(F&& f) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i < head; ++i) f(static_cast<const StorePoint&>(buf_[i & mask_]));
+        tail_.store(head, std::memory_order_release);
+        return static_cast<size_t>(head - tail);
+    }
+
+    /**
+     * 因缓冲满被丢弃的报告数。
+     */
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<StorePoint> buf_;
+    size_t                  mask_ = 0;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    std::atomic<uint64_t>   dropped_{0};
+};
+
+} // namespace edgestelle
+
+#endif // EDGESTELLE_TSDB_HPP
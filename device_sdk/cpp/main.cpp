@@ -7,17 +7,227 @@
  *
  * 运行:
  *   ./edgestelle_device <template_id> [device_id] [api_url] [mqtt_uri]
+ *
+ * 连续运行 (设置 LOOP_CYCLES，-1 表示直到 Ctrl-C):
+ *   LOOP_CYCLES=-1 SAMPLE_INTERVAL_MS=1000 CPU_BUDGET_PCT=2 ./edgestelle_device <template_id>
+ *
+ * 轨迹导出 (退出时写出，运行中 kill -USR2 <pid> 可随时导出):
+ *   EDGESTELLE_TRACE=/tmp/sdk_trace.json ./edgestelle_device <template_id>
+ *
+ * 舰队模拟 + 故障注入 (FLEET_SIZE 台设备共用一条 MQTT 连接，SCENARIO_FILE 可选):
+ *   FLEET_SIZE=5000 SCENARIO_FILE=storm.json FLEET_TIMELINE=/tmp/fleet.csv \
+ *       LOOP_CYCLES=600 ./edgestelle_device <template_id>
+ *
+ * 确定性快进 (固定种子 + 虚拟时钟，一天的舰队数据数秒生成，多次运行逐字节一致):
+ *   FLEET_SIZE=1000 LOOP_CYCLES=86400 SIM_SEED=7 VIRTUAL_CLOCK=1700000000 \
+ *       FLEET_CAPTURE=/tmp/day.log ./edgestelle_device <template_id>
+ *
+ * 多 broker (逗号分隔；设备按 id 一致性哈希分片，断开的 broker 上的设备自动改投):
+ *   mosquitto -p 1883 -d; mosquitto -p 1884 -d; mosquitto -p 1885 -d
+ *   MQTT_BROKER_URI=tcp://localhost:1883,tcp://localhost:1884,tcp://localhost:1885 \
+ *       FLEET_SIZE=3000 FLEET_SHARD_TIMELINE=/tmp/shards.csv LOOP_CYCLES=300 ./edgestelle_device <template_id>
+ *   运行中停掉其中一个 mosquitto，shards.csv 中其设备数转移到其余分片，重启后迁回。
+ *
+ * 按核分区 (每个分区一个线程、绑定一个 CPU，0 表示每个可用 CPU 一个；FLEET_CPUS 可选):
+ *   FLEET_SIZE=200000 FLEET_PARTITIONS=0 FLEET_CPUS=0,2,4,6 LOOP_CYCLES=600 ./edgestelle_device <template_id>
+ *
+ * 分布式压测 (协调端分配设备区间与速率、同步开始并合并结果；FLEET_SPAWN 在本机拉起 worker):
+ *   FLEET_LISTEN=0.0.0.0:7070 FLEET_SPAWN=4 FLEET_SIZE=400000 FLEET_RATE=400000 \
+ *       LOOP_CYCLES=300 ./edgestelle_device <template_id>
+ *   其他主机上的 worker (FLEET_WORKERS 为协调端等待的 worker 总数，含本机拉起的):
+ *   FLEET_COORDINATOR=coordinator-host:7070 FLEET_PARTITIONS=0 ./edgestelle_device <template_id>
+ *
+ * Prometheus 抓取 (连续运行时在 9464 端口提供 /metrics):
+ *   LOOP_CYCLES=-1 METRICS_PORT=9464 ./edgestelle_device <template_id>
+ *   curl -s localhost:9464/metrics
+ *
+ * 飞行记录器 (逐周期记录最近 600 个周期，越界时压缩上传到 <topic>/flight):
+ *   LOOP_CYCLES=-1 SAMPLE_INTERVAL_MS=100 FLIGHT_RECORDER_SAMPLES=600 \
+ *       FLIGHT_RECORDER_PATH=/var/lib/edgestelle/flight.ring ./edgestelle_device <template_id>
+ *
+ * 本地时序库 (断网时也能查询历史；开启指标端点时可经 /query 查询):
+ *   LOOP_CYCLES=-1 METRICS_PORT=9464 STORE_DIR=/var/lib/edgestelle/tsdb ./edgestelle_device <template_id>
+ *   curl -s 'localhost:9464/query?metric=cpu_usage&from=-3600000&step=60000'
+ *
+ * 实时采样 (SCHED_FIFO 优先级 50、绑定 CPU 3、锁定内存；需 CAP_SYS_NICE 与 CAP_IPC_LOCK，
+ * 唤醒延迟分布见 /metrics 的 edgestelle_sdk_wake_latency_seconds):
+ *   LOOP_CYCLES=-1 SAMPLE_INTERVAL_MS=10 RT_PRIORITY=50 RT_CPUS=3 RT_MLOCK=1 METRICS_PORT=9464 \
+ *       ./edgestelle_device <template_id>
+ *
+ * 嵌入式精简构建 (静态链接、-Os、无异常、无 json DOM):
+ *   cmake -S . -B build-embedded -DEDGESTELLE_PROFILE=embedded
  */
 
 #include "edgestelle_device.hpp"
-#include <iostream>
+#ifndef EDGESTELLE_MINIMAL
+#include "edgestelle_cluster.hpp"
+#endif
+#include <cerrno>
+#include <cstdio>
 #include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static edgestelle::EdgeStelleDevice* g_device = nullptr;
+#ifndef EDGESTELLE_MINIMAL
+static edgestelle::FleetSimulator*   g_fleet  = nullptr;
+static edgestelle::FleetCoordinator* g_coordinator = nullptr;
+static edgestelle::FleetWorker*      g_worker = nullptr;
+#endif
+
+static void on_signal(int) {
+    if (g_device) g_device->stop();
+#ifndef EDGESTELLE_MINIMAL
+    if (g_fleet)  g_fleet->stop();
+    if (g_coordinator) g_coordinator->stop();
+    if (g_worker) g_worker->stop();
+#endif
+}
+
+#ifndef EDGESTELLE_MINIMAL
+/**
+ * 分布式压测的协调端：只分配与汇总，设备由 worker 模拟。
+ */
+static int run_coordinator(const edgestelle::FleetConfig& fleet, const std::string& template_id,
+                           const std::vector<std::string>& args, const char* listen) {
+    edgestelle::CoordinatorConfig cc;
+    cc.listen  = listen;
+    cc.devices = fleet.devices;
+    cc.tick_ms = fleet.tick_ms;
+    cc.seed    = fleet.seed;
+    size_t spawn = 0;
+    if (const char* env = std::getenv("FLEET_SPAWN"))   spawn       = static_cast<size_t>(std::atol(env));
+    cc.workers = spawn > 0 ? spawn : 1;
+    if (const char* env = std::getenv("FLEET_WORKERS")) cc.workers  = static_cast<size_t>(std::atol(env));
+    if (const char* env = std::getenv("FLEET_RATE"))    cc.rate     = std::atof(env);
+
+    edgestelle::FleetCoordinator coordinator(cc);
+    auto ready = coordinator.listen();
+    if (ready && spawn > 0) ready = coordinator.spawn(args, spawn, {"FLEET_LISTEN", "FLEET_SPAWN", "FLEET_WORKERS"});
+    if (!ready) {
+        std::fprintf(stderr, "❌ 错误: %s\n", ready.error().to_string().c_str());
+        return 1;
+    }
+    const char* cycles = std::getenv("LOOP_CYCLES");
+    g_coordinator = &coordinator;
+    std::signal(SIGINT,  on_signal);
+    std::signal(SIGTERM, on_signal);
+    auto report = coordinator.run(template_id, cycles ? std::atoi(cycles) : -1);
+    g_coordinator = nullptr;
+    if (!report) {
+        std::fprintf(stderr, "❌ 错误: %s\n", report.error().to_string().c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int run_fleet(const edgestelle::DeviceConfig& cfg, const std::string& template_id,
+                     const std::vector<std::string>& args, edgestelle::Clock* clock) {
+    // 分布式压测的 worker：设备区间、速率、种子与周期数由协调端下发
+    const char* coordinator = std::getenv("FLEET_COORDINATOR");
+    edgestelle::FleetConfig fleet;
+    if (const char* env = std::getenv("FLEET_SIZE")) fleet.devices = static_cast<size_t>(std::atol(env));
+    if (cfg.sample_interval_ms > 0) fleet.tick_ms = cfg.sample_interval_ms;
+    if (const char* env = std::getenv("FLEET_MAX_IN_FLIGHT")) fleet.max_in_flight = std::atoi(env);
+    if (const char* env = std::getenv("FLEET_ID_PREFIX"))     fleet.id_prefix     = env;
+    if (const char* env = std::getenv("FLEET_PARTITIONS"))
+        fleet.partitions = static_cast<size_t>(std::atol(env));
+    if (const char* env = std::getenv("FLEET_CPUS")) {
+        for (const char* p = env; *p;) {
+            char* end = nullptr;
+            long cpu = std::strtol(p, &end, 10);
+            if (end == p) break;
+            fleet.cpus.push_back(static_cast<int>(cpu));
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    std::optional<edgestelle::Scenario> scenario;
+    if (const char* path = std::getenv("SCENARIO_FILE")) {
+        std::FILE* f = std::fopen(path, "rb");
+        if (!f) {
+            std::fprintf(stderr, "❌ 无法打开场景文件 %s: %s\n", path, std::strerror(errno));
+            return 1;
+        }
+        std::string text;
+        char buf[4096];
+        for (size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0;) text.append(buf, n);
+        std::fclose(f);
+        auto parsed = edgestelle::parse_scenario(text);
+        if (!parsed) {
+            std::fprintf(stderr, "❌ 错误: %s\n", parsed.error().to_string().c_str());
+            return 1;
+        }
+        scenario = std::move(parsed).value();
+        fleet.seed = scenario->seed;
+    }
+    if (cfg.seed != 0) fleet.seed = cfg.seed;
+
+    if (const char* listen = std::getenv("FLEET_LISTEN"); listen && !coordinator) {
+        return run_coordinator(fleet, template_id, args, listen);
+    }
+
+    // 同一主机上的多个 worker 各写一份，文件名追加 ".<pid>"。打开失败即退出：
+    // 例如 FLEET_CAPTURE 打不开时若继续运行，会悄然变成真实发布
+    auto open_output = [&](const char* env, const char* mode, std::FILE*& out) {
+        const char* path = std::getenv(env);
+        if (!path) return true;
+        std::string name = path;
+        if (coordinator) name += "." + std::to_string(getpid());
+        out = std::fopen(name.c_str(), mode);
+        if (!out) std::fprintf(stderr, "❌ 无法打开 %s=%s: %s\n", env, name.c_str(), std::strerror(errno));
+        return out != nullptr;
+    };
+    std::FILE* timeline = nullptr;
+    std::FILE* capture  = nullptr;
+    std::FILE* shards   = nullptr;
+    auto close_outputs = [&] {
+        for (std::FILE* f : {timeline, capture, shards}) {
+            if (f) std::fclose(f);
+        }
+    };
+    if (!open_output("FLEET_TIMELINE", "w", timeline) || !open_output("FLEET_CAPTURE", "wb", capture) ||
+        !open_output("FLEET_SHARD_TIMELINE", "w", shards)) {
+        close_outputs();
+        return 1;
+    }
+
+    std::signal(SIGINT,  on_signal);
+    std::signal(SIGTERM, on_signal);
+    edgestelle::Result<void> done;
+    if (coordinator) {
+        edgestelle::FleetWorker worker(cfg, fleet, std::move(scenario));
+        if (clock) worker.set_clock(*clock);
+        worker.set_capture(capture);
+        worker.set_shard_timeline(shards);
+        g_worker = &worker;
+        auto report = worker.run(coordinator, timeline);
+        g_worker = nullptr;
+        if (!report) done = report.error();
+    } else {
+        const char* cycles = std::getenv("LOOP_CYCLES");
+        edgestelle::FleetSimulator sim(cfg, fleet, std::move(scenario));
+        if (clock) sim.set_clock(*clock);
+        sim.set_capture(capture);
+        sim.set_shard_timeline(shards);
+        g_fleet = &sim;
+        done = sim.run(template_id, cycles ? std::atoi(cycles) : -1, timeline);
+        g_fleet = nullptr;
+    }
+    close_outputs();
+    if (!done) {
+        std::fprintf(stderr, "❌ 错误: %s\n", done.error().to_string().c_str());
+        return 1;
+    }
+    return 0;
+}
+#endif
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        std::cerr << "用法: " << argv[0]
-                  << " <template_id> [device_id] [api_url] [mqtt_uri]"
-                  << std::endl;
+        std::fprintf(stderr, "用法: %s <template_id> [device_id] [api_url] [mqtt_uri]\n", argv[0]);
         return 1;
     }
 
@@ -32,16 +242,110 @@ int main(int argc, char* argv[]) {
     if (const char* env = std::getenv("DEVICE_ID"))        cfg.device_id       = env;
     if (const char* env = std::getenv("API_BASE_URL"))     cfg.api_base_url    = env;
     if (const char* env = std::getenv("MQTT_BROKER_URI"))  cfg.mqtt_broker_uri = env;
+    // 单条报告消息上限 (字节)，超出即分块发布；0 不分块
+    if (const char* env = std::getenv("MQTT_MAX_MESSAGE_BYTES"))
+        cfg.max_message_bytes = static_cast<size_t>(std::strtoull(env, nullptr, 10));
+    // 逗号分隔的多个 broker
+    if (cfg.mqtt_broker_uri.find(',') != std::string::npos) {
+        for (size_t pos = 0; pos <= cfg.mqtt_broker_uri.size();) {
+            size_t end = cfg.mqtt_broker_uri.find(',', pos);
+            if (end == std::string::npos) end = cfg.mqtt_broker_uri.size();
+            if (end > pos) cfg.mqtt_brokers.push_back(cfg.mqtt_broker_uri.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        if (!cfg.mqtt_brokers.empty()) cfg.mqtt_broker_uri = cfg.mqtt_brokers.front();
+    }
+
+    // 发布分道：越界报告优先、QoS 1；常规报告 QoS 0。*_BPS 为令牌桶整形速率 (字节/秒)，0 不整形
+    if (const char* env = std::getenv("ALERT_LANE_BPS"))        cfg.alert_lane.bytes_per_s   = std::atof(env);
+    if (const char* env = std::getenv("ROUTINE_LANE_BPS"))      cfg.routine_lane.bytes_per_s = std::atof(env);
+    if (const char* env = std::getenv("ROUTINE_LANE_QOS"))      cfg.routine_lane.qos         = std::atoi(env);
+
+    // TLS (https:// 模板拉取 + ssl:// broker)
+    if (const char* env = std::getenv("TLS_CA_FILE"))           cfg.tls.ca_file            = env;
+    if (const char* env = std::getenv("TLS_CERT_FILE"))         cfg.tls.cert_file          = env;
+    if (const char* env = std::getenv("TLS_KEY_FILE"))          cfg.tls.key_file           = env;
+    if (const char* env = std::getenv("TLS_SESSION_CACHE"))     cfg.tls.session_cache_path = env;
+    if (const char* env = std::getenv("TLS_INSECURE"))          cfg.tls.verify_peer = std::string(env) != "1";
+
+    // 连续运行与自身开销预算
+    if (const char* env = std::getenv("SAMPLE_INTERVAL_MS"))    cfg.sample_interval_ms = std::atoi(env);
+    if (const char* env = std::getenv("BATCH_SIZE"))            cfg.batch_size         = std::atoi(env);
+    if (const char* env = std::getenv("CPU_BUDGET_PCT"))        cfg.budget.cpu_fraction = std::atof(env) / 100.0;
+    if (const char* env = std::getenv("RSS_BUDGET_MB"))
+        cfg.budget.rss_limit_bytes = static_cast<size_t>(std::atof(env) * 1024 * 1024);
+
+    // 飞行记录器：保留最近 N 个周期，越界时随告警上传；PATH 非空时映射到该文件，崩溃重启后沿用
+    if (const char* env = std::getenv("FLIGHT_RECORDER_SAMPLES")) cfg.flight_recorder_samples = std::atoi(env);
+    if (const char* env = std::getenv("FLIGHT_RECORDER_PATH"))    cfg.flight_recorder_path    = env;
+
+    // 本地时序库：STORE_DIR 非空时启用；STORE_RETENTION_H 为原始点保留小时数
+    if (const char* env = std::getenv("STORE_DIR"))             cfg.store_dir = env;
+    if (const char* env = std::getenv("STORE_RETENTION_H"))
+        cfg.store_tiers[0].retention_ms = static_cast<int64_t>(std::atof(env) * 3600 * 1000);
+
+    // 实时采样线程：RT_PRIORITY 为 SCHED_FIFO 优先级，RT_CPUS 为绑定的 CPU 列表，RT_MLOCK=1 锁定内存
+    if (const char* env = std::getenv("RT_PRIORITY"))           cfg.realtime.priority    = std::atoi(env);
+    if (const char* env = std::getenv("RT_MLOCK"))              cfg.realtime.lock_memory = std::atoi(env) != 0;
+    if (const char* env = std::getenv("RT_CPUS")) {
+        for (const char* p = env; *p;) {
+            char* end = nullptr;
+            long cpu = std::strtol(p, &end, 10);
+            if (end == p) break;
+            cfg.realtime.cpus.push_back(static_cast<int>(cpu));
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    // Prometheus 指标端点：METRICS_PORT 非 0 时在 METRICS_BIND (默认 0.0.0.0) 上提供 /metrics
+    if (const char* env = std::getenv("METRICS_PORT"))          cfg.metrics_port = std::atoi(env);
+    if (const char* env = std::getenv("METRICS_BIND"))          cfg.metrics_bind = env;
+
+    // 可复现运行：固定种子；VIRTUAL_CLOCK=<Unix 秒> 从该时刻起快进，不实际休眠
+    if (const char* env = std::getenv("SIM_SEED"))              cfg.seed = std::strtoull(env, nullptr, 10);
+    std::optional<edgestelle::VirtualClock> vclock;
+    if (const char* env = std::getenv("VIRTUAL_CLOCK"))         vclock.emplace(std::atoll(env));
+
+    auto& tracer = edgestelle::trace::Tracer::instance();
+    if (const char* env = std::getenv("EDGESTELLE_TRACE")) {
+        tracer.set_thread_name("main");
+        tracer.enable(env);
+        tracer.install_signal_handler(SIGUSR2);
+    }
+
+#ifndef EDGESTELLE_MINIMAL
+    if (std::getenv("FLEET_SIZE") || std::getenv("FLEET_COORDINATOR")) {
+        int rc = run_fleet(cfg, template_id, std::vector<std::string>(argv, argv + argc), vclock ? &*vclock : nullptr);
+        if (tracer.enabled()) tracer.write();
+        return rc;
+    }
+#endif
+
+    edgestelle::EdgeStelleDevice device(cfg);
+    if (vclock) device.set_clock(*vclock);
+
+    if (const char* env = std::getenv("LOOP_CYCLES")) {
+        // 连续运行：网络错误在循环内记录并重试，不会终止进程
+        g_device = &device;
+        std::signal(SIGINT,  on_signal);
+        std::signal(SIGTERM, on_signal);
+        device.run_loop(template_id, std::atoi(env));
+        g_device = nullptr;
+        if (tracer.enabled()) tracer.write();
+        return 0;
+    }
 
-    try {
-        edgestelle::EdgeStelleDevice device(cfg);
-        auto report = device.run(template_id);
-        std::cout << "\n✅ 测试报告:\n"
-                  << report.dump(2) << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "❌ 错误: " << e.what() << std::endl;
+    auto report = device.try_run(template_id);
+    if (tracer.enabled()) tracer.write();
+    if (!report) {
+        std::fprintf(stderr, "❌ 错误: %s\n", report.error().to_string().c_str());
         return 1;
     }
+    std::string payload = device.serialize(report.value());
+#ifndef EDGESTELLE_MINIMAL
+    payload = nlohmann::json::parse(payload).dump(2);
+#endif
+    std::printf("\n✅ 测试报告:\n%s\n", payload.c_str());
 
     return 0;
 }